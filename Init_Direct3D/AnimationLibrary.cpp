@@ -0,0 +1,121 @@
+#include "AnimationLibrary.h"
+
+namespace
+{
+	template<typename T>
+	bool SameArray(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() &&
+			(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	bool SameClip(const AnimationClip& a, const AnimationClip& b)
+	{
+		if( a.BoneAnimations.size() != b.BoneAnimations.size() )
+			return false;
+
+		for(size_t i = 0; i < a.BoneAnimations.size(); ++i)
+		{
+			if( !SameArray(a.BoneAnimations[i].Keyframes, b.BoneAnimations[i].Keyframes) )
+				return false;
+		}
+
+		if( a.RootMotion.EndTime != b.RootMotion.EndTime ||
+			!SameArray(a.RootMotion.Times, b.RootMotion.Times) ||
+			!SameArray(a.RootMotion.Translation, b.RootMotion.Translation) ||
+			!SameArray(a.RootMotion.Rotation, b.RootMotion.Rotation) )
+			return false;
+
+		const std::vector<AnimationEvent>& eventsA = a.Events.Events;
+		const std::vector<AnimationEvent>& eventsB = b.Events.Events;
+		if( eventsA.size() != eventsB.size() )
+			return false;
+
+		for(size_t i = 0; i < eventsA.size(); ++i)
+		{
+			if( eventsA[i].Time != eventsB[i].Time || eventsA[i].Name != eventsB[i].Name )
+				return false;
+		}
+
+		return true;
+	}
+}
+
+bool AnimationLibrary::Share(SkinnedData& skinnedInfo)
+{
+	const std::shared_ptr<AnimationClipSet>& clips = skinnedInfo.GetClipSet();
+
+	std::weak_ptr<AnimationClipSet>& entry = mClipSets[skinnedInfo.GetSkeletonSignature()];
+	std::shared_ptr<AnimationClipSet> shared = entry.lock();
+
+	if( shared == nullptr )
+	{
+		entry = clips;
+		return true;
+	}
+
+	if( shared == clips )
+		return true;
+
+	// Check every clip before adding any, so a clash leaves both sets as
+	// they were.
+	bool clash = false;
+	for(auto& e : clips->Animations)
+	{
+		auto existing = shared->Animations.find(e.first);
+		if( existing == shared->Animations.end() || SameClip(existing->second, e.second) )
+			continue;
+
+		char text[256];
+		sprintf_s(text, "AnimationLibrary: clip %s differs from the shared clip of the same name, not sharing\n",
+			e.first.c_str());
+		OutputDebugStringA(text);
+
+		clash = true;
+	}
+
+	if( clash )
+		return false;
+
+	// Node based maps keep the clips already handed out where they are.
+	for(auto& e : clips->Animations)
+	{
+		if( shared->Animations.count(e.first) != 0 )
+			continue;
+
+		assert(clips->CompiledAnimations.count(e.first) != 0);
+		assert(clips->CompiledAnimations[e.first].BoneCount() == skinnedInfo.BoneCount());
+
+		shared->Animations[e.first] = e.second;
+		shared->CompiledAnimations[e.first] = clips->CompiledAnimations[e.first];
+	}
+
+	skinnedInfo.SetClipSet(shared);
+
+	return true;
+}
+
+UINT AnimationLibrary::ClipSetCount()const
+{
+	UINT count = 0;
+	for(auto& e : mClipSets)
+	{
+		if( !e.second.expired() )
+			++count;
+	}
+
+	return count;
+}
+
+size_t AnimationLibrary::GetByteSize()const
+{
+	size_t size = 0;
+	for(auto& e : mClipSets)
+	{
+		std::shared_ptr<AnimationClipSet> clips = e.second.lock();
+		if( clips != nullptr )
+			size += clips->GetByteSize();
+	}
+
+	return size;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SkinnedData.h"
+
+///<summary>
+/// Clip sets shared between models, keyed by skeleton signature.
+///
+/// Share() hands a model's clips to the library.  The first model with a
+/// given skeleton donates its set; later ones drop their own copy and point
+/// at the stored one, adding any clips it does not have yet.  The models
+/// own the sets through their shared_ptr and the library only keeps a weak
+/// reference, so a set is freed with the last model using it.
+///
+/// A clip that both sides have under the same name must hold the same keys,
+/// root motion and events.  If any of them differ the model keeps its own
+/// set, the conflict is reported with OutputDebugString and Share returns
+/// false, so finish editing (root motion, curve reduction) before sharing.
+/// Share before resolving clips with FindClip(), since the model's own
+/// clips are released.
+///</summary>
+class AnimationLibrary
+{
+public:
+	// Returns false if a clip name clashes with a different clip; the model
+	// then keeps its own set.
+	bool Share(SkinnedData& skinnedInfo);
+
+	// Sets still used by at least one model.
+	UINT ClipSetCount()const;
+
+	// Memory held by the live sets, each counted once however many models
+	// share it.
+	size_t GetByteSize()const;
+
+private:
+	std::unordered_map<UINT64, std::weak_ptr<AnimationClipSet>> mClipSets;
+};
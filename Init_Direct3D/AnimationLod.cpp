@@ -0,0 +1,59 @@
+#include "AnimationLod.h"
+
+using namespace DirectX;
+
+AnimationLodPolicy::AnimationLodPolicy()
+{
+	mLevels.resize(4);
+
+	mLevels[0].MaxDistance = 20.0f;
+
+	mLevels[1].MaxDistance = 40.0f;
+	mLevels[1].UpdateInterval = 2;
+
+	mLevels[2].MaxDistance = 80.0f;
+	mLevels[2].UpdateInterval = 4;
+	mLevels[2].SkipLeafBones = true;
+
+	mLevels[3].UpdateInterval = 8;
+	mLevels[3].SkipLeafBones = true;
+}
+
+AnimationLodPolicy::AnimationLodPolicy(const std::vector<Level>& levels)
+	: mLevels(levels)
+{
+	assert(!mLevels.empty());
+}
+
+UINT AnimationLodPolicy::LevelCount()const
+{
+	return (UINT)mLevels.size();
+}
+
+const AnimationLodPolicy::Level& AnimationLodPolicy::GetLevel(UINT level)const
+{
+	return mLevels[level];
+}
+
+UINT AnimationLodPolicy::SelectLevel(float distance)const
+{
+	const UINT last = (UINT)mLevels.size() - 1;
+
+	for(UINT i = 0; i < last; ++i)
+	{
+		if( distance <= mLevels[i].MaxDistance )
+			return i;
+	}
+
+	return last;
+}
+
+const AnimationLodPolicy::Level& AnimationLodPolicy::Select(const Camera& camera, const XMFLOAT3& posW)const
+{
+	XMFLOAT3 eyePosW = camera.GetPosition3f();
+
+	XMVECTOR toInstance = XMVectorSubtract(XMLoadFloat3(&posW), XMLoadFloat3(&eyePosW));
+	float distance = XMVectorGetX(XMVector3Length(toInstance));
+
+	return mLevels[SelectLevel(distance)];
+}
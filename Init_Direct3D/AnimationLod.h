@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+#include "../Common/Camera.h"
+
+///<summary>
+/// Decides how much animation work a skinned instance gets from its distance
+/// to the camera.  Levels are ordered near to far; an instance takes the
+/// first level whose MaxDistance it is within, or the last level when it is
+/// past all of them.
+///
+/// Distant instances update their pose every few frames and reuse the last
+/// palette in between, and may skip sampling their leaf bones (fingers,
+/// toes, end effectors) once they are too small on screen to show them.
+///</summary>
+class AnimationLodPolicy
+{
+public:
+	struct Level
+	{
+		float MaxDistance = MathHelper::Infinity;
+
+		// Frames between pose updates; 1 updates every frame.
+		UINT UpdateInterval = 1;
+
+		// See SkinnedData::GetFinalTransforms.
+		bool SkipLeafBones = false;
+	};
+
+	// Default levels, sized for the soldier at the demo's scale (about 3.7
+	// units tall).
+	AnimationLodPolicy();
+	explicit AnimationLodPolicy(const std::vector<Level>& levels);
+
+	UINT LevelCount()const;
+	const Level& GetLevel(UINT level)const;
+
+	UINT SelectLevel(float distance)const;
+
+	// Level for an instance at posW, measured from Camera::GetPosition3f().
+	const Level& Select(const Camera& camera, const DirectX::XMFLOAT3& posW)const;
+
+private:
+	std::vector<Level> mLevels;
+};
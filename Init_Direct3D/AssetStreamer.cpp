@@ -0,0 +1,118 @@
+#include "AssetStreamer.h"
+
+AssetStreamer::AssetStreamer(UINT numThreads)
+{
+	numThreads = MathHelper::Max(numThreads, 1u);
+
+	for (UINT i = 0; i < numThreads; ++i)
+		mThreads.emplace_back(&AssetStreamer::StreamerMain, this);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWakeCV.notify_all();
+
+	for (auto& thread : mThreads)
+		thread.join();
+}
+
+void AssetStreamer::Request(LoadStep load)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mLoads.push_back(std::move(load));
+		++mPending;
+	}
+	mWakeCV.notify_one();
+}
+
+bool AssetStreamer::HasUploads()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return !mUploads.empty();
+}
+
+UINT AssetStreamer::Upload()
+{
+	std::deque<UploadStep> uploads;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		uploads.swap(mUploads);
+	}
+
+	// Outside the lock: an upload step may request more loads.
+	UINT count = 0;
+	for (auto& upload : uploads)
+	{
+		if (upload)
+		{
+			upload();
+			++count;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mPending -= (UINT)uploads.size();
+
+	return count;
+}
+
+UINT AssetStreamer::PendingCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending;
+}
+
+bool AssetStreamer::ReadFile(const std::wstring& filename, std::vector<BYTE>& data)
+{
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	bool ok = GetFileSizeEx(file, &fileSize) && fileSize.QuadPart < (LONGLONG)UINT_MAX;
+
+	if (ok)
+	{
+		data.resize((size_t)fileSize.QuadPart);
+
+		DWORD bytesRead = 0;
+		ok = ::ReadFile(file, data.data(), (DWORD)fileSize.QuadPart, &bytesRead, nullptr) &&
+			bytesRead == (DWORD)fileSize.QuadPart;
+	}
+
+	CloseHandle(file);
+
+	if (!ok)
+		data.clear();
+
+	return ok;
+}
+
+void AssetStreamer::StreamerMain()
+{
+	for (;;)
+	{
+		LoadStep load;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeCV.wait(lock, [this] { return mQuit || !mLoads.empty(); });
+
+			if (mQuit)
+				return;
+
+			load = std::move(mLoads.front());
+			mLoads.pop_front();
+		}
+
+		UploadStep upload = load();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mUploads.push_back(std::move(upload));
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+///<summary>
+/// Loads assets on background threads so the app can start drawing before
+/// they are in.
+///
+/// A request is a load step, run on one of the streaming threads, that
+/// reads and parses its files into a CPU payload and returns the upload
+/// step for it.  Upload steps create the GPU resources and run on the
+/// render thread when it calls Upload(), in the order the loads finished.
+/// A load that fails returns an empty upload step and is dropped.
+///
+/// Request, Upload and the counts are meant for the render thread; the
+/// load steps must only touch their own payload.
+///</summary>
+class AssetStreamer
+{
+public:
+	typedef std::function<void()> UploadStep;
+	typedef std::function<UploadStep()> LoadStep;
+
+	explicit AssetStreamer(UINT numThreads = 2);
+
+	AssetStreamer(const AssetStreamer& rhs)=delete;
+	AssetStreamer& operator=(const AssetStreamer& rhs)=delete;
+
+	// Waits for the loads already running; queued loads and uploads not
+	// run yet are dropped.
+	~AssetStreamer();
+
+	void Request(LoadStep load);
+
+	// True if a finished load is waiting for Upload().
+	bool HasUploads()const;
+
+	// Runs the upload steps of every load finished so far.  Upload steps
+	// may request more loads.  Returns how many ran.
+	UINT Upload();
+
+	// Requests whose upload step has not run yet.
+	UINT PendingCount()const;
+
+	// Reads a whole file, for load steps.
+	static bool ReadFile(const std::wstring& filename, std::vector<BYTE>& data);
+
+private:
+	void StreamerMain();
+
+private:
+	std::vector<std::thread> mThreads;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWakeCV;
+	bool mQuit = false;
+
+	std::deque<LoadStep> mLoads;
+	std::deque<UploadStep> mUploads;
+	UINT mPending = 0;
+};
@@ -0,0 +1,110 @@
+#include "BakedAnimation.h"
+
+using namespace DirectX;
+
+void BakedAnimation::Bake(const SkinnedData& skinnedInfo, float framesPerSecond)
+{
+	assert(framesPerSecond > 0.0f);
+
+	mBoneCount = skinnedInfo.BoneCount();
+	mFramesPerSecond = framesPerSecond;
+	mFrameCount = 0;
+	mClips.clear();
+
+	// Lay the clips out first so the buffer is allocated once.
+	for(const std::string& name : skinnedInfo.GetClipNames())
+	{
+		const CompiledAnimationClip* compiled = skinnedInfo.FindClip(name);
+
+		Clip clip;
+		clip.Name = name;
+		clip.StartTime = compiled->GetClipStartTime();
+		clip.EndTime = compiled->GetClipEndTime();
+		clip.FirstFrame = mFrameCount;
+		clip.FrameCount = (UINT)ceilf((clip.EndTime - clip.StartTime) * framesPerSecond) + 1;
+
+		mFrameCount += clip.FrameCount;
+		mClips.push_back(clip);
+	}
+
+	mPaletteRows.resize((size_t)mFrameCount * mBoneCount * BonePalette::Stride(BonePalette::Format::Affine3x4));
+
+	std::vector<XMFLOAT4X4> finalTransforms(mBoneCount);
+	AnimationWorkspace workspace;
+
+	for(const Clip& clip : mClips)
+	{
+		const CompiledAnimationClip* compiled = skinnedInfo.FindClip(clip.Name);
+
+		for(UINT i = 0; i < clip.FrameCount; ++i)
+		{
+			float t = MathHelper::Min(clip.StartTime + i / framesPerSecond, clip.EndTime);
+			skinnedInfo.GetFinalTransforms(compiled, t, finalTransforms, workspace);
+
+			BonePalette::Pack(BonePalette::Format::Affine3x4, finalTransforms.data(), mBoneCount,
+				&mPaletteRows[GetPaletteOffset(clip.FirstFrame + i)]);
+		}
+	}
+}
+
+UINT BakedAnimation::BoneCount()const
+{
+	return mBoneCount;
+}
+
+UINT BakedAnimation::FrameCount()const
+{
+	return mFrameCount;
+}
+
+float BakedAnimation::GetFramesPerSecond()const
+{
+	return mFramesPerSecond;
+}
+
+int BakedAnimation::FindClip(const std::string& clipName)const
+{
+	for(UINT i = 0; i < mClips.size(); ++i)
+	{
+		if( mClips[i].Name == clipName )
+			return (int)i;
+	}
+
+	return -1;
+}
+
+const BakedAnimation::Clip& BakedAnimation::GetClip(UINT clip)const
+{
+	return mClips[clip];
+}
+
+UINT BakedAnimation::GetFrame(UINT clip, float timePos)const
+{
+	const Clip& c = mClips[clip];
+
+	float frame = (timePos - c.StartTime) * mFramesPerSecond + 0.5f;
+	frame = MathHelper::Clamp(frame, 0.0f, (float)(c.FrameCount - 1));
+
+	return c.FirstFrame + (UINT)frame;
+}
+
+UINT BakedAnimation::GetPaletteOffset(UINT frame)const
+{
+	return frame * mBoneCount * BonePalette::Stride(BonePalette::Format::Affine3x4);
+}
+
+void BakedAnimation::GetFinalTransforms(UINT frame, std::vector<XMFLOAT4X4>& finalTransforms)const
+{
+	BonePalette::Unpack(BonePalette::Format::Affine3x4, &mPaletteRows[GetPaletteOffset(frame)],
+		mBoneCount, finalTransforms.data());
+}
+
+const std::vector<XMFLOAT4>& BakedAnimation::GetPaletteRows()const
+{
+	return mPaletteRows;
+}
+
+size_t BakedAnimation::GetByteSize()const
+{
+	return mPaletteRows.size() * sizeof(XMFLOAT4);
+}
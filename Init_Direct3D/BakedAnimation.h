@@ -0,0 +1,54 @@
+#pragma once
+
+#include "SkinnedData.h"
+#include "BonePalette.h"
+
+///<summary>
+/// Every clip of a SkinnedData sampled at a fixed rate into one palette
+/// buffer: frames x bones in BonePalette's Affine3x4 layout.
+///
+/// Clips sit back to back, so a playing instance only needs its clip and
+/// time to find its frame, and the whole crowd shares one buffer.
+///</summary>
+class BakedAnimation
+{
+public:
+	struct Clip
+	{
+		std::string Name;
+		UINT FirstFrame = 0;
+		UINT FrameCount = 0;
+		float StartTime = 0.0f;
+		float EndTime = 0.0f;
+	};
+
+	void Bake(const SkinnedData& skinnedInfo, float framesPerSecond);
+
+	UINT BoneCount()const;
+	UINT FrameCount()const;
+	float GetFramesPerSecond()const;
+
+	// Index of the clip, or -1 if it was not baked.
+	int FindClip(const std::string& clipName)const;
+	const Clip& GetClip(UINT clip)const;
+
+	// Nearest baked frame of the clip at timePos, clamped to the clip.
+	UINT GetFrame(UINT clip, float timePos)const;
+
+	// Index of the first float4 row of a frame in GetPaletteRows().
+	UINT GetPaletteOffset(UINT frame)const;
+
+	// Expands a frame back to the layout GetFinalTransforms writes.
+	void GetFinalTransforms(UINT frame, std::vector<DirectX::XMFLOAT4X4>& finalTransforms)const;
+
+	const std::vector<DirectX::XMFLOAT4>& GetPaletteRows()const;
+	size_t GetByteSize()const;
+
+private:
+	std::vector<Clip> mClips;
+	std::vector<DirectX::XMFLOAT4> mPaletteRows;
+
+	UINT mBoneCount = 0;
+	UINT mFrameCount = 0;
+	float mFramesPerSecond = 0.0f;
+};
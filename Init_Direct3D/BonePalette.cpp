@@ -0,0 +1,84 @@
+#include "BonePalette.h"
+
+using namespace DirectX;
+
+UINT BonePalette::Stride(Format format)
+{
+	switch( format )
+	{
+	case Format::Affine3x4:      return 3;
+	case Format::DualQuaternion: return 2;
+	default:                     return 4;
+	}
+}
+
+void BonePalette::Pack(Format format, const XMFLOAT4X4* finalTransforms, UINT boneCount, XMFLOAT4* palette)
+{
+	for(UINT i = 0; i < boneCount; ++i)
+	{
+		const XMFLOAT4X4& M = finalTransforms[i];
+
+		if( format == Format::Matrix4x4 || format == Format::Affine3x4 )
+		{
+			XMFLOAT4* rows = &palette[i * Stride(format)];
+			rows[0] = XMFLOAT4(M._11, M._12, M._13, M._14);
+			rows[1] = XMFLOAT4(M._21, M._22, M._23, M._24);
+			rows[2] = XMFLOAT4(M._31, M._32, M._33, M._34);
+
+			if( format == Format::Matrix4x4 )
+				rows[3] = XMFLOAT4(M._41, M._42, M._43, M._44);
+
+			continue;
+		}
+
+		// Back to the row-vector matrix: rotation in the upper 3x3,
+		// translation in the last row.
+		XMMATRIX F = XMMatrixTranspose(XMLoadFloat4x4(&M));
+
+		XMVECTOR q = XMQuaternionNormalize(XMQuaternionRotationMatrix(F));
+		XMVECTOR t = F.r[3];
+
+		// dual = 0.5 * (t, 0) q, written out as a Hamilton product.
+		XMVECTOR qv = XMVectorSetW(q, 0.0f);
+		XMVECTOR dual = XMVectorAdd(XMVectorScale(t, XMVectorGetW(q)), XMVector3Cross(t, qv));
+		dual = XMVectorSetW(dual, -XMVectorGetX(XMVector3Dot(t, qv)));
+		dual = XMVectorScale(dual, 0.5f);
+
+		XMStoreFloat4(&palette[i*2 + 0], q);
+		XMStoreFloat4(&palette[i*2 + 1], dual);
+	}
+}
+
+void BonePalette::Unpack(Format format, const XMFLOAT4* palette, UINT boneCount, XMFLOAT4X4* finalTransforms)
+{
+	for(UINT i = 0; i < boneCount; ++i)
+	{
+		if( format == Format::Matrix4x4 || format == Format::Affine3x4 )
+		{
+			const XMFLOAT4* rows = &palette[i * Stride(format)];
+			XMFLOAT4 r3 = format == Format::Matrix4x4 ? rows[3] : XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+			finalTransforms[i] = XMFLOAT4X4(
+				rows[0].x, rows[0].y, rows[0].z, rows[0].w,
+				rows[1].x, rows[1].y, rows[1].z, rows[1].w,
+				rows[2].x, rows[2].y, rows[2].z, rows[2].w,
+				r3.x,      r3.y,      r3.z,      r3.w);
+
+			continue;
+		}
+
+		XMVECTOR q = XMLoadFloat4(&palette[i*2 + 0]);
+		XMVECTOR d = XMLoadFloat4(&palette[i*2 + 1]);
+
+		// t = 2 * dual * conjugate(q), the same formula the shader uses.
+		XMVECTOR qv = XMVectorSetW(q, 0.0f);
+		XMVECTOR t = XMVectorSubtract(XMVectorScale(d, XMVectorGetW(q)), XMVectorScale(qv, XMVectorGetW(d)));
+		t = XMVectorAdd(t, XMVector3Cross(qv, d));
+		t = XMVectorSetW(XMVectorScale(t, 2.0f), 1.0f);
+
+		XMMATRIX F = XMMatrixRotationQuaternion(q);
+		F.r[3] = t;
+
+		XMStoreFloat4x4(&finalTransforms[i], XMMatrixTranspose(F));
+	}
+}
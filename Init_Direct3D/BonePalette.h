@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+
+///<summary>
+/// Packs the final transforms SkinnedData::GetFinalTransforms writes
+/// (transposed 4x4, ready for a column_major cbuffer) into the layouts the
+/// skinning shaders read, and back again.
+///
+///  Matrix4x4      - 4 float4 per bone, the matrix as is.
+///  Affine3x4      - 3 float4 per bone, the fourth row (0,0,0,1) dropped.
+///  DualQuaternion - 2 float4 per bone, rotation then dual part.  Only for
+///                   rigid transforms; scale and shear are lost.
+///</summary>
+class BonePalette
+{
+public:
+	enum class Format
+	{
+		Matrix4x4,
+		Affine3x4,
+		DualQuaternion
+	};
+
+	// Largest skeleton a palette constant buffer can hold in any format:
+	// 4096 float4 (64KB) at 4 per bone.  The shaders declare only as many
+	// bones as the model has (MAX_BONES).
+	static const UINT MaxBones = 1024;
+
+	// float4 entries per bone.
+	static UINT Stride(Format format);
+
+	static void Pack(Format format, const DirectX::XMFLOAT4X4* finalTransforms,
+		UINT boneCount, DirectX::XMFLOAT4* palette);
+
+	static void Unpack(Format format, const DirectX::XMFLOAT4* palette,
+		UINT boneCount, DirectX::XMFLOAT4X4* finalTransforms);
+};
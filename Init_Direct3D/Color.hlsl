@@ -16,6 +16,35 @@ struct VertexIn
 #endif
 };
 
+#ifdef PACKED_VERTEX
+// VertexCompression::PackedVertex, PackedSkinnedVertex
+struct PackedVertexIn
+{
+    float4 PosQ     : POSITION;
+    float2 NormalQ  : NORMAL;
+    float2 TangentQ : TANGENT;
+    float2 Uv       : TEXCOORD;
+#ifdef SKINNED
+    float3 BoneWeights  : WEIGHTS;
+    uint4 BoneIndices   : BONEINDICES;
+#endif
+};
+
+VertexIn UnpackVertex(PackedVertexIn pin)
+{
+    VertexIn vin;
+    vin.PosL = DecodePosition(pin.PosQ.xyz);
+    vin.NormalL = DecodeOctahedral(pin.NormalQ);
+    vin.Uv = pin.Uv;
+    vin.Tangent = DecodeOctahedral(pin.TangentQ);
+#ifdef SKINNED
+    vin.BoneWeights = pin.BoneWeights;
+    vin.BoneIndices = pin.BoneIndices;
+#endif
+    return vin;
+}
+#endif
+
 struct VertexOut
 {
     float4 PosH     : SV_POSITION;
@@ -26,8 +55,14 @@ struct VertexOut
     float2 Uv       : TEXCOORD;
 };
 
+#ifdef PACKED_VERTEX
+VertexOut VS(PackedVertexIn pin)
+{
+    VertexIn vin = UnpackVertex(pin);
+#else
 VertexOut VS(VertexIn vin)
 {
+#endif
     VertexOut vout;
     
 #ifdef SKINNED
@@ -37,20 +72,31 @@ VertexOut VS(VertexIn vin)
     weights[2] = vin.BoneWeights.z;
     weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
     
+#ifdef PALETTE_DQ
+    float4 real, dual;
+    BlendDualQuats(vin.BoneIndices, float4(weights[0], weights[1], weights[2], weights[3]), real, dual);
+
+    vin.PosL = DualQuatTransformPoint(real, dual, vin.PosL);
+    vin.NormalL = QuatRotate(real, vin.NormalL);
+    vin.Tangent = QuatRotate(real, vin.Tangent);
+#else
     float3 posL = float3(0.0f, 0.0f, 0.0f);
     float3 normalL = float3(0.0f, 0.0f, 0.0f);
     float3 tangentL = float3(0.0f, 0.0f, 0.0f);
     
     for(int i = 0; i < 4; ++i)
     {
-        posL += weights[i] * mul(float4(vin.PosL, 1.0f), gBoneTransforms[vin.BoneIndices[i]]).xyz;
-        normalL += weights[i] * mul(vin.NormalL, (float3x3) gBoneTransforms[vin.BoneIndices[i]]);
-        tangentL += weights[i] * mul(vin.Tangent, (float3x3) gBoneTransforms[vin.BoneIndices[i]]);
+        float4x4 boneTransform = BoneTransform(vin.BoneIndices[i]);
+
+        posL += weights[i] * mul(float4(vin.PosL, 1.0f), boneTransform).xyz;
+        normalL += weights[i] * mul(vin.NormalL, (float3x3) boneTransform);
+        tangentL += weights[i] * mul(vin.Tangent, (float3x3) boneTransform);
     }
     
     vin.PosL = posL;
     vin.NormalL = normalL;
     vin.Tangent = tangentL;
+#endif
 #endif
 
     float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "SkinnedData.h"
+#include "PoseCache.h"
+#include "BakedAnimation.h"
+#include "AnimationLod.h"
 #include "../Common/d3dUtil.h"
 
 using namespace DirectX;
@@ -12,6 +15,7 @@ enum class RenderLayer : int
 {
 	Opaque = 0,
 	SkinnedOpaque,
+	PackedOpaque,
 	Transparent,
 	AlphaTested,
 	Debug,
@@ -35,7 +39,7 @@ struct SkinnedVertex
 	XMFLOAT2 Uv;
 	XMFLOAT3 Tangent;
 	XMFLOAT3 BoneWeights;
-	BYTE BoneIndices[4];
+	USHORT BoneIndices[4];
 };
 
 
@@ -44,6 +48,12 @@ struct ObjectConstants
 {
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+	// ȭ  ġ = 尪 * Scale + Offset (VertexCompression)
+	XMFLOAT3 PosDequantScale = { 1.0f, 1.0f, 1.0f };
+	float ObjPad0 = 0.0f;
+	XMFLOAT3 PosDequantOffset = { 0.0f, 0.0f, 0.0f };
+	float ObjPad1 = 0.0f;
 };
 
 //  Ʈ  
@@ -101,6 +111,23 @@ struct SkinnedConstants
 	XMFLOAT4X4 BoneTransforms[96];
 };
 
+//  ȷƮ     (BAKED_ANIMATION)
+struct BakedSkinnedConstants
+{
+	UINT PaletteOffset = 0;
+	XMFLOAT3 padding = { 0.0f, 0.0f, 0.0f };
+};
+
+// LOD ϳ ׸ ε 
+struct MeshLod
+{
+	UINT StartIndexLocation = 0;
+	UINT IndexCount = 0;
+
+	//   (  Ÿ)
+	float Error = 0.0f;
+};
+
 struct GeometryInfo
 {
 	std::string Name;
@@ -122,6 +149,15 @@ struct GeometryInfo
 	UINT StartIndexLocation = 0;
 	// ؽ 
 	int BaseVertexLocation = 0;
+
+	// ȭ ̸ ġ  , ƴϸ ״
+	XMFLOAT3 PosDequantScale = { 1.0f, 1.0f, 1.0f };
+	XMFLOAT3 PosDequantOffset = { 0.0f, 0.0f, 0.0f };
+
+	// LOD  ε , 0  .   LOD 
+	std::vector<MeshLod> Lods;
+	// LOD ÿ     
+	BoundingSphere LodBounds;
 };
 
 // ؽó ü
@@ -157,14 +193,274 @@ struct SkinnedModelInstance
 	std::string ClipName;
 	float TimePos = 0.0f;
 
-	void UpdateSkinnedAnimation(float dt)
+	// ̸ ãƵ Ŭ   ϴ ۾ ޸
+	const CompiledAnimationClip* Clip = nullptr;
+	AnimationWorkspace Workspace;
+
+	//  Ŭ ϴ νϽ ϴ  ĳ ( ȴ)
+	PoseCache* Cache = nullptr;
+
+	//  ȷƮ   ȷƮ Ŭ ȣ (BakedAnimation::FindClip).
+	// Baked   θ SetClip  BakedClip   ٲ۴.  ȷƮ  ʴ´.
+	const BakedAnimation* Baked = nullptr;
+	int BakedClip = -1;
+
+	//   Ŭ.   Clip ϳ Ѵ.
+	std::vector<AnimationLayer> Layers;
+
+	// νϽ  ȯ. Ű  ׸ ̰ 󰣴.
+	XMFLOAT4X4 World = MathHelper::Identity4x4();
+
+	// ī޶ Ÿ LOD      ġ (World  ̵ )
+	XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+
+	// ִϸ̼ LOD (SetLod  AnimationLodPolicy  ܰ踦 ޴´)
+	UINT LodUpdateInterval = 1;
+	bool LodSkipLeafBones = false;
+
+	// νϽ ٸ ϸ ָ ִ νϽ   ӿ  .
+	UINT LodFrame = 0;
+	bool HasPose = false;
+
+	// ̹   Ŭ Ʈ    ( ,   ڼ ).
+	// Ʈ  ٽ ø ʰ ̰ ü ű.
+	XMFLOAT4 RootMotionRotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	XMFLOAT3 RootMotionTranslation = { 0.0f, 0.0f, 0.0f };
+
+	// ̹    ̺Ʈ (Ÿ  ä)
+	std::vector<const AnimationEvent*> FiredEvents;
+	UINT EventCursor = 0;
+
+	//  Ŭ ̸̸  Ŭ ״ Ѵ.
+	void SetClip(const std::string& clipName)
+	{
+		const CompiledAnimationClip* clip = SkinnedInfo->FindClip(clipName);
+		assert(clip != nullptr);
+		if (clip == nullptr)
+			return;
+
+		ClipName = clipName;
+		Clip = clip;
+		TimePos = clip->GetClipStartTime();
+		EventCursor = clip->Events.Seek(TimePos);
+		Layers.clear();
+
+		if (Baked != nullptr)
+		{
+			BakedClip = Baked->FindClip(clipName);
+			assert(BakedClip >= 0);
+		}
+	}
+
+	//    Ŭ  ٸ Ŭ ġ ´.
+	//  Ŭ ̸̰ų  ȷƮ  ̸ ̾  ʰ nullptr  ش.
+	AnimationLayer* AddLayer(const std::string& clipName, float weight)
+	{
+		assert(Baked == nullptr);
+		const CompiledAnimationClip* clip = SkinnedInfo->FindClip(clipName);
+		if (clip == nullptr || Baked != nullptr)
+			return nullptr;
+
+		BeginLayers();
+
+		AnimationLayer layer;
+		layer.Clip = clip;
+		layer.TimePos = clip->GetClipStartTime();
+		layer.EventCursor = clip->Events.Seek(layer.TimePos);
+		layer.Weight = weight;
+		Layers.push_back(std::move(layer));
+
+		return &Layers.back();
+	}
+
+	// duration      Ŭ Ѿ.
+	//  ȷƮ   Ƿ ׶ ٷ  Ŭ ٲ۴.
+	void CrossFade(const std::string& clipName, float duration)
 	{
-		TimePos += dt;
+		if (duration <= 0.0f || Baked != nullptr)
+		{
+			SetClip(clipName);
+			return;
+		}
 
-		if (TimePos > SkinnedInfo->GetClipEndTime(ClipName))
-			TimePos = 0.0f;
+		//  Ŭδ Ѿ ʰ  Ŭ ̾ Ѵ.
+		bool found = SkinnedInfo->FindClip(clipName) != nullptr;
+		assert(found);
+		if (!found)
+			return;
 
-		SkinnedInfo->GetFinalTransforms(ClipName, TimePos, FinalTransforms);
+		BeginLayers();
+
+		//  ̾  ġ 0  ð .
+		for (auto& layer : Layers)
+			layer.FadeRate = -layer.Weight / duration;
+
+		AnimationLayer* layer = AddLayer(clipName, 0.0f);
+		layer->FadeRate = 1.0f / duration;
+
+		ClipName = clipName;
+		Clip = layer->Clip;
+	}
+
+	void SetLod(const AnimationLodPolicy::Level& level)
+	{
+		LodUpdateInterval = MathHelper::Max(level.UpdateInterval, 1u);
+		LodSkipLeafBones = level.SkipLeafBones;
+	}
+
+	// ð   ϰ,  LodUpdateInterval Ӹ ٽ Ѵ.
+	// ǳʶ ӿ FinalTransforms    ״̰ false  ش.
+	bool UpdateSkinnedAnimation(float dt)
+	{
+		AdvanceTime(dt);
+
+		bool due = (LodFrame++ % LodUpdateInterval) == 0;
+		if (HasPose && !due)
+			return false;
+
+		if (Layers.empty())
+			EvaluateClip();
+		else
+			SkinnedInfo->GetFinalTransforms(Layers, FinalTransforms, Workspace);
+
+		HasPose = true;
+		return true;
+	}
+
+	//  ȷƮ   ð ϸ ȴ.
+	void UpdateBakedAnimation(float dt)
+	{
+		assert(Baked != nullptr && BakedClip >= 0 && Layers.empty());
+		AdvanceTime(dt);
+	}
+
+	// ̹  Ʈ Ǹŭ World  ű.   ̶ World տ Ѵ.
+	void ApplyRootMotion()
+	{
+		XMMATRIX motion = XMMatrixAffineTransformation(XMVectorSplatOne(), XMVectorZero(),
+			XMLoadFloat4(&RootMotionRotation), XMLoadFloat3(&RootMotionTranslation));
+
+		XMStoreFloat4x4(&World, XMMatrixMultiply(motion, XMLoadFloat4x4(&World)));
+		Position = XMFLOAT3(World._41, World._42, World._43);
+	}
+
+private:
+	// ð ϸ鼭   Ʈ ǰ ̺Ʈ .
+	void AdvanceTime(float dt)
+	{
+		FiredEvents.clear();
+
+		if (Layers.empty())
+		{
+			Clip->RootMotion.GetDelta(TimePos, dt, RootMotionRotation, RootMotionTranslation);
+			Clip->Events.Advance(TimePos, dt, Clip->GetClipStartTime(), Clip->GetClipEndTime(),
+				EventCursor, FiredEvents);
+
+			TimePos = WrapTime(Clip, TimePos + dt);
+			return;
+		}
+
+		// Ʈ  ̾ ġ , ̺Ʈ  ſ ̾ .
+		// ٸ ̾ Ŀ ߿   Advance  ٽ .
+		XMVECTOR rotation = XMVectorZero();
+		XMVECTOR translation = XMVectorZero();
+		float totalWeight = 0.0f;
+		AnimationLayer* heaviest = &Layers[0];
+
+		for (auto& layer : Layers)
+		{
+			XMFLOAT4 layerRotation;
+			XMFLOAT3 layerTranslation;
+			layer.Clip->RootMotion.GetDelta(layer.TimePos, dt, layerRotation, layerTranslation);
+
+			XMVECTOR q = XMLoadFloat4(&layerRotation);
+			if (XMVectorGetX(XMVector4Dot(q, rotation)) < 0.0f)
+				q = XMVectorNegate(q);
+
+			rotation = XMVectorAdd(rotation, XMVectorScale(q, layer.Weight));
+			translation = XMVectorAdd(translation, XMVectorScale(XMLoadFloat3(&layerTranslation), layer.Weight));
+			totalWeight += layer.Weight;
+
+			if (layer.Weight > heaviest->Weight)
+				heaviest = &layer;
+		}
+
+		if (totalWeight > 0.0f)
+		{
+			XMStoreFloat4(&RootMotionRotation, XMQuaternionNormalize(rotation));
+			XMStoreFloat3(&RootMotionTranslation, XMVectorScale(translation, 1.0f / totalWeight));
+		}
+		else
+		{
+			RootMotionRotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			RootMotionTranslation = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+
+		heaviest->Clip->Events.Advance(heaviest->TimePos, dt, heaviest->Clip->GetClipStartTime(),
+			heaviest->Clip->GetClipEndTime(), heaviest->EventCursor, FiredEvents);
+
+		for (auto& layer : Layers)
+		{
+			layer.TimePos = WrapTime(layer.Clip, layer.TimePos + dt);
+
+			if (layer.FadeRate != 0.0f)
+			{
+				layer.Weight = MathHelper::Clamp(layer.Weight + layer.FadeRate * dt, 0.0f, 1.0f);
+
+				//   ̾ .   ̾ FadeRate   ξ Ʒ .
+				if (layer.Weight >= 1.0f)
+					layer.FadeRate = 0.0f;
+			}
+		}
+
+		// ̵   ̾ . AddLayer  ġ 0   ̾ ´.
+		Layers.erase(std::remove_if(Layers.begin(), Layers.end(),
+			[](const AnimationLayer& layer) { return layer.Weight <= 0.0f && layer.FadeRate < 0.0f; }),
+			Layers.end());
+
+		// ϳ  ٽ  Ŭ η ư.
+		if (Layers.size() == 1 && Layers[0].FadeRate == 0.0f)
+		{
+			Clip = Layers[0].Clip;
+			TimePos = Layers[0].TimePos;
+			EventCursor = Layers[0].EventCursor;
+			Workspace.KeyframeCursors.swap(Layers[0].KeyframeCursors);
+			Layers.clear();
+		}
+	}
+
+	void EvaluateClip()
+	{
+		// ĳÿ    ̶   ͺ δ.    ĳÿ   .
+		if (Cache)
+			Cache->GetFinalTransforms(Clip, TimePos, FinalTransforms, Workspace, LodSkipLeafBones);
+		else
+			SkinnedInfo->GetFinalTransforms(Clip, TimePos, FinalTransforms, Workspace, LodSkipLeafBones);
+	}
+
+	//  Ŭ ù ° ̾ ű.
+	void BeginLayers()
+	{
+		if (!Layers.empty())
+			return;
+
+		AnimationLayer layer;
+		layer.Clip = Clip;
+		layer.TimePos = TimePos;
+		layer.KeyframeCursors = Workspace.KeyframeCursors;
+		layer.EventCursor = EventCursor;
+		Layers.push_back(std::move(layer));
+	}
+
+	//  Ѿ ŭ  ð ̾ Ѵ. ̰ 0 Ŭ  ð ӹ.
+	static float WrapTime(const CompiledAnimationClip* clip, float t)
+	{
+		float start = clip->GetClipStartTime();
+		float end = clip->GetClipEndTime();
+		if (end <= start)
+			return start;
+
+		return t > end ? start + fmodf(t - start, end - start) : t;
 	}
 };
 
@@ -184,6 +480,9 @@ struct RenderItem
 	GeometryInfo* Geo = nullptr;
 	MaterialInfo* Mat = nullptr;
 
+	// ̹ ӿ ׸ LOD
+	UINT Lod = 0;
+
 	UINT SkinnedCBIndex = 0;
 	SkinnedModelInstance* SkinnedModelInst = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "GeometryBuilder.h"
+
+namespace
+{
+	UINT64 AlignUp(UINT64 offset, UINT64 alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	ComPtr<ID3D12Resource> CreateMappedUploadBuffer(ID3D12Device* device, UINT64 byteSize, BYTE** mappedData)
+	{
+		ComPtr<ID3D12Resource> buffer;
+
+		D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+
+		ThrowIfFailed(device->CreateCommittedResource(
+			&heapProperty,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&buffer)));
+
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(buffer->Map(0, &readRange, reinterpret_cast<void**>(mappedData)));
+
+		return buffer;
+	}
+}
+
+void GeometryBuilder::AddVertices(PendingMesh& mesh, const void* vertexData, UINT vertexCount, UINT vertexStride)
+{
+	const BYTE* bytes = reinterpret_cast<const BYTE*>(vertexData);
+
+	mesh.Vertices.assign(bytes, bytes + (size_t)vertexCount * vertexStride);
+	mesh.VertexCount = vertexCount;
+	mesh.VertexStride = vertexStride;
+}
+
+void GeometryBuilder::Build(ID3D12Device* device)
+{
+	mVertexBuffer = nullptr;
+	mIndexBuffer = nullptr;
+
+	if( mMeshes.empty() )
+		return;
+
+	const UINT meshCount = (UINT)mMeshes.size();
+
+	// One vertex group per stride, in the order the strides first show up.
+	struct VertexGroup
+	{
+		UINT Stride = 0;
+		UINT VertexCount = 0;
+		UINT64 Offset = 0;
+	};
+
+	std::vector<VertexGroup> groups;
+	std::vector<UINT> meshGroup(meshCount);
+	std::vector<UINT> baseVertex(meshCount);
+
+	for(UINT i = 0; i < meshCount; ++i)
+	{
+		UINT g = 0;
+		while( g < (UINT)groups.size() && groups[g].Stride != mMeshes[i].VertexStride )
+			++g;
+
+		if( g == (UINT)groups.size() )
+		{
+			groups.push_back(VertexGroup());
+			groups[g].Stride = mMeshes[i].VertexStride;
+		}
+
+		meshGroup[i] = g;
+		baseVertex[i] = groups[g].VertexCount;
+		groups[g].VertexCount += mMeshes[i].VertexCount;
+	}
+
+	UINT64 vbByteSize = 0;
+	for(VertexGroup& group : groups)
+	{
+		group.Offset = AlignUp(vbByteSize, 16);
+		vbByteSize = group.Offset + (UINT64)group.VertexCount * group.Stride;
+	}
+
+	// The 16 bit indices first, then the 32 bit ones.
+	std::vector<bool> wideIndices(meshCount);
+	std::vector<UINT> startIndex(meshCount);
+	UINT index16Count = 0;
+	UINT index32Count = 0;
+
+	for(UINT i = 0; i < meshCount; ++i)
+	{
+		const PendingMesh& mesh = mMeshes[i];
+
+		wideIndices[i] = mesh.MaxIndex > 0xffff;
+		if( wideIndices[i] )
+		{
+			char text[256];
+			sprintf_s(text, "GeometryBuilder: %s has %u vertices, drawing it with 32 bit indices\n",
+				mesh.Geo->Name.c_str(), mesh.VertexCount);
+			OutputDebugStringA(text);
+
+			startIndex[i] = index32Count;
+			index32Count += (UINT)mesh.Indices.size();
+		}
+		else
+		{
+			startIndex[i] = index16Count;
+			index16Count += (UINT)mesh.Indices.size();
+		}
+	}
+
+	const UINT64 index32Offset = AlignUp((UINT64)index16Count * sizeof(std::uint16_t), sizeof(std::uint32_t));
+	const UINT64 ibByteSize = index32Offset + (UINT64)index32Count * sizeof(std::uint32_t);
+
+	BYTE* vertexData = nullptr;
+	BYTE* indexData = nullptr;
+	mVertexBuffer = CreateMappedUploadBuffer(device, MathHelper::Max(vbByteSize, (UINT64)16), &vertexData);
+	mIndexBuffer = CreateMappedUploadBuffer(device, MathHelper::Max(ibByteSize, (UINT64)16), &indexData);
+
+	const D3D12_GPU_VIRTUAL_ADDRESS vbAddress = mVertexBuffer->GetGPUVirtualAddress();
+	const D3D12_GPU_VIRTUAL_ADDRESS ibAddress = mIndexBuffer->GetGPUVirtualAddress();
+
+	for(UINT i = 0; i < meshCount; ++i)
+	{
+		const PendingMesh& mesh = mMeshes[i];
+		const VertexGroup& group = groups[meshGroup[i]];
+		GeometryInfo* geo = mesh.Geo;
+
+		memcpy(vertexData + group.Offset + (UINT64)baseVertex[i] * group.Stride,
+			mesh.Vertices.data(), mesh.Vertices.size());
+
+		if( wideIndices[i] )
+		{
+			std::uint32_t* dst = reinterpret_cast<std::uint32_t*>(indexData + index32Offset) + startIndex[i];
+			std::copy(mesh.Indices.begin(), mesh.Indices.end(), dst);
+		}
+		else
+		{
+			std::uint16_t* dst = reinterpret_cast<std::uint16_t*>(indexData) + startIndex[i];
+			for(size_t j = 0; j < mesh.Indices.size(); ++j)
+				dst[j] = (std::uint16_t)mesh.Indices[j];
+		}
+
+		geo->VertexBuffer = mVertexBuffer;
+		geo->VertexView.BufferLocation = vbAddress + group.Offset;
+		geo->VertexView.StrideInBytes = group.Stride;
+		geo->VertexView.SizeInBytes = group.VertexCount * group.Stride;
+
+		geo->IndexBuffer = mIndexBuffer;
+		if( wideIndices[i] )
+		{
+			geo->IndexView.BufferLocation = ibAddress + index32Offset;
+			geo->IndexView.Format = DXGI_FORMAT_R32_UINT;
+			geo->IndexView.SizeInBytes = index32Count * sizeof(std::uint32_t);
+		}
+		else
+		{
+			geo->IndexView.BufferLocation = ibAddress;
+			geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
+			geo->IndexView.SizeInBytes = index16Count * sizeof(std::uint16_t);
+		}
+
+		geo->VertexCount = (int)mesh.VertexCount;
+		geo->IndexCount = (int)mesh.Indices.size();
+		geo->StartIndexLocation = startIndex[i];
+		geo->BaseVertexLocation = (int)baseVertex[i];
+
+		// The LOD ranges were relative to the mesh's own indices.
+		if( !geo->Lods.empty() )
+		{
+			geo->IndexCount = (int)geo->Lods[0].IndexCount;
+			for(MeshLod& lod : geo->Lods)
+				lod.StartIndexLocation += startIndex[i];
+		}
+	}
+
+	mVertexBuffer->Unmap(0, nullptr);
+	mIndexBuffer->Unmap(0, nullptr);
+
+	mMeshes.clear();
+}
+
+UINT64 GeometryBuilder::VertexBufferByteSize()const
+{
+	return mVertexBuffer ? mVertexBuffer->GetDesc().Width : 0;
+}
+
+UINT64 GeometryBuilder::IndexBufferByteSize()const
+{
+	return mIndexBuffer ? mIndexBuffer->GetDesc().Width : 0;
+}
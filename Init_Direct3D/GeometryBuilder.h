@@ -0,0 +1,95 @@
+#pragma once
+
+#include "D3dHeader.h"
+
+///<summary>
+/// Packs meshes into one vertex buffer and one index buffer.
+///
+/// Meshes are queued with Add and laid out by Build: vertices are grouped
+/// by stride, so meshes with the same layout share a vertex buffer view and
+/// differ only in BaseVertexLocation.  Each mesh's indices are stored
+/// relative to its first vertex and narrowed to 16 bits when they fit; the
+/// 16 and 32 bit indices get a region, and an index buffer view, each.
+/// A mesh too big for 16 bit indices is reported with OutputDebugString and
+/// drawn with 32 bit ones.
+///
+/// A geometry that already has Lods is queued with its whole LOD chain as
+/// indices; Build moves the LOD ranges to where the chain landed and sets
+/// the draw range to LOD 0.
+///
+/// The geometries share the two resources through their VertexBuffer and
+/// IndexBuffer references, so they stay alive while any geometry does.
+///</summary>
+class GeometryBuilder
+{
+public:
+	template<typename VertexType, typename IndexType>
+	void Add(GeometryInfo* geo, const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices);
+
+	// Queues a mesh; geo gets its views and draw range from Build.  The
+	// indices are relative to the first of the vertexCount vertices.
+	template<typename IndexType>
+	void Add(GeometryInfo* geo, const void* vertexData, UINT vertexCount, UINT vertexStride,
+		const std::vector<IndexType>& indices);
+	template<typename IndexType>
+	void Add(GeometryInfo* geo, const void* vertexData, UINT vertexCount, UINT vertexStride,
+		const IndexType* indices, UINT indexCount);
+
+	// Creates the shared buffers in an upload heap and fills in every
+	// queued geometry.  The queue is emptied.
+	void Build(ID3D12Device* device);
+
+	// Bytes of the buffers the last Build created.
+	UINT64 VertexBufferByteSize()const;
+	UINT64 IndexBufferByteSize()const;
+
+private:
+	struct PendingMesh
+	{
+		GeometryInfo* Geo = nullptr;
+		std::vector<BYTE> Vertices;
+		UINT VertexCount = 0;
+		UINT VertexStride = 0;
+		std::vector<UINT> Indices;
+		UINT MaxIndex = 0;
+	};
+
+	void AddVertices(PendingMesh& mesh, const void* vertexData, UINT vertexCount, UINT vertexStride);
+
+private:
+	std::vector<PendingMesh> mMeshes;
+
+	ComPtr<ID3D12Resource> mVertexBuffer;
+	ComPtr<ID3D12Resource> mIndexBuffer;
+};
+
+template<typename VertexType, typename IndexType>
+void GeometryBuilder::Add(GeometryInfo* geo, const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices)
+{
+	Add(geo, vertices.data(), (UINT)vertices.size(), sizeof(VertexType), indices);
+}
+
+template<typename IndexType>
+void GeometryBuilder::Add(GeometryInfo* geo, const void* vertexData, UINT vertexCount, UINT vertexStride,
+	const std::vector<IndexType>& indices)
+{
+	Add(geo, vertexData, vertexCount, vertexStride, indices.data(), (UINT)indices.size());
+}
+
+template<typename IndexType>
+void GeometryBuilder::Add(GeometryInfo* geo, const void* vertexData, UINT vertexCount, UINT vertexStride,
+	const IndexType* indices, UINT indexCount)
+{
+	PendingMesh mesh;
+	mesh.Geo = geo;
+	AddVertices(mesh, vertexData, vertexCount, vertexStride);
+
+	mesh.Indices.resize(indexCount);
+	for(UINT i = 0; i < indexCount; ++i)
+	{
+		mesh.Indices[i] = (UINT)indices[i];
+		mesh.MaxIndex = MathHelper::Max(mesh.MaxIndex, mesh.Indices[i]);
+	}
+
+	mMeshes.push_back(std::move(mesh));
+}
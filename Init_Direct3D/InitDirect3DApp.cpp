@@ -30,6 +30,12 @@ InitDirect3DApp::InitDirect3DApp(HINSTANCE hInstance)
 
 InitDirect3DApp::~InitDirect3DApp()
 {
+    // д     ٸ,  ø   .
+    mAssetStreamer.reset();
+
+    //   ִ ִϸ̼  νϽ  ۸    ٸ.
+    mSkinnedUpdater.reset();
+
     if (md3dDevice != nullptr)
         FlushCommandQueue();
 
@@ -43,6 +49,10 @@ InitDirect3DApp::~InitDirect3DApp()
 
 bool InitDirect3DApp::Initialize()
 {
+#if defined(DEBUG) || defined(_DEBUG)
+    mStartTime = std::chrono::steady_clock::now();
+#endif
+
     if (!D3DApp::Initialize())
         return false;
 
@@ -62,8 +72,22 @@ bool InitDirect3DApp::Initialize()
     // ī޶ ʱ ġ 
     mCamera.SetPosition(0.0f, 2.0f, -15.0f);
 
+    // Ŀ  
+    mJobSystem = std::make_unique<JobSystem>();
+
+    // Ű νϽ Ű ȷƮ  ( ۴ BuildConstantBuffers  Ѵ)
+    mSkinnedUpdater = std::make_unique<SkinnedInstanceUpdater>(&mSkinnedModelInsts, mJobSystem.get(), mAsyncAnimation);
+    mSkinnedUpdater->SetPaletteFormat(mBonePaletteFormat);
+    if (mUseAnimationLod)
+        mSkinnedUpdater->SetLodPolicy(&mAnimationLod);
+    if (mUseBakedAnimation)
+        mSkinnedUpdater->SetBakedAnimation(&mBakedAnimation);
+
+    //  б Ľ Ʈ 忡 ϰ, ϴ   ̿ ø.
+    mAssetStreamer = std::make_unique<AssetStreamer>();
+
     // Skinned Model ε
-    LoadSkinnedModel();
+    RequestSkinnedModel();
 
     // ؽó ε
     LoadTextures();
@@ -72,12 +96,15 @@ bool InitDirect3DApp::Initialize()
     BuildDescriptorHeaps();
 
     //   
-    BuildBoxGeometry();
-    BuildGridGeometry();
-    BuildSphereGeometry();
-    BuildCylinderGeometry();
-    BuildQuadGeometry();
-    BuildSkullGeometry();
+    //     ϳ ε  ϳ Բ .
+    GeometryBuilder staticGeometry;
+    BuildBoxGeometry(staticGeometry);
+    BuildGridGeometry(staticGeometry);
+    BuildSphereGeometry(staticGeometry);
+    BuildCylinderGeometry(staticGeometry);
+    BuildQuadGeometry(staticGeometry);
+    staticGeometry.Build(md3dDevice.Get());
+    RequestSkullGeometry();
 
     //  
     BuildMaterials();
@@ -160,13 +187,21 @@ void InitDirect3DApp::OnResize()
 
 void InitDirect3DApp::Update(const GameTimer& gt)
 {
+    UploadStreamedAssets();
+
     UpdateCamera(gt);
+    UpdateLods();
+
+    // Ʈ  Ű νϽ  ȯ ٲٹǷ Ʈ   Ѵ.
+    UpdateSkinnedCBs(gt);
     UpdateObjectCBs(gt);
     UpdateMaterialCBs(gt);
     UpdateShadowTransform(gt);
     UpdatePassCB(gt);
     UpdateShadowPassCB(gt);
-    UpdateSkinnedCBs(gt);
+
+    // 񵿱 忡   ȷƮ ̹  ׸ ļ Ѵ.
+    mSkinnedUpdater->BeginNextFrame(gt.DeltaTime(), mCamera);
 }
 
 void InitDirect3DApp::UpdateCamera(const GameTimer& gt)
@@ -188,10 +223,32 @@ void InitDirect3DApp::UpdateCamera(const GameTimer& gt)
     mCamera.UpdateViewMatrix();
 }
 
+void InitDirect3DApp::UpdateLods()
+{
+    const float viewportHeight = (float)mClientHeight;
+
+    for (auto& e : mRenderitems)
+    {
+        if (!mUseMeshLod || e->Geo == nullptr)
+        {
+            e->Lod = 0;
+            continue;
+        }
+
+        // ȭ鿡  mLodPixelError ȼ   ģ LOD
+        e->Lod = MeshSimplifier::SelectLod(*e->Geo, XMLoadFloat4x4(&e->World), mCamera,
+            viewportHeight, mLodPixelError);
+    }
+}
+
 void InitDirect3DApp::UpdateObjectCBs(const GameTimer& gt)
 {
     for (auto& e : mRenderitems)
     {
+        // Ű ׸ νϽ 󰣴.
+        if (e->SkinnedModelInst)
+            e->World = e->SkinnedModelInst->World;
+
         XMMATRIX world = XMLoadFloat4x4(&e->World);
         XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
 
@@ -201,6 +258,13 @@ void InitDirect3DApp::UpdateObjectCBs(const GameTimer& gt)
 
         XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
 
+        // ȭ  ġ  
+        if (e->Geo != nullptr)
+        {
+            objConstants.PosDequantScale = e->Geo->PosDequantScale;
+            objConstants.PosDequantOffset = e->Geo->PosDequantOffset;
+        }
+
         UINT elementIndex = e->ObjCBIndex;
         UINT elementByteSize = (sizeof(ObjectConstants) + 255) & ~255;
         memcpy(&mObjectMappedData[elementIndex * elementByteSize], &objConstants, sizeof(ObjectConstants));
@@ -329,15 +393,8 @@ void InitDirect3DApp::UpdateShadowPassCB(const GameTimer& gt)
 
 void InitDirect3DApp::UpdateSkinnedCBs(const GameTimer& gt)
 {
-    mSkinnedModelInst->UpdateSkinnedAnimation(gt.DeltaTime());
-
-    SkinnedConstants skinnedCB;
-    std::copy(
-        std::begin(mSkinnedModelInst->FinalTransforms),
-        std::end(mSkinnedModelInst->FinalTransforms),
-        &skinnedCB.BoneTransforms[0]);
-
-    memcpy(&mSkinnedMappedData[0], &skinnedCB, sizeof(SkinnedConstants));
+    // 񵿱 忡  ӿ   ٸ.
+    mSkinnedUpdater->Update(gt.DeltaTime(), mCamera);
 }
 
 void InitDirect3DApp::Draw(const GameTimer& gt)
@@ -376,10 +433,16 @@ void InitDirect3DApp::Draw(const GameTimer& gt)
 
     mCommandList->SetGraphicsRootDescriptorTable(6, mShadowMapSrv);
 
+    if (mUseBakedAnimation && mBakedPaletteBuffer != nullptr)
+        mCommandList->SetGraphicsRootShaderResourceView(8, mBakedPaletteBuffer->GetGPUVirtualAddress());
+
     // to do : Rendering   
     mCommandList->SetPipelineState(mPSOs["opaque"].Get());
     DrawRenderItems(mRitemLayer[(int)RenderLayer::Opaque]);
 
+    mCommandList->SetPipelineState(mPSOs["packedOpaque"].Get());
+    DrawRenderItems(mRitemLayer[(int)RenderLayer::PackedOpaque]);
+
     mCommandList->SetPipelineState(mPSOs["skinnedOpaque"].Get());
     DrawRenderItems(mRitemLayer[(int)RenderLayer::SkinnedOpaque]);
 
@@ -400,13 +463,14 @@ void InitDirect3DApp::DrawRenderItems(const std::vector<RenderItem*>& ritems)
 {
     UINT objCBByteSize = (sizeof(ObjectConstants) + 255) & ~255;
     UINT matCBByteSize = (sizeof(MaterialConstants) + 255) & ~255;
-    UINT skinnedCBByteSize = (sizeof(SkinnedConstants) + 255) & ~255;
+    UINT skinnedCBByteSize = SkinnedCBByteSize();
 
     for (size_t i = 0; i < ritems.size(); ++i)
     {
         auto ri = ritems[i];
 
-        if (ri->Geo == nullptr)
+        //  Ʈ  ϴ ǳʶڴ.
+        if (ri->Geo == nullptr || ri->Geo->IndexBuffer == nullptr)
             continue;
 
         //  Ʈ    
@@ -443,6 +507,7 @@ void InitDirect3DApp::DrawRenderItems(const std::vector<RenderItem*>& ritems)
         if (ri->SkinnedModelInst != nullptr)
         {
             D3D12_GPU_VIRTUAL_ADDRESS skinnedCBAddress = mSkinnedCB->GetGPUVirtualAddress();
+            skinnedCBAddress += mSkinnedUpdater->GetRegion() * SkinnedRegionByteSize();
             skinnedCBAddress += ri->SkinnedCBIndex * skinnedCBByteSize;
             mCommandList->SetGraphicsRootConstantBufferView(7, skinnedCBAddress);
         }
@@ -457,11 +522,20 @@ void InitDirect3DApp::DrawRenderItems(const std::vector<RenderItem*>& ritems)
         mCommandList->IASetIndexBuffer(&ri->Geo->IndexView);
         mCommandList->IASetPrimitiveTopology(ri->PrimitiveType);
 
+        // LOD    LOD  ε  ׸
+        UINT indexCount = ri->Geo->IndexCount;
+        UINT startIndexLocation = ri->Geo->StartIndexLocation;
+        if (ri->Lod < ri->Geo->Lods.size())
+        {
+            indexCount = ri->Geo->Lods[ri->Lod].IndexCount;
+            startIndexLocation = ri->Geo->Lods[ri->Lod].StartIndexLocation;
+        }
+
         // 
         mCommandList->DrawIndexedInstanced(
-            ri->Geo->IndexCount, 
+            indexCount, 
             1, 
-            ri->Geo->StartIndexLocation, 
+            startIndexLocation, 
             ri->Geo->BaseVertexLocation, 
             0);
     }
@@ -486,9 +560,15 @@ void InitDirect3DApp::DrawSceneToShadowMap()
     D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = mPassCB->GetGPUVirtualAddress() + passCBByteSize;
     mCommandList->SetGraphicsRootConstantBufferView(2, passCBAddress);
 
+    if (mUseBakedAnimation && mBakedPaletteBuffer != nullptr)
+        mCommandList->SetGraphicsRootShaderResourceView(8, mBakedPaletteBuffer->GetGPUVirtualAddress());
+
     mCommandList->SetPipelineState(mPSOs["shadow"].Get());
     DrawRenderItems(mRitemLayer[(int)RenderLayer::Opaque]);
 
+    mCommandList->SetPipelineState(mPSOs["packedShadow"].Get());
+    DrawRenderItems(mRitemLayer[(int)RenderLayer::PackedOpaque]);
+
     mCommandList->SetPipelineState(mPSOs["skinnedShadow"].Get());
     DrawRenderItems(mRitemLayer[(int)RenderLayer::SkinnedOpaque]);
 
@@ -524,6 +604,14 @@ void InitDirect3DApp::DrawEnd(const GameTimer& gt)
     ThrowIfFailed(mSwapChain->Present(0, 0));
     mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
+#if defined(DEBUG) || defined(_DEBUG)
+    if (!mFirstFrameLogged)
+    {
+        mFirstFrameLogged = true;
+        LogStartupTime("first frame");
+    }
+#endif
+
     // Wait until frame commands are complete.  This waiting is inefficient and is
     // done for simplicity.  Later we will show how to organize our rendering code
     // so we do not have to wait per frame.
@@ -559,57 +647,201 @@ void InitDirect3DApp::OnMouseMove(WPARAM btnState, int x, int y)
     mLastMousePos.y = y;
 }
 
-void InitDirect3DApp::LoadSkinnedModel()
+void InitDirect3DApp::UploadStreamedAssets()
 {
-    std::vector<M3DLoader::SkinnedVertex> vertices;
-    std::vector<std::uint16_t> indices;
+    if (!mAssetStreamer->HasUploads())
+        return;
 
-    M3DLoader m3dLoader;
-    m3dLoader.LoadM3d(mSkinnedModelFilename, vertices, indices, mSkinnedSubsets, mSkinnedMats, mSkinnedInfo);
+    //    GPU  ٷǷ   ʱȭ ó ٷ   ִ.
+    ThrowIfFailed(mDirectCmdListAlloc->Reset());
+    ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-    mSkinnedModelInst = std::make_unique<SkinnedModelInstance>();
-    mSkinnedModelInst->SkinnedInfo = &mSkinnedInfo;
-    mSkinnedModelInst->FinalTransforms.resize(mSkinnedInfo.BoneCount());
-    mSkinnedModelInst->ClipName = "Take1";
-    mSkinnedModelInst->TimePos = 0.0f;
+    mAssetStreamer->Upload();
+
+    // ؽó   ϰ   ٸ.
+    ThrowIfFailed(mCommandList->Close());
+    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    FlushCommandQueue();
 
-    for (UINT i = 0; i < (UINT)mSkinnedSubsets.size(); ++i)
+    //    忡 Ѵ.
+#if defined(DEBUG) || defined(_DEBUG)
+    if (mAssetStreamer->PendingCount() == 0)
     {
-        //   Է
-        auto geo = std::make_unique<GeometryInfo>();
-        geo->Name = "sm_" + std::to_string(i);
+        LogStartupTime("all assets streamed");
+        LogGeometryMemory();
+        LogLodSavings();
+    }
+#endif
+}
 
-        //    
-        geo->VertexCount = (UINT)vertices.size();
-        const UINT vbByteSize = geo->VertexCount * sizeof(SkinnedVertex);
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogStartupTime(const char* what)
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mStartTime;
 
-        D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
+    char text[128];
+    sprintf_s(text, "startup: %s after %.1f ms\n", what, elapsed.count());
+    OutputDebugStringA(text);
+}
+#endif
 
-        md3dDevice->CreateCommittedResource(
-            &heapProperty,
-            D3D12_HEAP_FLAG_NONE,
-            &desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&geo->VertexBuffer));
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogModelMemory(const char* name, const ModelResource& model)
+{
+    char text[256];
+    sprintf_s(text, "model %s: %u subsets share %llu KB of buffers, per subset copies would take %llu KB\n",
+        name, model.SubsetCount(), model.UploadedByteSize() / 1024, model.PerSubsetCopyByteSize() / 1024);
+    OutputDebugStringA(text);
+}
+
+void InitDirect3DApp::LogGeometryMemory()
+{
+    // ϸ ϴ  ũ⸦  ,  ۴     ũ
+    std::vector<ID3D12Resource*> buffers;
+    UINT64 referencedBytes = 0;
+    UINT64 uniqueBytes = 0;
+
+    for (const auto& kv : mGeometries)
+    {
+        ID3D12Resource* geoBuffers[] = { kv.second->VertexBuffer.Get(), kv.second->IndexBuffer.Get() };
+        for (ID3D12Resource* buffer : geoBuffers)
+        {
+            if (buffer == nullptr)
+                continue;
+
+            const UINT64 byteSize = buffer->GetDesc().Width;
+            referencedBytes += byteSize;
+
+            if (std::find(buffers.begin(), buffers.end(), buffer) == buffers.end())
+            {
+                buffers.push_back(buffer);
+                uniqueBytes += byteSize;
+            }
+        }
+    }
+
+    char text[256];
+    sprintf_s(text, "geometry memory: %u geometries reference %llu KB, held in %u buffers of %llu KB\n",
+        (UINT)mGeometries.size(), referencedBytes / 1024, (UINT)buffers.size(), uniqueBytes / 1024);
+    OutputDebugStringA(text);
+}
+#endif
+
+void InitDirect3DApp::RequestSkinnedModel()
+{
+    const std::string filename = mSkinnedModelFilename;
+    JobSystem* jobSystem = mJobSystem.get();
+    const float aspect = AspectRatio();
+
+    mAssetStreamer->Request([this, filename, jobSystem, aspect]() -> AssetStreamer::UploadStep
+    {
+        auto model = std::make_shared<SkinnedModelPayload>();
+
+        // ó   ؽƮ  ̳ʸ(.m3db) ٲ ΰ,  ڷδ ̳ʸ ؼ д´.
+        // ؽƮ  ũ⳪  ð ̳ʸ  Ͱ ٸ ٽ ٲ۴.
+        // ̳ʸ    ȭ  · Ǿ,  ε ο ٷ .
+        M3DLoader m3dLoader;
+        // ؽƮ   , ﰢ, Ű  Ŀ 忡  ĽѴ.
+        m3dLoader.SetJobSystem(jobSystem);
+        const std::string binaryFilename = filename + "b";
+        const bool mapped = m3dLoader.OpenM3dBinary(binaryFilename, model->Binary, model->Subsets, model->Mats, model->SkinnedInfo, filename) ||
+            (m3dLoader.ConvertM3d(filename, binaryFilename) &&
+             m3dLoader.OpenM3dBinary(binaryFilename, model->Binary, model->Subsets, model->Mats, model->SkinnedInfo));
+        if (mapped)
+        {
+            model->VertexData = model->Binary.GetVertices();
+            model->VertexCount = model->Binary.GetHeader().VertexCount;
+            model->IndexData = model->Binary.GetIndices();
+            model->IndexCount = model->Binary.GetHeader().IndexCount;
+        }
+        else
+        {
+            if (!m3dLoader.LoadM3d(filename, model->Vertices, model->Indices, model->Subsets, model->Mats, model->SkinnedInfo))
+                return nullptr;
+
+            //   ״ ΰ, ¸ ﰢ  ĳ ,  ó ̴  ٽ þ´.
+#if defined(DEBUG) || defined(_DEBUG)
+            MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(model->Indices.data(), (UINT)model->Indices.size());
+#endif
+            for (const auto& subset : model->Subsets)
+            {
+                MeshOptimizer::OptimizeRange(model->Vertices.data(), subset.VertexStart, subset.VertexCount,
+                    model->Indices.data() + subset.FaceStart * 3, subset.FaceCount * 3);
+            }
+#if defined(DEBUG) || defined(_DEBUG)
+            LogMeshOptimization("soldier", before,
+                MeshOptimizer::AnalyzeVertexCache(model->Indices.data(), (UINT)model->Indices.size()));
+#endif
+
+            model->VertexData = model->Vertices.data();
+            model->VertexCount = (UINT)model->Vertices.size();
+            model->IndexData = model->Indices.data();
+            model->IndexCount = (UINT)model->Indices.size();
+        }
 
-        void* vertexDataBuff = nullptr;
-        CD3DX12_RANGE vertexRange(0, 0);
-        geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-        memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-        geo->VertexBuffer->Unmap(0, nullptr);
+#if defined(DEBUG) || defined(_DEBUG)
+        // ¸ ޽ .  ȯ z     ݽð  ո̴.
+        // ޽ CPU  ε  Ƿ, ε ̸ ε  ȮѴ.
+        if (!mapped || model->Binary.CheckMeshIndices())
+        {
+            MeshletBuilder::MeshletSet meshlets;
+            for (const auto& subset : model->Subsets)
+            {
+                MeshletBuilder::Build(model->VertexData, model->IndexData + subset.FaceStart * 3,
+                    subset.FaceCount * 3, meshlets, true);
+            }
+            LogMeshletCulling("soldier", meshlets, aspect);
+        }
+#endif
 
-        geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-        geo->VertexView.StrideInBytes = sizeof(SkinnedVertex);
-        geo->VertexView.SizeInBytes = vbByteSize;
+        // GPU  ȭ  ø.   ״ д.
+        if (mUsePackedVertices)
+        {
+            VertexCompression::Compress(model->VertexData, model->VertexCount, model->PackedVertices, model->PosDequant);
+#if defined(DEBUG) || defined(_DEBUG)
+            LogVertexCompression("soldier", model->VertexCount,
+                sizeof(M3DLoader::SkinnedVertex), sizeof(VertexCompression::PackedSkinnedVertex),
+                VertexCompression::MeasureError(model->VertexData, model->VertexCount, model->PackedVertices, model->PosDequant));
+#endif
+        }
 
-        // ε   
-        geo->IndexCount = (UINT)indices.size();
-        const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
+        // Ʈ  ̵ νϽ ű  , Ŭ ڸ Ѵ.
+        model->SkinnedInfo.ExtractRootMotion();
 
-        heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
+        //   Ǵ Ű .
+        model->SkinnedInfo.ReduceAnimations(KeyframeTolerance());
+
+        return [this, model]() { UploadSkinnedModel(*model); };
+    });
+}
+
+void InitDirect3DApp::UploadSkinnedModel(SkinnedModelPayload& model)
+{
+    //  ӿ  ִϸ̼   νϽ  ۸ ٲ  ִ.
+    // ٸ ڿ  Update   νϽ ȷƮ ٷ Ѵ.
+    mSkinnedUpdater->Wait();
+
+    mSkinnedInfo = std::move(model.SkinnedInfo);
+    mSkinnedSubsets = std::move(model.Subsets);
+    mSkinnedMats = std::move(model.Mats);
+
+    //  븦  𵨳 Ŭ    .
+    mAnimationLibrary.Share(mSkinnedInfo);
+
+    assert(mSkinnedInfo.BoneCount() <= BonePalette::MaxBones);
+
+    mPoseCache = std::make_unique<PoseCache>(mSkinnedInfo, 1.0f / 60.0f, 1 << 20);
+
+    if (mUseBakedAnimation)
+    {
+        mBakedAnimation.Bake(mSkinnedInfo, mBakedFramesPerSecond);
+
+        //  ȷƮ 
+        const UINT paletteByteSize = (UINT)mBakedAnimation.GetByteSize();
+
+        D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(paletteByteSize);
 
         md3dDevice->CreateCommittedResource(
             &heapProperty,
@@ -617,24 +849,89 @@ void InitDirect3DApp::LoadSkinnedModel()
             &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ,
             nullptr,
-            IID_PPV_ARGS(&geo->IndexBuffer));
+            IID_PPV_ARGS(&mBakedPaletteBuffer));
+
+        void* paletteData = nullptr;
+        CD3DX12_RANGE paletteRange(0, 0);
+        mBakedPaletteBuffer->Map(0, &paletteRange, &paletteData);
+        memcpy(paletteData, mBakedAnimation.GetPaletteRows().data(), paletteByteSize);
+        mBakedPaletteBuffer->Unmap(0, nullptr);
+    }
+
+    for (UINT i = 0; i < mSkinnedInstanceCount; ++i)
+    {
+        auto inst = std::make_unique<SkinnedModelInstance>();
+        inst->SkinnedInfo = &mSkinnedInfo;
+        inst->Cache = mPoseCache.get();
+        inst->FinalTransforms.resize(mSkinnedInfo.BoneCount());
+        if (mUseBakedAnimation)
+            inst->Baked = &mBakedAnimation;
+        inst->SetClip("Take1");
+
+        //  Ȱ  ʵ  ð ݾ ߳ Ѵ.
+        float clipLength = inst->Clip->GetClipEndTime() - inst->Clip->GetClipStartTime();
+        if (clipLength > 0.0f)
+            inst->TimePos += fmodf(0.37f * i, clipLength);
+        inst->LodFrame = i;
+
+        mSkinnedModelInsts.push_back(std::move(inst));
+    }
+
+    // ̳ʸ о ε Ͽ ٷ ø.  ε ܰ谡  Ǯ.
+    const void* vertexData = model.VertexData;
+    UINT vertexStride = sizeof(SkinnedVertex);
+    if (mUsePackedVertices)
+    {
+        vertexData = model.PackedVertices.data();
+        vertexStride = sizeof(VertexCompression::PackedSkinnedVertex);
+    }
 
-        void* indexDataBuff = nullptr;
-        CD3DX12_RANGE indexRange(0, 0);
-        geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-        memcpy(indexDataBuff, indices.data(), ibByteSize);
-        geo->IndexBuffer->Unmap(0, nullptr);
+    //  ü   ø,    ε  ׸.
+    mSkinnedModel.Upload(md3dDevice.Get(), "soldier", vertexData, model.VertexCount, vertexStride,
+        model.IndexData, model.IndexCount, mSkinnedSubsets);
+#if defined(DEBUG) || defined(_DEBUG)
+    LogModelMemory("soldier", mSkinnedModel);
+#endif
 
-        geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-        geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-        geo->IndexView.SizeInBytes = ibByteSize;
+    for (UINT i = 0; i < mSkinnedModel.SubsetCount(); ++i)
+    {
+        auto geo = mSkinnedModel.CreateSubsetGeometry(i, "sm_" + std::to_string(i));
 
-        geo->IndexCount = mSkinnedSubsets[i].FaceCount * 3;
-        geo->StartIndexLocation = mSkinnedSubsets[i].FaceStart * 3;
-        geo->BaseVertexLocation = 0;
+        if (mUsePackedVertices)
+        {
+            geo->PosDequantScale = model.PosDequant.Scale;
+            geo->PosDequantOffset = model.PosDequant.Offset;
+        }
 
         mGeometries[geo->Name] = std::move(geo);
-    }   
+    }
+
+    // Skinned Model Texture add
+    for (UINT i = 0; i < (UINT)mSkinnedMats.size(); ++i)
+    {
+        std::string diffuseName = mSkinnedMats[i].DiffuseMapName;
+        std::string normalName = mSkinnedMats[i].NormalMapName;
+
+        std::wstring diffuseFilename = L"../Textures/" + AnsiToWString(diffuseName);
+        std::wstring normalFilename = L"../Textures/" + AnsiToWString(normalName);
+
+        diffuseName = diffuseName.substr(0, diffuseName.find_last_of("."));
+        normalName = normalName.substr(0, normalName.find_last_of("."));
+
+        if (mTextures.find(diffuseName) == mTextures.end())
+            RequestTexture(diffuseName, diffuseFilename);
+
+        if (mTextures.find(normalName) == mTextures.end())
+            RequestTexture(normalName, normalFilename);
+    }
+
+    // 𵨿   ͵: ؽó ڸ, ,  ׸,    ̴  
+    BuildDescriptorHeaps();
+    BuildSkinnedMaterials();
+    BuildSkinnedRenderItems();
+    BuildSkinnedShaders();
+    BuildPSO();
+    BuildConstantBuffers();
 }
 
 void InitDirect3DApp::LoadTextures()
@@ -663,35 +960,15 @@ void InitDirect3DApp::LoadTextures()
         L"../Textures/grasscube1024.dds",
     };
 
-    // Skinned Model Texture add
-    for (UINT i = 0; i < (UINT)mSkinnedMats.size(); ++i)
+    for (int i = 0; i < (int)texFileNames.size(); ++i)
     {
-        std::string diffuseName = mSkinnedMats[i].DiffuseMapName;
-        std::string normalName = mSkinnedMats[i].NormalMapName;
-
-        std::wstring diffuseFilename = L"../Textures/" + AnsiToWString(diffuseName);
-        std::wstring normalFilename = L"../Textures/" + AnsiToWString(normalName);
-
-        diffuseName = diffuseName.substr(0, diffuseName.find_last_of("."));
-        normalName = normalName.substr(0, normalName.find_last_of("."));
-
-        if (std::find(mSkinnedTextureNames.begin(), mSkinnedTextureNames.end(), diffuseName) == mSkinnedTextureNames.end())
+        //  ؽó ٷ о    ؽó ڸ  .
+        if (texNames[i] != "default")
         {
-            mSkinnedTextureNames.push_back(diffuseName);
-            texNames.push_back(diffuseName);
-            texFileNames.push_back(diffuseFilename);
-        }
-
-        if (std::find(mSkinnedTextureNames.begin(), mSkinnedTextureNames.end(), normalName) == mSkinnedTextureNames.end())
-        {
-            mSkinnedTextureNames.push_back(normalName);
-            texNames.push_back(normalName);
-            texFileNames.push_back(normalFilename);
+            RequestTexture(texNames[i], texFileNames[i]);
+            continue;
         }
-    }
 
-    for (int i = 0; i < (int)texFileNames.size(); ++i)
-    {
         auto texMap = std::make_unique<TextureInfo>();
         texMap->Name = texNames[i];
         texMap->Filename = texFileNames[i];
@@ -700,10 +977,45 @@ void InitDirect3DApp::LoadTextures()
             texMap->Resource, texMap->UploadHeap));
         
         mTextures[texMap->Name] = std::move(texMap);
+        mSrvTextureNames.push_back(texNames[i]);
     }
 }
 
-void InitDirect3DApp::BuildBoxGeometry()
+void InitDirect3DApp::RequestTexture(const std::string& name, const std::wstring& filename)
+{
+    auto texMap = std::make_unique<TextureInfo>();
+    texMap->Name = name;
+    texMap->Filename = filename;
+    mTextures[texMap->Name] = std::move(texMap);
+    mSrvTextureNames.push_back(name);
+
+    //  Ʈ 忡 а, ҽ      忡 Ѵ.
+    mAssetStreamer->Request([this, name, filename]() -> AssetStreamer::UploadStep
+    {
+        auto ddsData = std::make_shared<std::vector<BYTE>>();
+        if (!AssetStreamer::ReadFile(filename, *ddsData))
+            return nullptr;
+
+        return [this, name, ddsData]()
+        {
+            TextureInfo* texMap = mTextures[name].get();
+            ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(md3dDevice.Get(),
+                mCommandList.Get(), ddsData->data(), ddsData->size(),
+                texMap->Resource, texMap->UploadHeap));
+
+            BuildTextureDescriptor(TextureHeapIndex(name));
+        };
+    });
+}
+
+UINT InitDirect3DApp::TextureHeapIndex(const std::string& name)const
+{
+    auto it = std::find(mSrvTextureNames.begin(), mSrvTextureNames.end(), name);
+    assert(it != mSrvTextureNames.end());
+    return (UINT)(it - mSrvTextureNames.begin());
+}
+
+void InitDirect3DApp::BuildBoxGeometry(GeometryBuilder& builder)
 {
     GeometryGenerator geoGen;
     GeometryGenerator::MeshData box = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3);
@@ -720,68 +1032,21 @@ void InitDirect3DApp::BuildBoxGeometry()
         vertices[k].Tangent = box.Vertices[i].TangentU;
     }
 
-    // ε 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-
     //   Է
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Box";
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
-
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
-
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
-
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
-
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
-
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
-
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
+    //  ε ڿ LOD ε ̾ ø
+    std::vector<std::uint32_t> lodIndices;
+    BuildMeshLods(geo->Name.c_str(), vertices, box.Indices32, lodIndices, geo->Lods, geo->LodBounds);
 
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+    //   ڸ ε  Build  
+    builder.Add(geo.get(), vertices, lodIndices);
 
     mGeometries[geo->Name] = std::move(geo);
 }
 
-void InitDirect3DApp::BuildGridGeometry()
+void InitDirect3DApp::BuildGridGeometry(GeometryBuilder& builder)
 {
     GeometryGenerator geoGen;
     GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
@@ -798,68 +1063,21 @@ void InitDirect3DApp::BuildGridGeometry()
         vertices[k].Tangent = grid.Vertices[i].TangentU;
     }
 
-    // ε 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-
     //   Է
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Grid";
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
-
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
-
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
-
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
+    //  ε ڿ LOD ε ̾ ø
+    std::vector<std::uint32_t> lodIndices;
+    BuildMeshLods(geo->Name.c_str(), vertices, grid.Indices32, lodIndices, geo->Lods, geo->LodBounds);
 
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
-
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
-
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
-
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+    //   ڸ ε  Build  
+    builder.Add(geo.get(), vertices, lodIndices);
 
     mGeometries[geo->Name] = std::move(geo);
 }
 
-void InitDirect3DApp::BuildSphereGeometry()
+void InitDirect3DApp::BuildSphereGeometry(GeometryBuilder& builder)
 {
     GeometryGenerator geoGen;
     GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
@@ -876,68 +1094,21 @@ void InitDirect3DApp::BuildSphereGeometry()
         vertices[k].Tangent = sphere.Vertices[i].TangentU;
     }
 
-    // ε 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-
     //   Է
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Sphere";
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
+    //  ε ڿ LOD ε ̾ ø
+    std::vector<std::uint32_t> lodIndices;
+    BuildMeshLods(geo->Name.c_str(), vertices, sphere.Indices32, lodIndices, geo->Lods, geo->LodBounds);
 
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
-
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
-
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
-
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
-
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
-
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
-
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+    //   ڸ ε  Build  
+    builder.Add(geo.get(), vertices, lodIndices);
 
     mGeometries[geo->Name] = std::move(geo);
 }
 
-void InitDirect3DApp::BuildCylinderGeometry()
+void InitDirect3DApp::BuildCylinderGeometry(GeometryBuilder& builder)
 {
     GeometryGenerator geoGen;
     GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
@@ -954,68 +1125,21 @@ void InitDirect3DApp::BuildCylinderGeometry()
         vertices[k].Tangent = cylinder.Vertices[i].TangentU;
     }
 
-    // ε 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
-
     //   Է
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Cylinder";
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
-
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
-
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
-
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
-
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
-
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
+    //  ε ڿ LOD ε ̾ ø
+    std::vector<std::uint32_t> lodIndices;
+    BuildMeshLods(geo->Name.c_str(), vertices, cylinder.Indices32, lodIndices, geo->Lods, geo->LodBounds);
 
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
-
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
-
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+    //   ڸ ε  Build  
+    builder.Add(geo.get(), vertices, lodIndices);
 
     mGeometries[geo->Name] = std::move(geo);
 }
 
-void InitDirect3DApp::BuildQuadGeometry()
+void InitDirect3DApp::BuildQuadGeometry(GeometryBuilder& builder)
 {
     GeometryGenerator geoGen;
     GeometryGenerator::MeshData quad = geoGen.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
@@ -1032,159 +1156,271 @@ void InitDirect3DApp::BuildQuadGeometry()
         vertices[k].Tangent = quad.Vertices[i].TangentU;
     }
 
-    // ε 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(quad.GetIndices16()), std::end(quad.GetIndices16()));
-
     //   Է
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Quad";
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
+    //   ڸ ε  Build  
+    builder.Add(geo.get(), vertices, quad.Indices32);
 
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
-
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
+    mGeometries[geo->Name] = std::move(geo);
+}
 
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogMeshOptimization(const char* name,
+    const MeshOptimizer::CacheStats& before, const MeshOptimizer::CacheStats& after)
+{
+    char text[160];
+    sprintf_s(text, "mesh %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+        name, before.Acmr, after.Acmr, before.Atvr, after.Atvr);
+    OutputDebugStringA(text);
+}
+#endif
 
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogVertexCompression(const char* name, UINT vertexCount, UINT stride, UINT packedStride,
+    const VertexCompression::ErrorStats& error)
+{
+    char text[256];
+    sprintf_s(text, "mesh %s: %u -> %u bytes per vertex, vertex buffer %u -> %u KB; "
+        "max error position %g, normal %.3f deg, tangent %.3f deg, uv %g, weight %g\n",
+        name, stride, packedStride, vertexCount * stride / 1024, vertexCount * packedStride / 1024,
+        error.MaxPosition, error.MaxNormalDegrees, error.MaxTangentDegrees, error.MaxUv, error.MaxWeight);
+    OutputDebugStringA(text);
+}
+#endif
 
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::uint16_t);
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogMeshletCulling(const char* name, const MeshletBuilder::MeshletSet& meshlets, float aspect)
+{
+    if (meshlets.Bounds.empty())
+        return;
 
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
+    // ޽ ü δ 
+    BoundingSphere bounds(meshlets.Bounds[0].Center, meshlets.Bounds[0].Radius);
+    for (const auto& b : meshlets.Bounds)
+    {
+        BoundingSphere merged;
+        BoundingSphere::CreateMerged(merged, bounds, BoundingSphere(b.Center, b.Radius));
+        bounds = merged;
+    }
 
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
+    // ޽ ѷ 10  ̺ ī޶, ָ   ̿  
+    const UINT steps = 36;
+    const float distances[] = { 3.0f, 1.0f };
 
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
+    for (float distance : distances)
+    {
+        UINT total = 0;
+        UINT frustumCulled = 0;
+        UINT backfaceCulled = 0;
 
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R16_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+        for (UINT step = 0; step < steps; ++step)
+        {
+            float angle = MathHelper::Pi * 2.0f * step / steps;
+            XMFLOAT3 eye(
+                bounds.Center.x + distance * bounds.Radius * sinf(angle),
+                bounds.Center.y,
+                bounds.Center.z - distance * bounds.Radius * cosf(angle));
+
+            Camera camera;
+            camera.SetLens(0.25f * MathHelper::Pi, aspect, 1.0f, 1000.0f);
+            camera.LookAt(eye, bounds.Center, XMFLOAT3(0.0f, 1.0f, 0.0f));
+            camera.UpdateViewMatrix();
+
+            MeshletBuilder::CullStats stats =
+                MeshletBuilder::Cull(meshlets, MeshletBuilder::MakeCullFrustum(camera, XMMatrixIdentity()));
+            total += stats.Total;
+            frustumCulled += stats.FrustumCulled;
+            backfaceCulled += stats.BackfaceCulled;
+        }
 
-    mGeometries[geo->Name] = std::move(geo);
+        char text[256];
+        sprintf_s(text, "meshlets %s: %u meshlets, %.1f vertices and %.1f triangles each; "
+            "turntable at %.0fx radius culls %.1f%% (frustum %.1f%%, back face %.1f%%)\n",
+            name, (UINT)meshlets.Meshlets.size(),
+            (float)meshlets.VertexIndices.size() / meshlets.Meshlets.size(),
+            (float)meshlets.Triangles.size() / 3 / meshlets.Meshlets.size(),
+            distance, 100.0f * (frustumCulled + backfaceCulled) / total,
+            100.0f * frustumCulled / total, 100.0f * backfaceCulled / total);
+        OutputDebugStringA(text);
+    }
 }
+#endif
 
-void InitDirect3DApp::BuildSkullGeometry()
+void InitDirect3DApp::BuildMeshLods(const char* name, const std::vector<Vertex>& vertices,
+    const std::vector<std::uint32_t>& indices, std::vector<std::uint32_t>& chain,
+    std::vector<MeshLod>& lods, BoundingSphere& bounds)
 {
-    std::ifstream fin("../Models/skull.txt");
-    if (!fin)
+    //  ޽ ܼȭ    ϳ LOD0  д.
+    if (vertices.empty() || indices.empty())
     {
-        MessageBox(0, L"../Models/skull.txt not found.", 0, 0);
+        chain = indices;
+        lods.assign(1, MeshLod());
+        lods[0].IndexCount = (UINT)indices.size();
+        bounds = BoundingSphere();
         return;
     }
 
-    UINT vCount = 0;
-    UINT tCount = 0;
+    BoundingSphere::CreateFromPoints(bounds, vertices.size(), &vertices.data()->Pos, sizeof(Vertex));
 
-    std::string ignore;
+    //     10%  Ѵ.
+    MeshSimplifier::BuildLodChain(vertices, indices, 0.1f * bounds.Radius, chain, lods);
 
-    fin >> ignore >> vCount;
-    fin >> ignore >> tCount;
-    fin >> ignore >> ignore >> ignore >> ignore;
+    // ܼȭ LOD  ﰢ   ĳÿ ° ٽ þ´.
+    for (size_t i = 1; i < lods.size(); ++i)
+        MeshOptimizer::OptimizeVertexCache(&chain[lods[i].StartIndexLocation], lods[i].IndexCount);
 
-    std::vector<Vertex> vertices(vCount);
-    for (UINT i = 0; i < vCount; ++i)
+#if defined(DEBUG) || defined(_DEBUG)
+    std::string text = std::string("mesh ") + name + ":";
+    for (size_t i = 0; i < lods.size(); ++i)
     {
-        fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-        fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+        char lodText[128];
+        sprintf_s(lodText, "%s LOD%u %u triangles, error %.4f (%.1f%% of radius)",
+            i > 0 ? ";" : "", (UINT)i, lods[i].IndexCount / 3, lods[i].Error, 100.0f * lods[i].Error / bounds.Radius);
+        text += lodText;
     }
+    text += "\n";
+    OutputDebugStringA(text.c_str());
+#endif
+}
+
+#if defined(DEBUG) || defined(_DEBUG)
+void InitDirect3DApp::LogLodSavings()
+{
+    //  ġ  ߽ 鼭 10  ڷ  ī޶
+    const UINT steps = 8;
+    const float stepDistance = 10.0f;
+    const float viewportHeight = (float)mClientHeight;
 
-    fin >> ignore;
-    fin >> ignore;
-    fin >> ignore;
+    Camera camera;
+    camera.SetLens(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
 
-    std::vector<std::int32_t> indices(tCount * 3);
-    for (UINT i = 0; i < tCount; ++i)
+    UINT64 pathFull = 0;
+    UINT64 pathDrawn = 0;
+
+    for (UINT step = 0; step <= steps; ++step)
     {
-        fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+        float distance = step * stepDistance;
+        camera.LookAt(XMFLOAT3(0.0f, 2.0f + 0.25f * distance, -15.0f - distance),
+            XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+        camera.UpdateViewMatrix();
+
+        // LOD   ׸ 
+        UINT full = 0;
+        UINT drawn = 0;
+        for (const auto& e : mRenderitems)
+        {
+            if (e->Geo == nullptr || e->Geo->Lods.empty())
+                continue;
+
+            UINT lod = MeshSimplifier::SelectLod(*e->Geo, XMLoadFloat4x4(&e->World), camera,
+                viewportHeight, mLodPixelError);
+            full += e->Geo->Lods[0].IndexCount / 3;
+            drawn += e->Geo->Lods[lod].IndexCount / 3;
+        }
+
+        if (full == 0)
+            return;
+
+        char text[160];
+        sprintf_s(text, "lod path: %.0f units back, %u of %u triangles (%.1f%% saved)\n",
+            distance, drawn, full, 100.0f * (full - drawn) / full);
+        OutputDebugStringA(text);
+
+        pathFull += full;
+        pathDrawn += drawn;
     }
 
-    fin.close();
+    char text[160];
+    sprintf_s(text, "lod path: %llu of %llu triangles over %u views (%.1f%% saved)\n",
+        pathDrawn, pathFull, steps + 1, 100.0 * (pathFull - pathDrawn) / pathFull);
+    OutputDebugStringA(text);
+}
+#endif
 
-    //   Է
+void InitDirect3DApp::RequestSkullGeometry()
+{
+    //  ׸ ų  ϸ   ΰ, ۴ ϸ ä.
     auto geo = std::make_unique<GeometryInfo>();
     geo->Name = "Skull";
+    mGeometries[geo->Name] = std::move(geo);
 
-    //    
-    geo->VertexCount = (UINT)vertices.size();
-    const UINT vbByteSize = geo->VertexCount * sizeof(Vertex);
-
-    D3D12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
+    const float aspect = AspectRatio();
 
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->VertexBuffer));
+    mAssetStreamer->Request([this, aspect]() -> AssetStreamer::UploadStep
+    {
+        auto vertices = std::make_shared<std::vector<Vertex>>();
+        auto indices = std::make_shared<std::vector<std::int32_t>>();
 
-    void* vertexDataBuff = nullptr;
-    CD3DX12_RANGE vertexRange(0, 0);
-    geo->VertexBuffer->Map(0, &vertexRange, &vertexDataBuff);
-    memcpy(vertexDataBuff, vertices.data(), vbByteSize);
-    geo->VertexBuffer->Unmap(0, nullptr);
+        if (!LoadPosNormalModel("../Models/skull.txt", *vertices, *indices))
+            return []() { MessageBox(0, L"../Models/skull.txt not found.", 0, 0); };
 
-    geo->VertexView.BufferLocation = geo->VertexBuffer->GetGPUVirtualAddress();
-    geo->VertexView.StrideInBytes = sizeof(Vertex);
-    geo->VertexView.SizeInBytes = vbByteSize;
+        // ﰢ  ĳ ,  ó ̴  ٽ þ´.
+#if defined(DEBUG) || defined(_DEBUG)
+        MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(indices->data(), (UINT)indices->size());
+#endif
+        MeshOptimizer::OptimizeRange(vertices->data(), 0, (UINT)vertices->size(), indices->data(), (UINT)indices->size());
+#if defined(DEBUG) || defined(_DEBUG)
+        LogMeshOptimization("skull", before, MeshOptimizer::AnalyzeVertexCache(indices->data(), (UINT)indices->size()));
+#endif
 
-    // ε   
-    geo->IndexCount = (UINT)indices.size();
-    const UINT ibByteSize = geo->IndexCount * sizeof(std::int32_t);
+#if defined(DEBUG) || defined(_DEBUG)
+        // ȭ  ޽ , ̺ ī޶ ޽ ø .
+        MeshletBuilder::MeshletSet meshlets;
+        MeshletBuilder::Build(vertices->data(), indices->data(), (UINT)indices->size(), meshlets);
+        LogMeshletCulling("skull", meshlets, aspect);
+#endif
 
-    heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    desc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
+        //  ε ڿ ܼȭ LOD  ε մ´.
+        auto lodIndices = std::make_shared<std::vector<std::uint32_t>>();
+        auto lods = std::make_shared<std::vector<MeshLod>>();
+        BoundingSphere lodBounds;
+        BuildMeshLods("Skull", *vertices, std::vector<std::uint32_t>(indices->begin(), indices->end()),
+            *lodIndices, *lods, lodBounds);
 
-    md3dDevice->CreateCommittedResource(
-        &heapProperty,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&geo->IndexBuffer));
+        if (!mUsePackedVertices)
+        {
+            return [this, vertices, lodIndices, lods, lodBounds]()
+            {
+                BuildSkullGeometry(vertices->data(), (UINT)vertices->size(), sizeof(Vertex),
+                    *lodIndices, *lods, lodBounds, VertexCompression::PositionDequant());
+            };
+        }
 
-    void* indexDataBuff = nullptr;
-    CD3DX12_RANGE indexRange(0, 0);
-    geo->IndexBuffer->Map(0, &indexRange, &indexDataBuff);
-    memcpy(indexDataBuff, indices.data(), ibByteSize);
-    geo->IndexBuffer->Unmap(0, nullptr);
+        // ġ    16Ʈ,  źƮ 8ü 16Ʈ  , UV  half  δ.
+        auto packed = std::make_shared<std::vector<VertexCompression::PackedVertex>>();
+        VertexCompression::PositionDequant dequant;
+        VertexCompression::Compress(*vertices, *packed, dequant);
+#if defined(DEBUG) || defined(_DEBUG)
+        LogVertexCompression("skull", (UINT)vertices->size(), sizeof(Vertex), sizeof(VertexCompression::PackedVertex),
+            VertexCompression::MeasureError(*vertices, *packed, dequant));
+#endif
 
-    geo->IndexView.BufferLocation = geo->IndexBuffer->GetGPUVirtualAddress();
-    geo->IndexView.Format = DXGI_FORMAT_R32_UINT;
-    geo->IndexView.SizeInBytes = ibByteSize;
+        return [this, packed, lodIndices, lods, lodBounds, dequant]()
+        {
+            BuildSkullGeometry(packed->data(), (UINT)packed->size(), sizeof(VertexCompression::PackedVertex),
+                *lodIndices, *lods, lodBounds, dequant);
+        };
+    });
+}
 
-    mGeometries[geo->Name] = std::move(geo);
+void InitDirect3DApp::BuildSkullGeometry(const void* vertexData, UINT vertexCount, UINT vertexStride,
+    const std::vector<std::uint32_t>& indices, const std::vector<MeshLod>& lods,
+    const BoundingSphere& lodBounds, const VertexCompression::PositionDequant& dequant)
+{
+    //   Է
+    GeometryInfo* geo = mGeometries["Skull"].get();
+    geo->PosDequantScale = dequant.Scale;
+    geo->PosDequantOffset = dequant.Offset;
+    geo->Lods = lods;
+    geo->LodBounds = lodBounds;
+
+    // Ʈ ߿ ϹǷ ۸  .
+    //  65536    16Ʈ ε پ.
+    GeometryBuilder builder;
+    builder.Add(geo, vertexData, vertexCount, vertexStride, indices);
+    builder.Build(md3dDevice.Get());
 }
 
 void InitDirect3DApp::BuildMaterials()
@@ -1252,16 +1488,24 @@ void InitDirect3DApp::BuildMaterials()
     skybox->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
     skybox->Roughness = 1.0f;
     mMaterials[skybox->Name] = std::move(skybox);
+}
 
-    UINT matCBIndex = 7;
-    UINT srvHeapIndex = mSkinnedSrvHeapStart;
+void InitDirect3DApp::BuildSkinnedMaterials()
+{
+    UINT matCBIndex = (UINT)mMaterials.size();
     for (UINT i = 0; i < (UINT)mSkinnedMats.size(); ++i)
     {
+        std::string diffuseName = mSkinnedMats[i].DiffuseMapName;
+        std::string normalName = mSkinnedMats[i].NormalMapName;
+
+        diffuseName = diffuseName.substr(0, diffuseName.find_last_of("."));
+        normalName = normalName.substr(0, normalName.find_last_of("."));
+
         auto mat = std::make_unique<MaterialInfo>();
         mat->Name = mSkinnedMats[i].Name;
         mat->MatCBIndex = matCBIndex++;
-        mat->DiffuseSrvHeapIndex = srvHeapIndex++;
-        mat->NormalSrvHeapIndex = srvHeapIndex++;
+        mat->DiffuseSrvHeapIndex = TextureHeapIndex(diffuseName);
+        mat->NormalSrvHeapIndex = TextureHeapIndex(normalName);
         mat->DiffuseAlbedo = mSkinnedMats[i].DiffuseAlbedo;
         mat->FresnelR0 = mSkinnedMats[i].FresnelR0;
         mat->Roughness = mSkinnedMats[i].Roughness;
@@ -1311,7 +1555,7 @@ void InitDirect3DApp::BuildRenderItems()
     skullRItem->Geo = mGeometries["Skull"].get();
     skullRItem->Mat = mMaterials["skull"].get();
     skullRItem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    mRitemLayer[(int)RenderLayer::Opaque].push_back(skullRItem.get());
+    mRitemLayer[(int)(mUsePackedVertices ? RenderLayer::PackedOpaque : RenderLayer::Opaque)].push_back(skullRItem.get());
     mRenderitems.push_back(std::move(skullRItem));
 
     auto quadRItem = std::make_unique<RenderItem>();
@@ -1374,27 +1618,42 @@ void InitDirect3DApp::BuildRenderItems()
         mRitemLayer[(int)RenderLayer::Opaque].push_back(rightSpRItem.get());
         mRenderitems.push_back(std::move(rightSpRItem));
     }
+}
 
-    for (UINT i = 0; i < (UINT)mSkinnedMats.size(); ++i)
+void InitDirect3DApp::BuildSkinnedRenderItems()
+{
+    UINT objectCBIndex = (UINT)mRenderitems.size();
+    for (UINT inst = 0; inst < (UINT)mSkinnedModelInsts.size(); ++inst)
     {
-        std::string meshName = "sm_" + std::to_string(i);
+        // νϽ 10   ġ
+        float x = 2.0f * (inst % 10);
+        float z = -5.0f - 2.0f * (inst / 10);
 
-        auto ritem = std::make_unique<RenderItem>();
+        //  ׸ νϽ  ȯ 󰣴 (Ʈ  δ).
         XMMATRIX scale = XMMatrixScaling(0.05f, 0.05f, -0.05f);
         XMMATRIX rotate = XMMatrixRotationY(MathHelper::Pi);
-        XMMATRIX pos = XMMatrixTranslation(0.0f, 0.0f, -5.0f);
-        XMStoreFloat4x4(&ritem->World, scale * rotate * pos);
-
-        ritem->TexTransform = MathHelper::Identity4x4();
-        ritem->ObjCBIndex = objectCBIndex++;
-        ritem->Mat = mMaterials[mSkinnedMats[i].Name].get();
-        ritem->Geo = mGeometries[meshName].get();
-        ritem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-        ritem->SkinnedCBIndex = 0;
-        ritem->SkinnedModelInst = mSkinnedModelInst.get();
-        mRitemLayer[(int)RenderLayer::SkinnedOpaque].push_back(ritem.get());
-        mRenderitems.push_back(std::move(ritem));
+        XMMATRIX pos = XMMatrixTranslation(x, 0.0f, z);
+        XMStoreFloat4x4(&mSkinnedModelInsts[inst]->World, scale * rotate * pos);
+        mSkinnedModelInsts[inst]->Position = XMFLOAT3(x, 0.0f, z);
+
+        for (UINT i = 0; i < (UINT)mSkinnedMats.size(); ++i)
+        {
+            std::string meshName = "sm_" + std::to_string(i);
+
+            auto ritem = std::make_unique<RenderItem>();
+            ritem->World = mSkinnedModelInsts[inst]->World;
+
+            ritem->TexTransform = MathHelper::Identity4x4();
+            ritem->ObjCBIndex = objectCBIndex++;
+            ritem->Mat = mMaterials[mSkinnedMats[i].Name].get();
+            ritem->Geo = mGeometries[meshName].get();
+            ritem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+            ritem->SkinnedCBIndex = inst;
+            ritem->SkinnedModelInst = mSkinnedModelInsts[inst].get();
+            mRitemLayer[(int)RenderLayer::SkinnedOpaque].push_back(ritem.get());
+            mRenderitems.push_back(std::move(ritem));
+        }
     }
 
 }
@@ -1416,7 +1675,25 @@ void InitDirect3DApp::BuildInputLayout()
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "WEIGHTS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "BONEINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 56, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BONEINDICES", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 56, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    mPackedInputLayout =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    mPackedSkinnedInputLayout =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "WEIGHTS", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BONEINDICES", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
 }
 
@@ -1435,14 +1712,14 @@ void InitDirect3DApp::BuildShaders()
         NULL, NULL
     };
 
-    const D3D_SHADER_MACRO skinnedDefines[] =
+    const D3D_SHADER_MACRO packedDefines[] =
     {
-        "SKINNED", "1",
+        "PACKED_VERTEX", "1",
         NULL, NULL
     };
 
     mShaders["standardVS"] = d3dUtil::CompileShader(L"Color.hlsl", nullptr, "VS", "vs_5_0");
-    mShaders["skinnedVS"] = d3dUtil::CompileShader(L"Color.hlsl", skinnedDefines, "VS", "vs_5_0");
+    mShaders["packedVS"] = d3dUtil::CompileShader(L"Color.hlsl", packedDefines, "VS", "vs_5_0");
     mShaders["opaquePS"] = d3dUtil::CompileShader(L"Color.hlsl", defines, "PS", "ps_5_0");
     mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Color.hlsl", alphaTestDefines, "PS", "ps_5_0");
 
@@ -1450,11 +1727,68 @@ void InitDirect3DApp::BuildShaders()
     mShaders["skyboxPS"] = d3dUtil::CompileShader(L"Skybox.hlsl", nullptr, "PS", "ps_5_0");
 
     mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shadow.hlsl", nullptr, "VS", "vs_5_0");
-    mShaders["skinnedshadowVS"] = d3dUtil::CompileShader(L"Shadow.hlsl", skinnedDefines, "VS", "vs_5_0");
+    mShaders["packedShadowVS"] = d3dUtil::CompileShader(L"Shadow.hlsl", packedDefines, "VS", "vs_5_0");
     mShaders["shadowPS"] = d3dUtil::CompileShader(L"Shadow.hlsl", nullptr, "PS", "ps_5_0");
 
     mShaders["debugVS"] = d3dUtil::CompileShader(L"ShadowDebug.hlsl", nullptr, "VS", "vs_5_0");
     mShaders["debugPS"] = d3dUtil::CompileShader(L"ShadowDebug.hlsl", nullptr, "PS", "ps_5_0");
+
+    BuildSkinnedShaders();
+}
+
+void InitDirect3DApp::BuildSkinnedShaders()
+{
+    //  ȷƮ ҷ   ŭ Ѵ.  ϱ   .
+    const std::string maxBones = std::to_string(MathHelper::Max(mSkinnedInfo.BoneCount(), 1u));
+
+    const D3D_SHADER_MACRO skinnedDefines[] =
+    {
+        "SKINNED", "1",
+        "MAX_BONES", maxBones.c_str(),
+        NULL, NULL
+    };
+
+    const D3D_SHADER_MACRO bakedSkinnedDefines[] =
+    {
+        "SKINNED", "1",
+        "BAKED_ANIMATION", "1",
+        NULL, NULL
+    };
+
+    const D3D_SHADER_MACRO palette3x4Defines[] =
+    {
+        "SKINNED", "1",
+        "PALETTE_3X4", "1",
+        "MAX_BONES", maxBones.c_str(),
+        NULL, NULL
+    };
+
+    const D3D_SHADER_MACRO paletteDQDefines[] =
+    {
+        "SKINNED", "1",
+        "PALETTE_DQ", "1",
+        "MAX_BONES", maxBones.c_str(),
+        NULL, NULL
+    };
+
+    const D3D_SHADER_MACRO* skinnedVSDefines = skinnedDefines;
+    if (mUseBakedAnimation)
+        skinnedVSDefines = bakedSkinnedDefines;
+    else if (mBonePaletteFormat == BonePalette::Format::Affine3x4)
+        skinnedVSDefines = palette3x4Defines;
+    else if (mBonePaletteFormat == BonePalette::Format::DualQuaternion)
+        skinnedVSDefines = paletteDQDefines;
+
+    // ȭ ̸ PACKED_VERTEX  δ.
+    std::vector<D3D_SHADER_MACRO> vsDefines;
+    for (const D3D_SHADER_MACRO* define = skinnedVSDefines; define->Name != NULL; ++define)
+        vsDefines.push_back(*define);
+    if (mUsePackedVertices)
+        vsDefines.push_back({ "PACKED_VERTEX", "1" });
+    vsDefines.push_back({ NULL, NULL });
+
+    mShaders["skinnedVS"] = d3dUtil::CompileShader(L"Color.hlsl", vsDefines.data(), "VS", "vs_5_0");
+    mShaders["skinnedshadowVS"] = d3dUtil::CompileShader(L"Shadow.hlsl", vsDefines.data(), "VS", "vs_5_0");
 }
 
 void InitDirect3DApp::BuildConstantBuffers()
@@ -1509,9 +1843,8 @@ void InitDirect3DApp::BuildConstantBuffers()
 
     mPassCB->Map(0, nullptr, reinterpret_cast<void**>(&mPassMappedData));
 
-    // Bone Transform  
-    size = sizeof(SkinnedConstants);
-    mSkinnedByteSize = ((size + 255) & ~255);
+    // Bone Transform   (νϽ  , 񵿱 忡   )
+    mSkinnedByteSize = SkinnedRegionByteSize() * mSkinnedUpdater->RegionCount();
     heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
     desc = CD3DX12_RESOURCE_DESC::Buffer(mSkinnedByteSize);
 
@@ -1524,6 +1857,7 @@ void InitDirect3DApp::BuildConstantBuffers()
         IID_PPV_ARGS(&mSkinnedCB));
 
     mSkinnedCB->Map(0, nullptr, reinterpret_cast<void**>(&mSkinnedMappedData));
+    mSkinnedUpdater->SetTarget(mSkinnedMappedData, SkinnedCBByteSize(), SkinnedRegionByteSize());
 }
 
 void InitDirect3DApp::BuildRootSignature()
@@ -1548,7 +1882,7 @@ void InitDirect3DApp::BuildRootSignature()
         CD3DX12_DESCRIPTOR_RANGE(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3), // t3 : Shadow Texture
     };
 
-    CD3DX12_ROOT_PARAMETER param[8];
+    CD3DX12_ROOT_PARAMETER param[9];
     param[0].InitAsConstantBufferView(0); // 0 -> b0 -> CBV //  Ʈ  
     param[1].InitAsConstantBufferView(1); // 1 -> b1 -> CBV //  Ʈ  
     param[2].InitAsConstantBufferView(2); // 2 -> b2 -> CBV //   
@@ -1557,6 +1891,7 @@ void InitDirect3DApp::BuildRootSignature()
     param[5].InitAsDescriptorTable(_countof(normalTable), normalTable);
     param[6].InitAsDescriptorTable(_countof(shadowTable), shadowTable);
     param[7].InitAsConstantBufferView(3); // 3 -> b3 -> CBV // Bone Transform 
+    param[8].InitAsShaderResourceView(4); // t4 :  ִϸ̼ ȷƮ
 
     auto staticSamplers = GetStaticSamplers();
 
@@ -1577,7 +1912,7 @@ void InitDirect3DApp::BuildDescriptorHeaps()
     // Create the SRV heap.
     //
     D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-    srvHeapDesc.NumDescriptors = (int)mTextures.size() + 1;     //  ؽó ׸  ؽó  ߰
+    srvHeapDesc.NumDescriptors = (int)mSrvTextureNames.size() + 1;     //  ؽó ׸  ؽó  ߰
     srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -1585,54 +1920,11 @@ void InitDirect3DApp::BuildDescriptorHeaps()
     //
     // Fill out the heap with actual descriptors.
     //
-    CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+    for (UINT i = 0; i < (UINT)mSrvTextureNames.size(); ++i)
+        BuildTextureDescriptor(i);
 
-    std::vector<ComPtr<ID3D12Resource>> tex2DList =
-    {
-        mTextures["bricks"]->Resource,
-        mTextures["bricksNormal"]->Resource,
-        mTextures["stone"]->Resource,
-        mTextures["tile"]->Resource,
-        mTextures["tileNormal"]->Resource,
-        mTextures["fence"]->Resource, 
-        mTextures["default"]->Resource,
-    };
-
-    mSkinnedSrvHeapStart = (UINT)tex2DList.size();
-
-    for (UINT i = 0; i < (UINT)mSkinnedTextureNames.size(); ++i)
-    {
-        auto texResource = mTextures[mSkinnedTextureNames[i]]->Resource;
-        assert(texResource != nullptr);
-        tex2DList.push_back(texResource);
-    }
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MostDetailedMip = 0;
-    srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-    for (int i = 0; i < (int)tex2DList.size(); ++i)
-    {
-        srvDesc.Format = tex2DList[i]->GetDesc().Format;
-        srvDesc.Texture2D.MipLevels = tex2DList[i]->GetDesc().MipLevels;
-        md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, hDescriptor);
-
-        // next descriptor
-        hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-    }
-
-    auto skyCubeMap = mTextures["skyCubeMap"]->Resource;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    srvDesc.TextureCube.MostDetailedMip = 0;
-    srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
-    srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-    srvDesc.Format = skyCubeMap->GetDesc().Format;
-    md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-
-    mSkyboxTexHeapIndex = (UINT)tex2DList.size();
-    mShadowMapHeapIndex = mSkyboxTexHeapIndex + 1;
+    mSkyboxTexHeapIndex = TextureHeapIndex("skyCubeMap");
+    mShadowMapHeapIndex = (UINT)mSrvTextureNames.size();
 
     auto srvCpuStart = mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
     auto srvGpuStart = mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
@@ -1647,6 +1939,39 @@ void InitDirect3DApp::BuildDescriptorHeaps()
         CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvCpuStart, 1, mDsvDescriptorSize));
 }
 
+void InitDirect3DApp::BuildTextureDescriptor(UINT heapIndex)
+{
+    const std::string& name = mSrvTextureNames[heapIndex];
+    const bool isCubeMap = (name == "skyCubeMap");
+
+    //    ؽó  ؽó, ť   ڷ ä д.
+    ID3D12Resource* resource = mTextures[name]->Resource.Get();
+    if (resource == nullptr && !isCubeMap)
+        resource = mTextures["default"]->Resource.Get();
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = resource != nullptr ? resource->GetDesc().Format : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    if (isCubeMap)
+    {
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+        srvDesc.TextureCube.MostDetailedMip = 0;
+        srvDesc.TextureCube.MipLevels = resource != nullptr ? resource->GetDesc().MipLevels : 1;
+        srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
+    }
+    else
+    {
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MostDetailedMip = 0;
+        srvDesc.Texture2D.MipLevels = resource->GetDesc().MipLevels;
+        srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+    }
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), heapIndex, mCbvSrvDescriptorSize);
+    md3dDevice->CreateShaderResourceView(resource, &srvDesc, hDescriptor);
+}
+
 void InitDirect3DApp::BuildPSO()
 {
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
@@ -1679,11 +2004,26 @@ void InitDirect3DApp::BuildPSO()
     opaquePsoDesc.DSVFormat = mDepthStencilFormat;
     ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
 
+    //
+    // PSO for quantized vertices
+    //
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC packedPsoDesc = opaquePsoDesc;
+    packedPsoDesc.InputLayout = { mPackedInputLayout.data(), (UINT)mPackedInputLayout.size() };
+    packedPsoDesc.VS =
+    {
+        reinterpret_cast<BYTE*>(mShaders["packedVS"]->GetBufferPointer()),
+        mShaders["packedVS"]->GetBufferSize()
+    };
+    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&packedPsoDesc, IID_PPV_ARGS(&mPSOs["packedOpaque"])));
+
     // 
     // PSO for skinned pass
     //
+    const std::vector<D3D12_INPUT_ELEMENT_DESC>& skinnedInputLayout =
+        mUsePackedVertices ? mPackedSkinnedInputLayout : mSkinnedInputLayout;
+
     D3D12_GRAPHICS_PIPELINE_STATE_DESC skinnedPsoDesc = opaquePsoDesc;
-    skinnedPsoDesc.InputLayout = { mSkinnedInputLayout.data(), (UINT)mSkinnedInputLayout.size() };
+    skinnedPsoDesc.InputLayout = { skinnedInputLayout.data(), (UINT)skinnedInputLayout.size() };
     skinnedPsoDesc.VS =
     {
         reinterpret_cast<BYTE*>(mShaders["skinnedVS"]->GetBufferPointer()),
@@ -1774,11 +2114,20 @@ void InitDirect3DApp::BuildPSO()
 
     ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&shadowPsoDesc, IID_PPV_ARGS(&mPSOs["shadow"])));
 
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC packedShadowPsoDesc = shadowPsoDesc;
+    packedShadowPsoDesc.InputLayout = { mPackedInputLayout.data(), (UINT)mPackedInputLayout.size() };
+    packedShadowPsoDesc.VS =
+    {
+        reinterpret_cast<BYTE*>(mShaders["packedShadowVS"]->GetBufferPointer()),
+        mShaders["packedShadowVS"]->GetBufferSize()
+    };
+    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&packedShadowPsoDesc, IID_PPV_ARGS(&mPSOs["packedShadow"])));
+
     //
     // PSO for Shadow map pass
     //
     D3D12_GRAPHICS_PIPELINE_STATE_DESC skinnedshadowPsoDesc = shadowPsoDesc;
-    skinnedshadowPsoDesc.InputLayout = { mSkinnedInputLayout.data(), (UINT)mSkinnedInputLayout.size() };
+    skinnedshadowPsoDesc.InputLayout = { skinnedInputLayout.data(), (UINT)skinnedInputLayout.size() };
     skinnedshadowPsoDesc.VS =
     {
         reinterpret_cast<BYTE*>(mShaders["skinnedshadowVS"]->GetBufferPointer()),
@@ -1808,6 +2157,23 @@ void InitDirect3DApp::BuildPSO()
     ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&debugPsoDesc, IID_PPV_ARGS(&mPSOs["debug"])));
 }
 
+UINT InitDirect3DApp::SkinnedRegionByteSize()const
+{
+    // νϽ  ؾ Ƿ   ´.
+    return SkinnedCBByteSize() * mSkinnedInstanceCount;
+}
+
+UINT InitDirect3DApp::SkinnedCBByteSize()const
+{
+    if (mUseBakedAnimation)
+        return d3dUtil::CalcConstantBufferByteSize(sizeof(BakedSkinnedConstants));
+
+    // ̴ ȷƮ MAX_BONES     ŭ Ѵ.
+    UINT boneCount = MathHelper::Max(mSkinnedInfo.BoneCount(), 1u);
+    UINT paletteByteSize = boneCount * BonePalette::Stride(mBonePaletteFormat) * sizeof(XMFLOAT4);
+    return d3dUtil::CalcConstantBufferByteSize(paletteByteSize);
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 2> InitDirect3DApp::GetStaticSamplers()
 {
     const CD3DX12_STATIC_SAMPLER_DESC pointWarp(
@@ -9,7 +9,21 @@
 #include "../Common/Camera.h"
 #include "ShadowMap.h"
 #include "LoadM3d.h"
+#include "M3dBinary.h"
+#include "LoadPosNormal.h"
 #include "SkinnedData.h"
+#include "AnimationLibrary.h"
+#include "JobSystem.h"
+#include "SkinnedInstanceUpdater.h"
+#include "BakedAnimation.h"
+#include "AssetStreamer.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "VertexCompression.h"
+#include "GeometryBuilder.h"
+#include "ModelResource.h"
+#include "MeshSimplifier.h"
+#include <chrono>
 
 class InitDirect3DApp : public D3DApp
 {
@@ -26,6 +40,7 @@ private:
 	
 	virtual void Update(const GameTimer& gt)override;
 	void UpdateCamera(const GameTimer& gt);
+	void UpdateLods();
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateShadowTransform(const GameTimer& gt);
@@ -45,42 +60,113 @@ private:
 	virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
 private:
-	// Skinned Model ε
-	void LoadSkinnedModel();
+	// Ʈ 忡 о  Ű 
+	struct SkinnedModelPayload
+	{
+		// ̳ʸ   ε  ʰ ε  ״ .
+		// ؽƮ о  Vertices, Indices  .
+		M3dBinaryFile Binary;
+		std::vector<M3DLoader::SkinnedVertex> Vertices;
+		std::vector<std::uint16_t> Indices;
+		std::vector<M3DLoader::Subset> Subsets;
+		std::vector<M3DLoader::M3dMaterial> Mats;
+		SkinnedData SkinnedInfo;
+
+		// Binary  Vertices, Indices    Ų.
+		const M3DLoader::SkinnedVertex* VertexData = nullptr;
+		UINT VertexCount = 0;
+		const std::uint16_t* IndexData = nullptr;
+		UINT IndexCount = 0;
+
+		// mUsePackedVertices   GPU  ø ȭ 
+		std::vector<VertexCompression::PackedSkinnedVertex> PackedVertices;
+		VertexCompression::PositionDequant PosDequant;
+	};
+
+	// Ʈ    ̿ GPU  ø.
+	void UploadStreamedAssets();
+#if defined(DEBUG) || defined(_DEBUG)
+	void LogStartupTime(const char* what);
+#endif
+
+	// Skinned Model ε û, ϸ νϽ ,  ׸ .
+	void RequestSkinnedModel();
+	void UploadSkinnedModel(SkinnedModelPayload& model);
+#if defined(DEBUG) || defined(_DEBUG)
+	//  ۸ ؼ پ ũ 
+	static void LogModelMemory(const char* name, const ModelResource& model);
+	//  ϰ  , ε  ũ  ( ۴   )
+	void LogGeometryMemory();
+#endif
+
+	//  ε ڿ ܼȭ LOD  ε մ´.  忡 LOD  ﰢ   
+	static void BuildMeshLods(const char* name, const std::vector<Vertex>& vertices,
+		const std::vector<std::uint32_t>& indices, std::vector<std::uint32_t>& chain,
+		std::vector<MeshLod>& lods, DirectX::BoundingSphere& bounds);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	//  ĳ ȭ  ACMR, ATVR 
+	static void LogMeshOptimization(const char* name,
+		const MeshOptimizer::CacheStats& before, const MeshOptimizer::CacheStats& after);
+	//    ũ   
+	static void LogVertexCompression(const char* name, UINT vertexCount, UINT stride, UINT packedStride,
+		const VertexCompression::ErrorStats& error);
+	// ޽ ũ, ޽ ѷ  ī޶󿡼 øǴ ޽  
+	static void LogMeshletCulling(const char* name, const MeshletBuilder::MeshletSet& meshlets, float aspect);
+	// ־ ī޶ ο LOD  پ ﰢ  
+	void LogLodSavings();
+#endif
 
 	// ؽó ε
 	void LoadTextures();
+	void RequestTexture(const std::string& name, const std::wstring& filename);
+	void BuildTextureDescriptor(UINT heapIndex);
+	UINT TextureHeapIndex(const std::string& name)const;
 
 	// SRV  
 	void BuildDescriptorHeaps();
 
 	//   
-	void BuildBoxGeometry();
-	void BuildGridGeometry();
-	void BuildSphereGeometry();
-	void BuildCylinderGeometry();
-	void BuildQuadGeometry();
-	void BuildSkullGeometry();
+	void BuildBoxGeometry(GeometryBuilder& builder);
+	void BuildGridGeometry(GeometryBuilder& builder);
+	void BuildSphereGeometry(GeometryBuilder& builder);
+	void BuildCylinderGeometry(GeometryBuilder& builder);
+	void BuildQuadGeometry(GeometryBuilder& builder);
+	void RequestSkullGeometry();
+	void BuildSkullGeometry(const void* vertexData, UINT vertexCount, UINT vertexStride,
+		const std::vector<std::uint32_t>& indices, const std::vector<MeshLod>& lods,
+		const DirectX::BoundingSphere& lodBounds, const VertexCompression::PositionDequant& dequant);
 
 	//  
 	void BuildMaterials();
+	void BuildSkinnedMaterials();
 
 	//    
 	void BuildRenderItems();
+	void BuildSkinnedRenderItems();
 
 	void BuildInputLayout();
 	void BuildShaders();
+	void BuildSkinnedShaders();
 	void BuildConstantBuffers();
 	void BuildRootSignature();
 	void BuildPSO();
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 2> GetStaticSamplers();
 
+	// νϽ ϳ  Bone Transform    ũ
+	UINT SkinnedCBByteSize()const;
+	//  νϽ    ϳ ũ
+	UINT SkinnedRegionByteSize()const;
+
 private:
 	// Է ġ
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 	// Ű ִϸ̼ǿ Է ġ
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mSkinnedInputLayout;
+	// ȭ  Է ġ (VertexCompression::PackedVertex, PackedSkinnedVertex)
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mPackedInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mPackedSkinnedInputLayout;
 
 	//  Ʈ  
 	ComPtr<ID3D12Resource>	mObjectCB = nullptr;
@@ -129,6 +215,9 @@ private:
 
 	// ؽó 
 	std::unordered_map<std::string, std::unique_ptr<TextureInfo>> mTextures;
+
+	// SRV  ̴  ؽó ̸. ׸    ڸ.
+	std::vector<std::string> mSrvTextureNames;
 	
 	// ׸  
 	std::unique_ptr<ShadowMap> mShadowMap;
@@ -143,14 +232,63 @@ private:
 	CD3DX12_GPU_DESCRIPTOR_HANDLE mShadowMapSrv;
 
 	// Skinned Model Data
-	UINT mSkinnedSrvHeapStart = 0;
 	std::string mSkinnedModelFilename = "..\\Models\\soldier.m3d";
 	SkinnedData mSkinnedInfo;
 	std::vector<M3DLoader::Subset> mSkinnedSubsets;
 	std::vector<M3DLoader::M3dMaterial> mSkinnedMats;
-	std::vector<std::string> mSkinnedTextureNames;
-
-	std::unique_ptr<SkinnedModelInstance> mSkinnedModelInst;
+	//  ü  , ε .  (sm_i)  .
+	ModelResource mSkinnedModel;
+
+	// Ű  νϽ (νϽ SkinnedCB  ϳ)
+	UINT mSkinnedInstanceCount = 1;
+	std::vector<std::unique_ptr<SkinnedModelInstance>> mSkinnedModelInsts;
+
+	// 밡  𵨵 ϴ Ŭ
+	AnimationLibrary mAnimationLibrary;
+
+	// νϽ ϴ  ĳ (1/60 , ִ 1MB)
+	std::unique_ptr<PoseCache> mPoseCache;
+
+	// ī޶󿡼 ־    ø   .
+	bool mUseAnimationLod = true;
+	AnimationLodPolicy mAnimationLod;
+
+	//  ȷƮ  (Color.hlsl/Shadow.hlsl  PALETTE_3X4, PALETTE_DQ)
+	BonePalette::Format mBonePaletteFormat = BonePalette::Format::Affine3x4;
+
+	//  Ŭ ̸  ȷƮ. Ѹ νϽ   
+	// ȷƮ ġ ϳ ø, ̴ ۿ  д´.
+	bool mUseBakedAnimation = false;
+	float mBakedFramesPerSecond = 60.0f;
+	BakedAnimation mBakedAnimation;
+	ComPtr<ID3D12Resource> mBakedPaletteBuffer;
+
+	// ҷ (ذ, Ű )  ȭؼ ø (44 -> 20, 64 -> 32 Ʈ).
+	// ̴ PACKED_VERTEX  Ǯ .
+	bool mUsePackedVertices = true;
+
+	//   ذ ܼȭ LOD   ÷ ΰ,  ȭ鿡
+	// mLodPixelError ȼ Ϸ ̴  ģ LOD  ׸.
+	bool mUseMeshLod = true;
+	float mLodPixelError = 1.0f;
+
+	// ִϸ̼ ſ Ŀ 
+	std::unique_ptr<JobSystem> mJobSystem;
+
+	// 𵨰 ؽó  д Ʈ . ϱ   ؽó
+	//  , ϴ ׸ ʴ´.
+	std::unique_ptr<AssetStreamer> mAssetStreamer;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// ۺ ù , Ʈ Ϸ ð 
+	std::chrono::steady_clock::time_point mStartTime;
+	bool mFirstFrameLogged = false;
+#endif
+
+	// Ѹ   ȷƮ ̹  ׸ ļ Ѵ.
+	//  ۴     : ϳ ׸ , ϳ  .
+	bool mAsyncAnimation = true;
+	std::unique_ptr<SkinnedInstanceUpdater> mSkinnedUpdater;
 
 	//  
 	DirectX::BoundingSphere mSceneBounds;
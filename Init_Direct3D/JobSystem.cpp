@@ -0,0 +1,142 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(UINT numWorkers)
+{
+	if (numWorkers == 0)
+	{
+		UINT hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (UINT i = 0; i < numWorkers + 1; ++i)
+		mQueues.push_back(std::make_unique<WorkQueue>());
+
+	for (UINT i = 0; i < numWorkers; ++i)
+		mWorkers.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mQuit = true;
+	}
+	mWakeCV.notify_all();
+
+	for (auto& worker : mWorkers)
+		worker.join();
+}
+
+UINT JobSystem::ThreadCount()const
+{
+	return (UINT)mWorkers.size() + 1;
+}
+
+void JobSystem::ParallelFor(UINT count, UINT grainSize, const std::function<void(UINT, UINT)>& job)
+{
+	if (count == 0)
+		return;
+
+	grainSize = MathHelper::Max(grainSize, 1u);
+
+	// Without workers, or with a single chunk, skip the queues entirely.
+	if (mWorkers.empty() || count <= grainSize)
+	{
+		job(0, count);
+		return;
+	}
+
+	UINT numTasks = (count + grainSize - 1) / grainSize;
+	std::atomic<UINT> pending{ numTasks };
+
+	// Counted before they are pushed, so a worker popping one can never
+	// take the count below zero.
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mQueuedTasks += numTasks;
+	}
+
+	// Deal the chunks out round robin so every queue starts with a share.
+	for (UINT i = 0; i < numTasks; ++i)
+	{
+		Task task;
+		task.Job = &job;
+		task.Pending = &pending;
+		task.Begin = i * grainSize;
+		task.End = MathHelper::Min(task.Begin + grainSize, count);
+
+		WorkQueue& queue = *mQueues[i % mQueues.size()];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Tasks.push_back(task);
+	}
+	mWakeCV.notify_all();
+
+	// The calling thread works too until its own chunks are all done,
+	// whichever call the chunks it picks up belong to.
+	while (pending.load() != 0)
+	{
+		Task task;
+		if (PopOrSteal(0, task))
+			Run(task);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerMain(UINT queueIndex)
+{
+	for (;;)
+	{
+		Task task;
+		if (PopOrSteal(queueIndex, task))
+		{
+			Run(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mWakeMutex);
+		mWakeCV.wait(lock, [this] { return mQuit || mQueuedTasks.load() != 0; });
+
+		if (mQuit)
+			return;
+	}
+}
+
+bool JobSystem::PopOrSteal(UINT queueIndex, Task& task)
+{
+	// Own queue first, newest task (still warm in cache).
+	{
+		WorkQueue& queue = *mQueues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty())
+		{
+			task = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			--mQueuedTasks;
+			return true;
+		}
+	}
+
+	// Steal the oldest task of the next non-empty queue.
+	const UINT numQueues = (UINT)mQueues.size();
+	for (UINT i = 1; i < numQueues; ++i)
+	{
+		WorkQueue& queue = *mQueues[(queueIndex + i) % numQueues];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty())
+		{
+			task = queue.Tasks.front();
+			queue.Tasks.pop_front();
+			--mQueuedTasks;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Run(const Task& task)
+{
+	(*task.Job)(task.Begin, task.End);
+	--*task.Pending;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+///<summary>
+/// Small fork/join worker pool.  Every worker owns a queue; it pops its own
+/// work from the back and steals from the front of the other queues when it
+/// runs dry.  The thread that calls ParallelFor gets a queue as well and
+/// works until the whole range is done, so a pool with zero workers simply
+/// runs everything inline.
+///
+/// Every ParallelFor call counts its own unfinished chunks, so several
+/// threads can call it at once; callers share queue 0 and may run each
+/// other's chunks while they wait.
+///</summary>
+class JobSystem
+{
+public:
+	// numWorkers == 0 uses one worker per hardware thread, minus the caller.
+	explicit JobSystem(UINT numWorkers = 0);
+
+	JobSystem(const JobSystem& rhs)=delete;
+	JobSystem& operator=(const JobSystem& rhs)=delete;
+	~JobSystem();
+
+	// Workers plus the calling thread.
+	UINT ThreadCount()const;
+
+	// Splits [0, count) into chunks of grainSize elements and runs
+	// job(begin, end) on each chunk.  Returns once every chunk has run.
+	void ParallelFor(UINT count, UINT grainSize, const std::function<void(UINT, UINT)>& job);
+
+private:
+	struct Task
+	{
+		const std::function<void(UINT, UINT)>* Job = nullptr;
+		// Chunks of the ParallelFor call this one belongs to still running.
+		std::atomic<UINT>* Pending = nullptr;
+		UINT Begin = 0;
+		UINT End = 0;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	void WorkerMain(UINT queueIndex);
+
+	// Pops from the back of our own queue, otherwise steals from the front
+	// of another one.
+	bool PopOrSteal(UINT queueIndex, Task& task);
+
+	void Run(const Task& task);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	// Queue 0 belongs to the calling thread, queue i+1 to worker i.
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+
+	std::mutex mWakeMutex;
+	std::condition_variable mWakeCV;
+	bool mQuit = false;
+
+	// Tasks sitting in a queue.
+	std::atomic<UINT> mQueuedTasks{ 0 };
+};
@@ -1,14 +1,47 @@
 #include "LoadM3d.h"
+#include "M3dBinary.h"
+#include "MeshOptimizer.h"
+#include "SkeletonCompiler.h"
+#include <algorithm>
  
 using namespace DirectX;
 
+namespace
+{
+	// The exporter labels every offset "BoneOffset<index>", which says
+	// nothing the bone index does not.  Such labels are not kept as names,
+	// so name matching (retargeting) cannot mistake bone order for names.
+	std::string BoneNameFromLabel(const std::string& label)
+	{
+		const char prefix[] = "BoneOffset";
+		const size_t prefixLength = sizeof(prefix) - 1;
+
+		bool placeholder = label.size() > prefixLength && label.compare(0, prefixLength, prefix) == 0 &&
+			std::all_of(label.begin() + prefixLength, label.end(), [](char c) { return c >= '0' && c <= '9'; });
+
+		return placeholder ? std::string() : label;
+	}
+
+	bool SubsetsInRange(const std::vector<M3DLoader::Subset>& subsets, UINT numVertices, UINT numTriangles)
+	{
+		for(const M3DLoader::Subset& subset : subsets)
+		{
+			if( subset.VertexStart > numVertices || subset.VertexCount > numVertices - subset.VertexStart ||
+				subset.FaceStart > numTriangles || subset.FaceCount > numTriangles - subset.FaceStart )
+				return false;
+		}
+
+		return true;
+	}
+}
+
 bool M3DLoader::LoadM3d(const std::string& filename, 
 						std::vector<Vertex>& vertices,
 						std::vector<USHORT>& indices,
 						std::vector<Subset>& subsets,
 						std::vector<M3dMaterial>& mats)
 {
-	std::ifstream fin(filename);
+	TextTokenizer fin;
 
 	UINT numMaterials = 0;
 	UINT numVertices  = 0;
@@ -16,23 +49,19 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 	UINT numBones     = 0;
 	UINT numAnimationClips = 0;
 
-	std::string ignore;
-
-	if( fin )
+	if( fin.Open(filename) )
 	{
-		fin >> ignore; // file header text
-		fin >> ignore >> numMaterials;
-		fin >> ignore >> numVertices;
-		fin >> ignore >> numTriangles;
-		fin >> ignore >> numBones;
-		fin >> ignore >> numAnimationClips;
+		ReadHeader(fin, numMaterials, numVertices, numTriangles, numBones, numAnimationClips);
+		if( numVertices > MaxVertices )
+			return false;
  
 		ReadMaterials(fin, numMaterials, mats);
 		ReadSubsetTable(fin, numMaterials, subsets);
 	    ReadVertices(fin, numVertices, vertices);
 	    ReadTriangles(fin, numTriangles, indices);
  
-		return true;
+		// A short or garbled file reads as zeros; do not hand those out.
+		return !fin.Fail();
 	 }
     return false;
 }
@@ -44,7 +73,8 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 						std::vector<M3dMaterial>& mats,
 						SkinnedData& skinInfo)
 {
-    std::ifstream fin(filename);
+	TextTokenizer fin;
+	mParallelSections = 0;
 
 	UINT numMaterials = 0;
 	UINT numVertices  = 0;
@@ -52,18 +82,14 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 	UINT numBones     = 0;
 	UINT numAnimationClips = 0;
 
-	std::string ignore;
-
-	if( fin )
+	if( fin.Open(filename) )
 	{
-		fin >> ignore; // file header text
-		fin >> ignore >> numMaterials;
-		fin >> ignore >> numVertices;
-		fin >> ignore >> numTriangles;
-		fin >> ignore >> numBones;
-		fin >> ignore >> numAnimationClips;
+		ReadHeader(fin, numMaterials, numVertices, numTriangles, numBones, numAnimationClips);
+		if( numVertices > MaxVertices )
+			return false;
  
 		std::vector<XMFLOAT4X4> boneOffsets;
+		std::vector<std::string> boneNames;
 		std::vector<int> boneIndexToParentIndex;
 		std::unordered_map<std::string, AnimationClip> animations;
 
@@ -71,187 +97,498 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 		ReadSubsetTable(fin, numMaterials, subsets);
 	    ReadSkinnedVertices(fin, numVertices, vertices);
 	    ReadTriangles(fin, numTriangles, indices);
-		ReadBoneOffsets(fin, numBones, boneOffsets);
+		ReadBoneOffsets(fin, numBones, boneOffsets, boneNames);
 	    ReadBoneHierarchy(fin, numBones, boneIndexToParentIndex);
 	    ReadAnimationClips(fin, numBones, numAnimationClips, animations);
  
-		skinInfo.Set(boneIndexToParentIndex, boneOffsets, animations);
+		if( fin.Fail() )
+			return false;
 
-	    return true;
+		if( !skinInfo.Set(boneIndexToParentIndex, boneOffsets, animations, boneNames) )
+			return false;
+
+	    return RemapBoneIndices(skinInfo.GetBoneRemap(), vertices);
 	}
     return false;
 }
 
-void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats)
+void M3DLoader::SetJobSystem(JobSystem* jobSystem)
 {
-	 std::string ignore;
-     mats.resize(numMaterials);
+	mJobSystem = jobSystem;
+}
+
+UINT M3DLoader::GetParallelSectionCount()const
+{
+	return mParallelSections;
+}
+
+bool M3DLoader::ConvertM3d(const std::string& textFilename, const std::string& binaryFilename)
+{
+	TextTokenizer fin;
+	mParallelSections = 0;
+	if( !fin.Open(textFilename) )
+		return false;
+
+	UINT numMaterials = 0;
+	UINT numVertices  = 0;
+	UINT numTriangles = 0;
+	UINT numBones     = 0;
+	UINT numAnimationClips = 0;
+
+	UINT64 sourceSize = 0;
+	UINT64 sourceWriteTime = 0;
+	if( !M3dBinaryFile::GetSourceStamp(textFilename, sourceSize, sourceWriteTime) )
+		return false;
+
+	ReadHeader(fin, numMaterials, numVertices, numTriangles, numBones, numAnimationClips);
+	if( numVertices > MaxVertices )
+		return false;
+
+	std::vector<M3dMaterial> mats;
+	std::vector<Subset> subsets;
+	std::vector<SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<XMFLOAT4X4> boneOffsets;
+	std::vector<std::string> boneNames;
+	std::vector<int> boneIndexToParentIndex;
+	std::unordered_map<std::string, AnimationClip> animations;
+
+	ReadMaterials(fin, numMaterials, mats);
+	ReadSubsetTable(fin, numMaterials, subsets);
+	ReadSkinnedVertices(fin, numVertices, vertices);
+	ReadTriangles(fin, numTriangles, indices);
+	ReadBoneOffsets(fin, numBones, boneOffsets, boneNames);
+	ReadBoneHierarchy(fin, numBones, boneIndexToParentIndex);
+	ReadAnimationClips(fin, numBones, numAnimationClips, animations);
+
+	if( fin.Fail() || !SubsetsInRange(subsets, numVertices, numTriangles) )
+		return false;
+
+	// Store the bones in the order SkinnedData::Set gives them, so the load
+	// renumbers nothing and the vertices are used as they are in the file.
+	SkeletonCompiler compiler;
+	if( !compiler.Compile(boneIndexToParentIndex) ||
+		!compiler.Apply(boneIndexToParentIndex, boneOffsets, animations) ||
+		!RemapBoneIndices(compiler.GetBoneRemap(), vertices) )
+		return false;
+
+	std::vector<std::string> compiledBoneNames(numBones);
+	for(UINT i = 0; i < numBones; ++i)
+		compiledBoneNames[compiler.GetBoneRemap()[i]] = boneNames[i];
+
+	// Subset ranges stay where they are; each one's triangles go in vertex
+	// cache order and its vertices in the order the triangles first use them.
+	for(const Subset& subset : subsets)
+	{
+		MeshOptimizer::OptimizeRange(vertices.data(), subset.VertexStart, subset.VertexCount,
+			indices.data() + subset.FaceStart * 3, subset.FaceCount * 3);
+	}
+
+	return M3dBinaryFile::Write(binaryFilename, sourceSize, sourceWriteTime, mats, subsets, vertices, indices,
+		boneOffsets, boneIndexToParentIndex, compiledBoneNames, animations);
+}
+
+bool M3DLoader::OpenM3dBinary(const std::string& filename,
+						M3dBinaryFile& file,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats,
+						SkinnedData& skinInfo,
+						const std::string& sourceFilename)
+{
+	if( !file.Open(filename) )
+		return false;
+
+	if( !sourceFilename.empty() && !file.MatchesSource(sourceFilename) )
+	{
+		file.Close();
+		return false;
+	}
+
+	const M3dBinaryFile::Header& header = file.GetHeader();
+
+	mats.resize(header.MaterialCount);
+	for(UINT i = 0; i < header.MaterialCount; ++i)
+	{
+		const M3dBinaryFile::Material& m = file.GetMaterials()[i];
+
+		mats[i].Name = file.GetString(m.Name);
+		mats[i].MaterialTypeName = file.GetString(m.MaterialTypeName);
+		mats[i].DiffuseMapName = file.GetString(m.DiffuseMapName);
+		mats[i].NormalMapName = file.GetString(m.NormalMapName);
+		mats[i].DiffuseAlbedo = m.DiffuseAlbedo;
+		mats[i].FresnelR0 = m.FresnelR0;
+		mats[i].Roughness = m.Roughness;
+		mats[i].AlphaClip = m.AlphaClip != 0;
+	}
+
+	subsets.assign(file.GetSubsets(), file.GetSubsets() + header.SubsetCount);
+
+	const UINT numBones = header.BoneCount;
+
+	std::vector<XMFLOAT4X4> boneOffsets(file.GetBoneOffsets(), file.GetBoneOffsets() + numBones);
+	std::vector<int> boneIndexToParentIndex(file.GetBoneHierarchy(), file.GetBoneHierarchy() + numBones);
+
+	std::vector<std::string> boneNames(numBones);
+	for(UINT i = 0; i < numBones; ++i)
+		boneNames[i] = BoneNameFromLabel(file.GetBoneName(i));
+
+	std::unordered_map<std::string, AnimationClip> animations;
+	for(UINT c = 0; c < header.ClipCount; ++c)
+	{
+		AnimationClip& clip = animations[file.GetClipName(c)];
+		clip.BoneAnimations.resize(numBones);
+
+		for(UINT i = 0; i < numBones; ++i)
+		{
+			UINT count = 0;
+			const Keyframe* keyframes = file.GetKeyframes(c, i, count);
+			clip.BoneAnimations[i].Keyframes.assign(keyframes, keyframes + count);
+		}
+	}
+
+	// ConvertM3d stored the compiled order, so Set must keep every bone
+	// where it is; the mapped vertices cannot be remapped.
+	bool loaded = skinInfo.Set(boneIndexToParentIndex, boneOffsets, animations, boneNames);
+	for(UINT i = 0; loaded && i < numBones; ++i)
+		loaded = skinInfo.GetBoneRemap()[i] == i;
+
+	if( !loaded )
+		file.Close();
+
+	return loaded;
+}
 
-	 std::string diffuseMapName;
-	 std::string normalMapName;
+bool M3DLoader::LoadM3dBinary(const std::string& filename, 
+						std::vector<SkinnedVertex>& vertices,
+						std::vector<USHORT>& indices,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats,
+						SkinnedData& skinInfo,
+						const std::string& sourceFilename)
+{
+	M3dBinaryFile file;
+	if( !OpenM3dBinary(filename, file, subsets, mats, skinInfo, sourceFilename) )
+		return false;
+
+	// Copies can go anywhere, so check them like the text path does.
+	if( !file.CheckMeshIndices() )
+		return false;
+
+	const M3dBinaryFile::Header& header = file.GetHeader();
+	vertices.assign(file.GetVertices(), file.GetVertices() + header.VertexCount);
+	indices.assign(file.GetIndices(), file.GetIndices() + header.IndexCount);
+
+	return true;
+}
 
-     fin >> ignore; // materials header text
+bool M3DLoader::RemapBoneIndices(const std::vector<UINT>& boneRemap, std::vector<SkinnedVertex>& vertices)
+{
+	for(auto& v : vertices)
+	{
+		// A bone the skeleton does not have would index past the remap.
+		for(int j = 0; j < 4; ++j)
+		{
+			if( v.BoneIndices[j] >= boneRemap.size() )
+				return false;
+		}
+
+		for(int j = 0; j < 4; ++j)
+			v.BoneIndices[j] = (USHORT)boneRemap[v.BoneIndices[j]];
+	}
+
+	return true;
+}
+
+void M3DLoader::ReadHeader(TextTokenizer& fin, UINT& numMaterials, UINT& numVertices,
+						   UINT& numTriangles, UINT& numBones, UINT& numAnimationClips)
+{
+	fin.Skip(); // file header text
+	fin.Skip(); numMaterials = fin.ReadUInt();
+	fin.Skip(); numVertices = fin.ReadUInt();
+	fin.Skip(); numTriangles = fin.ReadUInt();
+	fin.Skip(); numBones = fin.ReadUInt();
+	fin.Skip(); numAnimationClips = fin.ReadUInt();
+}
+
+void M3DLoader::ReadMaterials(TextTokenizer& fin, UINT numMaterials, std::vector<M3dMaterial>& mats)
+{
+     mats.resize(numMaterials);
+
+     fin.Skip(); // materials header text
 	 for(UINT i = 0; i < numMaterials; ++i)
 	 {
-         fin >> ignore >> mats[i].Name;
-		 fin >> ignore >> mats[i].DiffuseAlbedo.x  >> mats[i].DiffuseAlbedo.y  >> mats[i].DiffuseAlbedo.z;
-		 fin >> ignore >> mats[i].FresnelR0.x >> mats[i].FresnelR0.y >> mats[i].FresnelR0.z;
-         fin >> ignore >> mats[i].Roughness;
-		 fin >> ignore >> mats[i].AlphaClip;
-		 fin >> ignore >> mats[i].MaterialTypeName;
-		 fin >> ignore >> mats[i].DiffuseMapName;
-		 fin >> ignore >> mats[i].NormalMapName;
+		 fin.Skip(); mats[i].Name = fin.ReadString();
+		 fin.Skip(); ReadFloats(fin, &mats[i].DiffuseAlbedo.x, 3);
+		 fin.Skip(); ReadFloats(fin, &mats[i].FresnelR0.x, 3);
+		 fin.Skip(); mats[i].Roughness = fin.ReadFloat();
+		 fin.Skip(); mats[i].AlphaClip = fin.ReadBool();
+		 fin.Skip(); mats[i].MaterialTypeName = fin.ReadString();
+		 fin.Skip(); mats[i].DiffuseMapName = fin.ReadString();
+		 fin.Skip(); mats[i].NormalMapName = fin.ReadString();
 		}
 }
 
-void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets)
+void M3DLoader::ReadSubsetTable(TextTokenizer& fin, UINT numSubsets, std::vector<Subset>& subsets)
 {
-    std::string ignore;
 	subsets.resize(numSubsets);
 
-	fin >> ignore; // subset header text
+	fin.Skip(); // subset header text
 	for(UINT i = 0; i < numSubsets; ++i)
 	{
-        fin >> ignore >> subsets[i].Id;
-		fin >> ignore >> subsets[i].VertexStart;
-		fin >> ignore >> subsets[i].VertexCount;
-		fin >> ignore >> subsets[i].FaceStart;
-		fin >> ignore >> subsets[i].FaceCount;
+		fin.Skip(); subsets[i].Id = fin.ReadUInt();
+		fin.Skip(); subsets[i].VertexStart = fin.ReadUInt();
+		fin.Skip(); subsets[i].VertexCount = fin.ReadUInt();
+		fin.Skip(); subsets[i].FaceStart = fin.ReadUInt();
+		fin.Skip(); subsets[i].FaceCount = fin.ReadUInt();
     }
 }
 
-void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices)
+void M3DLoader::ReadVertices(TextTokenizer& fin, UINT numVertices, std::vector<Vertex>& vertices)
 {
-	std::string ignore;
     vertices.resize(numVertices);
 
-    fin >> ignore; // vertices header text
+    fin.Skip(); // vertices header text
     for(UINT i = 0; i < numVertices; ++i)
     {
-	    fin >> ignore >> vertices[i].Pos.x      >> vertices[i].Pos.y      >> vertices[i].Pos.z;
-		fin >> ignore >> vertices[i].TangentU.x >> vertices[i].TangentU.y >> vertices[i].TangentU.z >> vertices[i].TangentU.w;
-	    fin >> ignore >> vertices[i].Normal.x   >> vertices[i].Normal.y   >> vertices[i].Normal.z;
-	    fin >> ignore >> vertices[i].TexC.x     >> vertices[i].TexC.y;
+		fin.Skip(); ReadFloats(fin, &vertices[i].Pos.x, 3);
+		fin.Skip(); ReadFloats(fin, &vertices[i].TangentU.x, 4);
+		fin.Skip(); ReadFloats(fin, &vertices[i].Normal.x, 3);
+		fin.Skip(); ReadFloats(fin, &vertices[i].TexC.x, 2);
     }
 }
 
-void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
+void M3DLoader::ReadSkinnedVertices(TextTokenizer& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
 {
-	std::string ignore;
     vertices.resize(numVertices);
 
-    fin >> ignore; // vertices header text
-	int boneIndices[4];
-	float weights[4];
-    for(UINT i = 0; i < numVertices; ++i)
+    fin.Skip(); // vertices header text
+
+	// Position, Tangent, Normal, Tex-Coords, BlendWeights and BlendIndices lines.
+	bool parsed = ReadRecordsParallel(fin, numVertices, 6, [&](TextTokenizer& chunk, UINT begin, UINT end)
+	{
+		ReadSkinnedVertexRange(chunk, begin, end, vertices.data());
+	});
+
+	if( !parsed )
+		ReadSkinnedVertexRange(fin, 0, numVertices, vertices.data());
+}
+
+void M3DLoader::ReadSkinnedVertexRange(TextTokenizer& fin, UINT begin, UINT end, SkinnedVertex* vertices)
+{
+    for(UINT i = begin; i < end; ++i)
     {
-        float blah;
-	    fin >> ignore >> vertices[i].Pos.x        >> vertices[i].Pos.y          >> vertices[i].Pos.z;
-		fin >> ignore >> vertices[i].TangentU.x   >> vertices[i].TangentU.y     >> vertices[i].TangentU.z >> blah /*vertices[i].TangentU.w*/;
-	    fin >> ignore >> vertices[i].Normal.x     >> vertices[i].Normal.y       >> vertices[i].Normal.z;
-	    fin >> ignore >> vertices[i].TexC.x       >> vertices[i].TexC.y;
-		fin >> ignore >> weights[0]     >> weights[1]     >> weights[2]     >> weights[3];
-		fin >> ignore >> boneIndices[0] >> boneIndices[1] >> boneIndices[2] >> boneIndices[3];
-
-		vertices[i].BoneWeights.x = weights[0];
-		vertices[i].BoneWeights.y = weights[1];
-		vertices[i].BoneWeights.z = weights[2];
-
-		vertices[i].BoneIndices[0] = (BYTE)boneIndices[0]; 
-		vertices[i].BoneIndices[1] = (BYTE)boneIndices[1]; 
-		vertices[i].BoneIndices[2] = (BYTE)boneIndices[2]; 
-		vertices[i].BoneIndices[3] = (BYTE)boneIndices[3]; 
+		fin.Skip(); ReadFloats(fin, &vertices[i].Pos.x, 3);
+		fin.Skip(); ReadFloats(fin, &vertices[i].TangentU.x, 3);
+		fin.Skip(); // TangentU.w
+		fin.Skip(); ReadFloats(fin, &vertices[i].Normal.x, 3);
+		fin.Skip(); ReadFloats(fin, &vertices[i].TexC.x, 2);
+
+		fin.Skip(); ReadFloats(fin, &vertices[i].BoneWeights.x, 3);
+		fin.Skip(); // the fourth weight, implied by the other three
+
+		fin.Skip();
+		for(int j = 0; j < 4; ++j)
+			vertices[i].BoneIndices[j] = (USHORT)fin.ReadInt();
     }
 }
 
-void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices)
+void M3DLoader::ReadTriangles(TextTokenizer& fin, UINT numTriangles, std::vector<USHORT>& indices)
 {
-	std::string ignore;
     indices.resize(numTriangles*3);
 
-    fin >> ignore; // triangles header text
-    for(UINT i = 0; i < numTriangles; ++i)
+    fin.Skip(); // triangles header text
+
+	bool parsed = ReadRecordsParallel(fin, numTriangles, 1, [&](TextTokenizer& chunk, UINT begin, UINT end)
+	{
+		ReadTriangleRange(chunk, begin, end, indices.data());
+	});
+
+	if( !parsed )
+		ReadTriangleRange(fin, 0, numTriangles, indices.data());
+}
+
+void M3DLoader::ReadTriangleRange(TextTokenizer& fin, UINT begin, UINT end, USHORT* indices)
+{
+    for(UINT i = begin*3; i < end*3; ++i)
     {
-        fin >> indices[i*3+0] >> indices[i*3+1] >> indices[i*3+2];
+        indices[i] = (USHORT)fin.ReadUInt();
     }
 }
  
-void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets)
+void M3DLoader::ReadBoneOffsets(TextTokenizer& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets,
+								std::vector<std::string>& boneNames)
 {
-	std::string ignore;
     boneOffsets.resize(numBones);
+	boneNames.resize(numBones);
 
-    fin >> ignore; // BoneOffsets header text
+    fin.Skip(); // BoneOffsets header text
     for(UINT i = 0; i < numBones; ++i)
     {
-        fin >> ignore >> 
-            boneOffsets[i](0,0) >> boneOffsets[i](0,1) >> boneOffsets[i](0,2) >> boneOffsets[i](0,3) >>
-            boneOffsets[i](1,0) >> boneOffsets[i](1,1) >> boneOffsets[i](1,2) >> boneOffsets[i](1,3) >>
-            boneOffsets[i](2,0) >> boneOffsets[i](2,1) >> boneOffsets[i](2,2) >> boneOffsets[i](2,3) >>
-            boneOffsets[i](3,0) >> boneOffsets[i](3,1) >> boneOffsets[i](3,2) >> boneOffsets[i](3,3);
+		// The label in front of each offset names the bone, unless it is
+		// the exporter's placeholder.
+		boneNames[i] = BoneNameFromLabel(fin.ReadString());
+		ReadFloats(fin, &boneOffsets[i]._11, 16);
     }
 }
 
-void M3DLoader::ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
+void M3DLoader::ReadBoneHierarchy(TextTokenizer& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
 {
-	std::string ignore;
     boneIndexToParentIndex.resize(numBones);
 
-    fin >> ignore; // BoneHierarchy header text
+    fin.Skip(); // BoneHierarchy header text
 	for(UINT i = 0; i < numBones; ++i)
 	{
-	    fin >> ignore >> boneIndexToParentIndex[i];
+		fin.Skip(); boneIndexToParentIndex[i] = fin.ReadInt();
 	}
 }
 
-void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, 
+void M3DLoader::ReadAnimationClips(TextTokenizer& fin, UINT numBones, UINT numAnimationClips, 
 								   std::unordered_map<std::string, AnimationClip>& animations)
 {
-	std::string ignore;
-    fin >> ignore; // AnimationClips header text
+    fin.Skip(); // AnimationClips header text
     for(UINT clipIndex = 0; clipIndex < numAnimationClips; ++clipIndex)
     {
-        std::string clipName;
-        fin >> ignore >> clipName;
-        fin >> ignore; // {
+		fin.Skip();
+		AnimationClip& clip = animations[fin.ReadString()];
+		fin.Skip(); // {
 
-		AnimationClip clip;
 		clip.BoneAnimations.resize(numBones);
 
-        for(UINT boneIndex = 0; boneIndex < numBones; ++boneIndex)
-        {
-            ReadBoneKeyframes(fin, numBones, clip.BoneAnimations[boneIndex]);
-        }
-        fin >> ignore; // }
-
-        animations[clipName] = clip;
+		if( !ReadBoneKeyframesParallel(fin, numBones, clip) )
+		{
+			for(UINT boneIndex = 0; boneIndex < numBones; ++boneIndex)
+			{
+				ReadBoneKeyframes(fin, numBones, clip.BoneAnimations[boneIndex]);
+			}
+		}
+        fin.Skip(); // }
     }
 }
 
-void M3DLoader::ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation)
+void M3DLoader::ReadBoneKeyframes(TextTokenizer& fin, UINT numBones, BoneAnimation& boneAnimation)
 {
-	std::string ignore;
-    UINT numKeyframes = 0;
-    fin >> ignore >> ignore >> numKeyframes;
-    fin >> ignore; // {
+	fin.Skip(2);
+	UINT numKeyframes = fin.ReadUInt();
+	fin.Skip(); // {
 
     boneAnimation.Keyframes.resize(numKeyframes);
+	ReadKeyframes(fin, numKeyframes, boneAnimation.Keyframes.data());
+
+    fin.Skip(); // }
+}
+
+void M3DLoader::ReadKeyframes(TextTokenizer& fin, UINT numKeyframes, Keyframe* keyframes)
+{
     for(UINT i = 0; i < numKeyframes; ++i)
     {
-        float t    = 0.0f;
-        XMFLOAT3 p(0.0f, 0.0f, 0.0f);
-        XMFLOAT3 s(1.0f, 1.0f, 1.0f);
-        XMFLOAT4 q(0.0f, 0.0f, 0.0f, 1.0f);
-        fin >> ignore >> t;
-        fin >> ignore >> p.x >> p.y >> p.z;
-        fin >> ignore >> s.x >> s.y >> s.z;
-        fin >> ignore >> q.x >> q.y >> q.z >> q.w;
-
-	    boneAnimation.Keyframes[i].TimePos      = t;
-        boneAnimation.Keyframes[i].Translation  = p;
-	    boneAnimation.Keyframes[i].Scale        = s;
-	    boneAnimation.Keyframes[i].RotationQuat = q;
+		Keyframe& key = keyframes[i];
+
+		fin.Skip(); key.TimePos = fin.ReadFloat();
+		fin.Skip(); ReadFloats(fin, &key.Translation.x, 3);
+		fin.Skip(); ReadFloats(fin, &key.Scale.x, 3);
+		fin.Skip(); ReadFloats(fin, &key.RotationQuat.x, 4);
     }
+}
 
-    fin >> ignore; // }
-}
\ No newline at end of file
+void M3DLoader::ReadFloats(TextTokenizer& fin, float* values, UINT count)
+{
+	for(UINT i = 0; i < count; ++i)
+		values[i] = fin.ReadFloat();
+}
+
+bool M3DLoader::ReadRecordsParallel(TextTokenizer& fin, UINT numRecords, UINT linesPerRecord,
+									const std::function<void(TextTokenizer&, UINT, UINT)>& readRange)
+{
+	if( mJobSystem == nullptr || numRecords <= ParseGrainSize || fin.Fail() )
+		return false;
+
+	const char* sectionStart = fin.Tell();
+	const UINT grainSize = ParseGrainSize;
+
+	// Only newlines are looked at here; the parse proper happens on the workers.
+	UINT numChunks = (numRecords + grainSize - 1) / grainSize;
+	std::vector<const char*> begins(numChunks);
+	std::vector<const char*> ends(numChunks);
+	for(UINT c = 0; c < numChunks; ++c)
+	{
+		UINT count = MathHelper::Min(grainSize, numRecords - c * grainSize);
+
+		begins[c] = fin.Tell();
+		fin.SkipLines(count * linesPerRecord);
+		ends[c] = fin.Tell();
+	}
+
+	bool parsed = !fin.Fail() && ReadChunksParallel(fin, begins, ends, [&](TextTokenizer& chunk, UINT c)
+	{
+		UINT begin = c * grainSize;
+		readRange(chunk, begin, MathHelper::Min(begin + grainSize, numRecords));
+	});
+
+	if( parsed )
+		++mParallelSections;
+	else
+		fin.Seek(sectionStart);
+
+	return parsed;
+}
+
+bool M3DLoader::ReadBoneKeyframesParallel(TextTokenizer& fin, UINT numBones, AnimationClip& clip)
+{
+	if( mJobSystem == nullptr || fin.Fail() )
+		return false;
+
+	const char* clipStart = fin.Tell();
+
+	// The "BoneN #Keyframes: N {" headers are read here, the keyframe lines
+	// are only counted.
+	std::vector<const char*> begins(numBones);
+	std::vector<const char*> ends(numBones);
+	for(UINT boneIndex = 0; boneIndex < numBones && !fin.Fail(); ++boneIndex)
+	{
+		fin.Skip(2);
+		UINT numKeyframes = fin.ReadUInt();
+		fin.Skip(); // {
+
+		if( fin.Fail() )
+			break;
+
+		clip.BoneAnimations[boneIndex].Keyframes.resize(numKeyframes);
+
+		begins[boneIndex] = fin.Tell();
+		fin.SkipLines(numKeyframes);
+		ends[boneIndex] = fin.Tell();
+
+		fin.Skip(); // }
+	}
+
+	bool parsed = !fin.Fail() && ReadChunksParallel(fin, begins, ends, [&](TextTokenizer& chunk, UINT boneIndex)
+	{
+		std::vector<Keyframe>& keyframes = clip.BoneAnimations[boneIndex].Keyframes;
+		ReadKeyframes(chunk, (UINT)keyframes.size(), keyframes.data());
+	});
+
+	if( parsed )
+		++mParallelSections;
+	else
+		fin.Seek(clipStart);
+
+	return parsed;
+}
+
+bool M3DLoader::ReadChunksParallel(const TextTokenizer& fin, const std::vector<const char*>& begins,
+								   const std::vector<const char*>& ends, const std::function<void(TextTokenizer&, UINT)>& readChunk)
+{
+	std::vector<char> chunkParsed(begins.size(), 0);
+
+	mJobSystem->ParallelFor((UINT)begins.size(), 1, [&](UINT first, UINT last)
+	{
+		for(UINT c = first; c < last; ++c)
+		{
+			TextTokenizer chunk = fin.View(begins[c]);
+			readChunk(chunk, c);
+			chunkParsed[c] = !chunk.Fail() && chunk.Tell() == ends[c];
+		}
+	});
+
+	return std::all_of(chunkParsed.begin(), chunkParsed.end(), [](char ok) { return ok != 0; });
+}
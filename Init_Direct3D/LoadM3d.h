@@ -2,12 +2,22 @@
 #define LOADM3D_H
 
 #include "SkinnedData.h"
+#include "TextTokenizer.h"
+#include "JobSystem.h"
 
+class M3dBinaryFile;
 
 
 class M3DLoader
 {
 public:
+	// Records per chunk when the text is parsed on a job system.
+	static const UINT ParseGrainSize = 2048;
+
+	// Indices are 16 bit, so a model can use at most this many vertices.
+	// Bigger models fail to load instead of wrapping their indices.
+	static const UINT MaxVertices = 0x10000;
+
     struct Vertex
     {
         DirectX::XMFLOAT3 Pos;
@@ -23,7 +33,7 @@ public:
         DirectX::XMFLOAT2 TexC;
         DirectX::XMFLOAT3 TangentU;
         DirectX::XMFLOAT3 BoneWeights;
-        BYTE BoneIndices[4];
+        USHORT BoneIndices[4];
     };
 
     struct Subset
@@ -49,6 +59,8 @@ public:
         std::string NormalMapName;
     };
 
+	// False if the file is missing, ends early or has a token that does
+	// not parse, as well as for models the renderer cannot take.
 	bool LoadM3d(const std::string& filename, 
 		std::vector<Vertex>& vertices,
 		std::vector<USHORT>& indices,
@@ -61,16 +73,83 @@ public:
 		std::vector<M3dMaterial>& mats,
 		SkinnedData& skinInfo);
 
+	// With a job system set, the skinned text loaders find where the vertex,
+	// triangle and keyframe records start first and then parse them on all
+	// threads.  If the records are not laid out one per line as the exporter
+	// writes them, those sections are parsed in order instead.
+	void SetJobSystem(JobSystem* jobSystem);
+
+	// Sections (vertices, triangles, one per clip) the last skinned text
+	// load parsed on the job system; the others were parsed in order.
+	UINT GetParallelSectionCount()const;
+
+	// Writes the binary form (M3dBinaryFile) of a skinned text file, with
+	// the bones in compiled order and the subsets optimized.
+	bool ConvertM3d(const std::string& textFilename, const std::string& binaryFilename);
+
+	// Opens a file written by ConvertM3d and reads the skeleton, clips,
+	// materials and subsets out of it.  The vertices and indices stay in
+	// the mapping: use file.GetVertices() and file.GetIndices() while file
+	// is open.  Their bone indices already match skinInfo, but they are not
+	// range checked (M3dBinaryFile::CheckMeshIndices).  With sourceFilename,
+	// also fails if that text file has changed since the conversion, so the
+	// caller can convert it again.
+	bool OpenM3dBinary(const std::string& filename,
+		M3dBinaryFile& file,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo,
+		const std::string& sourceFilename = std::string());
+
+	// Same outputs as the skinned LoadM3d, from a file written by
+	// ConvertM3d: OpenM3dBinary, with the vertices and indices checked and
+	// copied out of the mapping.
+	bool LoadM3dBinary(const std::string& filename, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<USHORT>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo,
+		const std::string& sourceFilename = std::string());
+
+private:
+	void ReadHeader(TextTokenizer& fin, UINT& numMaterials, UINT& numVertices,
+		UINT& numTriangles, UINT& numBones, UINT& numAnimationClips);
+	void ReadMaterials(TextTokenizer& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
+	void ReadSubsetTable(TextTokenizer& fin, UINT numSubsets, std::vector<Subset>& subsets);
+	void ReadVertices(TextTokenizer& fin, UINT numVertices, std::vector<Vertex>& vertices);
+	void ReadSkinnedVertices(TextTokenizer& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
+	void ReadTriangles(TextTokenizer& fin, UINT numTriangles, std::vector<USHORT>& indices);
+	void ReadBoneOffsets(TextTokenizer& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
+		std::vector<std::string>& boneNames);
+	void ReadBoneHierarchy(TextTokenizer& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
+	void ReadAnimationClips(TextTokenizer& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
+	void ReadBoneKeyframes(TextTokenizer& fin, UINT numBones, BoneAnimation& boneAnimation);
+	void ReadFloats(TextTokenizer& fin, float* values, UINT count);
+
+	void ReadSkinnedVertexRange(TextTokenizer& fin, UINT begin, UINT end, SkinnedVertex* vertices);
+	void ReadTriangleRange(TextTokenizer& fin, UINT begin, UINT end, USHORT* indices);
+	void ReadKeyframes(TextTokenizer& fin, UINT numKeyframes, Keyframe* keyframes);
+
+	// Scans numRecords records of linesPerRecord lines into chunks and runs
+	// readRange(chunk, begin, end) on each.  False, with fin back where it
+	// was, if there is no job system or the records did not line up.
+	bool ReadRecordsParallel(TextTokenizer& fin, UINT numRecords, UINT linesPerRecord,
+		const std::function<void(TextTokenizer&, UINT, UINT)>& readRange);
+	bool ReadBoneKeyframesParallel(TextTokenizer& fin, UINT numBones, AnimationClip& clip);
+
+	// Runs readChunk(chunk, i) for chunks [begins[i], ends[i]) in parallel.
+	// True if every chunk parsed and stopped exactly at its end.
+	bool ReadChunksParallel(const TextTokenizer& fin, const std::vector<const char*>& begins,
+		const std::vector<const char*>& ends, const std::function<void(TextTokenizer&, UINT)>& readChunk);
+
+	// Renumbers the vertex bone indices (file index -> boneRemap[index]).
+	// False if a vertex names a bone past the end of the skeleton.
+	bool RemapBoneIndices(const std::vector<UINT>& boneRemap, std::vector<SkinnedVertex>& vertices);
+
 private:
-	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
-	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets);
-	void ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices);
-	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
-	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
-	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
-	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
-	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
-	void ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation);
+	JobSystem* mJobSystem = nullptr;
+	UINT mParallelSections = 0;
 };
 
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "TextTokenizer.h"
+
+///<summary>
+/// Loads the skull.txt / car.txt format: vertex and triangle counts, one
+/// position and normal per vertex, then the triangle list.
+///
+/// Vertex needs Pos and Normal members; everything else in it is
+/// value-initialized.  Returns false if the file is missing or a number
+/// does not parse.
+///</summary>
+template<typename Vertex>
+bool LoadPosNormalModel(const std::string& filename,
+	std::vector<Vertex>& vertices, std::vector<std::int32_t>& indices)
+{
+	TextTokenizer fin;
+	if( !fin.Open(filename) )
+		return false;
+
+	fin.Skip();
+	UINT vCount = fin.ReadUInt();
+	fin.Skip();
+	UINT tCount = fin.ReadUInt();
+	fin.Skip(4);
+
+	vertices.assign(vCount, Vertex());
+	for(UINT i = 0; i < vCount; ++i)
+	{
+		vertices[i].Pos.x = fin.ReadFloat();
+		vertices[i].Pos.y = fin.ReadFloat();
+		vertices[i].Pos.z = fin.ReadFloat();
+		vertices[i].Normal.x = fin.ReadFloat();
+		vertices[i].Normal.y = fin.ReadFloat();
+		vertices[i].Normal.z = fin.ReadFloat();
+	}
+
+	fin.Skip(3);
+
+	indices.resize(tCount * 3);
+	for(UINT i = 0; i < tCount * 3; ++i)
+	{
+		indices[i] = fin.ReadInt();
+	}
+
+	return !fin.Fail();
+}
@@ -0,0 +1,381 @@
+#include "M3dBinary.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const char Magic[4] = { 'M', '3', 'D', 'B' };
+
+	UINT Align16(size_t size)
+	{
+		return (UINT)((size + 15) & ~(size_t)15);
+	}
+
+	// Appends a section at the next 16-byte boundary and returns its offset.
+	template<typename T>
+	UINT AppendSection(std::vector<BYTE>& blob, const T* data, size_t count)
+	{
+		UINT offset = Align16(blob.size());
+		blob.resize(offset + count * sizeof(T));
+
+		if( count > 0 )
+			memcpy(&blob[offset], data, count * sizeof(T));
+
+		return offset;
+	}
+
+	UINT AddString(std::vector<char>& table, const std::string& s)
+	{
+		UINT offset = (UINT)table.size();
+		table.insert(table.end(), s.c_str(), s.c_str() + s.size() + 1);
+		return offset;
+	}
+}
+
+M3dBinaryFile::~M3dBinaryFile()
+{
+	Close();
+}
+
+bool M3dBinaryFile::GetSourceStamp(const std::string& filename, UINT64& size, UINT64& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if( !GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data) )
+		return false;
+
+	size = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	writeTime = ((UINT64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+bool M3dBinaryFile::Write(const std::string& filename,
+	UINT64 sourceSize, UINT64 sourceWriteTime,
+	const std::vector<M3DLoader::M3dMaterial>& mats,
+	const std::vector<M3DLoader::Subset>& subsets,
+	const std::vector<M3DLoader::SkinnedVertex>& vertices,
+	const std::vector<USHORT>& indices,
+	const std::vector<XMFLOAT4X4>& boneOffsets,
+	const std::vector<int>& boneHierarchy,
+	const std::vector<std::string>& boneNames,
+	const std::unordered_map<std::string, AnimationClip>& animations)
+{
+	const UINT numBones = (UINT)boneOffsets.size();
+	assert(boneHierarchy.size() == numBones && boneNames.size() == numBones);
+
+	std::vector<char> strings;
+
+	std::vector<Material> diskMats(mats.size());
+	for(size_t i = 0; i < mats.size(); ++i)
+	{
+		diskMats[i].Name = AddString(strings, mats[i].Name);
+		diskMats[i].MaterialTypeName = AddString(strings, mats[i].MaterialTypeName);
+		diskMats[i].DiffuseMapName = AddString(strings, mats[i].DiffuseMapName);
+		diskMats[i].NormalMapName = AddString(strings, mats[i].NormalMapName);
+		diskMats[i].DiffuseAlbedo = mats[i].DiffuseAlbedo;
+		diskMats[i].FresnelR0 = mats[i].FresnelR0;
+		diskMats[i].Roughness = mats[i].Roughness;
+		diskMats[i].AlphaClip = mats[i].AlphaClip ? 1 : 0;
+	}
+
+	std::vector<UINT> diskBoneNames(numBones);
+	for(UINT i = 0; i < numBones; ++i)
+		diskBoneNames[i] = AddString(strings, boneNames[i]);
+
+	// Sorted so the same text file always gives the same bytes.
+	std::vector<std::string> clipNames;
+	for(auto& e : animations)
+		clipNames.push_back(e.first);
+	std::sort(clipNames.begin(), clipNames.end());
+
+	std::vector<Clip> clips;
+	std::vector<Track> tracks;
+	std::vector<Keyframe> keyframes;
+
+	for(const std::string& name : clipNames)
+	{
+		const AnimationClip& clip = animations.at(name);
+		if( clip.BoneAnimations.size() != numBones )
+			return false;
+
+		Clip diskClip;
+		diskClip.Name = AddString(strings, name);
+		diskClip.FirstTrack = (UINT)tracks.size();
+		clips.push_back(diskClip);
+
+		for(const BoneAnimation& bone : clip.BoneAnimations)
+		{
+			Track track;
+			track.FirstKeyframe = (UINT)keyframes.size();
+			track.KeyframeCount = (UINT)bone.Keyframes.size();
+			tracks.push_back(track);
+
+			keyframes.insert(keyframes.end(), bone.Keyframes.begin(), bone.Keyframes.end());
+		}
+	}
+
+	Header header = {};
+	memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.VertexStride = sizeof(M3DLoader::SkinnedVertex);
+	header.KeyframeStride = sizeof(Keyframe);
+	header.MaterialCount = (UINT)mats.size();
+	header.SubsetCount = (UINT)subsets.size();
+	header.VertexCount = (UINT)vertices.size();
+	header.IndexCount = (UINT)indices.size();
+	header.BoneCount = numBones;
+	header.ClipCount = (UINT)clips.size();
+	header.KeyframeCount = (UINT)keyframes.size();
+	header.StringTableSize = (UINT)strings.size();
+	header.SourceSize = sourceSize;
+	header.SourceWriteTime = sourceWriteTime;
+
+	std::vector<BYTE> blob(sizeof(Header));
+	header.MaterialOffset = AppendSection(blob, diskMats.data(), diskMats.size());
+	header.SubsetOffset = AppendSection(blob, subsets.data(), subsets.size());
+	header.VertexOffset = AppendSection(blob, vertices.data(), vertices.size());
+	header.IndexOffset = AppendSection(blob, indices.data(), indices.size());
+	header.BoneOffsetOffset = AppendSection(blob, boneOffsets.data(), boneOffsets.size());
+	header.BoneHierarchyOffset = AppendSection(blob, boneHierarchy.data(), boneHierarchy.size());
+	header.BoneNameOffset = AppendSection(blob, diskBoneNames.data(), diskBoneNames.size());
+	header.ClipOffset = AppendSection(blob, clips.data(), clips.size());
+	header.TrackOffset = AppendSection(blob, tracks.data(), tracks.size());
+	header.KeyframeOffset = AppendSection(blob, keyframes.data(), keyframes.size());
+	header.StringTableOffset = AppendSection(blob, strings.data(), strings.size());
+
+	blob.resize(Align16(blob.size()));
+	header.FileSize = (UINT)blob.size();
+	memcpy(blob.data(), &header, sizeof(Header));
+
+	std::ofstream fout(filename, std::ios::binary);
+	if( !fout )
+		return false;
+
+	fout.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+	return (bool)fout;
+}
+
+bool M3dBinaryFile::Open(const std::string& filename)
+{
+	Close();
+
+	mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if( mFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header) )
+	{
+		Close();
+		return false;
+	}
+
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if( mMapping != nullptr )
+		mData = static_cast<const BYTE*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+
+	if( mData == nullptr || !Validate((size_t)fileSize.QuadPart) )
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void M3dBinaryFile::Close()
+{
+	if( mData != nullptr )
+		UnmapViewOfFile(mData);
+	if( mMapping != nullptr )
+		CloseHandle(mMapping);
+	if( mFile != INVALID_HANDLE_VALUE )
+		CloseHandle(mFile);
+
+	mData = nullptr;
+	mMapping = nullptr;
+	mFile = INVALID_HANDLE_VALUE;
+}
+
+bool M3dBinaryFile::Validate(size_t fileSize)const
+{
+	const Header& h = GetHeader();
+
+	if( memcmp(h.Magic, Magic, sizeof(Magic)) != 0 || h.Version != Version || h.FileSize != fileSize )
+		return false;
+
+	if( h.VertexStride != sizeof(M3DLoader::SkinnedVertex) || h.KeyframeStride != sizeof(Keyframe) )
+		return false;
+
+	auto fits = [&](UINT offset, size_t count, size_t stride)
+	{
+		return offset % 16 == 0 && offset >= sizeof(Header) &&
+			offset <= fileSize && count * stride <= fileSize - offset;
+	};
+
+	if( !fits(h.MaterialOffset, h.MaterialCount, sizeof(Material)) ||
+		!fits(h.SubsetOffset, h.SubsetCount, sizeof(M3DLoader::Subset)) ||
+		!fits(h.VertexOffset, h.VertexCount, sizeof(M3DLoader::SkinnedVertex)) ||
+		!fits(h.IndexOffset, h.IndexCount, sizeof(USHORT)) ||
+		!fits(h.BoneOffsetOffset, h.BoneCount, sizeof(XMFLOAT4X4)) ||
+		!fits(h.BoneHierarchyOffset, h.BoneCount, sizeof(int)) ||
+		!fits(h.BoneNameOffset, h.BoneCount, sizeof(UINT)) ||
+		!fits(h.ClipOffset, h.ClipCount, sizeof(Clip)) ||
+		!fits(h.TrackOffset, (size_t)h.ClipCount * h.BoneCount, sizeof(Track)) ||
+		!fits(h.KeyframeOffset, h.KeyframeCount, sizeof(Keyframe)) ||
+		!fits(h.StringTableOffset, h.StringTableSize, 1) )
+		return false;
+
+	// Every string must end inside the table.
+	if( h.StringTableSize > 0 && Section<char>(h.StringTableOffset)[h.StringTableSize - 1] != '\0' )
+		return false;
+
+	auto validString = [&](UINT offset) { return offset < h.StringTableSize; };
+
+	for(UINT i = 0; i < h.MaterialCount; ++i)
+	{
+		const Material& m = GetMaterials()[i];
+		if( !validString(m.Name) || !validString(m.MaterialTypeName) ||
+			!validString(m.DiffuseMapName) || !validString(m.NormalMapName) )
+			return false;
+	}
+
+	for(UINT i = 0; i < h.BoneCount; ++i)
+	{
+		if( !validString(Section<UINT>(h.BoneNameOffset)[i]) )
+			return false;
+	}
+
+	for(UINT i = 0; i < h.ClipCount; ++i)
+	{
+		const Clip& clip = GetClips()[i];
+		if( !validString(clip.Name) || clip.FirstTrack > (h.ClipCount - 1) * h.BoneCount )
+			return false;
+	}
+
+	const Track* tracks = Section<Track>(h.TrackOffset);
+	for(size_t i = 0; i < (size_t)h.ClipCount * h.BoneCount; ++i)
+	{
+		if( tracks[i].FirstKeyframe > h.KeyframeCount ||
+			tracks[i].KeyframeCount > h.KeyframeCount - tracks[i].FirstKeyframe )
+			return false;
+	}
+
+	// The loader and the renderer draw these ranges without further checks.
+	for(UINT i = 0; i < h.SubsetCount; ++i)
+	{
+		const M3DLoader::Subset& subset = GetSubsets()[i];
+		if( subset.VertexStart > h.VertexCount || subset.VertexCount > h.VertexCount - subset.VertexStart ||
+			subset.FaceStart > h.IndexCount / 3 || subset.FaceCount > h.IndexCount / 3 - subset.FaceStart )
+			return false;
+	}
+
+	const int* hierarchy = GetBoneHierarchy();
+	for(UINT i = 0; i < h.BoneCount; ++i)
+	{
+		if( hierarchy[i] < -1 || hierarchy[i] >= (int)h.BoneCount )
+			return false;
+	}
+
+	return true;
+}
+
+bool M3dBinaryFile::CheckMeshIndices()const
+{
+	const Header& h = GetHeader();
+
+	const USHORT* indices = GetIndices();
+	for(UINT i = 0; i < h.IndexCount; ++i)
+	{
+		if( indices[i] >= h.VertexCount )
+			return false;
+	}
+
+	const M3DLoader::SkinnedVertex* vertices = GetVertices();
+	for(UINT i = 0; i < h.VertexCount; ++i)
+	{
+		for(int j = 0; j < 4; ++j)
+		{
+			if( vertices[i].BoneIndices[j] >= h.BoneCount )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool M3dBinaryFile::MatchesSource(const std::string& sourceFilename)const
+{
+	UINT64 size = 0;
+	UINT64 writeTime = 0;
+	if( !GetSourceStamp(sourceFilename, size, writeTime) )
+		return true;
+
+	const Header& h = GetHeader();
+	return h.SourceSize == size && h.SourceWriteTime == writeTime;
+}
+
+const M3dBinaryFile::Header& M3dBinaryFile::GetHeader()const
+{
+	return *Section<Header>(0);
+}
+
+const M3dBinaryFile::Material* M3dBinaryFile::GetMaterials()const
+{
+	return Section<Material>(GetHeader().MaterialOffset);
+}
+
+const M3DLoader::Subset* M3dBinaryFile::GetSubsets()const
+{
+	return Section<M3DLoader::Subset>(GetHeader().SubsetOffset);
+}
+
+const M3DLoader::SkinnedVertex* M3dBinaryFile::GetVertices()const
+{
+	return Section<M3DLoader::SkinnedVertex>(GetHeader().VertexOffset);
+}
+
+const USHORT* M3dBinaryFile::GetIndices()const
+{
+	return Section<USHORT>(GetHeader().IndexOffset);
+}
+
+const XMFLOAT4X4* M3dBinaryFile::GetBoneOffsets()const
+{
+	return Section<XMFLOAT4X4>(GetHeader().BoneOffsetOffset);
+}
+
+const int* M3dBinaryFile::GetBoneHierarchy()const
+{
+	return Section<int>(GetHeader().BoneHierarchyOffset);
+}
+
+const char* M3dBinaryFile::GetBoneName(UINT bone)const
+{
+	return GetString(Section<UINT>(GetHeader().BoneNameOffset)[bone]);
+}
+
+const M3dBinaryFile::Clip* M3dBinaryFile::GetClips()const
+{
+	return Section<Clip>(GetHeader().ClipOffset);
+}
+
+const char* M3dBinaryFile::GetClipName(UINT clip)const
+{
+	return GetString(GetClips()[clip].Name);
+}
+
+const Keyframe* M3dBinaryFile::GetKeyframes(UINT clip, UINT bone, UINT& count)const
+{
+	const Header& h = GetHeader();
+	const Track& track = Section<Track>(h.TrackOffset)[GetClips()[clip].FirstTrack + bone];
+
+	count = track.KeyframeCount;
+	return Section<Keyframe>(h.KeyframeOffset) + track.FirstKeyframe;
+}
+
+const char* M3dBinaryFile::GetString(UINT offset)const
+{
+	assert(offset < GetHeader().StringTableSize);
+	return Section<char>(GetHeader().StringTableOffset) + offset;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "LoadM3d.h"
+
+///<summary>
+/// Binary form of a skinned .m3d file, read through a memory mapping.
+///
+/// The file is a Header followed by sections, each 16-byte aligned and
+/// stored exactly as the loader's structs lay out in memory (little endian,
+/// MSVC packing), so vertices, indices, subsets, bone data and keyframes
+/// are used in place as views.  Strings (names, texture files) sit in one
+/// table of null-terminated entries and are referenced by offset.
+///
+/// ConvertM3d writes the file ready to draw: the skeleton and clips are in
+/// SkeletonCompiler order with the vertex bone indices remapped to it, and
+/// each subset is already optimized with MeshOptimizer.  Loading it is then
+/// only SkinnedData::Set, which finds nothing to renumber, and the vertices
+/// and indices can go to the GPU straight from the mapping.
+///
+/// Open rejects files with another Version or struct size, a section past
+/// the end of the file, or out of range strings, tracks, subsets or parent
+/// indices; all of these are small.  The vertex and index sections are only
+/// range checked by CheckMeshIndices, for callers that index with them on
+/// the CPU.
+///
+/// The header records the size and last write time of the text file it was
+/// converted from, so a binary left over from an older text file can be
+/// told apart (MatchesSource) and converted again.
+///</summary>
+class M3dBinaryFile
+{
+public:
+	static const UINT Version = 3;
+
+	struct Header
+	{
+		char Magic[4];	// "M3DB"
+		UINT Version;
+		UINT FileSize;
+
+		// sizeof() the vertex and keyframe structs at write time.
+		UINT VertexStride;
+		UINT KeyframeStride;
+
+		UINT MaterialCount;
+		UINT SubsetCount;
+		UINT VertexCount;
+		UINT IndexCount;
+		UINT BoneCount;
+		UINT ClipCount;
+		UINT KeyframeCount;
+		UINT StringTableSize;
+
+		// Byte offsets of the sections from the start of the file.
+		UINT MaterialOffset;
+		UINT SubsetOffset;
+		UINT VertexOffset;
+		UINT IndexOffset;
+		UINT BoneOffsetOffset;
+		UINT BoneHierarchyOffset;
+		UINT BoneNameOffset;
+		UINT ClipOffset;
+		UINT TrackOffset;
+		UINT KeyframeOffset;
+		UINT StringTableOffset;
+
+		// The text file this was converted from (see GetSourceStamp).
+		UINT64 SourceSize;
+		UINT64 SourceWriteTime;
+	};
+
+	struct Material
+	{
+		UINT Name;
+		UINT MaterialTypeName;
+		UINT DiffuseMapName;
+		UINT NormalMapName;
+
+		DirectX::XMFLOAT4 DiffuseAlbedo;
+		DirectX::XMFLOAT3 FresnelR0;
+		float Roughness;
+		UINT AlphaClip;
+	};
+
+	struct Clip
+	{
+		UINT Name;
+
+		// Tracks [FirstTrack, FirstTrack + BoneCount), one per bone.
+		UINT FirstTrack;
+	};
+
+	struct Track
+	{
+		UINT FirstKeyframe;
+		UINT KeyframeCount;
+	};
+
+	M3dBinaryFile() = default;
+	M3dBinaryFile(const M3dBinaryFile& rhs)=delete;
+	M3dBinaryFile& operator=(const M3dBinaryFile& rhs)=delete;
+	~M3dBinaryFile();
+
+	// Size and last write time (FILETIME as one number) of a file.
+	static bool GetSourceStamp(const std::string& filename, UINT64& size, UINT64& writeTime);
+
+	static bool Write(const std::string& filename,
+		UINT64 sourceSize, UINT64 sourceWriteTime,
+		const std::vector<M3DLoader::M3dMaterial>& mats,
+		const std::vector<M3DLoader::Subset>& subsets,
+		const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		const std::vector<USHORT>& indices,
+		const std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
+		const std::vector<int>& boneHierarchy,
+		const std::vector<std::string>& boneNames,
+		const std::unordered_map<std::string, AnimationClip>& animations);
+
+	// Maps the file and validates it.  The views below stay valid
+	// until Close() or destruction.
+	bool Open(const std::string& filename);
+	void Close();
+
+	// True if every index names a vertex and every vertex bone index a bone.
+	// Reads both sections whole.
+	bool CheckMeshIndices()const;
+
+	const Header& GetHeader()const;
+
+	// False if the text file has changed since it was converted.  A missing
+	// text file counts as a match, so the binary can ship on its own.
+	bool MatchesSource(const std::string& sourceFilename)const;
+
+	const Material* GetMaterials()const;
+	const M3DLoader::Subset* GetSubsets()const;
+	const M3DLoader::SkinnedVertex* GetVertices()const;
+	const USHORT* GetIndices()const;
+
+	const DirectX::XMFLOAT4X4* GetBoneOffsets()const;
+	const int* GetBoneHierarchy()const;
+	const char* GetBoneName(UINT bone)const;
+
+	const Clip* GetClips()const;
+	const char* GetClipName(UINT clip)const;
+
+	// Keyframes of one bone in one clip; count receives their number.
+	const Keyframe* GetKeyframes(UINT clip, UINT bone, UINT& count)const;
+
+	const char* GetString(UINT offset)const;
+
+private:
+	bool Validate(size_t fileSize)const;
+
+	template<typename T>
+	const T* Section(UINT offset)const
+	{
+		return reinterpret_cast<const T*>(mData + offset);
+	}
+
+private:
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+	const BYTE* mData = nullptr;
+};
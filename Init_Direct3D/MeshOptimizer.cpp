@@ -0,0 +1,278 @@
+#include "MeshOptimizer.h"
+
+namespace
+{
+	// Forsyth's tuning constants.
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, UINT remainingTris)
+	{
+		// Nothing left to draw with it.
+		if( remainingTris == 0 )
+			return -1.0f;
+
+		float score = 0.0f;
+		if( cachePosition >= 0 )
+		{
+			// The last triangle's three vertices score the same, whatever
+			// order they went in, so no edge of it is preferred.
+			if( cachePosition < 3 )
+			{
+				score = LastTriScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (MeshOptimizer::ScoringCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Vertices with few triangles left are boosted, so lone triangles
+		// are drawn now rather than costing misses later.
+		score += ValenceBoostScale * powf((float)remainingTris, -ValenceBoostPower);
+
+		return score;
+	}
+
+	template<typename Index>
+	void IndexRange(const Index* indices, UINT indexCount, UINT& minIndex, UINT& maxIndex)
+	{
+		minIndex = UINT_MAX;
+		maxIndex = 0;
+
+		for(UINT i = 0; i < indexCount; ++i)
+		{
+			minIndex = MathHelper::Min(minIndex, (UINT)indices[i]);
+			maxIndex = MathHelper::Max(maxIndex, (UINT)indices[i]);
+		}
+	}
+}
+
+template<typename Index>
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const Index* indices, UINT indexCount,
+	UINT cacheSize)
+{
+	CacheStats stats;
+	if( indexCount < 3 )
+		return stats;
+
+	UINT minIndex, maxIndex;
+	IndexRange(indices, indexCount, minIndex, maxIndex);
+
+	// A vertex is in the FIFO if fewer than cacheSize misses happened since
+	// it went in.  Start the clock past cacheSize so nothing begins cached.
+	std::vector<UINT> insertedAt(maxIndex - minIndex + 1, 0);
+	std::vector<bool> used(insertedAt.size(), false);
+	UINT time = cacheSize + 1;
+	UINT misses = 0;
+	UINT usedCount = 0;
+
+	for(UINT i = 0; i < indexCount; ++i)
+	{
+		UINT v = (UINT)indices[i] - minIndex;
+
+		if( time - insertedAt[v] > cacheSize )
+		{
+			insertedAt[v] = time++;
+			++misses;
+		}
+
+		if( !used[v] )
+		{
+			used[v] = true;
+			++usedCount;
+		}
+	}
+
+	stats.Acmr = (float)misses / (indexCount / 3);
+	stats.Atvr = (float)misses / usedCount;
+
+	return stats;
+}
+
+template<typename Index>
+void MeshOptimizer::OptimizeVertexCache(Index* indices, UINT indexCount)
+{
+	const UINT triCount = indexCount / 3;
+	if( triCount < 2 )
+		return;
+
+	UINT minIndex, maxIndex;
+	IndexRange(indices, triCount * 3, minIndex, maxIndex);
+	const UINT vertexCount = maxIndex - minIndex + 1;
+
+	// Triangles of each vertex, packed.  The first remainingTris[v] entries
+	// of a vertex's list are the ones not drawn yet.
+	std::vector<UINT> remainingTris(vertexCount, 0);
+	for(UINT i = 0; i < triCount * 3; ++i)
+		++remainingTris[(UINT)indices[i] - minIndex];
+
+	std::vector<UINT> triListStart(vertexCount + 1, 0);
+	for(UINT v = 0; v < vertexCount; ++v)
+		triListStart[v + 1] = triListStart[v] + remainingTris[v];
+
+	std::vector<UINT> triLists(triCount * 3);
+	{
+		std::vector<UINT> fill(triListStart.begin(), triListStart.end() - 1);
+		for(UINT i = 0; i < triCount * 3; ++i)
+			triLists[fill[(UINT)indices[i] - minIndex]++] = i / 3;
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for(UINT v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, remainingTris[v]);
+
+	std::vector<float> triScore(triCount, 0.0f);
+	std::vector<bool> triDrawn(triCount, false);
+	for(UINT t = 0; t < triCount; ++t)
+	{
+		for(UINT k = 0; k < 3; ++k)
+			triScore[t] += vertexScore[(UINT)indices[t * 3 + k] - minIndex];
+	}
+
+	// The cache can hold three more entries for a moment while a triangle
+	// is pushed in front of it.
+	std::vector<UINT> cache;
+	std::vector<UINT> newCache;
+	cache.reserve(ScoringCacheSize + 3);
+	newCache.reserve(ScoringCacheSize + 3);
+
+	std::vector<Index> output;
+	output.reserve(triCount * 3);
+
+	int bestTri = (int)(std::max_element(triScore.begin(), triScore.end()) - triScore.begin());
+	UINT scanCursor = 0;
+
+	for(UINT drawn = 0; drawn < triCount; ++drawn)
+	{
+		// Nothing in the cache has triangles left; restart from the first
+		// triangle not drawn yet, which is as good as any.
+		if( bestTri < 0 )
+		{
+			while( triDrawn[scanCursor] )
+				++scanCursor;
+			bestTri = (int)scanCursor;
+		}
+
+		UINT tri[3];
+		for(UINT k = 0; k < 3; ++k)
+		{
+			output.push_back(indices[bestTri * 3 + k]);
+			tri[k] = (UINT)indices[bestTri * 3 + k] - minIndex;
+		}
+		triDrawn[bestTri] = true;
+
+		// Take the triangle out of its vertices' lists.
+		for(UINT k = 0; k < 3; ++k)
+		{
+			UINT v = tri[k];
+			UINT* list = &triLists[triListStart[v]];
+			for(UINT j = 0; j < remainingTris[v]; ++j)
+			{
+				if( list[j] == (UINT)bestTri )
+				{
+					std::swap(list[j], list[remainingTris[v] - 1]);
+					--remainingTris[v];
+					break;
+				}
+			}
+		}
+
+		// LRU: the triangle's vertices go to the front, the rest move back.
+		newCache.clear();
+		newCache.insert(newCache.end(), tri, tri + 3);
+		for(UINT v : cache)
+		{
+			if( v != tri[0] && v != tri[1] && v != tri[2] )
+				newCache.push_back(v);
+		}
+
+		// Rescore everything whose cache position changed and pick the
+		// best triangle among those still using the cache.
+		float bestScore = -1.0f;
+		bestTri = -1;
+		for(UINT i = 0; i < (UINT)newCache.size(); ++i)
+		{
+			UINT v = newCache[i];
+			cachePosition[v] = i < ScoringCacheSize ? (int)i : -1;
+
+			float score = VertexScore(cachePosition[v], remainingTris[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const UINT* list = &triLists[triListStart[v]];
+			for(UINT j = 0; j < remainingTris[v]; ++j)
+				triScore[list[j]] += delta;
+		}
+
+		for(UINT i = 0; i < (UINT)newCache.size() && i < ScoringCacheSize; ++i)
+		{
+			UINT v = newCache[i];
+			const UINT* list = &triLists[triListStart[v]];
+			for(UINT j = 0; j < remainingTris[v]; ++j)
+			{
+				if( triScore[list[j]] > bestScore )
+				{
+					bestScore = triScore[list[j]];
+					bestTri = (int)list[j];
+				}
+			}
+		}
+
+		if( newCache.size() > ScoringCacheSize )
+			newCache.resize(ScoringCacheSize);
+		cache.swap(newCache);
+	}
+
+	// Meshes exported already optimized can lose a little to the scoring
+	// cache not being the one the stats simulate; keep their order then.
+	CacheStats before = AnalyzeVertexCache(indices, triCount * 3);
+	CacheStats after = AnalyzeVertexCache(output.data(), triCount * 3);
+	if( after.Acmr < before.Acmr )
+		std::copy(output.begin(), output.end(), indices);
+}
+
+template<typename Index>
+bool MeshOptimizer::OptimizeVertexFetch(Index* indices, UINT indexCount,
+	UINT vertexStart, UINT vertexCount, std::vector<UINT>& remap)
+{
+	for(UINT i = 0; i < indexCount; ++i)
+	{
+		if( (UINT)indices[i] < vertexStart || (UINT)indices[i] - vertexStart >= vertexCount )
+			return false;
+	}
+
+	remap.assign(vertexCount, UINT_MAX);
+	UINT next = 0;
+
+	for(UINT i = 0; i < indexCount; ++i)
+	{
+		UINT v = (UINT)indices[i] - vertexStart;
+		if( remap[v] == UINT_MAX )
+			remap[v] = next++;
+
+		indices[i] = (Index)(vertexStart + remap[v]);
+	}
+
+	for(UINT v = 0; v < vertexCount; ++v)
+	{
+		if( remap[v] == UINT_MAX )
+			remap[v] = next++;
+	}
+
+	return true;
+}
+
+// The index types the loaders produce: M3D (16 bit) and the text models (32 bit),
+// plus the GeometryGenerator indices the LOD chains are built in.
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<std::uint16_t>(const std::uint16_t*, UINT, UINT);
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<std::int32_t>(const std::int32_t*, UINT, UINT);
+template void MeshOptimizer::OptimizeVertexCache<std::uint16_t>(std::uint16_t*, UINT);
+template void MeshOptimizer::OptimizeVertexCache<std::int32_t>(std::int32_t*, UINT);
+template void MeshOptimizer::OptimizeVertexCache<std::uint32_t>(std::uint32_t*, UINT);
+template bool MeshOptimizer::OptimizeVertexFetch<std::uint16_t>(std::uint16_t*, UINT, UINT, UINT, std::vector<UINT>&);
+template bool MeshOptimizer::OptimizeVertexFetch<std::int32_t>(std::int32_t*, UINT, UINT, UINT, std::vector<UINT>&);
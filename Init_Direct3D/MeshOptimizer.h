@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+
+///<summary>
+/// Reorders indexed triangle lists on the CPU so the GPU transforms and
+/// fetches fewer vertices.
+///
+/// Triangles are reordered for the post-transform vertex cache with Tom
+/// Forsyth's "linear-speed vertex cache optimisation": every vertex is
+/// scored by its place in a simulated LRU cache and by how many triangles
+/// still use it, and the best scoring triangle touching the cache is drawn
+/// next.  Vertices are then renumbered in the order the new triangle list
+/// first uses them, so vertex fetches walk the buffer forward.
+///
+/// Everything works on one range of the buffers at a time, so each M3D
+/// Subset is optimized in place and its VertexStart/FaceStart stay valid.
+///</summary>
+class MeshOptimizer
+{
+public:
+	// LRU cache size the triangle order is scored against.
+	static const UINT ScoringCacheSize = 32;
+
+	// FIFO cache size AnalyzeVertexCache simulates unless told otherwise.
+	static const UINT AnalysisCacheSize = 16;
+
+	struct CacheStats
+	{
+		// Average cache miss ratio: transformed vertices per triangle.
+		// 3 is no reuse at all; a regular grid can reach 0.5.
+		float Acmr = 0.0f;
+
+		// Average transform to vertex ratio: transformed vertices per
+		// vertex used.  1 is the best possible.
+		float Atvr = 0.0f;
+	};
+
+	// Counts the misses of a FIFO vertex cache over a triangle list.
+	template<typename Index>
+	static CacheStats AnalyzeVertexCache(const Index* indices, UINT indexCount,
+		UINT cacheSize = AnalysisCacheSize);
+
+	// Reorders the triangles of indices[0, indexCount) in place.  The
+	// index values themselves do not change.  The old order is kept if the
+	// new one misses more in AnalyzeVertexCache.
+	template<typename Index>
+	static void OptimizeVertexCache(Index* indices, UINT indexCount);
+
+	// Renumbers vertices [vertexStart, vertexStart + vertexCount) in the
+	// order indices[0, indexCount) first use them and rewrites the indices.
+	// remap[i] is the new place of vertex vertexStart + i, relative to
+	// vertexStart; vertices nothing uses go last in their old order.
+	// Returns false, touching nothing, if an index is outside the range.
+	template<typename Index>
+	static bool OptimizeVertexFetch(Index* indices, UINT indexCount,
+		UINT vertexStart, UINT vertexCount, std::vector<UINT>& remap);
+
+	// Moves vertices to the places OptimizeVertexFetch gave them.
+	template<typename Vertex>
+	static void RemapVertices(Vertex* vertices, const std::vector<UINT>& remap);
+
+	// Both passes over one range: the triangles indices[0, indexCount),
+	// which must only use vertices [vertexStart, vertexStart + vertexCount).
+	template<typename Vertex, typename Index>
+	static void OptimizeRange(Vertex* vertices, UINT vertexStart, UINT vertexCount,
+		Index* indices, UINT indexCount);
+};
+
+template<typename Vertex>
+void MeshOptimizer::RemapVertices(Vertex* vertices, const std::vector<UINT>& remap)
+{
+	std::vector<Vertex> old(vertices, vertices + remap.size());
+
+	for(UINT i = 0; i < (UINT)remap.size(); ++i)
+		vertices[remap[i]] = old[i];
+}
+
+template<typename Vertex, typename Index>
+void MeshOptimizer::OptimizeRange(Vertex* vertices, UINT vertexStart, UINT vertexCount,
+	Index* indices, UINT indexCount)
+{
+	OptimizeVertexCache(indices, indexCount);
+
+	std::vector<UINT> remap;
+	if( OptimizeVertexFetch(indices, indexCount, vertexStart, vertexCount, remap) )
+		RemapVertices(vertices + vertexStart, remap);
+}
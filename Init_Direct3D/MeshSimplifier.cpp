@@ -0,0 +1,490 @@
+#include "MeshSimplifier.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// A LOD has to drop at least this share of the triangles of the one
+	// before, or the chain ends.
+	const float MinLodReduction = 0.2f;
+
+	// Sum of w * (n.p + d)^2 over planes, kept as the symmetric matrix
+	// A = w n n^T, the vector b = w d n and c = w d^2, plus the total w.
+	struct Quadric
+	{
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+		double W = 0.0;
+
+		void AddPlane(const XMFLOAT3& n, float d, float w)
+		{
+			A00 += w * n.x * n.x; A01 += w * n.x * n.y; A02 += w * n.x * n.z;
+			A11 += w * n.y * n.y; A12 += w * n.y * n.z; A22 += w * n.z * n.z;
+			B0 += w * d * n.x; B1 += w * d * n.y; B2 += w * d * n.z;
+			C += w * d * d;
+			W += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12; A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			W += q.W;
+		}
+
+		// Mean squared distance from p to the planes.
+		float Error(const XMFLOAT3& p)const
+		{
+			if( W == 0.0 )
+				return 0.0f;
+
+			double e =
+				A00 * p.x * p.x + A11 * p.y * p.y + A22 * p.z * p.z +
+				2.0 * (A01 * p.x * p.y + A02 * p.x * p.z + A12 * p.y * p.z) +
+				2.0 * (B0 * p.x + B1 * p.y + B2 * p.z) + C;
+
+			return (float)MathHelper::Max(e / W, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		UINT From;
+		UINT To;
+		float Cost;
+	};
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		XMVECTOR pa = XMLoadFloat3(&a);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), pa), XMVectorSubtract(XMLoadFloat3(&c), pa));
+	}
+
+	float PointTriangleDistance(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+		XMVECTOR n = XMVector3Cross(ab, ac);
+
+		// Inside the triangle the distance is to its plane.
+		const float nn = XMVectorGetX(XMVector3LengthSq(n));
+		if( nn > 0.0f )
+		{
+			XMVECTOR ap = XMVectorSubtract(p, a);
+			XMVECTOR bp = XMVectorSubtract(p, b);
+			XMVECTOR cp = XMVectorSubtract(p, c);
+			const bool inside =
+				XMVectorGetX(XMVector3Dot(XMVector3Cross(ab, ap), n)) >= 0.0f &&
+				XMVectorGetX(XMVector3Dot(XMVector3Cross(XMVectorSubtract(c, b), bp), n)) >= 0.0f &&
+				XMVectorGetX(XMVector3Dot(XMVector3Cross(XMVectorSubtract(a, c), cp), n)) >= 0.0f;
+
+			if( inside )
+				return fabsf(XMVectorGetX(XMVector3Dot(ap, n))) / sqrtf(nn);
+		}
+
+		// Outside it, to the nearest edge.
+		auto edgeDistance = [&](FXMVECTOR from, FXMVECTOR to)
+		{
+			XMVECTOR edge = XMVectorSubtract(to, from);
+			float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(p, from), edge)) /
+				MathHelper::Max(XMVectorGetX(XMVector3LengthSq(edge)), 1e-20f);
+			t = MathHelper::Min(MathHelper::Max(t, 0.0f), 1.0f);
+			return XMVectorGetX(XMVector3Length(XMVectorSubtract(p, XMVectorAdd(from, XMVectorScale(edge, t)))));
+		};
+
+		return MathHelper::Min(edgeDistance(a, b), MathHelper::Min(edgeDistance(b, c), edgeDistance(c, a)));
+	}
+
+	// Vertices that must not move: the ones on an open border, where a
+	// directed edge has no twin going the other way, and the ones sharing
+	// their position with another vertex the indices use.
+	std::vector<bool> FindLockedVertices(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices)
+	{
+		const UINT vertexCount = (UINT)positions.size();
+		std::vector<bool> locked(vertexCount, false);
+
+		std::vector<bool> used(vertexCount, false);
+		for(UINT index : indices)
+			used[index] = true;
+
+		std::vector<UINT> order;
+		for(UINT i = 0; i < vertexCount; ++i)
+		{
+			if( used[i] )
+				order.push_back(i);
+		}
+
+		auto lessPosition = [&](UINT a, UINT b)
+		{
+			const XMFLOAT3& p = positions[a];
+			const XMFLOAT3& q = positions[b];
+			if( p.x != q.x ) return p.x < q.x;
+			if( p.y != q.y ) return p.y < q.y;
+			return p.z < q.z;
+		};
+		std::sort(order.begin(), order.end(), lessPosition);
+
+		for(UINT i = 1; i < (UINT)order.size(); ++i)
+		{
+			if( !lessPosition(order[i - 1], order[i]) )
+				locked[order[i - 1]] = locked[order[i]] = true;
+		}
+
+		std::vector<std::pair<UINT, UINT>> edges;
+		edges.reserve(indices.size());
+		for(size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			for(int k = 0; k < 3; ++k)
+				edges.push_back(std::make_pair(indices[t + k], indices[t + (k + 1) % 3]));
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for(const auto& e : edges)
+		{
+			if( !std::binary_search(edges.begin(), edges.end(), std::make_pair(e.second, e.first)) )
+				locked[e.first] = locked[e.second] = true;
+		}
+
+		return locked;
+	}
+}
+
+namespace
+{
+	// Every triangle's plane goes into its corners' quadrics, weighted by area.
+	std::vector<Quadric> ComputeQuadrics(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices)
+	{
+		std::vector<Quadric> quadrics(positions.size());
+		for(size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const XMFLOAT3& p0 = positions[indices[t]];
+			XMVECTOR n = TriangleNormal(p0, positions[indices[t + 1]], positions[indices[t + 2]]);
+
+			float doubleArea = XMVectorGetX(XMVector3Length(n));
+			if( doubleArea == 0.0f )
+				continue;
+
+			XMFLOAT3 unitNormal;
+			XMStoreFloat3(&unitNormal, XMVectorScale(n, 1.0f / doubleArea));
+			float d = -(unitNormal.x * p0.x + unitNormal.y * p0.y + unitNormal.z * p0.z);
+
+			for(int k = 0; k < 3; ++k)
+				quadrics[indices[t + k]].AddPlane(unitNormal, d, 0.5f * doubleArea);
+		}
+
+		return quadrics;
+	}
+
+	// Collapses edges of indices, in place, until at most targetIndexCount
+	// are left or the next collapse would cost more than maxCost.  Each
+	// vertex that moves gets the one it moved onto in collapsedTo.  The
+	// quadrics keep what was merged, so a later call carries on from here
+	// and still measures against the original planes.
+	void CollapseEdges(const std::vector<XMFLOAT3>& positions, const std::vector<bool>& locked,
+		std::vector<Quadric>& quadrics, std::vector<UINT>& collapsedTo, std::vector<UINT>& indices,
+		UINT targetIndexCount, float maxCost)
+	{
+		const UINT vertexCount = (UINT)positions.size();
+
+		std::vector<UINT> adjacencyStart(vertexCount + 1);
+		std::vector<UINT> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<bool> touched(vertexCount);
+		std::vector<UINT> remap(vertexCount);
+
+		// Each pass collapses the cheapest edges whose neighbourhoods don't
+		// overlap, then rewrites the index list.
+		while( (UINT)indices.size() > targetIndexCount )
+		{
+			const UINT triangleCount = (UINT)indices.size() / 3;
+
+			std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+			for(UINT index : indices)
+				++adjacencyStart[index + 1];
+			for(UINT v = 0; v < vertexCount; ++v)
+				adjacencyStart[v + 1] += adjacencyStart[v];
+
+			adjacency.resize(indices.size());
+			std::vector<UINT> adjacencyEnd(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for(UINT i = 0; i < (UINT)indices.size(); ++i)
+				adjacency[adjacencyEnd[indices[i]]++] = i / 3;
+
+			collapses.clear();
+			for(UINT t = 0; t < triangleCount; ++t)
+			{
+				for(int k = 0; k < 3; ++k)
+				{
+					const UINT a = indices[t * 3 + k];
+					const UINT b = indices[t * 3 + (k + 1) % 3];
+
+					if( !locked[a] )
+						collapses.push_back({ a, b, quadrics[a].Error(positions[b]) });
+					if( !locked[b] )
+						collapses.push_back({ b, a, quadrics[b].Error(positions[a]) });
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			std::fill(touched.begin(), touched.end(), false);
+			for(UINT v = 0; v < vertexCount; ++v)
+				remap[v] = v;
+
+			const UINT trianglesToRemove = triangleCount - targetIndexCount / 3;
+			UINT removed = 0;
+			UINT collapsed = 0;
+
+			for(const Collapse& c : collapses)
+			{
+				if( c.Cost > maxCost || removed >= trianglesToRemove )
+					break;
+
+				if( touched[c.From] || touched[c.To] )
+					continue;
+
+				// Moving From onto To must not turn any of From's other
+				// triangles over.
+				bool flips = false;
+				UINT shared = 0;
+				for(UINT a = adjacencyStart[c.From]; a < adjacencyStart[c.From + 1] && !flips; ++a)
+				{
+					const UINT* tri = &indices[adjacency[a] * 3];
+					if( tri[0] == c.To || tri[1] == c.To || tri[2] == c.To )
+					{
+						++shared;
+						continue;
+					}
+
+					XMFLOAT3 moved[3];
+					for(int k = 0; k < 3; ++k)
+						moved[k] = positions[tri[k] == c.From ? c.To : tri[k]];
+
+					XMVECTOR before = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+					XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+					flips = XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+				}
+
+				if( flips )
+					continue;
+
+				remap[c.From] = c.To;
+				collapsedTo[c.From] = c.To;
+				quadrics[c.To].Add(quadrics[c.From]);
+
+				// Nothing else this pass may use a triangle that changed.
+				for(UINT a = adjacencyStart[c.From]; a < adjacencyStart[c.From + 1]; ++a)
+				{
+					const UINT* tri = &indices[adjacency[a] * 3];
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+				}
+				touched[c.To] = true;
+
+				removed += shared;
+				++collapsed;
+			}
+
+			if( collapsed == 0 )
+				break;
+
+			UINT write = 0;
+			for(UINT t = 0; t < triangleCount; ++t)
+			{
+				const UINT a = remap[indices[t * 3 + 0]];
+				const UINT b = remap[indices[t * 3 + 1]];
+				const UINT c = remap[indices[t * 3 + 2]];
+				if( a == b || b == c || c == a )
+					continue;
+
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+	}
+
+	// Largest distance from a vertex of the original mesh to the triangles
+	// within two rings of the vertex it ended up on.  The nearest point of the whole
+	// simplified surface can only be closer, and it practically never is
+	// much closer.
+	float MeasureError(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& original,
+		std::vector<UINT>& collapsedTo, const std::vector<UINT>& simplified)
+	{
+		const UINT vertexCount = (UINT)positions.size();
+
+		std::vector<UINT> adjacencyStart(vertexCount + 1, 0);
+		for(UINT index : simplified)
+			++adjacencyStart[index + 1];
+		for(UINT v = 0; v < vertexCount; ++v)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+
+		std::vector<UINT> adjacency(simplified.size());
+		std::vector<UINT> adjacencyEnd(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for(UINT i = 0; i < (UINT)simplified.size(); ++i)
+			adjacency[adjacencyEnd[simplified[i]]++] = i / 3;
+
+		std::vector<bool> measured(vertexCount, false);
+		float error = 0.0f;
+
+		// The last vertex that looked at each triangle.
+		std::vector<UINT> visited(simplified.size() / 3, UINT_MAX);
+
+		for(UINT v : original)
+		{
+			if( measured[v] )
+				continue;
+			measured[v] = true;
+
+			// Follow the collapses, shortening the path for the next lookups.
+			UINT end = v;
+			while( collapsedTo[end] != end )
+				end = collapsedTo[end];
+			for(UINT u = v; collapsedTo[u] != end && u != end; )
+			{
+				UINT next = collapsedTo[u];
+				collapsedTo[u] = end;
+				u = next;
+			}
+
+			if( end == v )
+				continue;
+
+			XMVECTOR p = XMLoadFloat3(&positions[v]);
+			auto triangleDistance = [&](UINT t)
+			{
+				const UINT* tri = &simplified[t * 3];
+				return PointTriangleDistance(p,
+					XMLoadFloat3(&positions[tri[0]]), XMLoadFloat3(&positions[tri[1]]), XMLoadFloat3(&positions[tri[2]]));
+			};
+
+			float distance = MathHelper::Infinity;
+			for(UINT a = adjacencyStart[end]; a < adjacencyStart[end + 1]; ++a)
+			{
+				distance = MathHelper::Min(distance, triangleDistance(adjacency[a]));
+				visited[adjacency[a]] = v;
+			}
+
+			// Only the max matters, so the second ring is searched only when
+			// the first is further away than the error so far.
+			if( distance > error )
+			{
+				for(UINT a = adjacencyStart[end]; a < adjacencyStart[end + 1]; ++a)
+				{
+					const UINT* ring = &simplified[adjacency[a] * 3];
+					for(int k = 0; k < 3; ++k)
+					{
+						for(UINT b = adjacencyStart[ring[k]]; b < adjacencyStart[ring[k] + 1]; ++b)
+						{
+							const UINT t = adjacency[b];
+							if( visited[t] == v )
+								continue;
+
+							visited[t] = v;
+							distance = MathHelper::Min(distance, triangleDistance(t));
+						}
+					}
+				}
+			}
+
+			// A vertex whose triangles all collapsed away is measured to
+			// where it went.
+			if( distance == MathHelper::Infinity )
+				distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, XMLoadFloat3(&positions[end]))));
+
+			error = MathHelper::Max(error, distance);
+		}
+
+		return error;
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	UINT targetIndexCount, float maxError, std::vector<UINT>& result)
+{
+	std::vector<bool> locked = FindLockedVertices(positions, indices);
+	std::vector<Quadric> quadrics = ComputeQuadrics(positions, indices);
+
+	std::vector<UINT> collapsedTo(positions.size());
+	for(UINT v = 0; v < (UINT)positions.size(); ++v)
+		collapsedTo[v] = v;
+
+	result = indices;
+	CollapseEdges(positions, locked, quadrics, collapsedTo, result, targetIndexCount, maxError * maxError);
+
+	return MeasureError(positions, indices, collapsedTo, result);
+}
+
+void MeshSimplifier::BuildLods(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	float maxError, std::vector<UINT>& chain, std::vector<MeshLod>& lods)
+{
+	chain = indices;
+	lods.clear();
+
+	MeshLod full;
+	full.IndexCount = (UINT)indices.size();
+	lods.push_back(full);
+
+	std::vector<bool> locked = FindLockedVertices(positions, indices);
+	std::vector<Quadric> quadrics = ComputeQuadrics(positions, indices);
+
+	std::vector<UINT> collapsedTo(positions.size());
+	for(UINT v = 0; v < (UINT)positions.size(); ++v)
+		collapsedTo[v] = v;
+
+	// Every LOD carries on from the one before with the merged quadrics, so
+	// its collapses are still priced against the original surface.
+	std::vector<UINT> simplified = indices;
+	while( lods.size() < MaxLods )
+	{
+		const MeshLod& previous = lods.back();
+
+		const UINT target = previous.IndexCount / 6 * 3;
+		if( target < 3 )
+			break;
+
+		CollapseEdges(positions, locked, quadrics, collapsedTo, simplified, target, maxError * maxError);
+		if( simplified.size() > previous.IndexCount * (1.0f - MinLodReduction) )
+			break;
+
+		float error = MathHelper::Max(MeasureError(positions, indices, collapsedTo, simplified), previous.Error);
+		if( error > maxError )
+			break;
+
+		MeshLod lod;
+		lod.StartIndexLocation = (UINT)chain.size();
+		lod.IndexCount = (UINT)simplified.size();
+		lod.Error = error;
+		lods.push_back(lod);
+
+		chain.insert(chain.end(), simplified.begin(), simplified.end());
+	}
+}
+
+UINT MeshSimplifier::SelectLod(const GeometryInfo& geo, FXMMATRIX world, const Camera& camera,
+	float viewportHeight, float maxPixelError)
+{
+	if( geo.Lods.size() < 2 )
+		return 0;
+
+	BoundingSphere bounds;
+	geo.LodBounds.Transform(bounds, world);
+	const float scale = geo.LodBounds.Radius > 0.0f ? bounds.Radius / geo.LodBounds.Radius : 1.0f;
+
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&bounds.Center), camera.GetPosition())));
+	distance = MathHelper::Max(distance - bounds.Radius, camera.GetNearZ());
+
+	// Pixels one world unit covers at that distance.
+	const float pixelsPerUnit = viewportHeight / (2.0f * distance * tanf(0.5f * camera.GetFovY()));
+
+	for(UINT lod = (UINT)geo.Lods.size() - 1; lod > 0; --lod)
+	{
+		if( geo.Lods[lod].Error * scale * pixelsPerUnit <= maxPixelError )
+			return lod;
+	}
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "D3dHeader.h"
+#include "../Common/Camera.h"
+
+///<summary>
+/// Simplifies indexed triangle meshes with Garland and Heckbert's quadric
+/// error metric, builds LOD chains out of them and picks the LOD to draw.
+///
+/// Edges collapse onto one of their two vertices, so a simplified mesh is
+/// only a new index list over the same vertices and every LOD of a mesh
+/// shares its vertex buffer.  Each vertex carries the area weighted
+/// quadric of its triangles' planes; moving it onto a neighbour costs the
+/// mean squared distance from there to those planes.  Collapses that would
+/// flip a triangle are skipped.  The error of a LOD is measured afterwards,
+/// in model units, as the largest distance from an original vertex to the
+/// simplified triangles around where it went.
+///
+/// Vertices on an open border and vertices sharing their position with
+/// another one (UV and normal seams) never move, so the outline and the
+/// seams of a mesh stay closed in every LOD.  Vertices that are exact
+/// copies of each other are welded first and are no seam.
+///</summary>
+class MeshSimplifier
+{
+public:
+	static const UINT MaxLods = 5;
+
+	// Collapses edges until at most targetIndexCount indices are left or
+	// the next collapse would cost more than maxError.  Returns the
+	// measured error, which can come out somewhat above maxError.
+	static float Simplify(const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		UINT targetIndexCount, float maxError, std::vector<UINT>& result);
+
+	// chain gets the indices of LOD 0, the welded mesh itself, and then of every
+	// LOD down to MaxLods, each aiming at half the triangles of the one
+	// before.  The chain stops early once a LOD would save too little
+	// or cost more than maxError.  The ranges in lods start at chain[0].
+	template<typename Vertex, typename Index>
+	static void BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<Index>& indices,
+		float maxError, std::vector<Index>& chain, std::vector<MeshLod>& lods);
+
+	// The coarsest LOD of geo whose error, seen from the camera at the
+	// nearest point of geo's bounds, covers at most maxPixelError pixels of
+	// a viewport viewportHeight pixels high.  0 if geo has no LODs.
+	static UINT SelectLod(const GeometryInfo& geo, DirectX::FXMMATRIX world, const Camera& camera,
+		float viewportHeight, float maxPixelError);
+
+private:
+	static void BuildLods(const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		float maxError, std::vector<UINT>& chain, std::vector<MeshLod>& lods);
+};
+
+template<typename Vertex, typename Index>
+void MeshSimplifier::BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<Index>& indices,
+	float maxError, std::vector<Index>& chain, std::vector<MeshLod>& lods)
+{
+	const UINT vertexCount = (UINT)vertices.size();
+
+	std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+	for(UINT i = 0; i < vertexCount; ++i)
+		positions[i] = vertices[i].Pos;
+
+	// Copies of a vertex, as subdivision leaves along shared edges, are
+	// one vertex to the simplifier; the indices use the first copy.
+	auto lessVertex = [&](UINT a, UINT b) { return memcmp(&vertices[a], &vertices[b], sizeof(Vertex)) < 0; };
+
+	std::vector<UINT> order(vertexCount);
+	for(UINT i = 0; i < vertexCount; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), lessVertex);
+
+	std::vector<UINT> weld(vertexCount);
+	for(UINT i = 0; i < vertexCount; ++i)
+	{
+		const bool copy = i > 0 && !lessVertex(order[i - 1], order[i]);
+		weld[order[i]] = copy ? weld[order[i - 1]] : order[i];
+	}
+
+	std::vector<UINT> meshIndices(indices.size());
+	for(size_t i = 0; i < indices.size(); ++i)
+		meshIndices[i] = weld[(UINT)indices[i]];
+
+	std::vector<UINT> lodIndices;
+	BuildLods(positions, meshIndices, maxError, lodIndices, lods);
+
+	chain.resize(lodIndices.size());
+	for(size_t i = 0; i < lodIndices.size(); ++i)
+		chain[i] = (Index)lodIndices[i];
+}
@@ -0,0 +1,295 @@
+#include "MeshletBuilder.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Normals spread further than about 84 degrees from the axis leave no
+	// place from which the whole meshlet faces away.
+	const float MinConeDot = 0.1f;
+
+	// How much a triangle's angle to the meshlet normal counts against it,
+	// next to the vertices it brings in.
+	const float ConeWeight = 1.0f;
+}
+
+void MeshletBuilder::BuildMeshlets(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	MeshletSet& set, bool frontCounterClockwise, UINT maxVertices, UINT maxTriangles)
+{
+	assert(maxVertices >= 3 && maxVertices <= 256 && maxTriangles > 0);
+
+	const UINT vertexCount = (UINT)positions.size();
+	const UINT triangleCount = (UINT)indices.size() / 3;
+	if( triangleCount == 0 )
+		return;
+
+	// Unit normal of each triangle, zero for a degenerate one.
+	std::vector<XMFLOAT3> normals(triangleCount);
+	for(UINT t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + (frontCounterClockwise ? 2 : 1)]]);
+		XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + (frontCounterClockwise ? 1 : 2)]]);
+		XMStoreFloat3(&normals[t], XMVector3Normalize(
+			XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0))));
+	}
+
+	// Triangles around each vertex, as ranges of one list.
+	std::vector<UINT> adjacencyStart(vertexCount + 1, 0);
+	for(UINT index : indices)
+		++adjacencyStart[index + 1];
+	for(UINT v = 0; v < vertexCount; ++v)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+
+	std::vector<UINT> adjacency(triangleCount * 3);
+	std::vector<UINT> adjacencyEnd(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for(UINT i = 0; i < triangleCount * 3; ++i)
+		adjacency[adjacencyEnd[indices[i]]++] = i / 3;
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	// Place of each vertex in the current meshlet, -1 if it isn't in it.
+	std::vector<int> local(vertexCount, -1);
+
+	// A degenerate triangle can name a vertex twice; it is counted once.
+	auto newVertexCount = [&](UINT t)
+	{
+		const UINT* v = &indices[t * 3];
+		UINT count = 0;
+		for(int k = 0; k < 3; ++k)
+		{
+			if( local[v[k]] < 0 && (k < 1 || v[k] != v[0]) && (k < 2 || v[k] != v[1]) )
+				++count;
+		}
+		return count;
+	};
+
+	const size_t firstMeshlet = set.Meshlets.size();
+
+	Meshlet current;
+	current.VertexOffset = (UINT)set.VertexIndices.size();
+	current.TriangleOffset = (UINT)set.Triangles.size() / 3;
+	XMVECTOR normalSum = XMVectorZero();
+	UINT nextSeed = 0;
+
+	for(UINT emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// The best neighbour: fewest new vertices, then least spread.
+		UINT best = UINT_MAX;
+		float bestScore = MathHelper::Infinity;
+
+		if( current.TriangleCount < maxTriangles )
+		{
+			XMVECTOR axis = XMVector3Normalize(normalSum);
+
+			for(UINT j = 0; j < current.VertexCount; ++j)
+			{
+				const UINT v = set.VertexIndices[current.VertexOffset + j];
+				for(UINT a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a)
+				{
+					const UINT t = adjacency[a];
+					if( emitted[t] )
+						continue;
+
+					const UINT newVertices = newVertexCount(t);
+					if( current.VertexCount + newVertices > maxVertices )
+						continue;
+
+					float spread = 1.0f - XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normals[t])));
+					float score = newVertices + ConeWeight * spread;
+					if( score < bestScore )
+					{
+						best = t;
+						bestScore = score;
+					}
+				}
+			}
+		}
+
+		if( best == UINT_MAX )
+		{
+			if( current.TriangleCount > 0 )
+			{
+				for(UINT j = 0; j < current.VertexCount; ++j)
+					local[set.VertexIndices[current.VertexOffset + j]] = -1;
+
+				set.Meshlets.push_back(current);
+				current.VertexOffset += current.VertexCount;
+				current.VertexCount = 0;
+				current.TriangleOffset += current.TriangleCount;
+				current.TriangleCount = 0;
+				normalSum = XMVectorZero();
+			}
+
+			while( emitted[nextSeed] )
+				++nextSeed;
+			best = nextSeed;
+		}
+
+		for(int k = 0; k < 3; ++k)
+		{
+			const UINT v = indices[best * 3 + k];
+			if( local[v] < 0 )
+			{
+				local[v] = (int)current.VertexCount++;
+				set.VertexIndices.push_back(v);
+			}
+
+			set.Triangles.push_back((BYTE)local[v]);
+		}
+
+		normalSum = XMVectorAdd(normalSum, XMLoadFloat3(&normals[best]));
+		emitted[best] = true;
+		++current.TriangleCount;
+	}
+
+	set.Meshlets.push_back(current);
+
+	for(size_t i = firstMeshlet; i < set.Meshlets.size(); ++i)
+		set.Bounds.push_back(ComputeMeshletBounds(positions, set, set.Meshlets[i], frontCounterClockwise));
+}
+
+MeshletBuilder::MeshletBounds MeshletBuilder::ComputeMeshletBounds(const std::vector<XMFLOAT3>& positions,
+	const MeshletSet& set, const Meshlet& meshlet, bool frontCounterClockwise)
+{
+	MeshletBounds bounds;
+
+	std::vector<XMFLOAT3> points(meshlet.VertexCount);
+	for(UINT j = 0; j < meshlet.VertexCount; ++j)
+		points[j] = positions[set.VertexIndices[meshlet.VertexOffset + j]];
+
+	BoundingSphere sphere;
+	BoundingSphere::CreateFromPoints(sphere, points.size(), points.data(), sizeof(XMFLOAT3));
+	bounds.Center = sphere.Center;
+	bounds.Radius = sphere.Radius;
+
+	// Unit normals of the triangles that have an area, with a corner each.
+	struct Face
+	{
+		XMFLOAT3 Corner;
+		XMFLOAT3 Normal;
+	};
+	std::vector<Face> faces;
+	faces.reserve(meshlet.TriangleCount);
+
+	const BYTE* triangles = &set.Triangles[meshlet.TriangleOffset * 3];
+
+	XMVECTOR normalSum = XMVectorZero();
+	for(UINT t = 0; t < meshlet.TriangleCount; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&points[triangles[t * 3 + 0]]);
+		XMVECTOR p1 = XMLoadFloat3(&points[triangles[t * 3 + (frontCounterClockwise ? 2 : 1)]]);
+		XMVECTOR p2 = XMLoadFloat3(&points[triangles[t * 3 + (frontCounterClockwise ? 1 : 2)]]);
+
+		XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		if( XMVectorGetX(XMVector3LengthSq(n)) == 0.0f )
+			continue;
+
+		n = XMVector3Normalize(n);
+		normalSum = XMVectorAdd(normalSum, n);
+
+		Face face;
+		XMStoreFloat3(&face.Corner, p0);
+		XMStoreFloat3(&face.Normal, n);
+		faces.push_back(face);
+	}
+
+	if( faces.empty() || XMVectorGetX(XMVector3LengthSq(normalSum)) == 0.0f )
+		return bounds;
+
+	XMVECTOR axis = XMVector3Normalize(normalSum);
+
+	float minDot = 1.0f;
+	for(const Face& face : faces)
+		minDot = MathHelper::Min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&face.Normal))));
+
+	if( minDot <= MinConeDot )
+		return bounds;
+
+	// Slide the apex back along the axis until it is behind every
+	// triangle's plane.
+	XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	float maxT = 0.0f;
+	for(const Face& face : faces)
+	{
+		XMVECTOR n = XMLoadFloat3(&face.Normal);
+		float dc = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, XMLoadFloat3(&face.Corner)), n));
+		float dn = XMVectorGetX(XMVector3Dot(axis, n));
+		maxT = MathHelper::Max(maxT, dc / dn);
+	}
+
+	XMStoreFloat3(&bounds.ConeApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+	XMStoreFloat3(&bounds.ConeAxis, axis);
+	bounds.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+
+	return bounds;
+}
+
+MeshletBuilder::CullFrustum MeshletBuilder::MakeCullFrustum(const Camera& camera, FXMMATRIX world)
+{
+	CullFrustum frustum;
+
+	// The planes are sums of the columns of world * view * proj; with D3D's
+	// 0 to 1 depth the near plane is the third column on its own.
+	XMMATRIX columns = XMMatrixTranspose(world * camera.GetView() * camera.GetProj());
+	XMVECTOR col0 = columns.r[0];
+	XMVECTOR col1 = columns.r[1];
+	XMVECTOR col2 = columns.r[2];
+	XMVECTOR col3 = columns.r[3];
+
+	const XMVECTOR planes[6] =
+	{
+		XMVectorAdd(col3, col0),        // left
+		XMVectorSubtract(col3, col0),   // right
+		XMVectorAdd(col3, col1),        // bottom
+		XMVectorSubtract(col3, col1),   // top
+		col2,                           // near
+		XMVectorSubtract(col3, col2)    // far
+	};
+
+	for(int i = 0; i < 6; ++i)
+		XMStoreFloat4(&frustum.Planes[i], XMPlaneNormalize(planes[i]));
+
+	XMVECTOR det = XMMatrixDeterminant(world);
+	XMMATRIX invWorld = XMMatrixInverse(&det, world);
+	XMStoreFloat3(&frustum.Eye, XMVector3TransformCoord(camera.GetPosition(), invWorld));
+
+	return frustum;
+}
+
+MeshletBuilder::CullStats MeshletBuilder::Cull(const MeshletSet& set, const CullFrustum& frustum,
+	std::vector<UINT>* visible)
+{
+	CullStats stats;
+	stats.Total = (UINT)set.Bounds.size();
+
+	XMVECTOR eye = XMLoadFloat3(&frustum.Eye);
+
+	for(UINT i = 0; i < stats.Total; ++i)
+	{
+		const MeshletBounds& b = set.Bounds[i];
+		XMVECTOR center = XMLoadFloat3(&b.Center);
+
+		bool outside = false;
+		for(int p = 0; p < 6 && !outside; ++p)
+			outside = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&frustum.Planes[p]), center)) < -b.Radius;
+
+		if( outside )
+		{
+			++stats.FrustumCulled;
+			continue;
+		}
+
+		XMVECTOR toApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&b.ConeApex), eye));
+		if( XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&b.ConeAxis))) > b.ConeCutoff )
+		{
+			++stats.BackfaceCulled;
+			continue;
+		}
+
+		if( visible )
+			visible->push_back(i);
+	}
+
+	return stats;
+}
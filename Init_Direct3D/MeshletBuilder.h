@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+#include "../Common/Camera.h"
+
+///<summary>
+/// Splits indexed triangle lists into meshlets, clusters small enough to
+/// cull one by one, and culls them on the CPU.
+///
+/// A meshlet grows one triangle at a time from the triangles touching its
+/// vertices: the one bringing in the fewest new vertices first, and among
+/// those the one facing closest to the meshlet's average normal, so the
+/// meshlets stay flat enough to be back face culled.  It is closed when no
+/// neighbour fits in MaxVertices and MaxTriangles, and the next one starts
+/// at the first triangle left in the index order.
+///
+/// Every meshlet gets a bounding sphere and a normal cone around the front
+/// facing normals of its triangles (clockwise unless told otherwise, as for
+/// a mesh drawn mirrored).  A camera
+/// inside the cone, behind its apex, only sees back faces of the meshlet.
+/// Meshlets whose normals spread too far get a cone that never culls.
+///</summary>
+class MeshletBuilder
+{
+public:
+	static const UINT MaxVertices = 64;
+	static const UINT MaxTriangles = 124;
+
+	struct Meshlet
+	{
+		// Ranges of MeshletSet::VertexIndices and, in triangles, of
+		// MeshletSet::Triangles.
+		UINT VertexOffset = 0;
+		UINT VertexCount = 0;
+		UINT TriangleOffset = 0;
+		UINT TriangleCount = 0;
+	};
+
+	struct MeshletBounds
+	{
+		DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+		float Radius = 0.0f;
+
+		// Back facing when dot(normalize(ConeApex - eye), ConeAxis) > ConeCutoff.
+		DirectX::XMFLOAT3 ConeApex = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+		float ConeCutoff = 1.0f;
+	};
+
+	struct MeshletSet
+	{
+		std::vector<Meshlet> Meshlets;
+		std::vector<MeshletBounds> Bounds;
+
+		// The mesh vertex behind each meshlet vertex.
+		std::vector<UINT> VertexIndices;
+		// Three meshlet vertices per triangle.
+		std::vector<BYTE> Triangles;
+	};
+
+	// A camera's frustum planes and position, in the model space of a mesh.
+	struct CullFrustum
+	{
+		DirectX::XMFLOAT4 Planes[6];
+		DirectX::XMFLOAT3 Eye;
+	};
+
+	struct CullStats
+	{
+		UINT Total = 0;
+		UINT FrustumCulled = 0;
+		UINT BackfaceCulled = 0;
+	};
+
+	// Appends the meshlets of indices[0, indexCount), with their bounds.
+	// Call it once per subset and no meshlet mixes two.  maxVertices can be
+	// at most 256.
+	template<typename Vertex, typename Index>
+	static void Build(const Vertex* vertices, const Index* indices, UINT indexCount, MeshletSet& set,
+		bool frontCounterClockwise = false, UINT maxVertices = MaxVertices, UINT maxTriangles = MaxTriangles);
+
+	// camera must have an up to date view matrix.
+	static CullFrustum MakeCullFrustum(const Camera& camera, DirectX::FXMMATRIX world);
+
+	// Culls against the frustum, then the normal cones.  The meshlets that
+	// pass are appended to visible, if given.
+	static CullStats Cull(const MeshletSet& set, const CullFrustum& frustum,
+		std::vector<UINT>* visible = nullptr);
+
+private:
+	static void BuildMeshlets(const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		MeshletSet& set, bool frontCounterClockwise, UINT maxVertices, UINT maxTriangles);
+
+	static MeshletBounds ComputeMeshletBounds(const std::vector<DirectX::XMFLOAT3>& positions,
+		const MeshletSet& set, const Meshlet& meshlet, bool frontCounterClockwise);
+};
+
+template<typename Vertex, typename Index>
+void MeshletBuilder::Build(const Vertex* vertices, const Index* indices, UINT indexCount, MeshletSet& set,
+	bool frontCounterClockwise, UINT maxVertices, UINT maxTriangles)
+{
+	std::vector<UINT> meshIndices(indices, indices + indexCount);
+
+	UINT vertexCount = 0;
+	for(UINT index : meshIndices)
+		vertexCount = MathHelper::Max(vertexCount, index + 1);
+
+	std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+	for(UINT i = 0; i < vertexCount; ++i)
+		positions[i] = vertices[i].Pos;
+
+	BuildMeshlets(positions, meshIndices, set, frontCounterClockwise, maxVertices, maxTriangles);
+}
@@ -0,0 +1,45 @@
+#include "ModelResource.h"
+
+void ModelResource::Upload(ID3D12Device* device, const std::string& name,
+	const void* vertexData, UINT vertexCount, UINT vertexStride,
+	const std::uint16_t* indices, UINT indexCount, const std::vector<M3DLoader::Subset>& subsets)
+{
+	mName = name;
+	mSubsets = subsets;
+
+	mGeometry = GeometryInfo();
+	mGeometry.Name = name;
+
+	GeometryBuilder builder;
+	builder.Add(&mGeometry, vertexData, vertexCount, vertexStride, indices, indexCount);
+	builder.Build(device);
+
+	mUploadedByteSize = builder.VertexBufferByteSize() + builder.IndexBufferByteSize();
+}
+
+UINT ModelResource::SubsetCount()const
+{
+	return (UINT)mSubsets.size();
+}
+
+std::unique_ptr<GeometryInfo> ModelResource::CreateSubsetGeometry(UINT subset, const std::string& geoName)const
+{
+	auto geo = std::make_unique<GeometryInfo>(mGeometry);
+	geo->Name = geoName;
+
+	// The model is a single mesh, so its BaseVertexLocation carries over.
+	geo->IndexCount = (int)mSubsets[subset].FaceCount * 3;
+	geo->StartIndexLocation = mGeometry.StartIndexLocation + mSubsets[subset].FaceStart * 3;
+
+	return geo;
+}
+
+UINT64 ModelResource::UploadedByteSize()const
+{
+	return mUploadedByteSize;
+}
+
+UINT64 ModelResource::PerSubsetCopyByteSize()const
+{
+	return mUploadedByteSize * mSubsets.size();
+}
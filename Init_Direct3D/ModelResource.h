@@ -0,0 +1,40 @@
+#pragma once
+
+#include "GeometryBuilder.h"
+#include "LoadM3d.h"
+
+///<summary>
+/// A loaded model's vertices and indices, uploaded once.
+///
+/// The whole model goes through GeometryBuilder into one vertex buffer and
+/// one index buffer.  Its subsets are ranges of that index buffer: each
+/// subset geometry shares the two buffers and only differs in IndexCount
+/// and StartIndexLocation.  The subset geometries hold references to the
+/// buffers, so they stay alive while any subset is drawn.
+///</summary>
+class ModelResource
+{
+public:
+	// M3D subsets index the whole vertex buffer, FaceStart * 3 is the first
+	// index of a subset.
+	void Upload(ID3D12Device* device, const std::string& name,
+		const void* vertexData, UINT vertexCount, UINT vertexStride,
+		const std::uint16_t* indices, UINT indexCount, const std::vector<M3DLoader::Subset>& subsets);
+
+	UINT SubsetCount()const;
+
+	// A geometry drawing one subset out of the shared buffers.
+	std::unique_ptr<GeometryInfo> CreateSubsetGeometry(UINT subset, const std::string& geoName)const;
+
+	// Bytes of the shared buffers.
+	UINT64 UploadedByteSize()const;
+	// Bytes if every subset had its own copy of the whole model.
+	UINT64 PerSubsetCopyByteSize()const;
+
+private:
+	std::string mName;
+	GeometryInfo mGeometry;
+	std::vector<M3DLoader::Subset> mSubsets;
+
+	UINT64 mUploadedByteSize = 0;
+};
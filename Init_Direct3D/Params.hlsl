@@ -3,6 +3,11 @@
 
 #define MAXLIGHTS 16
 
+//     Ѵ (BonePalette::MaxBones ).
+#ifndef MAX_BONES
+#define MAX_BONES 96
+#endif
+
 struct Light
 {
 	int lightType;
@@ -26,6 +31,12 @@ cbuffer cbPerObject : register(b0)
 {
 	float4x4 gWorld;
 	float4x4 gTexTransform;
+
+	// ȭ  ġ = 尪 * Scale + Offset (PACKED_VERTEX)
+	float3 gPosDequantScale;
+	float gObjPad0;
+	float3 gPosDequantOffset;
+	float gObjPad1;
 };
 
 cbuffer cbMaterial : register(b1)
@@ -59,10 +70,112 @@ cbuffer cbPass : register(b2)
 	float2 FogPadding;
 };
 
+#ifdef BAKED_ANIMATION
+cbuffer cbSkinned : register(b3)
+{
+	uint gPaletteOffset;
+	float3 gSkinnedPadding;
+};
+
+//  Ŭ  x  x float4 3ٷ  ȷƮ
+StructuredBuffer<float4> gBakedPalettes : register(t4);
+#elif defined(PALETTE_3X4)
+cbuffer cbSkinned : register(b3)
+{
+	//  float4 3 (BonePalette::Format::Affine3x4)
+	float4 gBoneRows[MAX_BONES * 3];
+};
+#elif defined(PALETTE_DQ)
+cbuffer cbSkinned : register(b3)
+{
+	//  ȸ , ߺ (BonePalette::Format::DualQuaternion)
+	float4 gBoneDualQuats[MAX_BONES * 2];
+};
+#else
 cbuffer cbSkinned : register(b3)
 {
-	float4x4 gBoneTransforms[96];
+	float4x4 gBoneTransforms[MAX_BONES];
 };
+#endif
+
+// ġ   3,     3  ٽ .
+float4x4 AffineFromRows(float4 c0, float4 c1, float4 c2)
+{
+	return float4x4(
+		c0.x, c1.x, c2.x, 0.0f,
+		c0.y, c1.y, c2.y, 0.0f,
+		c0.z, c1.z, c2.z, 0.0f,
+		c0.w, c1.w, c2.w, 1.0f);
+}
+
+#ifndef PALETTE_DQ
+float4x4 BoneTransform(uint bone)
+{
+#if defined(BAKED_ANIMATION)
+	uint row = gPaletteOffset + bone * 3;
+	return AffineFromRows(gBakedPalettes[row + 0], gBakedPalettes[row + 1], gBakedPalettes[row + 2]);
+#elif defined(PALETTE_3X4)
+	uint row = bone * 3;
+	return AffineFromRows(gBoneRows[row + 0], gBoneRows[row + 1], gBoneRows[row + 2]);
+#else
+	return gBoneTransforms[bone];
+#endif
+}
+#else
+float3 QuatRotate(float4 q, float3 v)
+{
+	float3 t = 2.0f * cross(q.xyz, v);
+	return v + q.w * t + cross(q.xyz, t);
+}
+
+//     ġ ´ (ù   ݱ   ȭ).
+void BlendDualQuats(uint4 bones, float4 weights, out float4 real, out float4 dual)
+{
+	float4 pivot = gBoneDualQuats[bones[0] * 2];
+
+	real = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	dual = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	[unroll]
+	for (int i = 0; i < 4; ++i)
+	{
+		float4 r = gBoneDualQuats[bones[i] * 2 + 0];
+		float4 d = gBoneDualQuats[bones[i] * 2 + 1];
+		float w = dot(r, pivot) < 0.0f ? -weights[i] : weights[i];
+
+		real += w * r;
+		dual += w * d;
+	}
+
+	float invLength = 1.0f / length(real);
+	real *= invLength;
+	dual *= invLength;
+}
+
+float3 DualQuatTransformPoint(float4 real, float4 dual, float3 p)
+{
+	// t = 2 * dual * conjugate(real)
+	float3 t = 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+	return QuatRotate(real, p) + t;
+}
+#endif
+
+#ifdef PACKED_VERTEX
+// ȭ  . VertexCompression  DecodePosition, DecodeOctahedral   ̴.
+float3 DecodePosition(float3 p)
+{
+	return p * gPosDequantScale + gPosDequantOffset;
+}
+
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+#endif
 
 TextureCube	 gCubeMap	: register(t0);
 Texture2D    gTexture_0 : register(t1);
@@ -0,0 +1,120 @@
+#include "PoseCache.h"
+
+using namespace DirectX;
+
+PoseCache::PoseCache(const SkinnedData& skinnedInfo, float timeStep, size_t maxBytes)
+	: mSkinnedInfo(skinnedInfo),
+	mTimeStep(timeStep),
+	mBoneCount(skinnedInfo.BoneCount())
+{
+	assert(timeStep > 0.0f);
+
+	const size_t paletteBytes = mBoneCount * sizeof(XMFLOAT4X4);
+	mCapacity = paletteBytes > 0 ? (UINT)(maxBytes / paletteBytes) : 0;
+
+	mPalettes.resize((size_t)mCapacity * mBoneCount);
+	mSlots.resize(mCapacity);
+}
+
+void PoseCache::GetFinalTransforms(const CompiledAnimationClip* clip, float timePos,
+	std::vector<XMFLOAT4X4>& finalTransforms, AnimationWorkspace& workspace, bool skipLeafBones)
+{
+	const UINT frame = (UINT)(MathHelper::Max(timePos, 0.0f) / mTimeStep + 0.5f);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		std::vector<int>& frames = FramesOf(clip);
+		if( frame < frames.size() && frames[frame] >= 0 )
+		{
+			const XMFLOAT4X4* palette = &mPalettes[(size_t)frames[frame] * mBoneCount];
+			std::copy(palette, palette + mBoneCount, finalTransforms.begin());
+
+			++mHitCount;
+			return;
+		}
+
+		++mMissCount;
+	}
+
+	// Evaluate outside the lock so other threads can keep hitting.
+	float snappedTime = MathHelper::Min(frame * mTimeStep, clip->GetClipEndTime());
+	mSkinnedInfo.GetFinalTransforms(clip, snappedTime, finalTransforms, workspace, skipLeafBones);
+
+	// A pose with stale leaves must not reach instances that show them.
+	if( mCapacity == 0 || skipLeafBones )
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::vector<int>& frames = FramesOf(clip);
+	if( frame >= frames.size() || frames[frame] >= 0 )
+		return;
+
+	// Take the oldest slot, unlinking whatever it held.
+	const UINT slotIndex = mNextSlot;
+	mNextSlot = (mNextSlot + 1) % mCapacity;
+
+	Slot& slot = mSlots[slotIndex];
+	if( slot.Clip != nullptr )
+		mClipFrames[slot.Clip][slot.Frame] = -1;
+
+	slot.Clip = clip;
+	slot.Frame = frame;
+	frames[frame] = (int)slotIndex;
+
+	std::copy(finalTransforms.begin(), finalTransforms.begin() + mBoneCount,
+		mPalettes.begin() + (size_t)slotIndex * mBoneCount);
+}
+
+void PoseCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for(auto& e : mClipFrames)
+		std::fill(e.second.begin(), e.second.end(), -1);
+
+	std::fill(mSlots.begin(), mSlots.end(), Slot());
+	mNextSlot = 0;
+
+	mHitCount = 0;
+	mMissCount = 0;
+}
+
+float PoseCache::GetTimeStep()const
+{
+	return mTimeStep;
+}
+
+UINT PoseCache::GetCapacity()const
+{
+	return mCapacity;
+}
+
+size_t PoseCache::GetByteSize()const
+{
+	return mPalettes.size() * sizeof(XMFLOAT4X4);
+}
+
+UINT64 PoseCache::GetHitCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHitCount;
+}
+
+UINT64 PoseCache::GetMissCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMissCount;
+}
+
+std::vector<int>& PoseCache::FramesOf(const CompiledAnimationClip* clip)
+{
+	std::vector<int>& frames = mClipFrames[clip];
+
+	// One entry per step up to and including the clip's last key.
+	if( frames.empty() )
+		frames.assign((UINT)(clip->GetClipEndTime() / mTimeStep) + 2, -1);
+
+	return frames;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SkinnedData.h"
+#include <mutex>
+
+///<summary>
+/// Final bone palettes shared by every instance of one SkinnedData.  Time is
+/// snapped to multiples of a fixed step, so instances playing the same clip
+/// at (nearly) the same time get the same pose and only the first of them
+/// pays for it.
+///
+/// Storage is a fixed number of palette slots sized from a byte budget and
+/// allocated up front; once all slots are used the oldest entry is
+/// overwritten.  Safe to call from several threads at once.
+///</summary>
+class PoseCache
+{
+public:
+	PoseCache(const SkinnedData& skinnedInfo, float timeStep, size_t maxBytes);
+
+	PoseCache(const PoseCache& rhs)=delete;
+	PoseCache& operator=(const PoseCache& rhs)=delete;
+
+	// Same as SkinnedData::GetFinalTransforms, except that timePos is
+	// rounded to the cache's time step.  workspace is only touched on a miss.
+	// A hit returns the full pose even with skipLeafBones; a miss with it
+	// skips the leaves and does not store the result.
+	void GetFinalTransforms(const CompiledAnimationClip* clip, float timePos,
+		std::vector<DirectX::XMFLOAT4X4>& finalTransforms,
+		AnimationWorkspace& workspace, bool skipLeafBones = false);
+
+	void Clear();
+
+	float GetTimeStep()const;
+	UINT GetCapacity()const;
+	size_t GetByteSize()const;
+
+	UINT64 GetHitCount()const;
+	UINT64 GetMissCount()const;
+
+private:
+	struct Slot
+	{
+		const CompiledAnimationClip* Clip = nullptr;
+		UINT Frame = 0;
+	};
+
+	// Slot index per frame of a clip, -1 if that frame is not cached.
+	std::vector<int>& FramesOf(const CompiledAnimationClip* clip);
+
+private:
+	const SkinnedData& mSkinnedInfo;
+	float mTimeStep;
+	UINT mBoneCount;
+
+	std::unordered_map<const CompiledAnimationClip*, std::vector<int>> mClipFrames;
+
+	// mCapacity palettes of mBoneCount matrices, back to back.
+	std::vector<DirectX::XMFLOAT4X4> mPalettes;
+	std::vector<Slot> mSlots;
+	UINT mCapacity = 0;
+	UINT mNextSlot = 0;
+
+	UINT64 mHitCount = 0;
+	UINT64 mMissCount = 0;
+
+	mutable std::mutex mMutex;
+};
@@ -5,7 +5,11 @@
 
 struct VertexIn
 {
+#ifdef PACKED_VERTEX
+	float4 PosQ : POSITION;
+#else
 	float3 PosL : POSITION;
+#endif
 #ifdef SKINNED
     float3 BoneWeights  : WEIGHTS;
     uint4 BoneIndices   : BONEINDICES;
@@ -20,6 +24,12 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#ifdef PACKED_VERTEX
+	float3 posL = DecodePosition(vin.PosQ.xyz);
+#else
+	float3 posL = vin.PosL;
+#endif
 	
 #ifdef SKINNED
     float weights[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -28,17 +38,24 @@ VertexOut VS(VertexIn vin)
     weights[2] = vin.BoneWeights.z;
     weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
     
-    float3 posL = float3(0.0f, 0.0f, 0.0f);
+#ifdef PALETTE_DQ
+    float4 real, dual;
+    BlendDualQuats(vin.BoneIndices, float4(weights[0], weights[1], weights[2], weights[3]), real, dual);
+
+    posL = DualQuatTransformPoint(real, dual, posL);
+#else
+    float3 skinnedPosL = float3(0.0f, 0.0f, 0.0f);
     
     for(int i = 0; i < 4; ++i)
     {
-        posL += weights[i] * mul(float4(vin.PosL, 1.0f), gBoneTransforms[vin.BoneIndices[i]]).xyz;
+        skinnedPosL += weights[i] * mul(float4(posL, 1.0f), BoneTransform(vin.BoneIndices[i])).xyz;
     }
     
-    vin.PosL = posL;
+    posL = skinnedPosL;
+#endif
 #endif
 
-	float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+	float4 posW = mul(float4(posL, 1.0f), gWorld);
 
 	vout.PosH = mul(posW, gViewProj);
 
@@ -0,0 +1,148 @@
+#include "SkeletonCompiler.h"
+
+using namespace DirectX;
+
+bool SkeletonCompiler::Compile(const std::vector<int>& boneHierarchy)
+{
+	const UINT numBones = (UINT)boneHierarchy.size();
+
+	SetIdentity(numBones);
+
+	//
+	// Children of each bone, in file order, as one flat array.
+	//
+
+	std::vector<UINT> childStart(numBones + 1, 0);
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		int parent = boneHierarchy[i];
+		if( parent >= (int)numBones || parent == (int)i )
+			return false;
+
+		if( parent >= 0 )
+			++childStart[parent + 1];
+	}
+
+	for(UINT i = 0; i < numBones; ++i)
+		childStart[i + 1] += childStart[i];
+
+	std::vector<UINT> children(childStart[numBones]);
+	std::vector<UINT> fill(childStart.begin(), childStart.end() - 1);
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		if( boneHierarchy[i] >= 0 )
+			children[fill[boneHierarchy[i]]++] = i;
+	}
+
+	//
+	// Breadth first from the roots.  The output doubles as the queue.
+	//
+
+	std::vector<UINT> order;
+	order.reserve(numBones);
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		if( boneHierarchy[i] < 0 )
+			order.push_back(i);
+	}
+
+	const UINT rootCount = (UINT)order.size();
+
+	for(UINT next = 0; next < order.size(); ++next)
+	{
+		UINT bone = order[next];
+		order.insert(order.end(), children.begin() + childStart[bone], children.begin() + childStart[bone + 1]);
+	}
+
+	// Bones on a cycle are never reached from a root.
+	if( order.size() != numBones )
+		return false;
+
+	mNewToOld = order;
+	for(UINT i = 0; i < numBones; ++i)
+		mOldToNew[mNewToOld[i]] = i;
+
+	mRootCount = rootCount;
+
+	return true;
+}
+
+UINT SkeletonCompiler::BoneCount()const
+{
+	return (UINT)mNewToOld.size();
+}
+
+UINT SkeletonCompiler::RootCount()const
+{
+	return mRootCount;
+}
+
+const std::vector<UINT>& SkeletonCompiler::GetBoneRemap()const
+{
+	return mOldToNew;
+}
+
+bool SkeletonCompiler::Apply(std::vector<int>& boneHierarchy,
+	std::vector<XMFLOAT4X4>& boneOffsets,
+	std::unordered_map<std::string, AnimationClip>& animations)const
+{
+	const UINT numBones = BoneCount();
+
+	// A clip that cannot be renumbered would animate the wrong bones.
+	for(const auto& e : animations)
+	{
+		if( e.second.BoneAnimations.size() != numBones )
+			return false;
+	}
+
+	std::vector<int> hierarchy(numBones);
+	std::vector<XMFLOAT4X4> offsets(numBones);
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		UINT old = mNewToOld[i];
+		int parent = boneHierarchy[old];
+
+		hierarchy[i] = parent < 0 ? -1 : (int)mOldToNew[parent];
+		offsets[i] = boneOffsets[old];
+	}
+
+	boneHierarchy.swap(hierarchy);
+	boneOffsets.swap(offsets);
+
+	for(auto& e : animations)
+	{
+		std::vector<BoneAnimation>& tracks = e.second.BoneAnimations;
+
+		std::vector<BoneAnimation> reordered(numBones);
+		for(UINT i = 0; i < numBones; ++i)
+			reordered[i] = std::move(tracks[mNewToOld[i]]);
+
+		tracks.swap(reordered);
+	}
+
+	return true;
+}
+
+bool SkeletonCompiler::IsParentFirst(const std::vector<int>& boneHierarchy)
+{
+	for(UINT i = 0; i < boneHierarchy.size(); ++i)
+	{
+		if( boneHierarchy[i] >= (int)i )
+			return false;
+	}
+
+	return true;
+}
+
+void SkeletonCompiler::SetIdentity(UINT boneCount)
+{
+	mOldToNew.resize(boneCount);
+	mNewToOld.resize(boneCount);
+
+	for(UINT i = 0; i < boneCount; ++i)
+		mOldToNew[i] = mNewToOld[i] = i;
+
+	mRootCount = 0;
+}
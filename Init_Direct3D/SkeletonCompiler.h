@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SkinnedData.h"
+
+///<summary>
+/// Renumbers a skeleton at load time so the hierarchy pass in
+/// SkinnedData::GetFinalTransforms walks memory front to back.
+///
+/// Bones are ordered breadth first from the roots (bones with a negative
+/// parent), with the children of a bone kept together in their original
+/// order.  Every parent then comes before its children, all roots come
+/// first, and the parents read by consecutive bones are themselves
+/// consecutive, so the root-space pass streams through both arrays instead
+/// of jumping back up the tree.
+///</summary>
+class SkeletonCompiler
+{
+public:
+	// Returns false if a parent index is out of range or the hierarchy has
+	// a cycle.  The order is then left as it was.
+	bool Compile(const std::vector<int>& boneHierarchy);
+
+	UINT BoneCount()const;
+
+	// Bones [0, RootCount()) are the roots in the compiled order.
+	UINT RootCount()const;
+
+	// File (old) bone index -> compiled index.  Vertex bone indices are
+	// remapped with this.
+	const std::vector<UINT>& GetBoneRemap()const;
+
+	// Rewrites the skeleton and every clip's bone tracks in compiled order.
+	// Returns false, and changes nothing, if a clip does not have exactly
+	// one track per bone.
+	bool Apply(std::vector<int>& boneHierarchy,
+		std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
+		std::unordered_map<std::string, AnimationClip>& animations)const;
+
+	// True if every bone's parent has a lower index.
+	static bool IsParentFirst(const std::vector<int>& boneHierarchy);
+
+private:
+	void SetIdentity(UINT boneCount);
+
+	std::vector<UINT> mOldToNew;
+	std::vector<UINT> mNewToOld;
+	UINT mRootCount = 0;
+};
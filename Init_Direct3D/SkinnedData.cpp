@@ -1,7 +1,29 @@
 #include "SkinnedData.h"
+#include "SkeletonCompiler.h"
 
 using namespace DirectX;
 
+namespace
+{
+	template<typename T>
+	size_t VectorByteSize(const std::vector<T>& v)
+	{
+		return v.capacity() * sizeof(T);
+	}
+
+	UINT64 HashBytes(const void* data, size_t size, UINT64 hash)
+	{
+		// FNV-1a
+		const BYTE* bytes = static_cast<const BYTE*>(data);
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
 Keyframe::Keyframe()
 	: TimePos(0.0f),
 	Translation(0.0f, 0.0f, 0.0f),
@@ -28,7 +50,40 @@ float BoneAnimation::GetEndTime()const
 	return f;
 }
 
+UINT BoneAnimation::FindKeyframe(float t, UINT& cursor)const
+{
+	const UINT lastPair = (UINT)Keyframes.size() - 2;
+
+	// Forward playback usually stays in the same pair or moves to one of
+	// the next few, so try stepping from the cached cursor first.
+	if( cursor <= lastPair && t >= Keyframes[cursor].TimePos )
+	{
+		const UINT maxSteps = 4;
+		for(UINT step = 0; step < maxSteps && cursor <= lastPair; ++step, ++cursor)
+		{
+			if( t <= Keyframes[cursor+1].TimePos )
+				return cursor;
+		}
+	}
+
+	// Random seek or wrap around: binary search for the first keyframe
+	// after t.  The pair starts one before it.
+	auto it = std::upper_bound(Keyframes.begin(), Keyframes.end(), t,
+		[](float time, const Keyframe& key) { return time < key.TimePos; });
+
+	UINT i = (UINT)(it - Keyframes.begin());
+	cursor = MathHelper::Clamp(i, 1u, lastPair + 1) - 1;
+
+	return cursor;
+}
+
 void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
+{
+	UINT cursor = (UINT)-1;
+	Interpolate(t, M, cursor);
+}
+
+void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M, UINT& cursor)const
 {
 	if( t <= Keyframes.front().TimePos )
 	{
@@ -50,31 +105,236 @@ void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 	}
 	else
 	{
-		for(UINT i = 0; i < Keyframes.size()-1; ++i)
+		UINT i = FindKeyframe(t, cursor);
+
+		float lerpPercent = (t - Keyframes[i].TimePos) / (Keyframes[i+1].TimePos - Keyframes[i].TimePos);
+
+		XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
+		XMVECTOR s1 = XMLoadFloat3(&Keyframes[i+1].Scale);
+
+		XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
+		XMVECTOR p1 = XMLoadFloat3(&Keyframes[i+1].Translation);
+
+		XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
+		XMVECTOR q1 = XMLoadFloat4(&Keyframes[i+1].RotationQuat);
+
+		XMVECTOR S = XMVectorLerp(s0, s1, lerpPercent);
+		XMVECTOR P = XMVectorLerp(p0, p1, lerpPercent);
+		XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerpPercent);
+
+		XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+	}
+}
+
+namespace
+{
+	// True if interpolating k0 -> k1 at the time of key reproduces key
+	// within tolerance.
+	bool Reconstructs(const Keyframe& k0, const Keyframe& k1, const Keyframe& key,
+		const KeyframeTolerance& tolerance)
+	{
+		float span = k1.TimePos - k0.TimePos;
+		float lerpPercent = span > 0.0f ? (key.TimePos - k0.TimePos) / span : 0.0f;
+
+		XMVECTOR P = XMVectorLerp(XMLoadFloat3(&k0.Translation), XMLoadFloat3(&k1.Translation), lerpPercent);
+		XMVECTOR S = XMVectorLerp(XMLoadFloat3(&k0.Scale), XMLoadFloat3(&k1.Scale), lerpPercent);
+		XMVECTOR Q = XMQuaternionSlerp(XMLoadFloat4(&k0.RotationQuat), XMLoadFloat4(&k1.RotationQuat), lerpPercent);
+
+		float translationError = XMVectorGetX(XMVector3Length(XMVectorSubtract(P, XMLoadFloat3(&key.Translation))));
+		float scaleError = XMVectorGetX(XMVector3Length(XMVectorSubtract(S, XMLoadFloat3(&key.Scale))));
+
+		// Angle between the two rotations; q and -q are the same rotation.
+		float cosHalfAngle = fabsf(XMVectorGetX(XMQuaternionDot(
+			XMQuaternionNormalize(Q), XMQuaternionNormalize(XMLoadFloat4(&key.RotationQuat)))));
+		float rotationError = 2.0f * acosf(MathHelper::Min(cosHalfAngle, 1.0f));
+
+		return translationError <= tolerance.Translation &&
+			scaleError <= tolerance.Scale &&
+			rotationError <= tolerance.Rotation;
+	}
+}
+
+void BoneAnimation::Reduce(const KeyframeTolerance& tolerance)
+{
+	const UINT numKeys = (UINT)Keyframes.size();
+	if( numKeys <= 2 )
+		return;
+
+	std::vector<Keyframe> kept;
+	kept.push_back(Keyframes[0]);
+
+	// Grow a segment from the last kept key for as long as its end points
+	// reproduce every key inside it; when key j no longer fits, j-1 stays.
+	UINT anchor = 0;
+	for(UINT j = 2; j < numKeys; ++j)
+	{
+		bool fits = true;
+		for(UINT k = anchor + 1; k < j && fits; ++k)
+			fits = Reconstructs(Keyframes[anchor], Keyframes[j], Keyframes[k], tolerance);
+
+		if( !fits )
 		{
-			if( t >= Keyframes[i].TimePos && t <= Keyframes[i+1].TimePos )
-			{
-				float lerpPercent = (t - Keyframes[i].TimePos) / (Keyframes[i+1].TimePos - Keyframes[i].TimePos);
+			anchor = j - 1;
+			kept.push_back(Keyframes[anchor]);
+		}
+	}
 
-				XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
-				XMVECTOR s1 = XMLoadFloat3(&Keyframes[i+1].Scale);
+	kept.push_back(Keyframes.back());
+	Keyframes.swap(kept);
+}
+
+namespace
+{
+	// Motion "first" followed by motion "then", each a rotation followed by
+	// a translation.
+	void ComposeMotion(XMVECTOR& rotation, XMVECTOR& translation,
+		FXMVECTOR firstRotation, FXMVECTOR firstTranslation,
+		FXMVECTOR thenRotation, GXMVECTOR thenTranslation)
+	{
+		translation = XMVectorAdd(XMVector3Rotate(firstTranslation, thenRotation), thenTranslation);
+		rotation = XMQuaternionMultiply(firstRotation, thenRotation);
+	}
 
-				XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
-				XMVECTOR p1 = XMLoadFloat3(&Keyframes[i+1].Translation);
+	// Rotation about +Y contained in q (the twist of a swing-twist split).
+	XMVECTOR TwistAboutY(FXMVECTOR q)
+	{
+		XMVECTOR twist = XMVectorMultiply(q, XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
 
-				XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
-				XMVECTOR q1 = XMLoadFloat4(&Keyframes[i+1].RotationQuat);
+		if( XMVectorGetX(XMVector4LengthSq(twist)) < 1.0e-12f )
+			return XMQuaternionIdentity();
 
-				XMVECTOR S = XMVectorLerp(s0, s1, lerpPercent);
-				XMVECTOR P = XMVectorLerp(p0, p1, lerpPercent);
-				XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerpPercent);
+		return XMQuaternionNormalize(twist);
+	}
+}
 
-				XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-				XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+bool RootMotionTrack::Empty()const
+{
+	return Times.empty();
+}
 
-				break;
-			}
+void RootMotionTrack::Sample(float t, XMVECTOR& rotation, XMVECTOR& translation)const
+{
+	if( Times.empty() )
+	{
+		rotation = XMQuaternionIdentity();
+		translation = XMVectorZero();
+		return;
+	}
+
+	// Root tracks are short, and this is called a couple of times per
+	// update, so a binary search is enough.
+	UINT i = (UINT)(std::upper_bound(Times.begin(), Times.end(), t) - Times.begin());
+
+	if( i == 0 || i == Times.size() )
+	{
+		UINT key = i == 0 ? 0 : i - 1;
+		rotation = XMLoadFloat4(&Rotation[key]);
+		translation = XMLoadFloat3(&Translation[key]);
+		return;
+	}
+
+	float lerpPercent = (t - Times[i-1]) / (Times[i] - Times[i-1]);
+
+	rotation = XMQuaternionSlerp(XMLoadFloat4(&Rotation[i-1]), XMLoadFloat4(&Rotation[i]), lerpPercent);
+	translation = XMVectorLerp(XMLoadFloat3(&Translation[i-1]), XMLoadFloat3(&Translation[i]), lerpPercent);
+}
+
+void RootMotionTrack::GetDelta(float t0, float dt, XMFLOAT4& rotation, XMFLOAT3& translation)const
+{
+	XMVECTOR totalRotation = XMQuaternionIdentity();
+	XMVECTOR totalTranslation = XMVectorZero();
+
+	// Motion from a to b in the frame at a: rotation q(a)^-1 q(b), and the
+	// displacement p(b) - p(a) brought back into the frame at a.
+	auto addSegment = [&](float a, float b)
+	{
+		XMVECTOR qa, pa, qb, pb;
+		Sample(a, qa, pa);
+		Sample(b, qb, pb);
+
+		XMVECTOR qaInv = XMQuaternionInverse(qa);
+		XMVECTOR q = XMQuaternionMultiply(qb, qaInv);
+		XMVECTOR p = XMVector3Rotate(XMVectorSubtract(pb, pa), qaInv);
+
+		// Later segments happen in the frame the earlier ones left behind.
+		XMVECTOR composedRotation, composedTranslation;
+		ComposeMotion(composedRotation, composedTranslation, q, p, totalRotation, totalTranslation);
+
+		totalRotation = composedRotation;
+		totalTranslation = composedTranslation;
+	};
+
+	if( !Empty() && EndTime > StartTime && dt > 0.0f )
+	{
+		float from = t0;
+		float remaining = dt;
+
+		while( from + remaining > EndTime )
+		{
+			addSegment(from, EndTime);
+			remaining -= EndTime - from;
+			from = StartTime;
 		}
+
+		addSegment(from, from + remaining);
+	}
+
+	XMStoreFloat4(&rotation, totalRotation);
+	XMStoreFloat3(&translation, totalTranslation);
+}
+
+void AnimationEventTrack::Add(float time, const std::string& name)
+{
+	AnimationEvent e;
+	e.Time = time;
+	e.Name = name;
+
+	auto at = std::upper_bound(Events.begin(), Events.end(), time,
+		[](float t, const AnimationEvent& rhs) { return t < rhs.Time; });
+
+	Events.insert(at, e);
+}
+
+UINT AnimationEventTrack::Seek(float t)const
+{
+	auto at = std::upper_bound(Events.begin(), Events.end(), t,
+		[](float t, const AnimationEvent& rhs) { return t < rhs.Time; });
+
+	return (UINT)(at - Events.begin());
+}
+
+void AnimationEventTrack::Advance(float t0, float dt, float startTime, float endTime, UINT& cursor,
+	std::vector<const AnimationEvent*>& fired)const
+{
+	const UINT numEvents = (UINT)Events.size();
+	if( numEvents == 0 || endTime <= startTime || dt <= 0.0f )
+		return;
+
+	// The cursor sits between the last event at or before t0 and the first
+	// one after it.  Anything else means the time was moved behind our back.
+	bool stale = cursor > numEvents ||
+		(cursor > 0 && Events[cursor-1].Time > t0) ||
+		(cursor < numEvents && Events[cursor].Time <= t0);
+
+	if( stale )
+		cursor = Seek(t0);
+
+	float t = t0 + dt;
+	for(;;)
+	{
+		float stop = MathHelper::Min(t, endTime);
+
+		while( cursor < numEvents && Events[cursor].Time <= stop )
+			fired.push_back(&Events[cursor++]);
+
+		if( t <= endTime )
+			break;
+
+		// Back at the start, which is also the end: events right on it fire.
+		t -= endTime - startTime;
+		cursor = (UINT)(std::lower_bound(Events.begin(), Events.end(), startTime,
+			[](const AnimationEvent& lhs, float t) { return lhs.Time < t; }) - Events.begin());
 	}
 }
 
@@ -102,6 +362,86 @@ float AnimationClip::GetClipEndTime()const
 	return t;
 }
 
+void AnimationClip::Reduce(const KeyframeTolerance& tolerance)
+{
+	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+	{
+		BoneAnimations[i].Reduce(tolerance);
+	}
+}
+
+void AnimationClip::ExtractRootMotion(UINT rootBone)
+{
+	RootMotion = RootMotionTrack();
+	RootMotion.StartTime = GetClipStartTime();
+	RootMotion.EndTime = GetClipEndTime();
+
+	if( rootBone >= BoneAnimations.size() || BoneAnimations[rootBone].Keyframes.empty() )
+		return;
+
+	std::vector<Keyframe>& keys = BoneAnimations[rootBone].Keyframes;
+
+	const XMVECTOR groundPlane = XMVectorSet(1.0f, 0.0f, 1.0f, 0.0f);
+	const XMVECTOR p0 = XMLoadFloat3(&keys[0].Translation);
+	const XMVECTOR q0Inv = XMQuaternionInverse(XMLoadFloat4(&keys[0].RotationQuat));
+
+	std::vector<XMVECTOR> motionRotation(keys.size());
+	std::vector<XMVECTOR> motionTranslation(keys.size());
+	bool moves = false;
+
+	for(UINT i = 0; i < keys.size(); ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&keys[i].Translation);
+		XMVECTOR q = XMLoadFloat4(&keys[i].RotationQuat);
+
+		// Rotation since the first key (in model space), kept only about Y.
+		motionRotation[i] = TwistAboutY(XMQuaternionMultiply(q0Inv, q));
+		motionTranslation[i] = XMVectorMultiply(XMVectorSubtract(p, p0), groundPlane);
+
+		float angle = 2.0f * acosf(MathHelper::Min(fabsf(XMVectorGetW(motionRotation[i])), 1.0f));
+		float distance = XMVectorGetX(XMVector3Length(motionTranslation[i]));
+
+		if( angle > 1.0e-4f || distance > 1.0e-4f )
+			moves = true;
+	}
+
+	if( !moves )
+		return;
+
+	// The key becomes what is left after undoing the motion:
+	// key = stripped key, then motion rotation, then motion translation.
+	for(UINT i = 0; i < keys.size(); ++i)
+	{
+		XMVECTOR twistInv = XMQuaternionInverse(motionRotation[i]);
+
+		XMVECTOR p = XMLoadFloat3(&keys[i].Translation);
+		XMVECTOR q = XMLoadFloat4(&keys[i].RotationQuat);
+
+		XMStoreFloat3(&keys[i].Translation, XMVector3Rotate(XMVectorSubtract(p, motionTranslation[i]), twistInv));
+		XMStoreFloat4(&keys[i].RotationQuat, XMQuaternionNormalize(XMQuaternionMultiply(q, twistInv)));
+
+		RootMotion.Times.push_back(keys[i].TimePos);
+		RootMotion.Rotation.push_back(XMFLOAT4());
+		RootMotion.Translation.push_back(XMFLOAT3());
+		XMStoreFloat4(&RootMotion.Rotation.back(), motionRotation[i]);
+		XMStoreFloat3(&RootMotion.Translation.back(), motionTranslation[i]);
+	}
+}
+
+size_t AnimationClip::GetByteSize()const
+{
+	size_t size = VectorByteSize(BoneAnimations);
+	for(const BoneAnimation& bone : BoneAnimations)
+		size += VectorByteSize(bone.Keyframes);
+
+	size += VectorByteSize(RootMotion.Times);
+	size += VectorByteSize(RootMotion.Translation);
+	size += VectorByteSize(RootMotion.Rotation);
+
+	size += VectorByteSize(Events.Events);
+	return size;
+}
+
 void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms)const
 {
 	for(UINT i = 0; i < BoneAnimations.size(); ++i)
@@ -110,58 +450,1000 @@ void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms
 	}
 }
 
-float SkinnedData::GetClipStartTime(const std::string& clipName)const
+void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms, std::vector<UINT>& keyframeCursors)const
 {
-	auto clip = mAnimations.find(clipName);
-	return clip->second.GetClipStartTime();
+	if( keyframeCursors.size() != BoneAnimations.size() )
+		keyframeCursors.assign(BoneAnimations.size(), 0);
+
+	for(UINT i = 0; i < BoneAnimations.size(); ++i)
+	{
+		BoneAnimations[i].Interpolate(t, boneTransforms[i], keyframeCursors[i]);
+	}
 }
 
-float SkinnedData::GetClipEndTime(const std::string& clipName)const
+namespace
 {
-	auto clip = mAnimations.find(clipName);
-	return clip->second.GetClipEndTime();
+	// Index i of the pair [i, i+1] in times[0..numKeys) that bounds t, which must
+	// lie strictly inside the key range.  Same stepping strategy as
+	// BoneAnimation::FindKeyframe, on a bare time stream.
+	UINT FindKeyPair(const float* times, UINT numKeys, float t, UINT& cursor)
+	{
+		const UINT lastPair = numKeys - 2;
+
+		if( cursor <= lastPair && t >= times[cursor] )
+		{
+			const UINT maxSteps = 4;
+			for(UINT step = 0; step < maxSteps && cursor <= lastPair; ++step, ++cursor)
+			{
+				if( t <= times[cursor+1] )
+					return cursor;
+			}
+		}
+
+		UINT i = (UINT)(std::upper_bound(times, times + numKeys, t) - times);
+		cursor = MathHelper::Clamp(i, 1u, lastPair + 1) - 1;
+
+		return cursor;
+	}
+
+	XMVECTOR Gather(const std::vector<USHORT>& stream, const UINT key[4])
+	{
+		return XMVectorSet(stream[key[0]], stream[key[1]], stream[key[2]], stream[key[3]]);
+	}
+
+	// Lane i gets component c of v[bone[i]].
+	XMVECTOR GatherComponent(const std::vector<XMFLOAT3>& v, const UINT bone[4], UINT c)
+	{
+		return XMVectorSet((&v[bone[0]].x)[c], (&v[bone[1]].x)[c], (&v[bone[2]].x)[c], (&v[bone[3]].x)[c]);
+	}
+
+	// Smallest-three components lie in [-1/sqrt(2), 1/sqrt(2)].
+	const float QuatRange = 0.70710678f;
+	const float QuatStep = 2.0f * QuatRange / 32767.0f;
+
+	USHORT Quantize(float v, float min, float step)
+	{
+		if( step <= 0.0f )
+			return 0;
+
+		return (USHORT)MathHelper::Clamp((v - min) / step + 0.5f, 0.0f, 65535.0f);
+	}
+
+	void PackRotation(const XMFLOAT4& quat, USHORT& a, USHORT& b, USHORT& c)
+	{
+		XMFLOAT4 n;
+		XMStoreFloat4(&n, XMQuaternionNormalize(XMLoadFloat4(&quat)));
+		const float q[4] = { n.x, n.y, n.z, n.w };
+
+		UINT largest = 0;
+		for(UINT i = 1; i < 4; ++i)
+		{
+			if( fabsf(q[i]) > fabsf(q[largest]) )
+				largest = i;
+		}
+
+		// q and -q are the same rotation, so the dropped component can always
+		// be taken as positive and rebuilt as sqrt(1 - a^2 - b^2 - c^2).
+		const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+		USHORT packed[3];
+		UINT n3 = 0;
+		for(UINT i = 0; i < 4; ++i)
+		{
+			if( i != largest )
+				packed[n3++] = (USHORT)MathHelper::Clamp((q[i]*sign + QuatRange) / QuatStep + 0.5f, 0.0f, 32767.0f);
+		}
+
+		a = (USHORT)(packed[0] | ((largest >> 1) << 15));
+		b = (USHORT)(packed[1] | ((largest & 1) << 15));
+		c = packed[2];
+	}
 }
 
-UINT SkinnedData::BoneCount()const
+void CompiledAnimationClip::Build(const AnimationClip& clip)
 {
-	return mBoneHierarchy.size();
+	const UINT numBones = (UINT)clip.BoneAnimations.size();
+
+	UINT numKeys = 0;
+	for(UINT i = 0; i < numBones; ++i)
+		numKeys += (UINT)clip.BoneAnimations[i].Keyframes.size();
+
+	std::vector<USHORT>* streams[] =
+	{
+		&TranslationX, &TranslationY, &TranslationZ,
+		&ScaleX, &ScaleY, &ScaleZ,
+		&RotationA, &RotationB, &RotationC
+	};
+
+	Times.clear();
+	Times.reserve(numKeys);
+
+	for(auto stream : streams)
+	{
+		stream->clear();
+		stream->reserve(numKeys);
+	}
+
+	KeyStart.resize(numBones);
+	KeyCount.resize(numBones);
+	TranslationMin.resize(numBones);
+	TranslationStep.resize(numBones);
+	ScaleMin.resize(numBones);
+	ScaleStep.resize(numBones);
+
+	const XMVECTOR maxQuantized = XMVectorReplicate(65535.0f);
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		const std::vector<Keyframe>& keys = clip.BoneAnimations[i].Keyframes;
+
+		KeyStart[i] = (UINT)Times.size();
+		KeyCount[i] = (UINT)keys.size();
+
+		// Quantization range of this bone.
+		XMVECTOR tMin = XMVectorReplicate(+MathHelper::Infinity);
+		XMVECTOR tMax = XMVectorReplicate(-MathHelper::Infinity);
+		XMVECTOR sMin = tMin;
+		XMVECTOR sMax = tMax;
+
+		for(const Keyframe& key : keys)
+		{
+			tMin = XMVectorMin(tMin, XMLoadFloat3(&key.Translation));
+			tMax = XMVectorMax(tMax, XMLoadFloat3(&key.Translation));
+			sMin = XMVectorMin(sMin, XMLoadFloat3(&key.Scale));
+			sMax = XMVectorMax(sMax, XMLoadFloat3(&key.Scale));
+		}
+
+		XMStoreFloat3(&TranslationMin[i], tMin);
+		XMStoreFloat3(&TranslationStep[i], XMVectorDivide(XMVectorSubtract(tMax, tMin), maxQuantized));
+		XMStoreFloat3(&ScaleMin[i], sMin);
+		XMStoreFloat3(&ScaleStep[i], XMVectorDivide(XMVectorSubtract(sMax, sMin), maxQuantized));
+
+		const XMFLOAT3& t0 = TranslationMin[i];
+		const XMFLOAT3& dt = TranslationStep[i];
+		const XMFLOAT3& s0 = ScaleMin[i];
+		const XMFLOAT3& ds = ScaleStep[i];
+
+		for(const Keyframe& key : keys)
+		{
+			Times.push_back(key.TimePos);
+
+			TranslationX.push_back(Quantize(key.Translation.x, t0.x, dt.x));
+			TranslationY.push_back(Quantize(key.Translation.y, t0.y, dt.y));
+			TranslationZ.push_back(Quantize(key.Translation.z, t0.z, dt.z));
+
+			ScaleX.push_back(Quantize(key.Scale.x, s0.x, ds.x));
+			ScaleY.push_back(Quantize(key.Scale.y, s0.y, ds.y));
+			ScaleZ.push_back(Quantize(key.Scale.z, s0.z, ds.z));
+
+			USHORT a, b, c;
+			PackRotation(key.RotationQuat, a, b, c);
+			RotationA.push_back(a);
+			RotationB.push_back(b);
+			RotationC.push_back(c);
+		}
+	}
+
+	StartTime = clip.GetClipStartTime();
+	EndTime = clip.GetClipEndTime();
+
+	RootMotion = clip.RootMotion;
+	Events = clip.Events;
 }
 
-void SkinnedData::Set(std::vector<int>& boneHierarchy, 
-		              std::vector<XMFLOAT4X4>& boneOffsets,
-		              std::unordered_map<std::string, AnimationClip>& animations)
+UINT CompiledAnimationClip::BoneCount()const
 {
-	mBoneHierarchy = boneHierarchy;
-	mBoneOffsets   = boneOffsets;
-	mAnimations    = animations;
+	return (UINT)KeyStart.size();
 }
- 
-void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<XMFLOAT4X4>& finalTransforms)const
+
+size_t CompiledAnimationClip::GetByteSize()const
 {
-	UINT numBones = mBoneOffsets.size();
+	size_t size = VectorByteSize(KeyStart) + VectorByteSize(KeyCount) + VectorByteSize(Times);
 
-	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
+	size += VectorByteSize(TranslationX) + VectorByteSize(TranslationY) + VectorByteSize(TranslationZ);
+	size += VectorByteSize(ScaleX) + VectorByteSize(ScaleY) + VectorByteSize(ScaleZ);
+	size += VectorByteSize(RotationA) + VectorByteSize(RotationB) + VectorByteSize(RotationC);
 
-	// Interpolate all the bones of this clip at the given time instance.
-	auto clip = mAnimations.find(clipName);
-	clip->second.Interpolate(timePos, toParentTransforms);
+	size += VectorByteSize(TranslationMin) + VectorByteSize(TranslationStep);
+	size += VectorByteSize(ScaleMin) + VectorByteSize(ScaleStep);
+
+	size += VectorByteSize(RootMotion.Times);
+	size += VectorByteSize(RootMotion.Translation);
+	size += VectorByteSize(RootMotion.Rotation);
+
+	size += VectorByteSize(Events.Events);
+	return size;
+}
+
+float CompiledAnimationClip::GetClipStartTime()const
+{
+	return StartTime;
+}
+
+float CompiledAnimationClip::GetClipEndTime()const
+{
+	return EndTime;
+}
+
+void CompiledAnimationClip::GatherRotation(const UINT key[4], XMVECTOR& x, XMVECTOR& y, XMVECTOR& z, XMVECTOR& w)const
+{
+	XMFLOAT4A packedA, packedB, packedC, largest;
+
+	for(UINT lane = 0; lane < 4; ++lane)
+	{
+		const UINT a = RotationA[key[lane]];
+		const UINT b = RotationB[key[lane]];
+
+		(&packedA.x)[lane] = (float)(a & 0x7fff);
+		(&packedB.x)[lane] = (float)(b & 0x7fff);
+		(&packedC.x)[lane] = (float)RotationC[key[lane]];
+		(&largest.x)[lane] = (float)(((a >> 15) << 1) | (b >> 15));
+	}
+
+	const XMVECTOR step = XMVectorReplicate(QuatStep);
+	const XMVECTOR offset = XMVectorReplicate(-QuatRange);
+
+	XMVECTOR a = XMVectorMultiplyAdd(XMLoadFloat4A(&packedA), step, offset);
+	XMVECTOR b = XMVectorMultiplyAdd(XMLoadFloat4A(&packedB), step, offset);
+	XMVECTOR c = XMVectorMultiplyAdd(XMLoadFloat4A(&packedC), step, offset);
+
+	XMVECTOR d = XMVectorSubtract(XMVectorSplatOne(), XMVectorMultiply(a, a));
+	d = XMVectorNegativeMultiplySubtract(b, b, d);
+	d = XMVectorNegativeMultiplySubtract(c, c, d);
+	d = XMVectorSqrt(XMVectorMax(d, XMVectorZero()));
+
+	// Put the rebuilt component back in its slot:
+	//   0: (d,a,b,c)  1: (a,d,b,c)  2: (a,b,d,c)  3: (a,b,c,d)
+	XMVECTOR index = XMLoadFloat4A(&largest);
+	XMVECTOR is0 = XMVectorEqual(index, XMVectorZero());
+	XMVECTOR is1 = XMVectorEqual(index, XMVectorSplatOne());
+	XMVECTOR is2 = XMVectorEqual(index, XMVectorReplicate(2.0f));
+	XMVECTOR is3 = XMVectorEqual(index, XMVectorReplicate(3.0f));
+
+	x = XMVectorSelect(a, d, is0);
+	y = XMVectorSelect(XMVectorSelect(b, d, is1), a, is0);
+	z = XMVectorSelect(XMVectorSelect(c, d, is2), b, XMVectorOrInt(is0, is1));
+	w = XMVectorSelect(c, d, is3);
+}
+
+void CompiledAnimationClip::SampleGroup(const UINT bones[4], float t, std::vector<UINT>& keyframeCursors, XMVECTOR lanes[10])const
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR oneMinusEpsilon = XMVectorReplicate(1.0f - 0.00001f);
 
 	//
-	// Traverse the hierarchy and transform all the bones to the root space.
+	// Find the two keys and the blend factor of each lane.
 	//
 
-	std::vector<XMFLOAT4X4> toRootTransforms(numBones);
-
-	// The root bone has index 0.  The root bone has no parent, so its toRootTransform
-	// is just its local bone transform.
-	toRootTransforms[0] = toParentTransforms[0];
+	UINT key0[4];
+	UINT key1[4];
+	XMFLOAT4A lerpPercent;
+	float* lerpLane = &lerpPercent.x;
 
-	// Now find the toRootTransform of the children.
-	for(UINT i = 1; i < numBones; ++i)
+	for(UINT lane = 0; lane < 4; ++lane)
 	{
-		XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
+		const UINT bone = bones[lane];
+		const UINT start = KeyStart[bone];
+		const UINT count = KeyCount[bone];
+		const float* times = &Times[start];
+
+		if( t <= times[0] )
+		{
+			key0[lane] = key1[lane] = start;
+			lerpLane[lane] = 0.0f;
+		}
+		else if( t >= times[count-1] )
+		{
+			key0[lane] = key1[lane] = start + count - 1;
+			lerpLane[lane] = 0.0f;
+		}
+		else
+		{
+			UINT i = FindKeyPair(times, count, t, keyframeCursors[bone]);
+
+			key0[lane] = start + i;
+			key1[lane] = start + i + 1;
+			lerpLane[lane] = (t - times[i]) / (times[i+1] - times[i]);
+		}
+	}
+
+	XMVECTOR L = XMLoadFloat4A(&lerpPercent);
+
+	// Lerp the quantized values, then dequantize once.
+	XMVECTOR tx = XMVectorLerpV(Gather(TranslationX, key0), Gather(TranslationX, key1), L);
+	XMVECTOR ty = XMVectorLerpV(Gather(TranslationY, key0), Gather(TranslationY, key1), L);
+	XMVECTOR tz = XMVectorLerpV(Gather(TranslationZ, key0), Gather(TranslationZ, key1), L);
+
+	tx = XMVectorMultiplyAdd(tx, GatherComponent(TranslationStep, bones, 0), GatherComponent(TranslationMin, bones, 0));
+	ty = XMVectorMultiplyAdd(ty, GatherComponent(TranslationStep, bones, 1), GatherComponent(TranslationMin, bones, 1));
+	tz = XMVectorMultiplyAdd(tz, GatherComponent(TranslationStep, bones, 2), GatherComponent(TranslationMin, bones, 2));
+
+	XMVECTOR sx = XMVectorLerpV(Gather(ScaleX, key0), Gather(ScaleX, key1), L);
+	XMVECTOR sy = XMVectorLerpV(Gather(ScaleY, key0), Gather(ScaleY, key1), L);
+	XMVECTOR sz = XMVectorLerpV(Gather(ScaleZ, key0), Gather(ScaleZ, key1), L);
+
+	sx = XMVectorMultiplyAdd(sx, GatherComponent(ScaleStep, bones, 0), GatherComponent(ScaleMin, bones, 0));
+	sy = XMVectorMultiplyAdd(sy, GatherComponent(ScaleStep, bones, 1), GatherComponent(ScaleMin, bones, 1));
+	sz = XMVectorMultiplyAdd(sz, GatherComponent(ScaleStep, bones, 2), GatherComponent(ScaleMin, bones, 2));
+
+	//
+	// Slerp, lane-wise version of XMQuaternionSlerpV.
+	//
+
+	XMVECTOR qx0, qy0, qz0, qw0;
+	GatherRotation(key0, qx0, qy0, qz0, qw0);
+
+	XMVECTOR qx1, qy1, qz1, qw1;
+	GatherRotation(key1, qx1, qy1, qz1, qw1);
+
+	XMVECTOR cosOmega = XMVectorMultiply(qx0, qx1);
+	cosOmega = XMVectorMultiplyAdd(qy0, qy1, cosOmega);
+	cosOmega = XMVectorMultiplyAdd(qz0, qz1, cosOmega);
+	cosOmega = XMVectorMultiplyAdd(qw0, qw1, cosOmega);
+
+	// Take the shorter arc.
+	XMVECTOR sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(cosOmega, zero));
+	cosOmega = XMVectorMultiply(cosOmega, sign);
+
+	// Nearly parallel quaternions fall back to a plain lerp.
+	XMVECTOR useSlerp = XMVectorLess(cosOmega, oneMinusEpsilon);
+
+	XMVECTOR sinOmega = XMVectorSqrt(XMVectorNegativeMultiplySubtract(cosOmega, cosOmega, one));
+	XMVECTOR omega = XMVectorATan2(sinOmega, cosOmega);
+	XMVECTOR invSinOmega = XMVectorReciprocal(sinOmega);
+
+	XMVECTOR oneMinusL = XMVectorSubtract(one, L);
+	XMVECTOR s0 = XMVectorMultiply(XMVectorSin(XMVectorMultiply(oneMinusL, omega)), invSinOmega);
+	XMVECTOR s1 = XMVectorMultiply(XMVectorSin(XMVectorMultiply(L, omega)), invSinOmega);
+
+	s0 = XMVectorSelect(oneMinusL, s0, useSlerp);
+	s1 = XMVectorMultiply(XMVectorSelect(L, s1, useSlerp), sign);
+
+	XMVECTOR qx = XMVectorMultiplyAdd(qx1, s1, XMVectorMultiply(qx0, s0));
+	XMVECTOR qy = XMVectorMultiplyAdd(qy1, s1, XMVectorMultiply(qy0, s0));
+	XMVECTOR qz = XMVectorMultiplyAdd(qz1, s1, XMVectorMultiply(qz0, s0));
+	XMVECTOR qw = XMVectorMultiplyAdd(qw1, s1, XMVectorMultiply(qw0, s0));
+
+	lanes[0] = tx;  lanes[1] = ty;  lanes[2] = tz;
+	lanes[3] = sx;  lanes[4] = sy;  lanes[5] = sz;
+	lanes[6] = qx;  lanes[7] = qy;  lanes[8] = qz;  lanes[9] = qw;
+}
+
+void CompiledAnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms, std::vector<UINT>& keyframeCursors)const
+{
+	InterpolateBones(t, nullptr, BoneCount(), boneTransforms, keyframeCursors);
+}
+
+void CompiledAnimationClip::Interpolate(float t, const std::vector<UINT>& bones,
+	std::vector<XMFLOAT4X4>& boneTransforms, std::vector<UINT>& keyframeCursors)const
+{
+	if( !bones.empty() )
+		InterpolateBones(t, bones.data(), (UINT)bones.size(), boneTransforms, keyframeCursors);
+}
+
+void CompiledAnimationClip::GroupBones(const UINT* boneList, UINT count, UINT first, UINT bones[4])
+{
+	for(UINT lane = 0; lane < 4; ++lane)
+	{
+		UINT i = MathHelper::Min(first + lane, count - 1);
+		bones[lane] = boneList ? boneList[i] : i;
+	}
+}
+
+void CompiledAnimationClip::InterpolateBones(float t, const UINT* boneList, UINT count,
+	std::vector<XMFLOAT4X4>& boneTransforms, std::vector<UINT>& keyframeCursors)const
+{
+	const UINT numBones = BoneCount();
+
+	if( keyframeCursors.size() != numBones )
+		keyframeCursors.assign(numBones, 0);
+
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+
+	for(UINT first = 0; first < count; first += 4)
+	{
+		UINT bones[4];
+		GroupBones(boneList, count, first, bones);
+
+		XMVECTOR lanes[10];
+		SampleGroup(bones, t, keyframeCursors, lanes);
+
+		XMVECTOR tx = lanes[0], ty = lanes[1], tz = lanes[2];
+		XMVECTOR sx = lanes[3], sy = lanes[4], sz = lanes[5];
+		XMVECTOR qx = lanes[6], qy = lanes[7], qz = lanes[8], qw = lanes[9];
+
+		//
+		// Scale * Rotation(q) with translation in the last row, the same
+		// matrix XMMatrixAffineTransformation builds.
+		//
+
+		XMVECTOR xx = XMVectorMultiply(qx, qx);
+		XMVECTOR yy = XMVectorMultiply(qy, qy);
+		XMVECTOR zz = XMVectorMultiply(qz, qz);
+		XMVECTOR xy = XMVectorMultiply(qx, qy);
+		XMVECTOR xz = XMVectorMultiply(qx, qz);
+		XMVECTOR yz = XMVectorMultiply(qy, qz);
+		XMVECTOR xw = XMVectorMultiply(qx, qw);
+		XMVECTOR yw = XMVectorMultiply(qy, qw);
+		XMVECTOR zw = XMVectorMultiply(qz, qw);
+
+		XMFLOAT4A m[12];
+		XMStoreFloat4A(&m[0], XMVectorMultiply(sx, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(yy, zz), one)));
+		XMStoreFloat4A(&m[1], XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorAdd(xy, zw))));
+		XMStoreFloat4A(&m[2], XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorSubtract(xz, yw))));
+
+		XMStoreFloat4A(&m[3], XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorSubtract(xy, zw))));
+		XMStoreFloat4A(&m[4], XMVectorMultiply(sy, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, zz), one)));
+		XMStoreFloat4A(&m[5], XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorAdd(yz, xw))));
+
+		XMStoreFloat4A(&m[6], XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorAdd(xz, yw))));
+		XMStoreFloat4A(&m[7], XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorSubtract(yz, xw))));
+		XMStoreFloat4A(&m[8], XMVectorMultiply(sz, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, yy), one)));
+
+		XMStoreFloat4A(&m[9], tx);
+		XMStoreFloat4A(&m[10], ty);
+		XMStoreFloat4A(&m[11], tz);
+
+		// Scatter the lanes back out to one matrix per bone.
+		const UINT numLanes = MathHelper::Min(4u, count - first);
+		for(UINT lane = 0; lane < numLanes; ++lane)
+		{
+			auto e = [&](UINT k) { return (&m[k].x)[lane]; };
+
+			boneTransforms[bones[lane]] = XMFLOAT4X4(
+				e(0),  e(1),  e(2),  0.0f,
+				e(3),  e(4),  e(5),  0.0f,
+				e(6),  e(7),  e(8),  0.0f,
+				e(9),  e(10), e(11), 1.0f);
+		}
+	}
+}
+
+void CompiledAnimationClip::SamplePose(float t, std::vector<BonePose>& pose, std::vector<UINT>& keyframeCursors)const
+{
+	const UINT numBones = BoneCount();
+
+	if( keyframeCursors.size() != numBones )
+		keyframeCursors.assign(numBones, 0);
+
+	for(UINT first = 0; first < numBones; first += 4)
+	{
+		UINT bones[4];
+		GroupBones(nullptr, numBones, first, bones);
+
+		XMVECTOR lanes[10];
+		SampleGroup(bones, t, keyframeCursors, lanes);
+
+		XMFLOAT4A c[10];
+		for(UINT k = 0; k < 10; ++k)
+			XMStoreFloat4A(&c[k], lanes[k]);
+
+		const UINT numLanes = MathHelper::Min(4u, numBones - first);
+		for(UINT lane = 0; lane < numLanes; ++lane)
+		{
+			auto e = [&](UINT k) { return (&c[k].x)[lane]; };
+
+			BonePose& bone = pose[first + lane];
+			bone.Translation  = XMFLOAT3(e(0), e(1), e(2));
+			bone.Scale        = XMFLOAT3(e(3), e(4), e(5));
+			bone.RotationQuat = XMFLOAT4(e(6), e(7), e(8), e(9));
+		}
+	}
+}
+
+size_t AnimationClipSet::GetByteSize()const
+{
+	size_t size = 0;
+	for(auto& e : Animations)
+		size += sizeof(e) + e.second.GetByteSize();
+	for(auto& e : CompiledAnimations)
+		size += sizeof(e) + e.second.GetByteSize();
+
+	return size;
+}
+
+float SkinnedData::GetClipStartTime(const std::string& clipName)const
+{
+	auto clip = mClips->Animations.find(clipName);
+	return clip->second.GetClipStartTime();
+}
+
+float SkinnedData::GetClipEndTime(const std::string& clipName)const
+{
+	auto clip = mClips->Animations.find(clipName);
+	return clip->second.GetClipEndTime();
+}
+
+std::vector<std::string> SkinnedData::GetClipNames()const
+{
+	std::vector<std::string> names;
+	for(auto& e : mClips->Animations)
+		names.push_back(e.first);
+
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+const CompiledAnimationClip* SkinnedData::FindClip(const std::string& clipName)const
+{
+	auto clip = mClips->CompiledAnimations.find(clipName);
+	if( clip == mClips->CompiledAnimations.end() )
+		return nullptr;
+
+	return &clip->second;
+}
+
+UINT SkinnedData::BoneCount()const
+{
+	return mBoneHierarchy.size();
+}
+
+const std::vector<std::string>& SkinnedData::GetBoneNames()const
+{
+	return mBoneNames;
+}
+
+bool SkinnedData::SetBoneNames(const std::vector<std::string>& boneNames)
+{
+	if( boneNames.size() != mBoneHierarchy.size() )
+		return false;
+
+	mBoneNames.resize(boneNames.size());
+	for(UINT i = 0; i < boneNames.size(); ++i)
+		mBoneNames[mBoneRemap[i]] = boneNames[i];
+
+	return true;
+}
+
+UINT64 SkinnedData::GetSkeletonSignature()const
+{
+	UINT64 hash = 14695981039346656037ull;
+
+	UINT numBones = BoneCount();
+	hash = HashBytes(&numBones, sizeof(numBones), hash);
+	hash = HashBytes(mBoneHierarchy.data(), mBoneHierarchy.size() * sizeof(int), hash);
+	hash = HashBytes(mBoneOffsets.data(), mBoneOffsets.size() * sizeof(XMFLOAT4X4), hash);
+
+	for(const std::string& name : mBoneNames)
+		hash = HashBytes(name.c_str(), name.size() + 1, hash);
+
+	return hash;
+}
+
+const std::vector<UINT>& SkinnedData::GetBoneRemap()const
+{
+	return mBoneRemap;
+}
+
+const std::shared_ptr<AnimationClipSet>& SkinnedData::GetClipSet()const
+{
+	return mClips;
+}
+
+void SkinnedData::SetClipSet(const std::shared_ptr<AnimationClipSet>& clips)
+{
+	assert(clips != nullptr);
+	mClips = clips;
+}
+
+AnimationClipSet& SkinnedData::GetMutableClipSet()
+{
+	if( mClips.use_count() > 1 )
+		mClips = std::make_shared<AnimationClipSet>(*mClips);
+
+	return *mClips;
+}
+
+void SkinnedData::ReduceAnimations(const KeyframeTolerance& tolerance)
+{
+	AnimationClipSet& clips = GetMutableClipSet();
+	for(auto& e : clips.Animations)
+	{
+		e.second.Reduce(tolerance);
+		clips.CompiledAnimations[e.first].Build(e.second);
+	}
+}
+
+void SkinnedData::ExtractRootMotion()
+{
+	AnimationClipSet& clips = GetMutableClipSet();
+	for(auto& e : clips.Animations)
+	{
+		e.second.ExtractRootMotion(0);
+		clips.CompiledAnimations[e.first].Build(e.second);
+	}
+}
+
+bool SkinnedData::AddEvent(const std::string& clipName, float time, const std::string& name)
+{
+	if( mClips->Animations.find(clipName) == mClips->Animations.end() )
+		return false;
+
+	AnimationClipSet& clips = GetMutableClipSet();
+	AnimationClip& clip = clips.Animations[clipName];
+
+	clip.Events.Add(time, name);
+	clips.CompiledAnimations[clipName].Events = clip.Events;
+
+	return true;
+}
+
+bool SkinnedData::Set(std::vector<int>& boneHierarchy, 
+		              std::vector<XMFLOAT4X4>& boneOffsets,
+		              std::unordered_map<std::string, AnimationClip>& animations,
+		              const std::vector<std::string>& boneNames)
+{
+	std::vector<int> hierarchy = boneHierarchy;
+	std::vector<XMFLOAT4X4> offsets = boneOffsets;
+	std::unordered_map<std::string, AnimationClip> clips = animations;
+
+	// Renumber the bones so parents come first and siblings sit together.
+	SkeletonCompiler compiler;
+	if( !compiler.Compile(hierarchy) )
+		return false;
+
+	if( !compiler.Apply(hierarchy, offsets, clips) )
+		return false;
+
+	mBoneHierarchy.swap(hierarchy);
+	mBoneOffsets.swap(offsets);
+	mBoneRemap = compiler.GetBoneRemap();
+
+	assert(SkeletonCompiler::IsParentFirst(mBoneHierarchy));
+
+	// A new skeleton never shares the clips of the old one.
+	mClips = std::make_shared<AnimationClipSet>();
+	mClips->Animations.swap(clips);
+
+	mBoneNames.clear();
+	SetBoneNames(boneNames);
+
+	std::vector<bool> hasChildren(mBoneHierarchy.size(), false);
+	for(int parent : mBoneHierarchy)
+	{
+		if( parent >= 0 )
+			hasChildren[parent] = true;
+	}
+
+	mInnerBones.clear();
+	for(UINT i = 0; i < hasChildren.size(); ++i)
+	{
+		if( hasChildren[i] )
+			mInnerBones.push_back(i);
+	}
+
+	for(auto& e : mClips->Animations)
+	{
+		mClips->CompiledAnimations[e.first].Build(e.second);
+	}
+
+	return true;
+}
+ 
+void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<XMFLOAT4X4>& finalTransforms)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
+
+	// Interpolate all the bones of this clip at the given time instance.
+	auto clip = mClips->Animations.find(clipName);
+	clip->second.Interpolate(timePos, toParentTransforms);
+
+	std::vector<XMFLOAT4X4> toRootTransforms(numBones);
+	ToFinalTransforms(toParentTransforms, toRootTransforms, finalTransforms);
+}
+
+void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,
+	std::vector<XMFLOAT4X4>& finalTransforms, std::vector<UINT>& keyframeCursors)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
+
+	// Interpolate all the bones of this clip, resuming each bone's keyframe
+	// search from where the caller left it last time.
+	auto clip = mClips->CompiledAnimations.find(clipName);
+	clip->second.Interpolate(timePos, toParentTransforms, keyframeCursors);
+
+	std::vector<XMFLOAT4X4> toRootTransforms(numBones);
+	ToFinalTransforms(toParentTransforms, toRootTransforms, finalTransforms);
+}
+
+void SkinnedData::GetFinalTransforms(const CompiledAnimationClip* clip, float timePos,
+	std::vector<XMFLOAT4X4>& finalTransforms, AnimationWorkspace& workspace, bool skipLeafBones)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	// Only the first call for a workspace allocates.  The leaves have no
+	// previous transform to keep yet, so that call samples every bone.
+	if( workspace.ToParentTransforms.size() != numBones )
+	{
+		workspace.ToParentTransforms.resize(numBones);
+		workspace.ToRootTransforms.resize(numBones);
+		workspace.KeyframeCursors.assign(numBones, 0);
+		skipLeafBones = false;
+	}
+
+	if( skipLeafBones )
+		clip->Interpolate(timePos, mInnerBones, workspace.ToParentTransforms, workspace.KeyframeCursors);
+	else
+		clip->Interpolate(timePos, workspace.ToParentTransforms, workspace.KeyframeCursors);
+
+	ToFinalTransforms(workspace.ToParentTransforms, workspace.ToRootTransforms, finalTransforms);
+}
+
+void SkinnedData::GetFinalTransforms(std::vector<AnimationLayer>& layers,
+	std::vector<XMFLOAT4X4>& finalTransforms, AnimationWorkspace& workspace)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	if( workspace.ToParentTransforms.size() != numBones )
+	{
+		workspace.ToParentTransforms.resize(numBones);
+		workspace.ToRootTransforms.resize(numBones);
+		workspace.KeyframeCursors.assign(numBones, 0);
+	}
+
+	if( workspace.LayerPose.size() != numBones )
+	{
+		workspace.LayerPose.resize(numBones);
+		workspace.BlendedPose.resize(numBones);
+	}
+
+	//
+	// Accumulate the weighted local poses.  Translation and scale are summed
+	// linearly; rotations are summed on the same hemisphere as the first layer
+	// and renormalized afterwards (normalized lerp), which is order independent
+	// and cheap enough to do per bone.
+	//
+
+	float totalWeight = 0.0f;
+
+	for(AnimationLayer& layer : layers)
+	{
+		if( layer.Weight <= 0.0f )
+			continue;
+
+		layer.Clip->SamplePose(layer.TimePos, workspace.LayerPose, layer.KeyframeCursors);
+
+		XMVECTOR w = XMVectorReplicate(layer.Weight);
+
+		for(UINT i = 0; i < numBones; ++i)
+		{
+			const BonePose& src = workspace.LayerPose[i];
+			BonePose& dst = workspace.BlendedPose[i];
+
+			XMVECTOR T = XMVectorScale(XMLoadFloat3(&src.Translation), layer.Weight);
+			XMVECTOR S = XMVectorScale(XMLoadFloat3(&src.Scale), layer.Weight);
+			XMVECTOR Q = XMLoadFloat4(&src.RotationQuat);
+
+			if( totalWeight > 0.0f )
+			{
+				XMVECTOR sumQ = XMLoadFloat4(&dst.RotationQuat);
+				if( XMVectorGetX(XMVector4Dot(sumQ, Q)) < 0.0f )
+					Q = XMVectorNegate(Q);
+
+				T = XMVectorAdd(T, XMLoadFloat3(&dst.Translation));
+				S = XMVectorAdd(S, XMLoadFloat3(&dst.Scale));
+				Q = XMVectorMultiplyAdd(Q, w, sumQ);
+			}
+			else
+			{
+				Q = XMVectorMultiply(Q, w);
+			}
+
+			XMStoreFloat3(&dst.Translation, T);
+			XMStoreFloat3(&dst.Scale, S);
+			XMStoreFloat4(&dst.RotationQuat, Q);
+		}
+
+		totalWeight += layer.Weight;
+	}
+
+	if( totalWeight <= 0.0f )
+	{
+		// Nothing contributes; fall back to the first layer at full weight.
+		layers[0].Clip->Interpolate(layers[0].TimePos, workspace.ToParentTransforms, layers[0].KeyframeCursors);
+	}
+	else
+	{
+		XMVECTOR zero = XMVectorZero();
+		float invWeight = 1.0f / totalWeight;
+
+		for(UINT i = 0; i < numBones; ++i)
+		{
+			const BonePose& pose = workspace.BlendedPose[i];
+
+			XMVECTOR T = XMVectorScale(XMLoadFloat3(&pose.Translation), invWeight);
+			XMVECTOR S = XMVectorScale(XMLoadFloat3(&pose.Scale), invWeight);
+			XMVECTOR Q = XMQuaternionNormalize(XMLoadFloat4(&pose.RotationQuat));
+
+			XMStoreFloat4x4(&workspace.ToParentTransforms[i], XMMatrixAffineTransformation(S, zero, Q, T));
+		}
+	}
+
+	ToFinalTransforms(workspace.ToParentTransforms, workspace.ToRootTransforms, finalTransforms);
+}
+
+bool SkinnedData::BuildRetargetMap(const SkinnedData& source, RetargetMap& map)const
+{
+	UINT numBones = BoneCount();
+
+	map.SourceBones.assign(numBones, -1);
+	map.SourceBindTranslation.assign(numBones, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	map.BindRotationDelta.assign(numBones, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+	map.SourceBoneCount = source.BoneCount();
+	map.MatchedBoneCount = 0;
+	map.TranslationScale = 1.0f;
+
+	GetBindPose(map.BindPose);
+
+	std::unordered_map<std::string, int> sourceBones;
+	for(UINT i = 0; i < source.mBoneNames.size(); ++i)
+	{
+		if( !source.mBoneNames[i].empty() )
+			sourceBones[source.mBoneNames[i]] = (int)i;
+	}
+
+	for(UINT i = 0; i < mBoneNames.size(); ++i)
+	{
+		if( mBoneNames[i].empty() )
+			continue;
+
+		auto bone = sourceBones.find(mBoneNames[i]);
+		if( bone == sourceBones.end() )
+			continue;
+
+		map.SourceBones[i] = bone->second;
+		++map.MatchedBoneCount;
+	}
+
+	if( map.MatchedBoneCount == 0 )
+		return false;
+
+	//
+	// Compare the bone lengths of the matched bones (the bind translation of
+	// every non-root bone) to get the size ratio of the two skeletons, and
+	// keep how the bind orientations differ.
+	//
+
+	std::vector<BonePose> sourceBindPose;
+	source.GetBindPose(sourceBindPose);
+
+	float targetLength = 0.0f;
+	float sourceLength = 0.0f;
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		int src = map.SourceBones[i];
+		if( src < 0 )
+			continue;
+
+		map.SourceBindTranslation[i] = sourceBindPose[src].Translation;
+
+		// XMQuaternionMultiply(a, b) is b * a, so this is targetBind * inverse(sourceBind).
+		XMVECTOR sourceBindInv = XMQuaternionInverse(XMLoadFloat4(&sourceBindPose[src].RotationQuat));
+		XMVECTOR delta = XMQuaternionMultiply(sourceBindInv, XMLoadFloat4(&map.BindPose[i].RotationQuat));
+		XMStoreFloat4(&map.BindRotationDelta[i], XMQuaternionNormalize(delta));
+
+		if( mBoneHierarchy[i] < 0 )
+			continue;
+
+		targetLength += XMVectorGetX(XMVector3Length(XMLoadFloat3(&map.BindPose[i].Translation)));
+		sourceLength += XMVectorGetX(XMVector3Length(XMLoadFloat3(&sourceBindPose[src].Translation)));
+	}
+
+	if( targetLength > 0.0f && sourceLength > 0.0f )
+		map.TranslationScale = targetLength / sourceLength;
+
+	return true;
+}
+
+void SkinnedData::GetFinalTransforms(const CompiledAnimationClip* sourceClip, float timePos,
+	const RetargetMap& map, std::vector<XMFLOAT4X4>& finalTransforms, AnimationWorkspace& workspace)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	assert(map.SourceBones.size() == numBones);
+	assert(sourceClip->BoneCount() == map.SourceBoneCount);
+
+	if( workspace.ToParentTransforms.size() != numBones )
+	{
+		workspace.ToParentTransforms.resize(numBones);
+		workspace.ToRootTransforms.resize(numBones);
+	}
+
+	// The clip is sampled in source bone order; SamplePose sizes the cursors.
+	if( workspace.LayerPose.size() != map.SourceBoneCount )
+		workspace.LayerPose.resize(map.SourceBoneCount);
+
+	sourceClip->SamplePose(timePos, workspace.LayerPose, workspace.KeyframeCursors);
+
+	XMVECTOR zero = XMVectorZero();
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		const BonePose& bind = map.BindPose[i];
+		int src = map.SourceBones[i];
+
+		XMVECTOR S, Q;
+		XMVECTOR T = XMLoadFloat3(&bind.Translation);
+		if( src < 0 )
+		{
+			S = XMLoadFloat3(&bind.Scale);
+			Q = XMLoadFloat4(&bind.RotationQuat);
+		}
+		else
+		{
+			const BonePose& pose = workspace.LayerPose[src];
+
+			S = XMLoadFloat3(&pose.Scale);
+			Q = XMQuaternionMultiply(XMLoadFloat4(&pose.RotationQuat), XMLoadFloat4(&map.BindRotationDelta[i]));
+
+			XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&pose.Translation), XMLoadFloat3(&map.SourceBindTranslation[i]));
+			T = XMVectorMultiplyAdd(offset, XMVectorReplicate(map.TranslationScale), T);
+		}
+
+		XMStoreFloat4x4(&workspace.ToParentTransforms[i], XMMatrixAffineTransformation(S, zero, Q, T));
+	}
+
+	ToFinalTransforms(workspace.ToParentTransforms, workspace.ToRootTransforms, finalTransforms);
+}
+
+void SkinnedData::GetBindPose(std::vector<BonePose>& pose)const
+{
+	UINT numBones = mBoneOffsets.size();
+	pose.resize(numBones);
+
+	// The offset transform is the inverse of the bone's bind toRoot
+	// transform, so toParent = toRoot * inverse(parentToRoot)
+	//                        = inverse(offset) * parentOffset.
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
+		XMMATRIX toParent = XMMatrixInverse(nullptr, offset);
+
+		int parentIndex = mBoneHierarchy[i];
+		if( parentIndex >= 0 )
+			toParent = XMMatrixMultiply(toParent, XMLoadFloat4x4(&mBoneOffsets[parentIndex]));
+
+		XMVECTOR S, Q, T;
+		XMMatrixDecompose(&S, &Q, &T, toParent);
+
+		XMStoreFloat3(&pose[i].Scale, S);
+		XMStoreFloat4(&pose[i].RotationQuat, Q);
+		XMStoreFloat3(&pose[i].Translation, T);
+	}
+}
+
+void SkinnedData::ToFinalTransforms(const std::vector<XMFLOAT4X4>& toParentTransforms,
+	std::vector<XMFLOAT4X4>& toRootTransforms, std::vector<XMFLOAT4X4>& finalTransforms)const
+{
+	UINT numBones = mBoneOffsets.size();
+
+	//
+	// Traverse the hierarchy and transform all the bones to the root space.
+	// Set() ordered the bones so that the roots come first and every parent
+	// comes before its children, so one forward pass sees each parent's
+	// toRootTransform before it is needed.
+	//
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
+
+		// A root has no parent, so its toRootTransform is just its local
+		// bone transform.
+		int parentIndex = mBoneHierarchy[i];
+		if( parentIndex < 0 )
+		{
+			XMStoreFloat4x4(&toRootTransforms[i], toParent);
+			continue;
+		}
 
-		int parentIndex = mBoneHierarchy[i];
 		XMMATRIX parentToRoot = XMLoadFloat4x4(&toRootTransforms[parentIndex]);
 
 		XMMATRIX toRoot = XMMatrixMultiply(toParent, parentToRoot);
@@ -18,6 +18,19 @@ struct Keyframe
     DirectX::XMFLOAT4 RotationQuat;
 };
 
+///<summary>
+/// How far a reduced curve may stray from the original keys, per bone and
+/// in the bone's parent space, so the error seen on the mesh grows down the
+/// hierarchy.  Translation and scale are in model units, rotation is an
+/// angle in radians.
+///</summary>
+struct KeyframeTolerance
+{
+	float Translation = 0.001f;
+	float Rotation = 0.0005f;
+	float Scale = 0.0001f;
+};
+
 ///<summary>
 /// A BoneAnimation is defined by a list of keyframes.  For time
 /// values inbetween two keyframes, we interpolate between the
@@ -30,11 +43,79 @@ struct BoneAnimation
 	float GetStartTime()const;
 	float GetEndTime()const;
 
+	// Returns the index i of the keyframe pair [i, i+1] that bounds t.
+	// The cursor holds the pair found on the previous call; playback that
+	// moves forward only steps the cursor, anything else (looping, seeking)
+	// falls back to a binary search.
+	UINT FindKeyframe(float t, UINT& cursor)const;
+
     void Interpolate(float t, DirectX::XMFLOAT4X4& M)const;
+    void Interpolate(float t, DirectX::XMFLOAT4X4& M, UINT& cursor)const;
+
+	// Drops every key that interpolating its neighbours reproduces within
+	// tolerance.  The first and last keys are always kept.
+	void Reduce(const KeyframeTolerance& tolerance);
 
 	std::vector<Keyframe> Keyframes; 	
 };
 
+///<summary>
+/// Motion of a clip's root bone on the ground plane: translation in XZ and
+/// rotation about Y, both relative to the first key.
+/// AnimationClip::ExtractRootMotion moves it out of the bone, so the clip
+/// plays in place and whoever owns the entity moves it by GetDelta()
+/// instead of sampling the root bone again.
+///
+/// Looping follows SkinnedModelInstance: time runs from StartTime to
+/// EndTime and wraps back to StartTime, the clip's first and last key.
+///</summary>
+struct RootMotionTrack
+{
+	bool Empty()const;
+
+	// Motion from time 0 to t.
+	void Sample(float t, DirectX::XMVECTOR& rotation, DirectX::XMVECTOR& translation)const;
+
+	// Motion from t0 to t0 + dt, expressed in the entity's frame at t0.
+	// Wraps past EndTime to StartTime as many times as dt covers.
+	void GetDelta(float t0, float dt, DirectX::XMFLOAT4& rotation, DirectX::XMFLOAT3& translation)const;
+
+	std::vector<float> Times;
+	std::vector<DirectX::XMFLOAT3> Translation;
+	std::vector<DirectX::XMFLOAT4> Rotation;
+
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+};
+
+struct AnimationEvent
+{
+	float Time = 0.0f;
+	std::string Name;
+};
+
+///<summary>
+/// Named points in a clip (footsteps, sounds, ...) kept sorted by time.
+/// Playback keeps a cursor at the next event, so an update only looks at
+/// the events it actually passes.
+///</summary>
+struct AnimationEventTrack
+{
+	void Add(float time, const std::string& name);
+
+	// Cursor for time t: the first event after t.
+	UINT Seek(float t)const;
+
+	// Appends the events in (t0, t0 + dt] to fired, wrapping at endTime back
+	// to startTime the same way the playback time does; events at startTime
+	// fire on the wrap.  cursor must come from Seek() or a previous
+	// Advance(); a stale one is re-seeked.
+	void Advance(float t0, float dt, float startTime, float endTime, UINT& cursor,
+		std::vector<const AnimationEvent*>& fired)const;
+
+	std::vector<AnimationEvent> Events;
+};
+
 ///<summary>
 /// Examples of AnimationClips are "Walk", "Run", "Attack", "Defend".
 /// An AnimationClip requires a BoneAnimation for every bone to form
@@ -47,7 +128,202 @@ struct AnimationClip
 
     void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
 
+	// Same as above, but keeps one keyframe cursor per bone.  The cursors
+	// are owned by the caller (usually the model instance) and are resized
+	// here if needed.
+    void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms,
+		std::vector<UINT>& keyframeCursors)const;
+
+	void Reduce(const KeyframeTolerance& tolerance);
+
+	// Moves the ground-plane motion of a root bone into RootMotion.  Clips
+	// whose root stays put get an empty track.
+	void ExtractRootMotion(UINT rootBone);
+
+	// Heap memory held by the keys, root motion and events.
+	size_t GetByteSize()const;
+
     std::vector<BoneAnimation> BoneAnimations; 	
+
+	RootMotionTrack RootMotion;
+	AnimationEventTrack Events;
+};
+
+///<summary>
+/// Local (to-parent) transform of one bone in decomposed form, so that
+/// poses from several clips can be blended before the hierarchy pass.
+///</summary>
+struct BonePose
+{
+	DirectX::XMFLOAT3 Translation;
+	DirectX::XMFLOAT3 Scale;
+	DirectX::XMFLOAT4 RotationQuat;
+};
+
+///<summary>
+/// An AnimationClip flattened into structure-of-arrays form.  The keys of
+/// all bones are stored back to back in one stream per component, and
+/// bone i owns the range [KeyStart[i], KeyStart[i]+KeyCount[i]).  Sampling
+/// gathers four bones at a time into the lanes of an XMVECTOR and does the
+/// lerp/slerp and the matrix build for all four at once.
+///
+/// The keys are stored quantized, 22 bytes per key instead of 44:
+///  - translation and scale as 16 bits per component over the bone's own
+///    [min, max] range,
+///  - rotation as "smallest three": the largest component is dropped (and
+///    made positive), the other three take 15 bits each over
+///    [-1/sqrt(2), 1/sqrt(2)], and the index of the dropped one goes in the
+///    top bits of the first two.
+/// Decoding happens in the 4-wide sampler, so nothing is unpacked up front.
+/// The result matches AnimationClip::Interpolate to within the
+/// quantization step.
+///</summary>
+struct CompiledAnimationClip
+{
+	void Build(const AnimationClip& clip);
+
+	UINT BoneCount()const;
+
+	float GetClipStartTime()const;
+	float GetClipEndTime()const;
+
+    void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms,
+		std::vector<UINT>& keyframeCursors)const;
+
+	// Samples only the listed bones; the other entries of boneTransforms
+	// keep whatever they held.
+    void Interpolate(float t, const std::vector<UINT>& bones,
+		std::vector<DirectX::XMFLOAT4X4>& boneTransforms,
+		std::vector<UINT>& keyframeCursors)const;
+
+	// Same sampling, but leaves each bone decomposed instead of building
+	// its matrix.  pose must already hold BoneCount() entries.
+	void SamplePose(float t, std::vector<BonePose>& pose,
+		std::vector<UINT>& keyframeCursors)const;
+
+	size_t GetByteSize()const;
+
+	std::vector<UINT> KeyStart;
+	std::vector<UINT> KeyCount;
+
+	std::vector<float> Times;
+	std::vector<USHORT> TranslationX, TranslationY, TranslationZ;
+	std::vector<USHORT> ScaleX, ScaleY, ScaleZ;
+	std::vector<USHORT> RotationA, RotationB, RotationC;
+
+	// Per bone dequantization: value = q * Step + Min.
+	std::vector<DirectX::XMFLOAT3> TranslationMin, TranslationStep;
+	std::vector<DirectX::XMFLOAT3> ScaleMin, ScaleStep;
+
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+
+	// Copied from the AnimationClip.
+	RootMotionTrack RootMotion;
+	AnimationEventTrack Events;
+
+private:
+	void GatherRotation(const UINT key[4], DirectX::XMVECTOR& x, DirectX::XMVECTOR& y,
+		DirectX::XMVECTOR& z, DirectX::XMVECTOR& w)const;
+
+	// Bones of the group starting at entry first of boneList, or of
+	// 0..count-1 if boneList is null.  The last group repeats its last bone.
+	static void GroupBones(const UINT* boneList, UINT count, UINT first, UINT bones[4]);
+
+	void InterpolateBones(float t, const UINT* boneList, UINT count,
+		std::vector<DirectX::XMFLOAT4X4>& boneTransforms,
+		std::vector<UINT>& keyframeCursors)const;
+
+	// Samples four bones into lanes: translation x/y/z, scale x/y/z, then
+	// rotation x/y/z/w.
+	void SampleGroup(const UINT bones[4], float t, std::vector<UINT>& keyframeCursors,
+		DirectX::XMVECTOR lanes[10])const;
+};
+
+///<summary>
+/// One clip contributing to a blended pose.  Weights are relative; they are
+/// normalized over all layers when the pose is built.  FadeRate is not used
+/// by SkinnedData, it is the weight change per second applied by whoever
+/// drives a cross-fade.
+///</summary>
+struct AnimationLayer
+{
+	const CompiledAnimationClip* Clip = nullptr;
+	float TimePos = 0.0f;
+	float Weight = 1.0f;
+	float FadeRate = 0.0f;
+
+	std::vector<UINT> KeyframeCursors;
+	UINT EventCursor = 0;
+};
+
+///<summary>
+/// Scratch memory for SkinnedData::GetFinalTransforms, owned by the caller
+/// (usually one per model instance) so that steady-state pose evaluation
+/// does not touch the heap.  The buffers are sized on first use.
+///</summary>
+struct AnimationWorkspace
+{
+	std::vector<DirectX::XMFLOAT4X4> ToParentTransforms;
+	std::vector<DirectX::XMFLOAT4X4> ToRootTransforms;
+	std::vector<UINT> KeyframeCursors;
+
+	// Used only when blending layers.
+	std::vector<BonePose> LayerPose;
+	std::vector<BonePose> BlendedPose;
+};
+
+///<summary>
+/// The clips of one skeleton, both the source curves and their compiled
+/// copies.  SkinnedData holds them through a shared_ptr so that models with
+/// the same skeleton can point at one set (see AnimationLibrary).
+///</summary>
+struct AnimationClipSet
+{
+	size_t GetByteSize()const;
+
+	std::unordered_map<std::string, AnimationClip> Animations;
+	std::unordered_map<std::string, CompiledAnimationClip> CompiledAnimations;
+};
+
+///<summary>
+/// Plays the clips of a source skeleton on a target skeleton by matching
+/// bone names.  Built by SkinnedData::BuildRetargetMap on the target.
+///
+/// Matched bones take scale from the source clip, and the clip's rotation
+/// relative to the source bind pose applied on top of the target bind
+/// pose: q_target = q_targetBind * inverse(q_sourceBind) * q_source.
+/// Their translation is the target's bind translation plus the clip's
+/// offset from the source bind translation, scaled by TranslationScale, so
+/// the target keeps its own proportions but still gets hip sway and root
+/// motion left in the clip.  Unmatched target bones stay in bind pose.
+///
+/// The translation offset is not rotated, so it is only right where the
+/// parents' bind orientations agree.  Only named bones match: .m3d files
+/// carry no bone names (their "BoneOffsetN" labels are dropped on load),
+/// so for those the caller has to supply them with SetBoneNames.
+///</summary>
+struct RetargetMap
+{
+	// Source bone for each target bone, or -1.
+	std::vector<int> SourceBones;
+
+	// Target local bind pose, from the bone offsets.
+	std::vector<BonePose> BindPose;
+
+	// Bind translation of the matched source bone, per target bone.
+	std::vector<DirectX::XMFLOAT3> SourceBindTranslation;
+
+	// q_targetBind * inverse(q_sourceBind) per target bone (identity if
+	// unmatched), so the per-frame work is one quaternion product.
+	std::vector<DirectX::XMFLOAT4> BindRotationDelta;
+
+	// Target size over source size, measured on the matched bones.
+	// Root motion from the source clip should be scaled by it as well.
+	float TranslationScale = 1.0f;
+
+	UINT SourceBoneCount = 0;
+	UINT MatchedBoneCount = 0;
 };
 
 class SkinnedData
@@ -56,18 +332,111 @@ public:
 
 	UINT BoneCount()const;
 
+	// Bone names in bone order (empty if the file had none).  An empty
+	// name marks a bone without one.
+	const std::vector<std::string>& GetBoneNames()const;
+
+	// Names the bones, in file bone order like Set().  For models whose
+	// file has no names, so they can be retargeted.  Returns false if the
+	// count does not match the bones.
+	bool SetBoneNames(const std::vector<std::string>& boneNames);
+
+	// Hash of the hierarchy, bind pose (bone offsets) and bone names.
+	// Skeletons with equal signatures can play each other's clips without
+	// retargeting.
+	UINT64 GetSkeletonSignature()const;
+
 	float GetClipStartTime(const std::string& clipName)const;
 	float GetClipEndTime(const std::string& clipName)const;
 
-	void Set(
+	// Names of all clips, sorted.
+	std::vector<std::string> GetClipNames()const;
+
+	// Resolves a clip name once so per-frame calls can skip the string
+	// lookup.  Returns nullptr if there is no such clip.  The pointer stays
+	// valid until the next Set().
+	const CompiledAnimationClip* FindClip(const std::string& clipName)const;
+
+	// Curve-reduces every clip and rebuilds the compiled copies.  Clip
+	// pointers from FindClip() stay valid, unless the clips were shared:
+	// this and the other editing calls below first make a private copy.
+	void ReduceAnimations(const KeyframeTolerance& tolerance);
+
+	// Pulls root motion out of the first root bone of every clip (bone 0
+	// after Set()).  Call before ReduceAnimations so the in-place curves
+	// are the ones reduced.
+	void ExtractRootMotion();
+
+	// Returns false if there is no such clip.
+	bool AddEvent(const std::string& clipName, float time, const std::string& name);
+
+	// Renumbers the bones with SkeletonCompiler on the way in; vertex bone
+	// indices from the same file must be remapped with GetBoneRemap().
+	// Returns false, and keeps the previous skeleton, if the hierarchy has a
+	// bad parent or a cycle, or a clip does not have one track per bone.
+	bool Set(
 		std::vector<int>& boneHierarchy, 
 		std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
-		std::unordered_map<std::string, AnimationClip>& animations);
+		std::unordered_map<std::string, AnimationClip>& animations,
+		const std::vector<std::string>& boneNames = std::vector<std::string>());
+
+	// File bone index -> bone index used by this SkinnedData.
+	const std::vector<UINT>& GetBoneRemap()const;
+
+	// The clip set is shared between every SkinnedData given the same
+	// pointer.  Only AnimationLibrary should need these.
+	const std::shared_ptr<AnimationClipSet>& GetClipSet()const;
+	void SetClipSet(const std::shared_ptr<AnimationClipSet>& clips);
+
+	// Matches this skeleton's bones to source's by name; unnamed bones never
+	// match.  Returns false if no bone matched.
+	bool BuildRetargetMap(const SkinnedData& source, RetargetMap& map)const;
 
 	 // In a real project, you'd want to cache the result if there was a chance
 	 // that you were calling this several times with the same clipName at 
-	 // the same timePos.
+	 // the same timePos.  (PoseCache does that for the compiled clips.)
+    void GetFinalTransforms(const std::string& clipName, float timePos, 
+		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms)const;
+
+	// Samples the compiled (SoA) copy of the clip, resuming each bone's
+	// keyframe search from the caller's cursors.
     void GetFinalTransforms(const std::string& clipName, float timePos, 
+		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms,
+		 std::vector<UINT>& keyframeCursors)const;
+
+	// Allocation free version: takes a clip from FindClip() and keeps all
+	// intermediate results in the caller's workspace.
+	//
+	// With skipLeafBones, bones without children are not sampled and keep
+	// the local transform of the last call on this workspace; they still
+	// follow their parents.  Meant for instances too small on screen for
+	// fingers and toes to matter.
+    void GetFinalTransforms(const CompiledAnimationClip* clip, float timePos, 
+		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms,
+		 AnimationWorkspace& workspace, bool skipLeafBones = false)const;
+
+	// Blends the local poses of all layers by weight, then runs the
+	// hierarchy pass once on the result.  layers must not be empty.
+    void GetFinalTransforms(std::vector<AnimationLayer>& layers,
+		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms,
+		 AnimationWorkspace& workspace)const;
+
+	// Samples a clip of the map's source skeleton and poses this skeleton
+	// with it.
+    void GetFinalTransforms(const CompiledAnimationClip* sourceClip, float timePos,
+		 const RetargetMap& map,
+		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms,
+		 AnimationWorkspace& workspace)const;
+
+private:
+	// The clip set for editing, copied first if other models share it.
+	AnimationClipSet& GetMutableClipSet();
+
+	// Local (to-parent) bind pose recovered from the bone offsets.
+	void GetBindPose(std::vector<BonePose>& pose)const;
+
+	void ToFinalTransforms(const std::vector<DirectX::XMFLOAT4X4>& toParentTransforms,
+		 std::vector<DirectX::XMFLOAT4X4>& toRootTransforms,
 		 std::vector<DirectX::XMFLOAT4X4>& finalTransforms)const;
 
 private:
@@ -75,8 +444,16 @@ private:
 	std::vector<int> mBoneHierarchy;
 
 	std::vector<DirectX::XMFLOAT4X4> mBoneOffsets;
+
+	std::vector<UINT> mBoneRemap;
+
+	// Bones with at least one child, built in Set().
+	std::vector<UINT> mInnerBones;
+
+	std::vector<std::string> mBoneNames;
    
-	std::unordered_map<std::string, AnimationClip> mAnimations;
+	// Source clips and their SoA copies built in Set(); possibly shared.
+	std::shared_ptr<AnimationClipSet> mClips = std::make_shared<AnimationClipSet>();
 };
  
 #endif // SKINNEDDATA_H
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "SkinnedInstanceUpdater.h"
+
+using namespace DirectX;
+
+SkinnedInstanceUpdater::SkinnedInstanceUpdater(const InstanceList* instances, JobSystem* jobSystem, bool async)
+	: mInstances(instances), mJobSystem(jobSystem), mAsync(async)
+{
+}
+
+SkinnedInstanceUpdater::~SkinnedInstanceUpdater()
+{
+	if (mTask.valid())
+		mTask.wait();
+}
+
+bool SkinnedInstanceUpdater::IsAsync()const
+{
+	return mAsync;
+}
+
+UINT SkinnedInstanceUpdater::RegionCount()const
+{
+	return mAsync ? 2 : 1;
+}
+
+void SkinnedInstanceUpdater::SetTarget(BYTE* data, UINT slotByteSize, UINT regionByteSize)
+{
+	mData = data;
+	mSlotByteSize = slotByteSize;
+	mRegionByteSize = regionByteSize;
+}
+
+void SkinnedInstanceUpdater::SetPaletteFormat(BonePalette::Format format)
+{
+	mPaletteFormat = format;
+}
+
+void SkinnedInstanceUpdater::SetLodPolicy(const AnimationLodPolicy* lod)
+{
+	mLod = lod;
+}
+
+void SkinnedInstanceUpdater::SetBakedAnimation(const BakedAnimation* baked)
+{
+	mBaked = baked;
+}
+
+void SkinnedInstanceUpdater::Update(float dt, const Camera& camera)
+{
+	if (!mAsync)
+	{
+		Animate(dt, camera, 0);
+		return;
+	}
+
+	// Wait for the frame started last time; the first frame is computed here.
+	if (mTask.valid())
+		mTask.get();
+	else
+		Animate(dt, camera, mNextRegion);
+
+	mRegion = mNextRegion;
+}
+
+void SkinnedInstanceUpdater::BeginNextFrame(float dt, const Camera& camera)
+{
+	if (!mAsync)
+		return;
+
+	// The camera may move while this frame is drawn.
+	mTaskCamera = camera;
+	mNextRegion = 1 - mRegion;
+
+	mTask = std::async(std::launch::async, [this, dt]()
+	{
+		Animate(dt, mTaskCamera, mNextRegion);
+	});
+}
+
+void SkinnedInstanceUpdater::Wait()
+{
+	if (mTask.valid())
+		mTask.get();
+}
+
+UINT SkinnedInstanceUpdater::GetRegion()const
+{
+	return mRegion;
+}
+
+void SkinnedInstanceUpdater::Animate(float dt, const Camera& camera, UINT region)
+{
+	const InstanceList& instances = *mInstances;
+	BYTE* regionData = &mData[region * mRegionByteSize];
+
+	// Baked palettes: advance the time and write the palette offset only.
+	if (mBaked != nullptr)
+	{
+		for (UINT i = 0; i < (UINT)instances.size(); ++i)
+		{
+			SkinnedModelInstance* inst = instances[i].get();
+			inst->UpdateBakedAnimation(dt);
+			inst->ApplyRootMotion();
+
+			BakedSkinnedConstants bakedConstants;
+			UINT frame = mBaked->GetFrame(inst->BakedClip, inst->TimePos);
+			bakedConstants.PaletteOffset = mBaked->GetPaletteOffset(frame);
+
+			memcpy(&regionData[i * mSlotByteSize], &bakedConstants, sizeof(BakedSkinnedConstants));
+		}
+		return;
+	}
+
+	// Each job updates a run of instances and writes their own slots.
+	auto animate = [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			SkinnedModelInstance* inst = instances[i].get();
+
+			if (mLod != nullptr)
+				inst->SetLod(mLod->Select(camera, inst->Position));
+
+			// Time and root motion move on even when the pose is skipped.
+			bool posed = inst->UpdateSkinnedAnimation(dt);
+			inst->ApplyRootMotion();
+
+			// A skipped pose keeps the palette already in the slot.  With two
+			// regions that palette is two frames old, so it is written again.
+			if (!posed && !mAsync)
+				continue;
+
+			BonePalette::Pack(mPaletteFormat, inst->FinalTransforms.data(), (UINT)inst->FinalTransforms.size(),
+				reinterpret_cast<XMFLOAT4*>(&regionData[i * mSlotByteSize]));
+		}
+	};
+
+	if (mJobSystem != nullptr)
+		mJobSystem->ParallelFor((UINT)instances.size(), 8, animate);
+	else
+		animate(0, (UINT)instances.size());
+}
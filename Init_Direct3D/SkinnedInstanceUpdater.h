@@ -0,0 +1,81 @@
+#pragma once
+
+#include "D3dHeader.h"
+#include "JobSystem.h"
+#include <future>
+
+///<summary>
+/// Animates the skinned instances every frame and packs their palettes
+/// into a constant buffer the caller has mapped.  It never touches the
+/// device, so the app and the tests run the same code.
+///
+/// Instance i writes its slot at data + region * regionByteSize +
+/// i * slotByteSize.  In serial mode there is one region and Update()
+/// fills it.  In async mode there are two: BeginNextFrame() starts the
+/// next frame's palettes on another thread, writing the region not being
+/// drawn, and the next Update() waits for it.  GetRegion() is the region
+/// the frame's draw calls read.
+///
+/// Call Wait() before changing the instances, the target or the settings
+/// while a frame may be running.
+///</summary>
+class SkinnedInstanceUpdater
+{
+public:
+	typedef std::vector<std::unique_ptr<SkinnedModelInstance>> InstanceList;
+
+	// jobSystem == nullptr runs the instances in order on the calling thread.
+	SkinnedInstanceUpdater(const InstanceList* instances, JobSystem* jobSystem, bool async);
+
+	SkinnedInstanceUpdater(const SkinnedInstanceUpdater& rhs)=delete;
+	SkinnedInstanceUpdater& operator=(const SkinnedInstanceUpdater& rhs)=delete;
+
+	// Waits for the frame still running.
+	~SkinnedInstanceUpdater();
+
+	bool IsAsync()const;
+	UINT RegionCount()const;
+
+	void SetTarget(BYTE* data, UINT slotByteSize, UINT regionByteSize);
+	void SetPaletteFormat(BonePalette::Format format);
+
+	// nullptr turns the animation LOD off.
+	void SetLodPolicy(const AnimationLodPolicy* lod);
+
+	// With a baked animation each slot holds BakedSkinnedConstants instead
+	// of a palette; nullptr goes back to sampling.
+	void SetBakedAnimation(const BakedAnimation* baked);
+
+	// Makes the palettes for this frame ready in GetRegion().
+	void Update(float dt, const Camera& camera);
+
+	// Async mode only: starts the next frame.  dt is this frame's, as the
+	// next one is not known yet; the camera is copied.
+	void BeginNextFrame(float dt, const Camera& camera);
+
+	// Waits for the frame BeginNextFrame() started, if any.
+	void Wait();
+
+	UINT GetRegion()const;
+
+private:
+	void Animate(float dt, const Camera& camera, UINT region);
+
+private:
+	const InstanceList* mInstances = nullptr;
+	JobSystem* mJobSystem = nullptr;
+	bool mAsync = false;
+
+	BYTE* mData = nullptr;
+	UINT mSlotByteSize = 0;
+	UINT mRegionByteSize = 0;
+
+	BonePalette::Format mPaletteFormat = BonePalette::Format::Affine3x4;
+	const AnimationLodPolicy* mLod = nullptr;
+	const BakedAnimation* mBaked = nullptr;
+
+	std::future<void> mTask;
+	Camera mTaskCamera;
+	UINT mRegion = 0;
+	UINT mNextRegion = 0;
+};
@@ -0,0 +1,80 @@
+#include "SoftwareSkinning.h"
+
+using namespace DirectX;
+
+void SoftwareSkinner::SetPalette(const XMFLOAT4X4* finalTransforms, UINT boneCount)
+{
+	mPalette.resize(boneCount);
+
+	for(UINT i = 0; i < boneCount; ++i)
+		XMStoreFloat4x4(&mPalette[i], XMMatrixTranspose(XMLoadFloat4x4(&finalTransforms[i])));
+}
+
+UINT SoftwareSkinner::BoneCount()const
+{
+	return (UINT)mPalette.size();
+}
+
+void SoftwareSkinner::Skin(const M3DLoader::SkinnedVertex* vertices, UINT begin, UINT end,
+	XMFLOAT3* positions, XMFLOAT3* normals)const
+{
+	const XMFLOAT4X4* palette = mPalette.data();
+
+	for(UINT i = begin; i < end; ++i)
+	{
+		const M3DLoader::SkinnedVertex& v = vertices[i];
+
+		assert(v.BoneIndices[0] < mPalette.size() && v.BoneIndices[1] < mPalette.size() &&
+			v.BoneIndices[2] < mPalette.size() && v.BoneIndices[3] < mPalette.size());
+
+		// Same weights as the shader: the fourth one is implied.
+		XMVECTOR weights = XMLoadFloat3(&v.BoneWeights);
+		XMVECTOR w0 = XMVectorSplatX(weights);
+		XMVECTOR w1 = XMVectorSplatY(weights);
+		XMVECTOR w2 = XMVectorSplatZ(weights);
+		XMVECTOR w3 = XMVectorReplicate(1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z);
+
+		const XMFLOAT4X4& b0 = palette[v.BoneIndices[0]];
+		const XMFLOAT4X4& b1 = palette[v.BoneIndices[1]];
+		const XMFLOAT4X4& b2 = palette[v.BoneIndices[2]];
+		const XMFLOAT4X4& b3 = palette[v.BoneIndices[3]];
+
+		XMMATRIX M;
+		for(int r = 0; r < 4; ++r)
+		{
+			XMVECTOR row = XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b0.m[r])), w0);
+			row = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b1.m[r])), w1, row);
+			row = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b2.m[r])), w2, row);
+			row = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b3.m[r])), w3, row);
+			M.r[r] = row;
+		}
+
+		XMStoreFloat3(&positions[i], XMVector3Transform(XMLoadFloat3(&v.Pos), M));
+
+		if( normals != nullptr )
+			XMStoreFloat3(&normals[i], XMVector3TransformNormal(XMLoadFloat3(&v.Normal), M));
+	}
+}
+
+void SoftwareSkinner::Skin(JobSystem& jobSystem, const std::vector<M3DLoader::SkinnedVertex>& vertices,
+	std::vector<XMFLOAT3>& positions)const
+{
+	positions.resize(vertices.size());
+
+	jobSystem.ParallelFor((UINT)vertices.size(), GrainSize, [&](UINT begin, UINT end)
+	{
+		Skin(vertices.data(), begin, end, positions.data());
+	});
+}
+
+void SoftwareSkinner::Skin(JobSystem& jobSystem, const std::vector<M3DLoader::SkinnedVertex>& vertices,
+	std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT3>& normals)const
+{
+	positions.resize(vertices.size());
+	normals.resize(vertices.size());
+
+	jobSystem.ParallelFor((UINT)vertices.size(), GrainSize, [&](UINT begin, UINT end)
+	{
+		Skin(vertices.data(), begin, end, positions.data(), normals.data());
+	});
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "LoadM3d.h"
+#include "JobSystem.h"
+
+///<summary>
+/// Skins M3D vertices on the CPU, for picking, collision and refitting
+/// bounds, where the GPU's skinned positions are out of reach.
+///
+/// The math is the linear blend of the SKINNED vertex shaders (the matrix
+/// and 3x4 palettes): the fourth weight is 1 - x - y - z, and a vertex is
+/// moved by the weighted sum of its four bone matrices.  The sum is taken
+/// over the matrices rather than the transformed points; that is the same
+/// thing up to float rounding.  The dual quaternion palette is not matched.
+///
+/// Each vertex blends its four bones with XMVECTOR multiply-adds and then
+/// goes through one 4x4 transform.  The parallel versions hand vertex
+/// ranges to a JobSystem.
+///</summary>
+class SoftwareSkinner
+{
+public:
+	// Vertices per job in the parallel versions.
+	static const UINT GrainSize = 2048;
+
+	// finalTransforms as SkinnedData::GetFinalTransforms writes them
+	// (transposed for the shader).  Kept until the next call.
+	void SetPalette(const DirectX::XMFLOAT4X4* finalTransforms, UINT boneCount);
+
+	UINT BoneCount()const;
+
+	// Skins vertices [begin, end) into the same entries of positions and,
+	// if not null, normals.  Normals are not renormalized, as in the shader.
+	void Skin(const M3DLoader::SkinnedVertex* vertices, UINT begin, UINT end,
+		DirectX::XMFLOAT3* positions, DirectX::XMFLOAT3* normals = nullptr)const;
+
+	// All vertices, split across the job system.  The outputs are resized.
+	void Skin(JobSystem& jobSystem, const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		std::vector<DirectX::XMFLOAT3>& positions)const;
+	void Skin(JobSystem& jobSystem, const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		std::vector<DirectX::XMFLOAT3>& positions, std::vector<DirectX::XMFLOAT3>& normals)const;
+
+private:
+	// The palette transposed back to row-vector form, so a blended bone
+	// goes straight into XMVector3Transform.
+	std::vector<DirectX::XMFLOAT4X4> mPalette;
+};
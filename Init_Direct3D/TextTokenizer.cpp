@@ -0,0 +1,327 @@
+#include "TextTokenizer.h"
+#include <cstdlib>
+#include <cfloat>
+#include <climits>
+
+namespace
+{
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Powers of ten that are exact in a double.
+	const double ExactPowersOfTen[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const int MaxExactPower = 22;
+	const UINT64 MaxExactMantissa = 1ull << 53;
+}
+
+bool TextTokenizer::Open(const std::string& filename)
+{
+	mBuffer.clear();
+	mPos = nullptr;
+	mFail = true;
+
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	bool ok = GetFileSizeEx(file, &fileSize) && fileSize.QuadPart < (LONGLONG)UINT_MAX;
+
+	if( ok )
+	{
+		mBuffer.resize((size_t)fileSize.QuadPart + 1);
+
+		DWORD bytesRead = 0;
+		ok = ReadFile(file, mBuffer.data(), (DWORD)fileSize.QuadPart, &bytesRead, nullptr) &&
+			bytesRead == (DWORD)fileSize.QuadPart;
+	}
+
+	CloseHandle(file);
+
+	if( !ok )
+	{
+		mBuffer.clear();
+		return false;
+	}
+
+	mBuffer.back() = '\0';
+	mPos = mBuffer.data();
+	mFail = false;
+
+	return true;
+}
+
+bool TextTokenizer::Fail()const
+{
+	return mFail;
+}
+
+const char* TextTokenizer::NextToken()
+{
+	if( mPos == nullptr )
+		return nullptr;
+
+	while( IsSpace(*mPos) )
+		++mPos;
+
+	return *mPos != '\0' ? mPos : nullptr;
+}
+
+bool TextTokenizer::EndOfToken(const char* p)const
+{
+	return *p == '\0' || IsSpace(*p);
+}
+
+void TextTokenizer::Skip(UINT count)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		if( NextToken() == nullptr )
+		{
+			mFail = true;
+			return;
+		}
+
+		while( !EndOfToken(mPos) )
+			++mPos;
+	}
+}
+
+std::string TextTokenizer::ReadString()
+{
+	const char* token = NextToken();
+	if( token == nullptr )
+	{
+		mFail = true;
+		return std::string();
+	}
+
+	while( !EndOfToken(mPos) )
+		++mPos;
+
+	return std::string(token, mPos);
+}
+
+void TextTokenizer::SkipLines(UINT count)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		if( NextToken() == nullptr )
+		{
+			mFail = true;
+			return;
+		}
+
+		const char* endOfLine = strchr(mPos, '\n');
+		mPos = endOfLine != nullptr ? endOfLine + 1 : mPos + strlen(mPos);
+	}
+}
+
+const char* TextTokenizer::Tell()const
+{
+	const char* p = mPos;
+	if( p != nullptr )
+	{
+		while( IsSpace(*p) )
+			++p;
+	}
+
+	return p;
+}
+
+void TextTokenizer::Seek(const char* position)
+{
+	mPos = position;
+	mFail = false;
+}
+
+TextTokenizer TextTokenizer::View(const char* position)const
+{
+	TextTokenizer view;
+	view.mPos = position;
+	return view;
+}
+
+int TextTokenizer::ReadInt()
+{
+	return (int)ReadUInt();
+}
+
+UINT TextTokenizer::ReadUInt()
+{
+	// Like operator>> on unsigned, a leading '-' wraps around.
+	const char* p = NextToken();
+	if( p == nullptr )
+	{
+		mFail = true;
+		return 0;
+	}
+
+	bool negative = *p == '-';
+	if( *p == '-' || *p == '+' )
+		++p;
+
+	if( !IsDigit(*p) )
+	{
+		mFail = true;
+		return 0;
+	}
+
+	UINT value = 0;
+	while( IsDigit(*p) )
+		value = value * 10 + (UINT)(*p++ - '0');
+
+	if( !EndOfToken(p) )
+	{
+		mFail = true;
+		return 0;
+	}
+
+	mPos = p;
+	return negative ? 0u - value : value;
+}
+
+bool TextTokenizer::ReadBool()
+{
+	return ReadUInt() != 0;
+}
+
+float TextTokenizer::ReadFloat()
+{
+	const char* token = NextToken();
+	if( token == nullptr )
+	{
+		mFail = true;
+		return 0.0f;
+	}
+
+	const char* p = token;
+
+	bool negative = *p == '-';
+	if( *p == '-' || *p == '+' )
+		++p;
+
+	// Up to 19 significant digits fit in the mantissa; the decimal point
+	// only moves the exponent.
+	UINT64 mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	bool truncated = false;
+
+	for( ; IsDigit(*p); ++p)
+	{
+		anyDigits = true;
+		if( significantDigits < 19 )
+		{
+			mantissa = mantissa * 10 + (UINT64)(*p - '0');
+			if( mantissa != 0 )
+				++significantDigits;
+		}
+		else
+		{
+			truncated |= *p != '0';
+			++exponent;
+		}
+	}
+
+	if( *p == '.' )
+	{
+		for(++p; IsDigit(*p); ++p)
+		{
+			anyDigits = true;
+			if( significantDigits < 19 )
+			{
+				mantissa = mantissa * 10 + (UINT64)(*p - '0');
+				if( mantissa != 0 )
+					++significantDigits;
+				--exponent;
+			}
+			else
+			{
+				truncated |= *p != '0';
+			}
+		}
+	}
+
+	if( anyDigits && (*p == 'e' || *p == 'E') )
+	{
+		const char* e = p + 1;
+
+		bool negativeExponent = *e == '-';
+		if( *e == '-' || *e == '+' )
+			++e;
+
+		if( IsDigit(*e) )
+		{
+			int value = 0;
+			for( ; IsDigit(*e); ++e)
+			{
+				if( value < 10000 )
+					value = value * 10 + (*e - '0');
+			}
+
+			exponent += negativeExponent ? -value : value;
+			p = e;
+		}
+	}
+
+	if( !anyDigits || !EndOfToken(p) || truncated ||
+		mantissa > MaxExactMantissa || exponent < -MaxExactPower || exponent > MaxExactPower )
+	{
+		return ReadFloatSlow(token);
+	}
+
+	if( mantissa == 0 )
+	{
+		mPos = p;
+		return negative ? -0.0f : 0.0f;
+	}
+
+	// One exactly rounded operation on exact operands.
+	double d = (double)mantissa;
+	d = exponent < 0 ? d / ExactPowersOfTen[-exponent] : d * ExactPowersOfTen[exponent];
+
+	if( d < FLT_MIN || d > FLT_MAX )
+		return ReadFloatSlow(token);
+
+	// Rounding the double to float again is only wrong when the double sits
+	// exactly halfway between two floats: 29 dropped mantissa bits of 1000...
+	UINT64 bits;
+	memcpy(&bits, &d, sizeof(bits));
+	if( (bits & 0x1FFFFFFFull) == 0x10000000ull )
+		return ReadFloatSlow(token);
+
+	mPos = p;
+
+	float f = (float)d;
+	return negative ? -f : f;
+}
+
+float TextTokenizer::ReadFloatSlow(const char* token)
+{
+	char* end = nullptr;
+	float f = strtof(token, &end);
+
+	if( end == token || !EndOfToken(end) )
+	{
+		mFail = true;
+		return 0.0f;
+	}
+
+	mPos = end;
+	return f;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../Common/d3dUtil.h"
+
+///<summary>
+/// Reads a whitespace separated text file (.m3d, skull.txt, car.txt) into
+/// one buffer and parses numbers in place, with no stream, locale or
+/// temporary strings.
+///
+/// Numbers come out the same as reading them with operator>>: a float is
+/// built from its decimal digits in one exactly rounded double operation,
+/// which gives the correctly rounded float unless the double lands exactly
+/// halfway between two floats.  That case, values with more than 19
+/// significant digits or a large exponent, and anything that is not plain
+/// decimal go through strtof on the token instead.
+///
+/// A token that does not parse as the requested type, or reading past the
+/// end, sets Fail() like a stream's failbit; the value returned is then 0.
+///</summary>
+class TextTokenizer
+{
+public:
+	bool Open(const std::string& filename);
+
+	bool Fail()const;
+
+	// Skips count tokens (labels such as "Vertices:" or "{").
+	void Skip(UINT count = 1);
+
+	float ReadFloat();
+	int ReadInt();
+	UINT ReadUInt();
+	bool ReadBool();
+
+	// For tokens that are kept, such as names.
+	std::string ReadString();
+
+	// Moves past the end of the line count non-empty lines further on,
+	// without looking at the tokens.  Used to find record boundaries.
+	void SkipLines(UINT count);
+
+	// Where the next token starts (the terminating 0 at the end), for
+	// coming back with Seek or comparing positions.
+	const char* Tell()const;
+
+	// Goes back to a position from Tell() and clears Fail(), like seekg.
+	void Seek(const char* position);
+
+	// A tokenizer reading this one's buffer from position, so a section can
+	// be parsed on another thread.  It must not outlive this one.
+	TextTokenizer View(const char* position)const;
+
+private:
+	// Moves to the next token and returns its first character, or null at
+	// the end of the buffer.
+	const char* NextToken();
+	bool EndOfToken(const char* p)const;
+
+	float ReadFloatSlow(const char* token);
+
+private:
+	// The file plus a terminating 0 so scanning never needs a bounds check.
+	// Empty in a View, which reads the buffer of the tokenizer it came from.
+	std::vector<char> mBuffer;
+	const char* mPos = nullptr;
+	bool mFail = false;
+};
@@ -0,0 +1,257 @@
+#include "VertexCompression.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMLoadFloat3(&a);
+		XMVECTOR vb = XMLoadFloat3(&b);
+
+		// Nothing to compare against; a zero tangent has no direction to lose.
+		if( XMVectorGetX(XMVector3LengthSq(va)) == 0.0f )
+			return 0.0f;
+
+		float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(va), XMVector3Normalize(vb)));
+		return XMConvertToDegrees(acosf(MathHelper::Clamp(cosAngle, -1.0f, 1.0f)));
+	}
+}
+
+template<typename PackedType>
+void VertexCompression::PackCommon(const XMFLOAT3& pos, const XMFLOAT3& normal,
+	const XMFLOAT3& tangent, const XMFLOAT2& uv,
+	const PositionDequant& dequant, PackedType& out)
+{
+	out.Pos = EncodePosition(pos, dequant);
+	out.Normal = EncodeOctahedral(normal);
+	out.Tangent = EncodeOctahedral(tangent);
+	XMStoreHalf2(&out.Uv, XMLoadFloat2(&uv));
+}
+
+template<typename PackedType>
+void VertexCompression::MeasureCommon(const XMFLOAT3& pos, const XMFLOAT3& normal,
+	const XMFLOAT3& tangent, const XMFLOAT2& uv,
+	const PackedType& packed, const PositionDequant& dequant, ErrorStats& stats)
+{
+	XMFLOAT3 p = DecodePosition(packed.Pos, dequant);
+	float posError = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&pos))));
+	stats.MaxPosition = MathHelper::Max(stats.MaxPosition, posError);
+
+	stats.MaxNormalDegrees = MathHelper::Max(stats.MaxNormalDegrees, AngleDegrees(normal, DecodeOctahedral(packed.Normal)));
+	stats.MaxTangentDegrees = MathHelper::Max(stats.MaxTangentDegrees, AngleDegrees(tangent, DecodeOctahedral(packed.Tangent)));
+
+	XMFLOAT2 t;
+	XMStoreFloat2(&t, XMLoadHalf2(&packed.Uv));
+	stats.MaxUv = MathHelper::Max(stats.MaxUv, MathHelper::Max(fabsf(t.x - uv.x), fabsf(t.y - uv.y)));
+}
+
+template<typename SourceVertex>
+VertexCompression::PositionDequant VertexCompression::BoundsDequant(const SourceVertex* vertices, size_t vertexCount)
+{
+	if( vertexCount == 0 )
+		return PositionDequant();
+
+	XMVECTOR vMin = XMLoadFloat3(&vertices[0].Pos);
+	XMVECTOR vMax = vMin;
+	for(size_t i = 0; i < vertexCount; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[i].Pos);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	XMFLOAT3 minPos, maxPos;
+	XMStoreFloat3(&minPos, vMin);
+	XMStoreFloat3(&maxPos, vMax);
+
+	return ComputeDequant(minPos, maxPos);
+}
+
+void VertexCompression::Compress(const std::vector<Vertex>& vertices,
+	std::vector<PackedVertex>& packed, PositionDequant& dequant)
+{
+	dequant = BoundsDequant(vertices.data(), vertices.size());
+	packed.resize(vertices.size());
+
+	for(size_t i = 0; i < vertices.size(); ++i)
+	{
+		const Vertex& v = vertices[i];
+		PackCommon(v.Pos, v.Normal, v.Tangent, v.Uv, dequant, packed[i]);
+	}
+}
+
+void VertexCompression::Compress(const std::vector<M3DLoader::SkinnedVertex>& vertices,
+	std::vector<PackedSkinnedVertex>& packed, PositionDequant& dequant)
+{
+	Compress(vertices.data(), (UINT)vertices.size(), packed, dequant);
+}
+
+void VertexCompression::Compress(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount,
+	std::vector<PackedSkinnedVertex>& packed, PositionDequant& dequant)
+{
+	dequant = BoundsDequant(vertices, vertexCount);
+	packed.resize(vertexCount);
+
+	for(UINT i = 0; i < vertexCount; ++i)
+	{
+		const M3DLoader::SkinnedVertex& v = vertices[i];
+		PackCommon(v.Pos, v.Normal, v.TangentU, v.TexC, dequant, packed[i]);
+
+		packed[i].BoneWeights = EncodeWeights(v.BoneWeights);
+		for(int j = 0; j < 4; ++j)
+			packed[i].BoneIndices[j] = v.BoneIndices[j];
+	}
+}
+
+VertexCompression::ErrorStats VertexCompression::MeasureError(const std::vector<Vertex>& vertices,
+	const std::vector<PackedVertex>& packed, const PositionDequant& dequant)
+{
+	ErrorStats stats;
+
+	for(size_t i = 0; i < vertices.size(); ++i)
+	{
+		const Vertex& v = vertices[i];
+		MeasureCommon(v.Pos, v.Normal, v.Tangent, v.Uv, packed[i], dequant, stats);
+	}
+
+	return stats;
+}
+
+VertexCompression::ErrorStats VertexCompression::MeasureError(const std::vector<M3DLoader::SkinnedVertex>& vertices,
+	const std::vector<PackedSkinnedVertex>& packed, const PositionDequant& dequant)
+{
+	return MeasureError(vertices.data(), (UINT)vertices.size(), packed, dequant);
+}
+
+VertexCompression::ErrorStats VertexCompression::MeasureError(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount,
+	const std::vector<PackedSkinnedVertex>& packed, const PositionDequant& dequant)
+{
+	ErrorStats stats;
+
+	for(UINT i = 0; i < vertexCount; ++i)
+	{
+		const M3DLoader::SkinnedVertex& v = vertices[i];
+		MeasureCommon(v.Pos, v.Normal, v.TangentU, v.TexC, packed[i], dequant, stats);
+
+		const float original[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z,
+			1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z };
+		XMFLOAT4 w = DecodeWeights(packed[i].BoneWeights);
+		const float decoded[4] = { w.x, w.y, w.z, w.w };
+
+		for(int j = 0; j < 4; ++j)
+			stats.MaxWeight = MathHelper::Max(stats.MaxWeight, fabsf(decoded[j] - original[j]));
+	}
+
+	return stats;
+}
+
+VertexCompression::PositionDequant VertexCompression::ComputeDequant(const XMFLOAT3& minPos, const XMFLOAT3& maxPos)
+{
+	PositionDequant dequant;
+	dequant.Offset = minPos;
+	dequant.Scale = XMFLOAT3(maxPos.x - minPos.x, maxPos.y - minPos.y, maxPos.z - minPos.z);
+
+	return dequant;
+}
+
+XMUSHORTN4 VertexCompression::EncodePosition(const XMFLOAT3& p, const PositionDequant& dequant)
+{
+	// A flat axis has no range; every vertex sits on the offset.
+	const XMFLOAT3& s = dequant.Scale;
+	const XMFLOAT3& o = dequant.Offset;
+	XMVECTOR unit = XMVectorSet(
+		s.x > 0.0f ? (p.x - o.x) / s.x : 0.0f,
+		s.y > 0.0f ? (p.y - o.y) / s.y : 0.0f,
+		s.z > 0.0f ? (p.z - o.z) / s.z : 0.0f,
+		0.0f);
+
+	XMUSHORTN4 packed;
+	XMStoreUShortN4(&packed, unit);
+	return packed;
+}
+
+XMFLOAT3 VertexCompression::DecodePosition(const XMUSHORTN4& p, const PositionDequant& dequant)
+{
+	// DecodePosition in Params.hlsl.
+	XMVECTOR pos = XMVectorMultiplyAdd(XMLoadUShortN4(&p), XMLoadFloat3(&dequant.Scale), XMLoadFloat3(&dequant.Offset));
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, pos);
+	return result;
+}
+
+XMSHORTN2 VertexCompression::EncodeOctahedral(const XMFLOAT3& n)
+{
+	XMSHORTN2 packed;
+
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the
+	// lower half over the diagonals onto the outer triangles of the square.
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if( l1 == 0.0f )
+	{
+		XMStoreShortN2(&packed, XMVectorZero());
+		return packed;
+	}
+
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if( n.z < 0.0f )
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	XMStoreShortN2(&packed, XMVectorSet(x, y, 0.0f, 0.0f));
+	return packed;
+}
+
+XMFLOAT3 VertexCompression::DecodeOctahedral(const XMSHORTN2& e)
+{
+	// DecodeOctahedral in Params.hlsl.
+	XMFLOAT2 f;
+	XMStoreFloat2(&f, XMLoadShortN2(&e));
+
+	XMFLOAT3 n(f.x, f.y, 1.0f - fabsf(f.x) - fabsf(f.y));
+	float t = MathHelper::Clamp(-n.z, 0.0f, 1.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+	return n;
+}
+
+XMUBYTEN4 VertexCompression::EncodeWeights(const XMFLOAT3& w)
+{
+	int q[3] =
+	{
+		(int)(MathHelper::Clamp(w.x, 0.0f, 1.0f) * 255.0f + 0.5f),
+		(int)(MathHelper::Clamp(w.y, 0.0f, 1.0f) * 255.0f + 0.5f),
+		(int)(MathHelper::Clamp(w.z, 0.0f, 1.0f) * 255.0f + 0.5f)
+	};
+
+	// Rounding up can push the implied fourth weight below zero; take the
+	// excess back from the largest weight, where it matters least.
+	while( q[0] + q[1] + q[2] > 255 )
+	{
+		int largest = 0;
+		if( q[1] > q[largest] ) largest = 1;
+		if( q[2] > q[largest] ) largest = 2;
+		--q[largest];
+	}
+
+	return XMUBYTEN4((uint8_t)q[0], (uint8_t)q[1], (uint8_t)q[2], (uint8_t)0);
+}
+
+XMFLOAT4 VertexCompression::DecodeWeights(const XMUBYTEN4& w)
+{
+	XMFLOAT4 weights;
+	XMStoreFloat4(&weights, XMLoadUByteN4(&w));
+
+	// As the skinned shaders do.
+	weights.w = 1.0f - weights.x - weights.y - weights.z;
+	return weights;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "D3dHeader.h"
+#include "LoadM3d.h"
+
+///<summary>
+/// Quantized vertex formats for the loaded meshes, and the CPU side of
+/// their encoding.
+///
+/// Positions are 16 bit UNORM within the mesh bounds and are restored with
+/// a per mesh scale and offset (the gPosDequant constants).  Normals and
+/// tangents are octahedral encoded into two 16 bit SNORMs, UVs are halves.
+/// Skinned vertices also store their three bone weights as 8 bit UNORMs;
+/// the fourth weight stays implied, so the three are rounded to never add
+/// up past one.
+///
+/// The Decode functions are the math of the PACKED_VERTEX shaders in
+/// Params.hlsl, so MeasureError reports what the GPU reconstructs.  Only
+/// directions survive for normals and tangents, which the shaders
+/// renormalize anyway; a zero tangent decodes to +z.
+///</summary>
+class VertexCompression
+{
+public:
+	// 20 bytes, against 44 for Vertex.
+	struct PackedVertex
+	{
+		DirectX::PackedVector::XMUSHORTN4 Pos;     // R16G16B16A16_UNORM
+		DirectX::PackedVector::XMSHORTN2 Normal;   // R16G16_SNORM
+		DirectX::PackedVector::XMSHORTN2 Tangent;  // R16G16_SNORM
+		DirectX::PackedVector::XMHALF2 Uv;         // R16G16_FLOAT
+	};
+
+	// 32 bytes, against 64 for M3DLoader::SkinnedVertex.
+	struct PackedSkinnedVertex
+	{
+		DirectX::PackedVector::XMUSHORTN4 Pos;          // R16G16B16A16_UNORM
+		DirectX::PackedVector::XMSHORTN2 Normal;        // R16G16_SNORM
+		DirectX::PackedVector::XMSHORTN2 Tangent;       // R16G16_SNORM
+		DirectX::PackedVector::XMHALF2 Uv;              // R16G16_FLOAT
+		DirectX::PackedVector::XMUBYTEN4 BoneWeights;   // R8G8B8A8_UNORM, w unused
+		USHORT BoneIndices[4];                          // R16G16B16A16_UINT
+	};
+
+	// Position = stored UNORM * Scale + Offset.
+	struct PositionDequant
+	{
+		DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+		DirectX::XMFLOAT3 Offset = { 0.0f, 0.0f, 0.0f };
+	};
+
+	struct ErrorStats
+	{
+		float MaxPosition = 0.0f;        // distance, model units
+		float MaxNormalDegrees = 0.0f;
+		float MaxTangentDegrees = 0.0f;
+		float MaxUv = 0.0f;
+		float MaxWeight = 0.0f;          // skinned only, all four weights
+	};
+
+	static void Compress(const std::vector<Vertex>& vertices,
+		std::vector<PackedVertex>& packed, PositionDequant& dequant);
+	static void Compress(const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		std::vector<PackedSkinnedVertex>& packed, PositionDequant& dequant);
+	// For vertices that are not in a vector, such as a mapped M3dBinaryFile.
+	static void Compress(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount,
+		std::vector<PackedSkinnedVertex>& packed, PositionDequant& dequant);
+
+	static ErrorStats MeasureError(const std::vector<Vertex>& vertices,
+		const std::vector<PackedVertex>& packed, const PositionDequant& dequant);
+	static ErrorStats MeasureError(const std::vector<M3DLoader::SkinnedVertex>& vertices,
+		const std::vector<PackedSkinnedVertex>& packed, const PositionDequant& dequant);
+	static ErrorStats MeasureError(const M3DLoader::SkinnedVertex* vertices, UINT vertexCount,
+		const std::vector<PackedSkinnedVertex>& packed, const PositionDequant& dequant);
+
+	static PositionDequant ComputeDequant(const DirectX::XMFLOAT3& minPos, const DirectX::XMFLOAT3& maxPos);
+
+	static DirectX::PackedVector::XMUSHORTN4 EncodePosition(const DirectX::XMFLOAT3& p, const PositionDequant& dequant);
+	static DirectX::XMFLOAT3 DecodePosition(const DirectX::PackedVector::XMUSHORTN4& p, const PositionDequant& dequant);
+
+	static DirectX::PackedVector::XMSHORTN2 EncodeOctahedral(const DirectX::XMFLOAT3& n);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const DirectX::PackedVector::XMSHORTN2& e);
+
+	static DirectX::PackedVector::XMUBYTEN4 EncodeWeights(const DirectX::XMFLOAT3& w);
+	static DirectX::XMFLOAT4 DecodeWeights(const DirectX::PackedVector::XMUBYTEN4& w);
+
+private:
+	// The attributes both layouts share.  Vertex and SkinnedVertex name
+	// them differently, so they are passed one by one.
+	template<typename PackedType>
+	static void PackCommon(const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal,
+		const DirectX::XMFLOAT3& tangent, const DirectX::XMFLOAT2& uv,
+		const PositionDequant& dequant, PackedType& out);
+	template<typename PackedType>
+	static void MeasureCommon(const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal,
+		const DirectX::XMFLOAT3& tangent, const DirectX::XMFLOAT2& uv,
+		const PackedType& packed, const PositionDequant& dequant, ErrorStats& stats);
+
+	template<typename SourceVertex>
+	static PositionDequant BoundsDequant(const SourceVertex* vertices, size_t vertexCount);
+};
@@ -0,0 +1,285 @@
+#include "TestFramework.h"
+#include "TestSoldier.h"
+#include "../Init_Direct3D/AssetStreamer.h"
+#include "../Init_Direct3D/LoadPosNormal.h"
+#include "../Init_Direct3D/M3dBinary.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	// Runs uploads the way the app does between frames until every request
+	// is done.  False if that takes longer than anything here should.
+	bool Drain(AssetStreamer& streamer, UINT& uploads)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while( streamer.PendingCount() > 0 )
+		{
+			if( std::chrono::steady_clock::now() > deadline )
+				return false;
+
+			uploads += streamer.Upload();
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	bool WaitFor(const std::atomic<bool>& flag)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while( !flag )
+		{
+			if( std::chrono::steady_clock::now() > deadline )
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+TEST_CASE(StreamedLoadsUploadOnTheRenderThread)
+{
+	const std::thread::id renderThread = std::this_thread::get_id();
+
+	// One streaming thread, so the loads finish in the order requested.
+	AssetStreamer streamer(1);
+	std::vector<int> uploaded;
+	std::atomic<int> loadsOnRenderThread{ 0 };
+	bool uploadsOnRenderThread = true;
+
+	for(int i = 0; i < 3; ++i)
+	{
+		streamer.Request([&, i]() -> AssetStreamer::UploadStep
+		{
+			if( std::this_thread::get_id() == renderThread )
+				++loadsOnRenderThread;
+
+			return [&, i]()
+			{
+				uploadsOnRenderThread = uploadsOnRenderThread && std::this_thread::get_id() == renderThread;
+				uploaded.push_back(i);
+			};
+		});
+	}
+	CHECK(streamer.PendingCount() == 3);
+
+	UINT uploads = 0;
+	CHECK(Drain(streamer, uploads));
+	CHECK(uploads == 3);
+	CHECK(!streamer.HasUploads());
+
+	CHECK(loadsOnRenderThread == 0);
+	CHECK(uploadsOnRenderThread);
+	CHECK(uploaded == std::vector<int>({ 0, 1, 2 }));
+}
+
+TEST_CASE(FailedLoadIsDropped)
+{
+	AssetStreamer streamer(2);
+	bool uploaded = false;
+
+	streamer.Request([]() -> AssetStreamer::UploadStep { return nullptr; });
+	streamer.Request([&]() -> AssetStreamer::UploadStep { return [&]() { uploaded = true; }; });
+
+	// The failed load leaves the pending count but never uploads.
+	UINT uploads = 0;
+	CHECK(Drain(streamer, uploads));
+	CHECK(uploads == 1);
+	CHECK(uploaded);
+	CHECK(streamer.PendingCount() == 0);
+}
+
+TEST_CASE(UploadStepCanRequestMore)
+{
+	AssetStreamer streamer(2);
+	bool second = false;
+
+	streamer.Request([&]() -> AssetStreamer::UploadStep
+	{
+		return [&]()
+		{
+			streamer.Request([&]() -> AssetStreamer::UploadStep { return [&]() { second = true; }; });
+		};
+	});
+
+	UINT uploads = 0;
+	CHECK(Drain(streamer, uploads));
+	CHECK(uploads == 2);
+	CHECK(second);
+}
+
+TEST_CASE(DestructorDropsQueuedLoads)
+{
+	std::atomic<bool> started{ false };
+	std::atomic<bool> release{ false };
+	std::atomic<int> queuedLoads{ 0 };
+	auto payload = std::make_shared<int>(0);
+
+	auto streamer = std::make_unique<AssetStreamer>(1);
+
+	// The only streaming thread sits in this load until released.
+	streamer->Request([&]() -> AssetStreamer::UploadStep
+	{
+		started = true;
+		while( !release )
+			std::this_thread::yield();
+		return []() {};
+	});
+
+	for(int i = 0; i < 3; ++i)
+	{
+		streamer->Request([&, payload]() -> AssetStreamer::UploadStep
+		{
+			++queuedLoads;
+			return []() {};
+		});
+	}
+	CHECK(payload.use_count() == 4);
+	CHECK(WaitFor(started));
+
+	// Released well after the destructor has told the thread to quit, so
+	// the running load finishes and nothing queued behind it starts.
+	std::thread releaser([&]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		release = true;
+	});
+	streamer.reset();
+	releaser.join();
+
+	CHECK(queuedLoads == 0);
+	CHECK(payload.use_count() == 1);
+}
+
+BENCHMARK(StreamedStartup)
+{
+	// The app's startup assets, minus the sky cube this checkout lacks.
+	// The upload steps stand in for the device: they copy the payload into
+	// an "upload heap", which is the render thread's share of the work.
+	const std::vector<std::wstring> textureFiles = {
+		L"../Textures/bricks.dds", L"../Textures/bricks_nmap.dds", L"../Textures/stone.dds",
+		L"../Textures/tile.dds", L"../Textures/tile_nmap.dds", L"../Textures/WireFence.dds" };
+	const std::string skullFilename = "../Models/skull.txt";
+	const std::string binaryFilename = "StreamedStartup.m3db";
+
+	// Later runs of the app find the binary already converted.
+	M3DLoader converter;
+	if( !converter.ConvertM3d(TestSoldier::Filename, binaryFilename) )
+	{
+		std::printf("  %s did not load, skipped\n", TestSoldier::Filename);
+		return;
+	}
+
+	std::vector<BYTE> uploadHeap;
+	auto upload = [&uploadHeap](const void* data, size_t size)
+	{
+		uploadHeap.resize(size);
+		std::memcpy(uploadHeap.data(), data, size);
+	};
+
+	std::vector<AssetStreamer::LoadStep> loads;
+	loads.push_back([&]() -> AssetStreamer::UploadStep
+	{
+		struct Payload
+		{
+			M3dBinaryFile Binary;
+			std::vector<M3DLoader::Subset> Subsets;
+			std::vector<M3DLoader::M3dMaterial> Mats;
+			SkinnedData SkinnedInfo;
+		};
+		auto model = std::make_shared<Payload>();
+
+		M3DLoader loader;
+		if( !loader.OpenM3dBinary(binaryFilename, model->Binary, model->Subsets, model->Mats, model->SkinnedInfo) )
+			return nullptr;
+
+		model->SkinnedInfo.ExtractRootMotion();
+		model->SkinnedInfo.ReduceAnimations(KeyframeTolerance());
+
+		return [&, model]()
+		{
+			const M3dBinaryFile::Header& header = model->Binary.GetHeader();
+			upload(model->Binary.GetVertices(), header.VertexCount * sizeof(M3DLoader::SkinnedVertex));
+			upload(model->Binary.GetIndices(), header.IndexCount * sizeof(USHORT));
+		};
+	});
+	loads.push_back([&]() -> AssetStreamer::UploadStep
+	{
+		auto vertices = std::make_shared<std::vector<M3DLoader::Vertex>>();
+		auto indices = std::make_shared<std::vector<std::int32_t>>();
+		if( !LoadPosNormalModel(skullFilename, *vertices, *indices) )
+			return nullptr;
+
+		return [&, vertices, indices]()
+		{
+			upload(vertices->data(), vertices->size() * sizeof(M3DLoader::Vertex));
+			upload(indices->data(), indices->size() * sizeof(std::int32_t));
+		};
+	});
+	for(const std::wstring& filename : textureFiles)
+	{
+		loads.push_back([&, filename]() -> AssetStreamer::UploadStep
+		{
+			auto dds = std::make_shared<std::vector<BYTE>>();
+			if( !AssetStreamer::ReadFile(filename, *dds) )
+				return nullptr;
+
+			return [&, dds]() { upload(dds->data(), dds->size()); };
+		});
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	auto elapsed = [](Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// Best of five, like MeasureMilliseconds, for both moments of a run.
+	double inlineFirstFrame = 1e30;
+	double streamedFirstFrame = 1e30;
+	double streamedAll = 1e30;
+	UINT streamedFrames = 0;
+
+	for(int run = 0; run < 5; ++run)
+	{
+		// Everything loaded and uploaded before the first frame.
+		Clock::time_point start = Clock::now();
+		for(const AssetStreamer::LoadStep& load : loads)
+		{
+			AssetStreamer::UploadStep step = load();
+			if( step )
+				step();
+		}
+		inlineFirstFrame = MathHelper::Min(inlineFirstFrame, elapsed(start));
+
+		// Requests only; the first frame is drawn at once and uploads
+		// happen between the frames that follow.
+		start = Clock::now();
+		AssetStreamer streamer;
+		for(const AssetStreamer::LoadStep& load : loads)
+			streamer.Request(load);
+		streamedFirstFrame = MathHelper::Min(streamedFirstFrame, elapsed(start));
+
+		// Frames here are only 0.1 ms apart, so this is close to the time
+		// the loads themselves take.
+		UINT frames = 0;
+		while( streamer.PendingCount() > 0 )
+		{
+			streamer.Upload();
+			++frames;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		streamedAll = MathHelper::Min(streamedAll, elapsed(start));
+		streamedFrames = frames;
+	}
+
+	std::remove(binaryFilename.c_str());
+
+	TestRegistry::Report("inline loads, first frame", inlineFirstFrame, "ms");
+	TestRegistry::Report("streamed, first frame", streamedFirstFrame, "ms");
+	TestRegistry::Report("streamed, everything uploaded", streamedAll, "ms");
+	TestRegistry::Report("streamed, frames until uploaded", streamedFrames, "frames");
+}
@@ -0,0 +1,214 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "../Init_Direct3D/D3dHeader.h"
+#include "../Init_Direct3D/BonePalette.h"
+#include "../Init_Direct3D/SkinnedInstanceUpdater.h"
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BoneCount = 40;
+	const UINT InstanceCount = 48;
+	const UINT FrameCount = 150;
+	const float FrameTime = 1.0f / 60.0f;
+	const BonePalette::Format PaletteFormat = BonePalette::Format::Affine3x4;
+
+	///<summary>
+	/// The skinned instances of InitDirect3DApp without the device: one
+	/// skeleton, an optional pose cache, instances spread out in front of the
+	/// camera so the animation LOD picks different levels.  A few start a
+	/// cross-fade so layer blending runs too.
+	///</summary>
+	struct Scene
+	{
+		SkinnedData SkinnedInfo;
+		std::unique_ptr<PoseCache> Cache;
+		std::vector<std::unique_ptr<SkinnedModelInstance>> Instances;
+		AnimationLodPolicy AnimationLod;
+		Camera SceneCamera;
+
+		explicit Scene(bool usePoseCache)
+		{
+			CHECK(TestSkeleton::Build(SkinnedInfo, BoneCount));
+			SkinnedInfo.ExtractRootMotion();
+
+			if( usePoseCache )
+				Cache = std::make_unique<PoseCache>(SkinnedInfo, 1.0f / 60.0f, 1 << 20);
+
+			SceneCamera.SetPosition(0.0f, 2.0f, -10.0f);
+
+			for(UINT i = 0; i < InstanceCount; ++i)
+			{
+				auto inst = std::make_unique<SkinnedModelInstance>();
+				inst->SkinnedInfo = &SkinnedInfo;
+				inst->FinalTransforms.resize(SkinnedInfo.BoneCount());
+				inst->Cache = Cache.get();
+				inst->LodFrame = i;
+				inst->SetClip(i % 2 == 0 ? "Walk" : "Run");
+				inst->TimePos = fmodf(0.37f * i, inst->Clip->GetClipEndTime());
+
+				if( i % 5 == 0 )
+					inst->CrossFade(i % 2 == 0 ? "Run" : "Walk", 0.5f);
+
+				float x = 3.0f * (i % 8) - 10.0f;
+				float z = 15.0f * (i / 8);
+				XMStoreFloat4x4(&inst->World, XMMatrixTranslation(x, 0.0f, z));
+				inst->Position = XMFLOAT3(x, 0.0f, z);
+
+				Instances.push_back(std::move(inst));
+			}
+		}
+	};
+
+	///<summary>
+	/// Stands in for the skinned constant buffer and the draw calls: two
+	/// regions with one palette slot per instance.  Draw() records the
+	/// region the frame's draw calls would read.
+	///</summary>
+	struct FakeRenderer
+	{
+		UINT SlotSize = BoneCount * BonePalette::Stride(PaletteFormat);
+		UINT RegionSize = SlotSize * InstanceCount;
+		std::vector<XMFLOAT4> Buffer;
+		std::vector<std::vector<XMFLOAT4>> DrawnFrames;
+		std::vector<UINT> DrawnRegions;
+
+		FakeRenderer()
+		{
+			Buffer.resize(RegionSize * 2);
+		}
+
+		// Points updater at the buffer, the way InitDirect3DApp does.
+		void Connect(SkinnedInstanceUpdater& updater, const Scene& scene)
+		{
+			updater.SetTarget(reinterpret_cast<BYTE*>(Buffer.data()),
+				SlotSize * sizeof(XMFLOAT4), RegionSize * sizeof(XMFLOAT4));
+			updater.SetPaletteFormat(PaletteFormat);
+			updater.SetLodPolicy(&scene.AnimationLod);
+		}
+
+		void Draw(UINT region)
+		{
+			auto first = Buffer.begin() + region * RegionSize;
+			DrawnFrames.emplace_back(first, first + RegionSize);
+			DrawnRegions.push_back(region);
+		}
+	};
+
+	// Update then draw, one frame after the other.  Ends with one more
+	// update, as the async runs evaluate a frame past the last one drawn.
+	void RunSerial(Scene& scene, FakeRenderer& renderer)
+	{
+		SkinnedInstanceUpdater updater(&scene.Instances, nullptr, false);
+		renderer.Connect(updater, scene);
+
+		for(UINT frame = 0; frame < FrameCount; ++frame)
+		{
+			updater.Update(FrameTime, scene.SceneCamera);
+			renderer.Draw(updater.GetRegion());
+		}
+
+		updater.Update(FrameTime, scene.SceneCamera);
+	}
+
+	// InitDirect3DApp's async mode: frame N+1 is evaluated into the other
+	// region on worker threads while frame N is drawn.
+	void RunAsync(Scene& scene, FakeRenderer& renderer, JobSystem& jobs)
+	{
+		SkinnedInstanceUpdater updater(&scene.Instances, &jobs, true);
+		renderer.Connect(updater, scene);
+		CHECK(updater.RegionCount() == 2);
+
+		for(UINT frame = 0; frame < FrameCount; ++frame)
+		{
+			updater.Update(FrameTime, scene.SceneCamera);
+			updater.BeginNextFrame(FrameTime, scene.SceneCamera);
+			renderer.Draw(updater.GetRegion());
+		}
+
+		updater.Wait();
+	}
+
+	bool SameFrames(const FakeRenderer& a, const FakeRenderer& b)
+	{
+		if( a.DrawnFrames.size() != b.DrawnFrames.size() )
+			return false;
+
+		for(size_t i = 0; i < a.DrawnFrames.size(); ++i)
+		{
+			if( memcmp(a.DrawnFrames[i].data(), b.DrawnFrames[i].data(), a.DrawnFrames[i].size() * sizeof(XMFLOAT4)) != 0 )
+				return false;
+		}
+		return true;
+	}
+
+	bool SameWorlds(const Scene& a, const Scene& b)
+	{
+		for(UINT i = 0; i < InstanceCount; ++i)
+		{
+			if( memcmp(&a.Instances[i]->World, &b.Instances[i]->World, sizeof(XMFLOAT4X4)) != 0 )
+				return false;
+		}
+		return true;
+	}
+
+	void CheckAsyncMatchesSerial(bool usePoseCache)
+	{
+		Scene serialScene(usePoseCache);
+		FakeRenderer serial;
+		RunSerial(serialScene, serial);
+
+		for(UINT workers : { 1u, 3u })
+		{
+			Scene asyncScene(usePoseCache);
+			FakeRenderer async;
+			JobSystem jobs(workers);
+			RunAsync(asyncScene, async, jobs);
+
+			CHECK(SameFrames(serial, async));
+			CHECK(SameWorlds(serialScene, asyncScene));
+
+			// Consecutive frames draw from alternate regions.
+			bool alternates = true;
+			for(size_t i = 1; i < async.DrawnRegions.size(); ++i)
+				alternates = alternates && async.DrawnRegions[i] != async.DrawnRegions[i - 1];
+			CHECK(alternates);
+		}
+	}
+}
+
+TEST_CASE(AsyncAnimationMatchesSerial)
+{
+	CheckAsyncMatchesSerial(false);
+}
+
+TEST_CASE(AsyncAnimationWithPoseCacheMatchesSerial)
+{
+	CheckAsyncMatchesSerial(true);
+}
+
+TEST_CASE(AsyncAnimationIsRepeatable)
+{
+	FakeRenderer first;
+	FakeRenderer second;
+
+	{
+		Scene scene(true);
+		JobSystem jobs(4);
+		RunAsync(scene, first, jobs);
+	}
+	{
+		Scene scene(true);
+		JobSystem jobs(2);
+		RunAsync(scene, second, jobs);
+	}
+
+	CHECK(first.DrawnFrames.size() == FrameCount);
+	CHECK(SameFrames(first, second));
+
+	// The instances really move: the last frame differs from the first.
+	CHECK(memcmp(first.DrawnFrames.front().data(), first.DrawnFrames.back().data(),
+		first.DrawnFrames.front().size() * sizeof(XMFLOAT4)) != 0);
+}
@@ -0,0 +1,100 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "../Init_Direct3D/D3dHeader.h"
+#include "../Init_Direct3D/BakedAnimation.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BoneCount = 24;
+	const float FramesPerSecond = 30.0f;
+
+	// Affine3x4 drops the constant column and nothing else.
+	const float MaxPaletteError = 1e-6f;
+
+	using TestSkeleton::MaxDifference;
+}
+
+TEST_CASE(BakedFramesMatchSampledPoses)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	BakedAnimation baked;
+	baked.Bake(skinned, FramesPerSecond);
+	CHECK(baked.BoneCount() == BoneCount);
+
+	std::vector<XMFLOAT4X4> fromBake(BoneCount);
+	std::vector<XMFLOAT4X4> sampled(BoneCount);
+	UINT totalFrames = 0;
+
+	for(const std::string& name : skinned.GetClipNames())
+	{
+		int clipIndex = baked.FindClip(name);
+		CHECK(clipIndex >= 0);
+		if( clipIndex < 0 )
+			continue;
+
+		const BakedAnimation::Clip& clip = baked.GetClip(clipIndex);
+		const CompiledAnimationClip* compiled = skinned.FindClip(name);
+		CHECK(clip.StartTime == compiled->GetClipStartTime());
+		CHECK(clip.EndTime == compiled->GetClipEndTime());
+		CHECK(clip.FirstFrame == totalFrames);
+
+		// Frames cover the whole clip, the last one clamped to its end.
+		CHECK((clip.FrameCount - 1) / FramesPerSecond >= clip.EndTime - clip.StartTime);
+		CHECK((clip.FrameCount - 2) / FramesPerSecond < clip.EndTime - clip.StartTime);
+
+		AnimationWorkspace workspace;
+		for(UINT i = 0; i < clip.FrameCount; ++i)
+		{
+			float t = MathHelper::Min(clip.StartTime + i / FramesPerSecond, clip.EndTime);
+
+			CHECK(baked.GetFrame(clipIndex, t) == clip.FirstFrame + i);
+
+			baked.GetFinalTransforms(clip.FirstFrame + i, fromBake);
+			skinned.GetFinalTransforms(compiled, t, sampled, workspace);
+			CHECK(MaxDifference(fromBake, sampled) <= MaxPaletteError);
+		}
+
+		// Times off the clip clamp to its first and last frame.
+		CHECK(baked.GetFrame(clipIndex, clip.StartTime - 1.0f) == clip.FirstFrame);
+		CHECK(baked.GetFrame(clipIndex, clip.EndTime + 1.0f) == clip.FirstFrame + clip.FrameCount - 1);
+
+		totalFrames += clip.FrameCount;
+	}
+
+	CHECK(baked.FrameCount() == totalFrames);
+	CHECK(baked.GetByteSize() == (size_t)totalFrames * BoneCount * 3 * sizeof(XMFLOAT4));
+}
+
+TEST_CASE(BakedInstanceFollowsClipChanges)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	BakedAnimation baked;
+	baked.Bake(skinned, FramesPerSecond);
+
+	SkinnedModelInstance inst;
+	inst.SkinnedInfo = &skinned;
+	inst.FinalTransforms.resize(BoneCount);
+	inst.Baked = &baked;
+
+	inst.SetClip("Walk");
+	CHECK(inst.BakedClip == baked.FindClip("Walk"));
+
+	inst.UpdateBakedAnimation(0.1f);
+	inst.SetClip("Run");
+	CHECK(inst.BakedClip == baked.FindClip("Run"));
+
+	// Baked palettes cannot be blended, so a cross-fade switches at once.
+	inst.CrossFade("Walk", 0.5f);
+	CHECK(inst.Layers.empty());
+	CHECK(inst.ClipName == "Walk");
+	CHECK(inst.BakedClip == baked.FindClip("Walk"));
+
+	inst.UpdateBakedAnimation(0.1f);
+	CHECK(baked.GetFrame(inst.BakedClip, inst.TimePos) == baked.GetClip(inst.BakedClip).FirstFrame + 3);
+}
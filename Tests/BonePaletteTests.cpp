@@ -0,0 +1,170 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "../Init_Direct3D/BonePalette.h"
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const BonePalette::Format Formats[] =
+	{
+		BonePalette::Format::Matrix4x4,
+		BonePalette::Format::Affine3x4,
+		BonePalette::Format::DualQuaternion
+	};
+
+	// A final transform as GetFinalTransforms writes it: scale, rotation
+	// and translation as a row-vector matrix, transposed.
+	XMFLOAT4X4 RandomTransform(std::mt19937& rng, bool rigid)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		XMVECTOR axis = XMVectorSet(unit(rng), unit(rng), unit(rng) + 1.5f, 0.0f);
+		XMVECTOR q = XMQuaternionRotationAxis(axis, XM_PI * unit(rng));
+
+		XMVECTOR s = rigid ? XMVectorSplatOne() : XMVectorSet(scale(rng), scale(rng), scale(rng), 0.0f);
+		XMVECTOR t = XMVectorScale(XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f), 10.0f);
+
+		XMFLOAT4X4 M;
+		XMStoreFloat4x4(&M, XMMatrixTranspose(XMMatrixAffineTransformation(s, XMVectorZero(), q, t)));
+		return M;
+	}
+
+	using TestSkeleton::MaxDifference;
+}
+
+TEST_CASE(PaletteStrides)
+{
+	CHECK(BonePalette::Stride(BonePalette::Format::Matrix4x4) == 4);
+	CHECK(BonePalette::Stride(BonePalette::Format::Affine3x4) == 3);
+	CHECK(BonePalette::Stride(BonePalette::Format::DualQuaternion) == 2);
+}
+
+TEST_CASE(PackWritesOnlyBoneCountEntries)
+{
+	const UINT boneCount = 37;
+	const XMFLOAT4 sentinel(-7.0f, -7.0f, -7.0f, -7.0f);
+
+	std::mt19937 rng(9);
+	std::vector<XMFLOAT4X4> transforms(boneCount);
+	for(auto& M : transforms)
+		M = RandomTransform(rng, true);
+
+	for(BonePalette::Format format : Formats)
+	{
+		UINT used = boneCount * BonePalette::Stride(format);
+		std::vector<XMFLOAT4> palette(BonePalette::MaxBones * 4, sentinel);
+
+		BonePalette::Pack(format, transforms.data(), boneCount, palette.data());
+
+		bool untouched = true;
+		for(UINT i = used; i < palette.size(); ++i)
+			untouched = untouched && memcmp(&palette[i], &sentinel, sizeof(XMFLOAT4)) == 0;
+
+		CHECK(untouched);
+		CHECK(memcmp(&palette[used - 1], &sentinel, sizeof(XMFLOAT4)) != 0);
+	}
+}
+
+TEST_CASE(MatrixPalettesRoundTripExactly)
+{
+	const UINT boneCount = 64;
+
+	std::mt19937 rng(3);
+	std::vector<XMFLOAT4X4> transforms(boneCount);
+	for(auto& M : transforms)
+		M = RandomTransform(rng, false);
+
+	for(BonePalette::Format format : { BonePalette::Format::Matrix4x4, BonePalette::Format::Affine3x4 })
+	{
+		std::vector<XMFLOAT4> palette(boneCount * BonePalette::Stride(format));
+		std::vector<XMFLOAT4X4> unpacked(boneCount);
+
+		BonePalette::Pack(format, transforms.data(), boneCount, palette.data());
+		BonePalette::Unpack(format, palette.data(), boneCount, unpacked.data());
+
+		CHECK(memcmp(transforms.data(), unpacked.data(), boneCount * sizeof(XMFLOAT4X4)) == 0);
+	}
+}
+
+TEST_CASE(DualQuaternionRoundTripWithinBound)
+{
+	const UINT boneCount = 256;
+
+	// Rotation entries are at most 1 and translations at most 10*sqrt(3),
+	// so a few float ulps of those.
+	const float rotationBound = 1e-5f;
+	const float translationBound = 1e-4f;
+
+	std::mt19937 rng(5);
+	std::vector<XMFLOAT4X4> transforms(boneCount);
+	for(auto& M : transforms)
+		M = RandomTransform(rng, true);
+
+	std::vector<XMFLOAT4> palette(boneCount * 2);
+	std::vector<XMFLOAT4X4> unpacked(boneCount);
+
+	BonePalette::Pack(BonePalette::Format::DualQuaternion, transforms.data(), boneCount, palette.data());
+	BonePalette::Unpack(BonePalette::Format::DualQuaternion, palette.data(), boneCount, unpacked.data());
+
+	float rotationError = 0.0f;
+	float translationError = 0.0f;
+
+	for(UINT i = 0; i < boneCount; ++i)
+	{
+		const XMFLOAT4X4& a = transforms[i];
+		const XMFLOAT4X4& b = unpacked[i];
+
+		// Transposed: rotation in the upper 3x3, translation in the last column.
+		for(int r = 0; r < 3; ++r)
+		{
+			for(int c = 0; c < 3; ++c)
+				rotationError = MathHelper::Max(rotationError, fabsf(a.m[r][c] - b.m[r][c]));
+
+			translationError = MathHelper::Max(translationError, fabsf(a.m[r][3] - b.m[r][3]));
+		}
+
+		CHECK(b._41 == 0.0f && b._42 == 0.0f && b._43 == 0.0f && b._44 == 1.0f);
+
+		// The rotation part of each dual quaternion is a unit quaternion.
+		CHECK_NEAR(XMVectorGetX(XMVector4Length(XMLoadFloat4(&palette[i*2]))), 1.0f, 1e-5f);
+	}
+
+	CHECK(rotationError <= rotationBound);
+	CHECK(translationError <= translationBound);
+}
+
+TEST_CASE(DualQuaternionKeepsAnimatedPose)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 60));
+
+	const CompiledAnimationClip* clip = skinned.FindClip("Walk");
+	CHECK(clip != nullptr);
+	if( clip == nullptr )
+		return;
+
+	UINT boneCount = skinned.BoneCount();
+	AnimationWorkspace workspace;
+	std::vector<XMFLOAT4X4> finalTransforms(boneCount);
+	std::vector<XMFLOAT4> palette(boneCount * 2);
+	std::vector<XMFLOAT4X4> unpacked(boneCount);
+
+	// The test skeleton has no scale, so every bone is rigid.
+	for(float t = 0.0f; t < clip->GetClipEndTime(); t += 0.05f)
+	{
+		skinned.GetFinalTransforms(clip, t, finalTransforms, workspace);
+
+		BonePalette::Pack(BonePalette::Format::DualQuaternion, finalTransforms.data(), boneCount, palette.data());
+		BonePalette::Unpack(BonePalette::Format::DualQuaternion, palette.data(), boneCount, unpacked.data());
+
+		float maxDiff = 0.0f;
+		for(UINT i = 0; i < boneCount; ++i)
+			maxDiff = MathHelper::Max(maxDiff, MaxDifference(finalTransforms[i], unpacked[i]));
+
+		CHECK(maxDiff <= 1e-4f);
+	}
+}
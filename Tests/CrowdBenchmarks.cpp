@@ -0,0 +1,87 @@
+#include "TestFramework.h"
+#include "TestCrowd.h"
+#include <string>
+#include <thread>
+
+namespace
+{
+	const UINT CrowdSize = 1000;
+	const UINT FramesPerRun = 60;
+	const float FrameTime = 1.0f / 60.0f;
+
+	// Milliseconds per frame for the crowd's updater, best of five runs.
+	double MeasureFrameTime(TestCrowd& crowd, JobSystem* jobs, const AnimationLodPolicy* lod)
+	{
+		SkinnedInstanceUpdater updater(&crowd.Instances, jobs, false);
+		crowd.Connect(updater, lod);
+
+		// One warm-up frame sizes the workspaces and fills the cache.
+		updater.Update(FrameTime, crowd.SceneCamera);
+
+		return MeasureMilliseconds([&]() {
+			for(UINT frame = 0; frame < FramesPerRun; ++frame)
+				updater.Update(FrameTime, crowd.SceneCamera);
+		}) / FramesPerRun;
+	}
+}
+
+BENCHMARK(CrowdThreadScaling)
+{
+	TestCrowd crowd;
+	if( !crowd.Load() )
+		return;
+
+	crowd.Populate(CrowdSize, false);
+
+	// Every instance posed every frame, so the work is the same at any
+	// thread count.  Counts up to four run even on smaller machines, where
+	// they show what the pool costs when it cannot help.
+	UINT hardwareThreads = MathHelper::Max(std::thread::hardware_concurrency(), 1u);
+	UINT maxThreads = MathHelper::Max(hardwareThreads, 4u);
+	for(UINT threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ?
+		maxThreads : threads * 2)
+	{
+		std::unique_ptr<JobSystem> jobs;
+		if( threads > 1 )
+			jobs = std::make_unique<JobSystem>(threads - 1);
+
+		std::string what = std::to_string(CrowdSize) + " soldiers, " + std::to_string(threads) + " thread(s)";
+		if( threads > hardwareThreads )
+			what += ", oversubscribed";
+		TestRegistry::Report(what.c_str(), MeasureFrameTime(crowd, jobs.get(), nullptr), "ms/frame");
+	}
+}
+
+BENCHMARK(CrowdAnimationLod)
+{
+	TestCrowd crowd;
+	if( !crowd.Load() )
+		return;
+
+	// The app's levels with leaf skipping turned off, to tell its share of
+	// the savings from the slower updates.
+	std::vector<AnimationLodPolicy::Level> levels;
+	for(UINT i = 0; i < crowd.AnimationLod.LevelCount(); ++i)
+	{
+		levels.push_back(crowd.AnimationLod.GetLevel(i));
+		levels.back().SkipLeafBones = false;
+	}
+	AnimationLodPolicy noLeafSkipping(levels);
+
+	for(bool usePoseCache : { false, true })
+	{
+		std::string crowdName = std::to_string(CrowdSize) + (usePoseCache ? " soldiers, cached" : " soldiers, uncached");
+
+		crowd.Populate(CrowdSize, usePoseCache);
+		TestRegistry::Report((crowdName + ", no LOD").c_str(),
+			MeasureFrameTime(crowd, nullptr, nullptr), "ms/frame");
+
+		crowd.Populate(CrowdSize, usePoseCache);
+		TestRegistry::Report((crowdName + ", LOD without leaf skipping").c_str(),
+			MeasureFrameTime(crowd, nullptr, &noLeafSkipping), "ms/frame");
+
+		crowd.Populate(CrowdSize, usePoseCache);
+		TestRegistry::Report((crowdName + ", LOD").c_str(),
+			MeasureFrameTime(crowd, nullptr, &crowd.AnimationLod), "ms/frame");
+	}
+}
@@ -0,0 +1,445 @@
+#include "TestFramework.h"
+#include "TestM3d.h"
+#include "TestSkeleton.h"
+#include "TestSoldier.h"
+#include "../Init_Direct3D/LoadM3d.h"
+#include "../Init_Direct3D/M3dBinary.h"
+#include "../Init_Direct3D/MeshOptimizer.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// Written next to the test binary and removed again by each test.
+	const char* TestFilename = "LoaderTests.m3d";
+	const char* BinaryFilename = "LoaderTests.m3db";
+
+	using TestSkeleton::MaxDifference;
+
+	bool LoadSkinned(const TestM3d::Options& options, SkinnedData& skinInfo)
+	{
+		if( !TestM3d::Write(TestFilename, options) )
+			return false;
+
+		std::vector<M3DLoader::SkinnedVertex> vertices;
+		std::vector<USHORT> indices;
+		std::vector<M3DLoader::Subset> subsets;
+		std::vector<M3DLoader::M3dMaterial> mats;
+
+		M3DLoader loader;
+		bool loaded = loader.LoadM3d(TestFilename, vertices, indices, subsets, mats, skinInfo);
+
+		std::remove(TestFilename);
+		return loaded;
+	}
+
+	bool LoadSkinned(const TestM3d::Options& options)
+	{
+		SkinnedData skinInfo;
+		return LoadSkinned(options, skinInfo);
+	}
+
+	struct SkinnedModel
+	{
+		std::vector<M3DLoader::SkinnedVertex> Vertices;
+		std::vector<USHORT> Indices;
+		std::vector<M3DLoader::Subset> Subsets;
+		std::vector<M3DLoader::M3dMaterial> Mats;
+		SkinnedData SkinInfo;
+
+		// M3DLoader::GetParallelSectionCount after the load.
+		UINT ParallelSections = 0;
+	};
+
+	bool LoadText(const std::string& filename, JobSystem* jobs, SkinnedModel& model)
+	{
+		M3DLoader loader;
+		loader.SetJobSystem(jobs);
+		bool loaded = loader.LoadM3d(filename, model.Vertices, model.Indices, model.Subsets, model.Mats,
+			model.SkinInfo);
+
+		model.ParallelSections = loader.GetParallelSectionCount();
+		return loaded;
+	}
+
+	// Same mesh bytes, skeleton and poses.
+	bool SameModel(const SkinnedModel& a, const SkinnedModel& b)
+	{
+		if( a.Vertices.size() != b.Vertices.size() || a.Indices.size() != b.Indices.size() ||
+			std::memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(M3DLoader::SkinnedVertex)) != 0 ||
+			std::memcmp(a.Indices.data(), b.Indices.data(), a.Indices.size() * sizeof(USHORT)) != 0 ||
+			a.SkinInfo.GetSkeletonSignature() != b.SkinInfo.GetSkeletonSignature() ||
+			a.SkinInfo.GetClipNames() != b.SkinInfo.GetClipNames() )
+			return false;
+
+		AnimationWorkspace workspace;
+		std::vector<XMFLOAT4X4> poseA(a.SkinInfo.BoneCount());
+		std::vector<XMFLOAT4X4> poseB(b.SkinInfo.BoneCount());
+		for(const std::string& name : a.SkinInfo.GetClipNames())
+		{
+			const CompiledAnimationClip* clipA = a.SkinInfo.FindClip(name);
+			const CompiledAnimationClip* clipB = b.SkinInfo.FindClip(name);
+			for(float t = clipA->GetClipStartTime(); t <= clipA->GetClipEndTime(); t += 0.05f)
+			{
+				a.SkinInfo.GetFinalTransforms(clipA, t, poseA, workspace);
+				b.SkinInfo.GetFinalTransforms(clipB, t, poseB, workspace);
+				if( MaxDifference(poseA, poseB) != 0.0f )
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool LoadStatic(const TestM3d::Options& options)
+	{
+		if( !TestM3d::Write(TestFilename, options) )
+			return false;
+
+		std::vector<M3DLoader::Vertex> vertices;
+		std::vector<USHORT> indices;
+		std::vector<M3DLoader::Subset> subsets;
+		std::vector<M3DLoader::M3dMaterial> mats;
+
+		M3DLoader loader;
+		bool loaded = loader.LoadM3d(TestFilename, vertices, indices, subsets, mats);
+
+		std::remove(TestFilename);
+		return loaded;
+	}
+}
+
+TEST_CASE(SkinnedTextLoads)
+{
+	CHECK(LoadSkinned(TestM3d::Options()));
+}
+
+TEST_CASE(BoneIndexPastSkeletonFailsLoad)
+{
+	TestM3d::Options options;
+	options.BadBoneIndex = true;
+	CHECK(!LoadSkinned(options));
+}
+
+TEST_CASE(BoneOffsetLabelsAreNotNames)
+{
+	TestM3d::Options options;
+
+	SkinnedData a;
+	SkinnedData b;
+	CHECK(LoadSkinned(options, a));
+	CHECK(LoadSkinned(options, b));
+
+	// "BoneOffsetN" only repeats the bone index, so nothing matches by name.
+	for(const std::string& name : a.GetBoneNames())
+		CHECK(name.empty());
+
+	RetargetMap map;
+	CHECK(!a.BuildRetargetMap(b, map));
+
+	// Names from the caller make the same skeletons match.
+	std::vector<std::string> names;
+	for(UINT i = 0; i < options.Bones; ++i)
+		names.push_back("bone" + std::to_string(i));
+
+	CHECK(!a.SetBoneNames(std::vector<std::string>(options.Bones + 1)));
+	CHECK(a.SetBoneNames(names));
+	CHECK(b.SetBoneNames(names));
+	CHECK(a.BuildRetargetMap(b, map));
+	CHECK(map.MatchedBoneCount == options.Bones);
+}
+
+TEST_CASE(TruncatedTextFailsLoad)
+{
+	TestM3d::Options options;
+	options.Truncate = true;
+	CHECK(!LoadSkinned(options));
+
+	options.Skinned = false;
+	CHECK(!LoadStatic(options));
+
+	options.Truncate = false;
+	CHECK(LoadStatic(options));
+}
+
+TEST_CASE(ParallelParseMatchesSequential)
+{
+	// Three chunks of vertices and of triangles.
+	TestM3d::Options options;
+	options.Vertices = M3DLoader::ParseGrainSize * 2 + 100;
+	CHECK(TestM3d::Write(TestFilename, options));
+
+	JobSystem jobs(3);
+	SkinnedModel sequential;
+	SkinnedModel parallel;
+	CHECK(LoadText(TestFilename, nullptr, sequential));
+	CHECK(LoadText(TestFilename, &jobs, parallel));
+	std::remove(TestFilename);
+
+	// Vertices, triangles and the one clip.
+	CHECK(sequential.ParallelSections == 0);
+	CHECK(parallel.ParallelSections == 3);
+	CHECK(SameModel(parallel, sequential));
+}
+
+TEST_CASE(MovedLineBreaksFallBackToSequentialParse)
+{
+	TestM3d::Options options;
+	options.Vertices = M3DLoader::ParseGrainSize * 2 + 100;
+	CHECK(TestM3d::Write(TestFilename, options));
+
+	SkinnedModel reference;
+	CHECK(LoadText(TestFilename, nullptr, reference));
+
+	// The same tokens, but records no longer one per line: every chunk
+	// boundary is off, so every section is parsed in order.
+	options.MovedLineBreaks = true;
+	CHECK(TestM3d::Write(TestFilename, options));
+
+	JobSystem jobs(3);
+	SkinnedModel parallel;
+	CHECK(LoadText(TestFilename, &jobs, parallel));
+	std::remove(TestFilename);
+
+	CHECK(parallel.ParallelSections == 0);
+	CHECK(SameModel(parallel, reference));
+}
+
+TEST_CASE(BinaryLoadMatchesText)
+{
+	TestM3d::Options options;
+	options.Vertices = 300;
+	options.Bones = 9;
+	CHECK(TestM3d::Write(TestFilename, options));
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+
+	M3DLoader loader;
+	CHECK(loader.LoadM3d(TestFilename, vertices, indices, subsets, mats, skinInfo));
+	CHECK(loader.ConvertM3d(TestFilename, BinaryFilename));
+
+	// The binary holds what the app drew from the text file: the same
+	// skeleton and the subsets optimized.
+	for(const M3DLoader::Subset& subset : subsets)
+	{
+		MeshOptimizer::OptimizeRange(vertices.data(), subset.VertexStart, subset.VertexCount,
+			indices.data() + subset.FaceStart * 3, subset.FaceCount * 3);
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> copiedVertices;
+	std::vector<USHORT> copiedIndices;
+	std::vector<M3DLoader::Subset> copiedSubsets;
+	std::vector<M3DLoader::M3dMaterial> copiedMats;
+	SkinnedData copiedSkinInfo;
+	CHECK(loader.LoadM3dBinary(BinaryFilename, copiedVertices, copiedIndices, copiedSubsets, copiedMats,
+		copiedSkinInfo, TestFilename));
+
+	M3dBinaryFile file;
+	std::vector<M3DLoader::Subset> mappedSubsets;
+	std::vector<M3DLoader::M3dMaterial> mappedMats;
+	SkinnedData mappedSkinInfo;
+	CHECK(loader.OpenM3dBinary(BinaryFilename, file, mappedSubsets, mappedMats, mappedSkinInfo, TestFilename));
+
+	const size_t vertexBytes = vertices.size() * sizeof(M3DLoader::SkinnedVertex);
+	const size_t indexBytes = indices.size() * sizeof(USHORT);
+
+	CHECK(copiedVertices.size() == vertices.size());
+	CHECK(copiedIndices.size() == indices.size());
+	CHECK(std::memcmp(copiedVertices.data(), vertices.data(), vertexBytes) == 0);
+	CHECK(std::memcmp(copiedIndices.data(), indices.data(), indexBytes) == 0);
+
+	CHECK(file.GetHeader().VertexCount == vertices.size());
+	CHECK(file.GetHeader().IndexCount == indices.size());
+	CHECK(std::memcmp(file.GetVertices(), vertices.data(), vertexBytes) == 0);
+	CHECK(std::memcmp(file.GetIndices(), indices.data(), indexBytes) == 0);
+	CHECK(file.CheckMeshIndices());
+
+	CHECK(mappedSubsets.size() == subsets.size() && mappedMats.size() == mats.size());
+	for(size_t i = 0; i < subsets.size() && i < mappedSubsets.size(); ++i)
+	{
+		CHECK(mappedSubsets[i].VertexStart == subsets[i].VertexStart);
+		CHECK(mappedSubsets[i].VertexCount == subsets[i].VertexCount);
+		CHECK(mappedSubsets[i].FaceStart == subsets[i].FaceStart);
+		CHECK(mappedSubsets[i].FaceCount == subsets[i].FaceCount);
+	}
+	for(size_t i = 0; i < mats.size() && i < mappedMats.size(); ++i)
+	{
+		CHECK(mappedMats[i].Name == mats[i].Name);
+		CHECK(mappedMats[i].DiffuseMapName == mats[i].DiffuseMapName);
+		CHECK(mappedMats[i].Roughness == mats[i].Roughness);
+	}
+
+	// Stored in compiled order, so nothing is renumbered on the way in.
+	for(UINT i = 0; i < mappedSkinInfo.BoneCount(); ++i)
+		CHECK(mappedSkinInfo.GetBoneRemap()[i] == i);
+
+	CHECK(mappedSkinInfo.GetSkeletonSignature() == skinInfo.GetSkeletonSignature());
+	CHECK(copiedSkinInfo.GetSkeletonSignature() == skinInfo.GetSkeletonSignature());
+
+	const CompiledAnimationClip* clip = skinInfo.FindClip("Take1");
+	const CompiledAnimationClip* mappedClip = mappedSkinInfo.FindClip("Take1");
+	CHECK(clip != nullptr && mappedClip != nullptr);
+	if( clip != nullptr && mappedClip != nullptr )
+	{
+		AnimationWorkspace workspace;
+		std::vector<XMFLOAT4X4> expected(skinInfo.BoneCount());
+		std::vector<XMFLOAT4X4> mapped(skinInfo.BoneCount());
+		for(float t = 0.0f; t <= 1.0f; t += 0.1f)
+		{
+			skinInfo.GetFinalTransforms(clip, t, expected, workspace);
+			mappedSkinInfo.GetFinalTransforms(mappedClip, t, mapped, workspace);
+			CHECK(MaxDifference(mapped, expected) == 0.0f);
+		}
+	}
+
+	// A mapped file cannot be removed on Windows.
+	file.Close();
+	std::remove(TestFilename);
+	std::remove(BinaryFilename);
+}
+
+TEST_CASE(BinaryMeshIndicesAreCheckedOnlyOnRequest)
+{
+	TestM3d::Options options;
+	CHECK(TestM3d::Write(TestFilename, options));
+
+	M3DLoader loader;
+	CHECK(loader.ConvertM3d(TestFilename, BinaryFilename));
+	std::remove(TestFilename);
+
+	// Point the first index past the vertices.
+	{
+		std::fstream binary(BinaryFilename, std::ios::in | std::ios::out | std::ios::binary);
+		M3dBinaryFile::Header header = {};
+		binary.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+		const USHORT badIndex = (USHORT)header.VertexCount;
+		binary.seekp(header.IndexOffset);
+		binary.write(reinterpret_cast<const char*>(&badIndex), sizeof(badIndex));
+		CHECK((bool)binary);
+	}
+
+	// Open reads the skeleton only; the mesh is checked when asked for or
+	// when it is copied out.
+	M3dBinaryFile file;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+	CHECK(loader.OpenM3dBinary(BinaryFilename, file, subsets, mats, skinInfo));
+	CHECK(!file.CheckMeshIndices());
+	file.Close();
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	CHECK(!loader.LoadM3dBinary(BinaryFilename, vertices, indices, subsets, mats, skinInfo));
+
+	std::remove(BinaryFilename);
+}
+
+BENCHMARK(BinaryLoad)
+{
+	const char* binaryFilename = "BinaryLoad.m3db";
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+	if( !TestSoldier::Load(vertices, indices, skinInfo) )
+		return;
+
+	M3DLoader loader;
+	if( !loader.ConvertM3d(TestSoldier::Filename, binaryFilename) )
+		return;
+
+	double text = MeasureMilliseconds([&]() {
+		loader.LoadM3d(TestSoldier::Filename, vertices, indices, subsets, mats, skinInfo);
+	});
+
+	// The first run converts the text file; later runs only map the binary.
+	double cold = MeasureMilliseconds([&]() {
+		M3dBinaryFile file;
+		loader.ConvertM3d(TestSoldier::Filename, binaryFilename);
+		loader.OpenM3dBinary(binaryFilename, file, subsets, mats, skinInfo);
+	});
+	double copied = MeasureMilliseconds([&]() {
+		loader.LoadM3dBinary(binaryFilename, vertices, indices, subsets, mats, skinInfo);
+	});
+	double mapped = MeasureMilliseconds([&]() {
+		M3dBinaryFile file;
+		loader.OpenM3dBinary(binaryFilename, file, subsets, mats, skinInfo);
+	});
+
+	M3dBinaryFile file;
+	loader.OpenM3dBinary(binaryFilename, file, subsets, mats, skinInfo);
+	double check = MeasureMilliseconds([&]() { file.CheckMeshIndices(); });
+	file.Close();
+
+	std::remove(binaryFilename);
+
+	TestRegistry::Report("text LoadM3d", text, "ms");
+	TestRegistry::Report("cold: ConvertM3d + OpenM3dBinary", cold, "ms");
+	TestRegistry::Report("warm: LoadM3dBinary, copied", copied, "ms");
+	TestRegistry::Report("warm: OpenM3dBinary, mapped views", mapped, "ms");
+	TestRegistry::Report("CheckMeshIndices, skipped by Open", check, "ms");
+}
+
+BENCHMARK(TextParseScaling)
+{
+	const char* syntheticFilename = "TextParseScaling.m3d";
+
+	// Near the 16 bit index limit, with long clips.
+	TestM3d::Options options;
+	options.Vertices = 60000;
+	options.Bones = 60;
+	options.Keyframes = 400;
+	if( !TestM3d::Write(syntheticFilename, options) )
+		return;
+
+	struct File
+	{
+		const char* Name;
+		std::string Filename;
+	};
+	std::vector<File> files = { { "soldier.m3d", TestSoldier::Filename },
+		{ "60k vertices", syntheticFilename } };
+
+	UINT hardwareThreads = MathHelper::Max(std::thread::hardware_concurrency(), 1u);
+	UINT maxThreads = MathHelper::Max(hardwareThreads, 4u);
+
+	for(const File& file : files)
+	{
+		SkinnedModel model;
+		if( !LoadText(file.Filename, nullptr, model) )
+		{
+			std::printf("  %s did not load, skipped\n", file.Filename.c_str());
+			continue;
+		}
+
+		// One thread is the loader without a job system.
+		for(UINT threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ?
+			maxThreads : threads * 2)
+		{
+			std::unique_ptr<JobSystem> jobs;
+			if( threads > 1 )
+				jobs = std::make_unique<JobSystem>(threads - 1);
+
+			double parallel = MeasureMilliseconds([&]() { LoadText(file.Filename, jobs.get(), model); });
+
+			std::string what = std::string(file.Name) + ", " + std::to_string(threads) + " thread(s)";
+			if( threads > hardwareThreads )
+				what += ", oversubscribed";
+			TestRegistry::Report(what.c_str(), parallel, "ms");
+		}
+	}
+
+	std::remove(syntheticFilename);
+}
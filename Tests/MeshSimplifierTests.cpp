@@ -0,0 +1,279 @@
+#include "TestFramework.h"
+#include "../Init_Direct3D/MeshSimplifier.h"
+#include "TestMeshes.h"
+#include <algorithm>
+
+using namespace DirectX;
+using TestMeshes::ToVertices;
+
+namespace
+{
+	const float ViewportHeight = 1000.0f;
+	const float MaxPixelError = 1.0f;
+
+	// Closest point of triangle abc to p, from Ericson's Real-Time
+	// Collision Detection.
+	XMVECTOR ClosestPointOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+
+		XMVECTOR ap = XMVectorSubtract(p, a);
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if( d1 <= 0.0f && d2 <= 0.0f )
+			return a;
+
+		XMVECTOR bp = XMVectorSubtract(p, b);
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if( d3 >= 0.0f && d4 <= d3 )
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f )
+			return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+
+		XMVECTOR cp = XMVectorSubtract(p, c);
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if( d6 >= 0.0f && d5 <= d6 )
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f )
+			return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+
+		float va = d3 * d6 - d5 * d4;
+		if( va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f )
+			return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		float denom = 1.0f / (va + vb + vc);
+		return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denom), XMVectorScale(ac, vc * denom)));
+	}
+
+	// The largest distance from a vertex of the original mesh to the
+	// nearest triangle of the LOD, anywhere on it.  The simplifier only
+	// looks near where each vertex went, so it never reports less.
+	float DistanceToLod(const std::vector<Vertex>& vertices, const std::vector<UINT>& chain, const MeshLod& lod)
+	{
+		float maxDistance = 0.0f;
+		for(const Vertex& v : vertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&v.Pos);
+			float nearest = MathHelper::Infinity;
+
+			for(UINT i = lod.StartIndexLocation; i < lod.StartIndexLocation + lod.IndexCount; i += 3)
+			{
+				XMVECTOR q = ClosestPointOnTriangle(p,
+					XMLoadFloat3(&vertices[chain[i + 0]].Pos),
+					XMLoadFloat3(&vertices[chain[i + 1]].Pos),
+					XMLoadFloat3(&vertices[chain[i + 2]].Pos));
+				nearest = MathHelper::Min(nearest, XMVectorGetX(XMVector3Length(XMVectorSubtract(p, q))));
+			}
+
+			maxDistance = MathHelper::Max(maxDistance, nearest);
+		}
+		return maxDistance;
+	}
+
+	float LodArea(const std::vector<Vertex>& vertices, const std::vector<UINT>& chain, const MeshLod& lod)
+	{
+		float area = 0.0f;
+		for(UINT i = lod.StartIndexLocation; i < lod.StartIndexLocation + lod.IndexCount; i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[chain[i + 0]].Pos);
+			XMVECTOR b = XMLoadFloat3(&vertices[chain[i + 1]].Pos);
+			XMVECTOR c = XMLoadFloat3(&vertices[chain[i + 2]].Pos);
+			area += 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a))));
+		}
+		return area;
+	}
+
+	void CheckLodChain(const GeometryGenerator::MeshData& mesh)
+	{
+		std::vector<Vertex> vertices = ToVertices(mesh);
+
+		BoundingSphere bounds;
+		BoundingSphere::CreateFromPoints(bounds, vertices.size(), &vertices.data()->Pos, sizeof(Vertex));
+		const float maxError = 0.1f * bounds.Radius;
+
+		std::vector<UINT> chain;
+		std::vector<MeshLod> lods;
+		MeshSimplifier::BuildLodChain(vertices, mesh.Indices32, maxError, chain, lods);
+
+		CHECK(lods.size() >= 2 && lods.size() <= MeshSimplifier::MaxLods);
+		if( lods.empty() )
+			return;
+
+		CHECK(lods[0].StartIndexLocation == 0);
+		CHECK(lods[0].IndexCount == mesh.Indices32.size());
+		CHECK(lods[0].Error == 0.0f);
+
+		bool inRange = true;
+		for(UINT index : chain)
+			inRange = inRange && index < vertices.size();
+		CHECK(inRange);
+
+		for(size_t i = 1; i < lods.size(); ++i)
+		{
+			const MeshLod& lod = lods[i];
+			const MeshLod& previous = lods[i - 1];
+
+			// Each LOD follows the one before in the chain and is at least a
+			// fifth smaller.
+			CHECK(lod.StartIndexLocation == previous.StartIndexLocation + previous.IndexCount);
+			CHECK(lod.IndexCount > 0 && lod.IndexCount % 3 == 0);
+			CHECK(lod.IndexCount <= previous.IndexCount * 0.8f);
+
+			CHECK(lod.Error >= previous.Error);
+			CHECK(lod.Error <= maxError);
+			CHECK(DistanceToLod(vertices, chain, lod) <= lod.Error + 1e-5f * bounds.Radius);
+
+			bool noDegenerate = true;
+			for(UINT j = lod.StartIndexLocation; j < lod.StartIndexLocation + lod.IndexCount; j += 3)
+				noDegenerate = noDegenerate && chain[j] != chain[j + 1] && chain[j + 1] != chain[j + 2] && chain[j] != chain[j + 2];
+			CHECK(noDegenerate);
+		}
+
+		CHECK(lods.back().StartIndexLocation + lods.back().IndexCount == chain.size());
+
+		// 16 bit indices give the same chain.
+		GeometryGenerator::MeshData copy = mesh;
+		std::vector<std::uint16_t> chain16;
+		std::vector<MeshLod> lods16;
+		MeshSimplifier::BuildLodChain(vertices, copy.GetIndices16(), maxError, chain16, lods16);
+		CHECK(lods16.size() == lods.size());
+		CHECK(std::equal(chain.begin(), chain.end(), chain16.begin(), chain16.end()));
+	}
+
+	struct LodScene
+	{
+		GeometryInfo Geo;
+		std::vector<UINT> Chain;
+
+		LodScene()
+		{
+			GeometryGenerator geoGen;
+			GeometryGenerator::MeshData mesh = geoGen.CreateSphere(2.0f, 40, 40);
+			std::vector<Vertex> vertices = ToVertices(mesh);
+
+			BoundingSphere::CreateFromPoints(Geo.LodBounds, vertices.size(), &vertices.data()->Pos, sizeof(Vertex));
+			MeshSimplifier::BuildLodChain(vertices, mesh.Indices32, 0.1f * Geo.LodBounds.Radius, Chain, Geo.Lods);
+		}
+	};
+
+	Camera LookingAt(const XMFLOAT3& center, float distance)
+	{
+		Camera camera;
+		camera.SetLens(0.25f * MathHelper::Pi, 1.5f, 1.0f, 1000.0f);
+		camera.LookAt(XMFLOAT3(center.x, center.y, center.z - distance), center, XMFLOAT3(0.0f, 1.0f, 0.0f));
+		camera.UpdateViewMatrix();
+		return camera;
+	}
+
+	// Pixels the error of lod covers, seen from distance in front of the
+	// nearest point of the bounds.
+	float PixelError(const MeshLod& lod, float scale, float distance, const Camera& camera)
+	{
+		distance = MathHelper::Max(distance, camera.GetNearZ());
+		return lod.Error * scale * ViewportHeight / (2.0f * distance * tanf(0.5f * camera.GetFovY()));
+	}
+}
+
+TEST_CASE(LodChainsShrinkWithinError)
+{
+	GeometryGenerator geoGen;
+
+	CheckLodChain(geoGen.CreateSphere(1.0f, 40, 40));
+	CheckLodChain(geoGen.CreateGeosphere(2.0f, 3));
+	CheckLodChain(geoGen.CreateCylinder(1.0f, 0.5f, 4.0f, 40, 10));
+}
+
+TEST_CASE(FlatGridLodsKeepTheirOutline)
+{
+	// Interior vertices of a plane collapse for free; the locked border
+	// keeps every LOD covering exactly the grid.
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData grid = geoGen.CreateGrid(10.0f, 20.0f, 24, 24);
+	std::vector<Vertex> vertices = ToVertices(grid);
+
+	std::vector<UINT> chain;
+	std::vector<MeshLod> lods;
+	MeshSimplifier::BuildLodChain(vertices, grid.Indices32, 0.5f, chain, lods);
+
+	CHECK(lods.size() >= 2);
+	for(const MeshLod& lod : lods)
+	{
+		CHECK(lod.Error <= 1e-5f);
+		CHECK_NEAR(LodArea(vertices, chain, lod), 200.0f, 1e-2f);
+	}
+}
+
+TEST_CASE(SelectLodFollowsScreenError)
+{
+	LodScene scene;
+	const GeometryInfo& geo = scene.Geo;
+	CHECK(geo.Lods.size() >= 3);
+
+	const XMFLOAT3 center(3.0f, -1.0f, 8.0f);
+	const float radius = geo.LodBounds.Radius;
+
+	// Model space bounds are centred near the origin; move them out to center.
+	XMMATRIX world = XMMatrixTranslation(center.x - geo.LodBounds.Center.x,
+		center.y - geo.LodBounds.Center.y, center.z - geo.LodBounds.Center.z);
+	XMMATRIX scaledWorld = XMMatrixScaling(3.0f, 3.0f, 3.0f) * world;
+
+	// Up close the full mesh, far away the coarsest LOD.
+	CHECK(MeshSimplifier::SelectLod(geo, world, LookingAt(center, 0.5f * radius), ViewportHeight, MaxPixelError) == 0);
+	CHECK(MeshSimplifier::SelectLod(geo, world, LookingAt(center, 1.5f * radius), ViewportHeight, MaxPixelError) == 0);
+	CHECK(MeshSimplifier::SelectLod(geo, world, LookingAt(center, 5000.0f), ViewportHeight, MaxPixelError) ==
+		geo.Lods.size() - 1);
+
+	UINT previous = 0;
+	bool monotonic = true;
+	bool coarsestWithinError = true;
+	bool scaledNotCoarser = true;
+
+	for(float distance = 0.5f; distance < 1000.0f; distance += 2.5f)
+	{
+		Camera camera = LookingAt(center, distance);
+		UINT lod = MeshSimplifier::SelectLod(geo, world, camera, ViewportHeight, MaxPixelError);
+
+		monotonic = monotonic && lod >= previous;
+		previous = lod;
+
+		// The chosen LOD is within the pixel error, the next one is not.
+		float surfaceDistance = distance - radius;
+		if( lod > 0 )
+			coarsestWithinError = coarsestWithinError &&
+				PixelError(geo.Lods[lod], 1.0f, surfaceDistance, camera) <= MaxPixelError * 1.0001f;
+		if( lod + 1 < geo.Lods.size() )
+			coarsestWithinError = coarsestWithinError &&
+				PixelError(geo.Lods[lod + 1], 1.0f, surfaceDistance, camera) >= MaxPixelError * 0.9999f;
+
+		// A bigger instance at the same place needs at least as fine a LOD.
+		scaledNotCoarser = scaledNotCoarser &&
+			MeshSimplifier::SelectLod(geo, scaledWorld, camera, ViewportHeight, MaxPixelError) <= lod;
+	}
+
+	CHECK(monotonic);
+	CHECK(coarsestWithinError);
+	CHECK(scaledNotCoarser);
+	CHECK(previous == geo.Lods.size() - 1);
+}
+
+TEST_CASE(SelectLodWithoutLods)
+{
+	LodScene scene;
+	GeometryInfo geo;
+	geo.LodBounds = scene.Geo.LodBounds;
+
+	Camera camera = LookingAt(XMFLOAT3(0.0f, 0.0f, 0.0f), 5000.0f);
+
+	// No LODs at all, and only the full mesh.
+	CHECK(MeshSimplifier::SelectLod(geo, XMMatrixIdentity(), camera, ViewportHeight, MaxPixelError) == 0);
+
+	geo.Lods.assign(1, scene.Geo.Lods[0]);
+	CHECK(MeshSimplifier::SelectLod(geo, XMMatrixIdentity(), camera, ViewportHeight, MaxPixelError) == 0);
+}
@@ -0,0 +1,309 @@
+#include "TestFramework.h"
+#include "../Init_Direct3D/D3dHeader.h"
+#include "../Init_Direct3D/MeshletBuilder.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+
+using namespace DirectX;
+using TestMeshes::ToVertices;
+
+namespace
+{
+	typedef std::array<UINT, 3> Triangle;
+
+	// The mesh triangles of meshlets [first, last), in mesh vertex indices.
+	std::vector<Triangle> MeshletTriangles(const MeshletBuilder::MeshletSet& set, size_t first, size_t last)
+	{
+		std::vector<Triangle> triangles;
+		for(size_t m = first; m < last; ++m)
+		{
+			const MeshletBuilder::Meshlet& meshlet = set.Meshlets[m];
+			for(UINT t = 0; t < meshlet.TriangleCount; ++t)
+			{
+				Triangle tri;
+				for(int k = 0; k < 3; ++k)
+				{
+					BYTE local = set.Triangles[(meshlet.TriangleOffset + t) * 3 + k];
+					tri[k] = set.VertexIndices[meshlet.VertexOffset + local];
+				}
+				triangles.push_back(tri);
+			}
+		}
+		return triangles;
+	}
+
+	std::vector<Triangle> MeshTriangles(const std::vector<UINT>& indices, size_t first, size_t last)
+	{
+		std::vector<Triangle> triangles;
+		for(size_t i = first; i < last; i += 3)
+			triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+		return triangles;
+	}
+
+	// Same triangles, same corner order, each used once.
+	bool SameTriangles(std::vector<Triangle> a, std::vector<Triangle> b)
+	{
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		return a == b;
+	}
+
+	void CheckLimits(const MeshletBuilder::MeshletSet& set, UINT maxVertices, UINT maxTriangles)
+	{
+		CHECK(!set.Meshlets.empty());
+		CHECK(set.Bounds.size() == set.Meshlets.size());
+
+		bool withinLimits = true;
+		bool validLocals = true;
+		bool packed = true;
+		UINT vertexOffset = 0;
+		UINT triangleOffset = 0;
+
+		for(const MeshletBuilder::Meshlet& meshlet : set.Meshlets)
+		{
+			withinLimits = withinLimits &&
+				meshlet.VertexCount >= 3 && meshlet.VertexCount <= maxVertices &&
+				meshlet.TriangleCount >= 1 && meshlet.TriangleCount <= maxTriangles;
+
+			// Meshlets follow each other in both lists.
+			packed = packed && meshlet.VertexOffset == vertexOffset && meshlet.TriangleOffset == triangleOffset;
+			vertexOffset += meshlet.VertexCount;
+			triangleOffset += meshlet.TriangleCount;
+
+			for(UINT i = 0; i < meshlet.TriangleCount * 3; ++i)
+				validLocals = validLocals && set.Triangles[meshlet.TriangleOffset * 3 + i] < meshlet.VertexCount;
+		}
+
+		CHECK(withinLimits);
+		CHECK(validLocals);
+		CHECK(packed);
+		CHECK(vertexOffset == set.VertexIndices.size());
+		CHECK(triangleOffset * 3 == set.Triangles.size());
+	}
+
+	// A camera going round the mesh, close enough for part of it to fall
+	// outside the frustum.
+	Camera OrbitCamera(const XMFLOAT3& center, float distance, float angle, float height)
+	{
+		XMFLOAT3 eye(center.x + distance * sinf(angle), center.y + height, center.z - distance * cosf(angle));
+
+		Camera camera;
+		camera.SetLens(0.25f * MathHelper::Pi, 1.5f, 1.0f, 1000.0f);
+		camera.LookAt(eye, center, XMFLOAT3(0.0f, 1.0f, 0.0f));
+		camera.UpdateViewMatrix();
+		return camera;
+	}
+
+	struct CullCheck
+	{
+		UINT FrustumCulled = 0;
+		UINT BackfaceCulled = 0;
+		UINT Visible = 0;
+		bool CulledCorrectly = true;
+		bool VisibleListed = true;
+	};
+
+	// Checks every culled meshlet against its own triangles, worked out
+	// here in world and clip space rather than from the meshlet bounds:
+	// either all of it is outside the frustum or none of it faces the eye.
+	void CheckCull(const MeshletBuilder::MeshletSet& set, const std::vector<Vertex>& vertices,
+		bool frontCounterClockwise, const Camera& camera, FXMMATRIX world, CullCheck& check)
+	{
+		std::vector<UINT> visible;
+		MeshletBuilder::CullStats stats = MeshletBuilder::Cull(set, MeshletBuilder::MakeCullFrustum(camera, world), &visible);
+
+		check.VisibleListed = check.VisibleListed && stats.Total == set.Meshlets.size() &&
+			visible.size() == stats.Total - stats.FrustumCulled - stats.BackfaceCulled;
+		check.FrustumCulled += stats.FrustumCulled;
+		check.BackfaceCulled += stats.BackfaceCulled;
+		check.Visible += (UINT)visible.size();
+
+		std::vector<bool> isVisible(set.Meshlets.size(), false);
+		for(UINT i : visible)
+			isVisible[i] = true;
+
+		XMMATRIX worldViewProj = world * camera.GetView() * camera.GetProj();
+		XMVECTOR eye = camera.GetPosition();
+
+		for(size_t m = 0; m < set.Meshlets.size(); ++m)
+		{
+			if( isVisible[m] )
+				continue;
+
+			const MeshletBuilder::Meshlet& meshlet = set.Meshlets[m];
+
+			// Frustum culled: every vertex is outside the same clip plane.
+			bool outside[6] = { true, true, true, true, true, true };
+			for(UINT j = 0; j < meshlet.VertexCount; ++j)
+			{
+				XMFLOAT4 c;
+				XMStoreFloat4(&c, XMVector4Transform(
+					XMVectorSetW(XMLoadFloat3(&vertices[set.VertexIndices[meshlet.VertexOffset + j]].Pos), 1.0f),
+					worldViewProj));
+
+				const float eps = 1e-4f * fabsf(c.w) + 1e-5f;
+				outside[0] = outside[0] && c.x < -c.w + eps;
+				outside[1] = outside[1] && c.x > c.w - eps;
+				outside[2] = outside[2] && c.y < -c.w + eps;
+				outside[3] = outside[3] && c.y > c.w - eps;
+				outside[4] = outside[4] && c.z < eps;
+				outside[5] = outside[5] && c.z > c.w - eps;
+			}
+
+			bool anyOutside = false;
+			for(int p = 0; p < 6; ++p)
+				anyOutside = anyOutside || outside[p];
+
+			// Back face culled: the eye is behind every triangle's plane.
+			bool allBackFacing = true;
+			for(UINT t = 0; t < meshlet.TriangleCount; ++t)
+			{
+				XMVECTOR p[3];
+				for(int k = 0; k < 3; ++k)
+				{
+					BYTE local = set.Triangles[(meshlet.TriangleOffset + t) * 3 + k];
+					p[k] = XMVector3TransformCoord(
+						XMLoadFloat3(&vertices[set.VertexIndices[meshlet.VertexOffset + local]].Pos), world);
+				}
+				if( frontCounterClockwise )
+					std::swap(p[1], p[2]);
+
+				XMVECTOR n = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+				if( XMVectorGetX(XMVector3LengthSq(n)) == 0.0f )
+					continue;
+
+				XMVECTOR toEye = XMVector3Normalize(XMVectorSubtract(eye, p[0]));
+				allBackFacing = allBackFacing && XMVectorGetX(XMVector3Dot(XMVector3Normalize(n), toEye)) <= 1e-4f;
+			}
+
+			check.CulledCorrectly = check.CulledCorrectly && (anyOutside || allBackFacing);
+		}
+	}
+}
+
+TEST_CASE(MeshletsStayWithinLimits)
+{
+	GeometryGenerator geoGen;
+	const GeometryGenerator::MeshData meshes[] =
+	{
+		geoGen.CreateSphere(1.0f, 60, 60),
+		geoGen.CreateGeosphere(2.0f, 4),
+		geoGen.CreateBox(2.0f, 3.0f, 4.0f, 3),
+		geoGen.CreateGrid(10.0f, 10.0f, 40, 40)
+	};
+
+	for(const GeometryGenerator::MeshData& mesh : meshes)
+	{
+		std::vector<Vertex> vertices = ToVertices(mesh);
+
+		MeshletBuilder::MeshletSet set;
+		MeshletBuilder::Build(vertices.data(), mesh.Indices32.data(), (UINT)mesh.Indices32.size(), set);
+		CheckLimits(set, MeshletBuilder::MaxVertices, MeshletBuilder::MaxTriangles);
+
+		// Smaller limits, and 16 bit indices.
+		MeshletBuilder::MeshletSet small;
+		GeometryGenerator::MeshData copy = mesh;
+		MeshletBuilder::Build(vertices.data(), copy.GetIndices16().data(), (UINT)copy.Indices32.size(), small,
+			false, 16, 20);
+		CheckLimits(small, 16, 20);
+
+		// The geosphere and box share no vertices between small patches, so
+		// smaller limits need not split them further.
+		CHECK(small.Meshlets.size() >= set.Meshlets.size());
+	}
+}
+
+TEST_CASE(MeshletsCoverEveryTriangleOnce)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh = geoGen.CreateSphere(2.0f, 60, 60);
+	std::vector<Vertex> vertices = ToVertices(mesh);
+
+	const std::vector<UINT>& indices = mesh.Indices32;
+	const size_t split = (indices.size() / 3 / 2) * 3;
+
+	// Two subsets into one set: each gets its own meshlets.
+	MeshletBuilder::MeshletSet set;
+	MeshletBuilder::Build(vertices.data(), indices.data(), (UINT)split, set);
+	const size_t firstCount = set.Meshlets.size();
+	MeshletBuilder::Build(vertices.data(), indices.data() + split, (UINT)(indices.size() - split), set);
+
+	CheckLimits(set, MeshletBuilder::MaxVertices, MeshletBuilder::MaxTriangles);
+	CHECK(firstCount > 0 && set.Meshlets.size() > firstCount);
+
+	CHECK(SameTriangles(MeshletTriangles(set, 0, firstCount), MeshTriangles(indices, 0, split)));
+	CHECK(SameTriangles(MeshletTriangles(set, firstCount, set.Meshlets.size()),
+		MeshTriangles(indices, split, indices.size())));
+
+	// No triangles, no meshlets.
+	MeshletBuilder::MeshletSet empty;
+	MeshletBuilder::Build(vertices.data(), indices.data(), 0, empty);
+	CHECK(empty.Meshlets.empty() && empty.Bounds.empty());
+}
+
+TEST_CASE(MeshletBoundsContainTheirVertices)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh = geoGen.CreateCylinder(1.0f, 0.5f, 4.0f, 40, 10);
+	std::vector<Vertex> vertices = ToVertices(mesh);
+
+	MeshletBuilder::MeshletSet set;
+	MeshletBuilder::Build(vertices.data(), mesh.Indices32.data(), (UINT)mesh.Indices32.size(), set);
+
+	bool contained = true;
+	for(size_t m = 0; m < set.Meshlets.size(); ++m)
+	{
+		const MeshletBuilder::Meshlet& meshlet = set.Meshlets[m];
+		const MeshletBuilder::MeshletBounds& b = set.Bounds[m];
+
+		for(UINT j = 0; j < meshlet.VertexCount; ++j)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[set.VertexIndices[meshlet.VertexOffset + j]].Pos);
+			float d = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, XMLoadFloat3(&b.Center))));
+			contained = contained && d <= b.Radius * 1.0001f + 1e-5f;
+		}
+	}
+	CHECK(contained);
+}
+
+TEST_CASE(CulledMeshletsAreNotVisible)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh = geoGen.CreateSphere(2.0f, 60, 60);
+	std::vector<Vertex> vertices = ToVertices(mesh);
+
+	// The same mesh wound the other way, for counter-clockwise front faces.
+	std::vector<UINT> flipped = mesh.Indices32;
+	for(size_t i = 0; i < flipped.size(); i += 3)
+		std::swap(flipped[i + 1], flipped[i + 2]);
+
+	for(bool frontCounterClockwise : { false, true })
+	{
+		const std::vector<UINT>& indices = frontCounterClockwise ? flipped : mesh.Indices32;
+
+		MeshletBuilder::MeshletSet set;
+		MeshletBuilder::Build(vertices.data(), indices.data(), (UINT)indices.size(), set, frontCounterClockwise);
+
+		XMFLOAT3 center(5.0f, 1.0f, -3.0f);
+		XMMATRIX world = XMMatrixRotationY(0.7f) * XMMatrixTranslation(center.x, center.y, center.z);
+
+		CullCheck check;
+		for(float distance : { 6.0f, 2.6f })
+		{
+			for(UINT step = 0; step < 24; ++step)
+			{
+				float angle = MathHelper::Pi * 2.0f * step / 24;
+				CheckCull(set, vertices, frontCounterClockwise, OrbitCamera(center, distance, angle, 0.5f), world, check);
+			}
+		}
+
+		CHECK(check.VisibleListed);
+		CHECK(check.CulledCorrectly);
+
+		// Both tests really cull, and not everything.
+		CHECK(check.FrustumCulled > 0);
+		CHECK(check.BackfaceCulled > 0);
+		CHECK(check.Visible > 0);
+	}
+}
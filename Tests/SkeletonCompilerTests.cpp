@@ -0,0 +1,163 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "../Init_Direct3D/SkeletonCompiler.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	using TestSkeleton::MaxDifference;
+
+	///<summary>
+	/// A skeleton as a file would list it: the bone stored in slot s is
+	/// bone Order[s] of a ternary tree (bone b hangs off bone (b-1)/3).
+	/// Offsets and tracks belong to the bone, not the slot, so every order
+	/// describes the same skeleton.
+	///</summary>
+	struct FileSkeleton
+	{
+		std::vector<UINT> Order;
+		std::vector<UINT> SlotOf;
+
+		std::vector<int> Hierarchy;
+		std::vector<XMFLOAT4X4> Offsets;
+		std::unordered_map<std::string, AnimationClip> Clips;
+
+		FileSkeleton(UINT boneCount, UINT shuffleSeed)
+			: Order(boneCount), SlotOf(boneCount), Hierarchy(boneCount), Offsets(boneCount)
+		{
+			std::iota(Order.begin(), Order.end(), 0u);
+			if( shuffleSeed != 0 )
+				std::shuffle(Order.begin(), Order.end(), std::mt19937(shuffleSeed));
+
+			for(UINT s = 0; s < boneCount; ++s)
+				SlotOf[Order[s]] = s;
+
+			AnimationClip& clip = Clips["Walk"];
+			clip.BoneAnimations.resize(boneCount);
+
+			for(UINT s = 0; s < boneCount; ++s)
+			{
+				UINT bone = Order[s];
+				Hierarchy[s] = bone == 0 ? -1 : (int)SlotOf[(bone - 1) / 3];
+				XMStoreFloat4x4(&Offsets[s], XMMatrixTranslation(0.0f, -0.1f * bone, 0.01f * bone));
+				clip.BoneAnimations[s] = TestSkeleton::MakeTrack(bone, 11, 1.0f, 0.0f);
+			}
+		}
+
+		bool Set(SkinnedData& skinned)
+		{
+			return skinned.Set(Hierarchy, Offsets, Clips);
+		}
+
+		// Where bone ended up after skinned.Set() renumbered it.
+		UINT CompiledIndex(const SkinnedData& skinned, UINT bone)const
+		{
+			return skinned.GetBoneRemap()[SlotOf[bone]];
+		}
+	};
+}
+
+TEST_CASE(ShuffledHierarchyCompilesToTheSamePose)
+{
+	const UINT boneCount = 40;
+
+	FileSkeleton parentFirst(boneCount, 0);
+	FileSkeleton shuffled(boneCount, 17);
+	CHECK(!SkeletonCompiler::IsParentFirst(shuffled.Hierarchy));
+
+	SkinnedData a;
+	SkinnedData b;
+	CHECK(parentFirst.Set(a));
+	CHECK(shuffled.Set(b));
+
+	std::vector<XMFLOAT4X4> fromA(boneCount);
+	std::vector<XMFLOAT4X4> fromB(boneCount);
+	AnimationWorkspace workspaceA;
+	AnimationWorkspace workspaceB;
+
+	for(float t : { 0.0f, 0.33f, 0.5f, 0.91f })
+	{
+		a.GetFinalTransforms(a.FindClip("Walk"), t, fromA, workspaceA);
+		b.GetFinalTransforms(b.FindClip("Walk"), t, fromB, workspaceB);
+
+		float maxDiff = 0.0f;
+		for(UINT bone = 0; bone < boneCount; ++bone)
+		{
+			maxDiff = MathHelper::Max(maxDiff, MaxDifference(
+				fromA[parentFirst.CompiledIndex(a, bone)], fromB[shuffled.CompiledIndex(b, bone)]));
+		}
+		CHECK(maxDiff <= 1e-5f);
+	}
+}
+
+TEST_CASE(BadHierarchiesAreRejected)
+{
+	const std::vector<std::vector<int>> bad =
+	{
+		{ -1, 0, 4, 1 },	// parent past the last bone
+		{ -1, 0, 2, 1 },	// bone is its own parent
+		{ -1, 2, 1, 0 },	// 1 and 2 are each other's parent
+		{ 1, 2, 0 },		// no root, one cycle
+	};
+
+	for(const std::vector<int>& hierarchy : bad)
+	{
+		SkeletonCompiler compiler;
+		CHECK(!compiler.Compile(hierarchy));
+
+		// The order is left as it was.
+		for(UINT i = 0; i < compiler.BoneCount(); ++i)
+			CHECK(compiler.GetBoneRemap()[i] == i);
+	}
+
+	// SkinnedData keeps the skeleton it had.
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 7));
+
+	std::vector<int> hierarchy = { -1, 2, 1, 0, 0, 0, 0 };
+	std::vector<XMFLOAT4X4> offsets(7, MathHelper::Identity4x4());
+	std::unordered_map<std::string, AnimationClip> clips;
+	for(UINT i = 0; i < 7; ++i)
+		clips["Walk"].BoneAnimations.push_back(TestSkeleton::MakeTrack(i, 5, 1.0f, 0.0f));
+
+	CHECK(!skinned.Set(hierarchy, offsets, clips));
+	CHECK(skinned.BoneCount() == 7);
+	CHECK(skinned.FindClip("Run") != nullptr);
+
+	// A valid hierarchy with a clip short of a track is turned down too.
+	hierarchy = { -1, 0, 0, 1, 1, 2, 2 };
+	clips["Walk"].BoneAnimations.pop_back();
+	CHECK(!skinned.Set(hierarchy, offsets, clips));
+	CHECK(skinned.FindClip("Run") != nullptr);
+}
+
+BENCHMARK(DeepSkeleton)
+{
+	for(UINT boneCount : { 256u, 1024u })
+	{
+		FileSkeleton shuffled(boneCount, 5);
+		SkinnedData skinned;
+
+		double setTime = MeasureMilliseconds([&]() { shuffled.Set(skinned); });
+
+		const CompiledAnimationClip* clip = skinned.FindClip("Walk");
+		std::vector<XMFLOAT4X4> finalTransforms(boneCount);
+		AnimationWorkspace workspace;
+		const UINT poses = 200;
+
+		double poseTime = MeasureMilliseconds([&]() {
+			for(UINT i = 0; i < poses; ++i)
+				skinned.GetFinalTransforms(clip, i / (float)poses, finalTransforms, workspace);
+		});
+
+		std::string bones = std::to_string(boneCount) + " bones, shuffled file order";
+		TestRegistry::Report((bones + ", Set").c_str(), setTime, "ms");
+		TestRegistry::Report((bones + ", pose").c_str(), poseTime * 1e3 / poses, "us");
+		TestRegistry::Report((bones + ", pose per bone").c_str(), poseTime * 1e6 / (poses * boneCount), "ns");
+	}
+}
@@ -0,0 +1,520 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "TestSoldier.h"
+#include "../Init_Direct3D/PoseCache.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BoneCount = 40;
+	const UINT FrameCount = 300;
+	const float FrameTime = 1.0f / 60.0f;
+
+	using TestSkeleton::MaxDifference;
+}
+
+TEST_CASE(FinalTransformsWithWorkspaceDoNotAllocate)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+	CHECK(skinned.BoneCount() == BoneCount);
+
+	const CompiledAnimationClip* clip = skinned.FindClip("Walk");
+	CHECK(clip != nullptr);
+	if( clip == nullptr )
+		return;
+
+	// The caller sizes the output; the first call sizes the workspace.
+	AnimationWorkspace workspace;
+	std::vector<XMFLOAT4X4> finalTransforms(skinned.BoneCount());
+	skinned.GetFinalTransforms(clip, 0.0f, finalTransforms, workspace);
+
+	size_t allocations = gAllocationCount;
+
+	float t = 0.0f;
+	for(UINT frame = 0; frame < FrameCount; ++frame)
+	{
+		t += FrameTime;
+		if( t > clip->GetClipEndTime() )
+			t = 0.0f;
+
+		skinned.GetFinalTransforms(clip, t, finalTransforms, workspace);
+		skinned.GetFinalTransforms(clip, t, finalTransforms, workspace, true);
+	}
+
+	CHECK(gAllocationCount == allocations);
+}
+
+TEST_CASE(BlendedFinalTransformsDoNotAllocate)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	std::vector<AnimationLayer> layers(2);
+	layers[0].Clip = skinned.FindClip("Walk");
+	layers[1].Clip = skinned.FindClip("Run");
+	layers[1].Weight = 0.5f;
+	CHECK(layers[0].Clip != nullptr && layers[1].Clip != nullptr);
+	if( layers[0].Clip == nullptr || layers[1].Clip == nullptr )
+		return;
+
+	AnimationWorkspace workspace;
+	std::vector<XMFLOAT4X4> finalTransforms(skinned.BoneCount());
+	skinned.GetFinalTransforms(layers, finalTransforms, workspace);
+
+	size_t allocations = gAllocationCount;
+
+	for(UINT frame = 0; frame < FrameCount; ++frame)
+	{
+		for(AnimationLayer& layer : layers)
+			layer.TimePos = fmodf(layer.TimePos + FrameTime, layer.Clip->GetClipEndTime());
+
+		skinned.GetFinalTransforms(layers, finalTransforms, workspace);
+	}
+
+	CHECK(gAllocationCount == allocations);
+}
+
+TEST_CASE(FinalTransformsWithWorkspaceMatchNamedClip)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	const CompiledAnimationClip* clip = skinned.FindClip("Walk");
+	CHECK(clip != nullptr);
+	if( clip == nullptr )
+		return;
+
+	AnimationWorkspace workspace;
+	std::vector<UINT> cursors;
+	std::vector<XMFLOAT4X4> fromWorkspace(skinned.BoneCount());
+	std::vector<XMFLOAT4X4> fromName(skinned.BoneCount());
+	std::vector<XMFLOAT4X4> fromSource(skinned.BoneCount());
+
+	for(UINT frame = 0; frame < 120; ++frame)
+	{
+		float t = fmodf(frame * FrameTime, clip->GetClipEndTime());
+
+		skinned.GetFinalTransforms(clip, t, fromWorkspace, workspace);
+		skinned.GetFinalTransforms("Walk", t, fromName, cursors);
+		skinned.GetFinalTransforms("Walk", t, fromSource);
+
+		// Both sample the compiled clip.
+		CHECK(MaxDifference(fromWorkspace, fromName) <= 1e-5f);
+
+		// The source curves differ only by the key quantization.
+		CHECK(MaxDifference(fromWorkspace, fromSource) <= 1e-2f);
+	}
+}
+
+namespace
+{
+	const char* RigBoneNames[] = { "hips", "spine", "neck", "head" };
+	const UINT RigBoneCount = 4;
+
+	// The rotation the clip adds to every bone's bind rotation at time t.
+	XMVECTOR RigMotion(UINT bone, float t)
+	{
+		return XMQuaternionRotationAxis(XMVectorSet(1.0f, 1.0f, (float)bone, 0.0f), 0.8f * sinf(XM_2PI * t + bone));
+	}
+
+	// A chain of RigBoneCount bones, boneLength apart, bent by the given
+	// bind rotations, with one clip "Wave" that turns each bone by
+	// RigMotion relative to its bind pose and keeps the bind translations.
+	bool BuildRig(SkinnedData& skinned, const XMVECTOR* bindRotations, float boneLength)
+	{
+		std::vector<int> hierarchy(RigBoneCount);
+		std::vector<XMFLOAT4X4> offsets(RigBoneCount);
+		std::vector<std::string> names(RigBoneNames, RigBoneNames + RigBoneCount);
+		std::unordered_map<std::string, AnimationClip> clips;
+
+		XMMATRIX parentToRoot = XMMatrixIdentity();
+		for(UINT i = 0; i < RigBoneCount; ++i)
+		{
+			hierarchy[i] = (int)i - 1;
+
+			XMVECTOR translation = XMVectorSet(0.0f, i == 0 ? 0.0f : boneLength, 0.0f, 0.0f);
+			XMMATRIX toParent = XMMatrixAffineTransformation(XMVectorSplatOne(), XMVectorZero(), bindRotations[i], translation);
+			XMMATRIX toRoot = XMMatrixMultiply(toParent, parentToRoot);
+			XMStoreFloat4x4(&offsets[i], XMMatrixInverse(nullptr, toRoot));
+			parentToRoot = toRoot;
+
+			BoneAnimation track;
+			for(UINT k = 0; k < 9; ++k)
+			{
+				Keyframe key;
+				key.TimePos = k / 8.0f;
+				XMStoreFloat3(&key.Translation, translation);
+				key.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+				// Motion relative to the bind pose: bind * motion.
+				XMStoreFloat4(&key.RotationQuat, XMQuaternionMultiply(RigMotion(i, key.TimePos), bindRotations[i]));
+				track.Keyframes.push_back(key);
+			}
+			clips["Wave"].BoneAnimations.push_back(track);
+		}
+
+		return skinned.Set(hierarchy, offsets, clips, names);
+	}
+}
+
+TEST_CASE(RetargetAppliesBindRotationDelta)
+{
+	// Same chain, but every bone of the target is bound at another angle
+	// about another axis, and twice as long.
+	XMVECTOR sourceBind[RigBoneCount];
+	XMVECTOR targetBind[RigBoneCount];
+	for(UINT i = 0; i < RigBoneCount; ++i)
+	{
+		sourceBind[i] = XMQuaternionRotationAxis(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.3f + 0.2f * i);
+		targetBind[i] = XMQuaternionRotationAxis(XMVectorSet(0.0f, 0.5f, 1.0f, 0.0f), -0.6f + 0.4f * i);
+	}
+
+	SkinnedData source;
+	SkinnedData target;
+	CHECK(BuildRig(source, sourceBind, 1.0f));
+	CHECK(BuildRig(target, targetBind, 2.0f));
+
+	RetargetMap map;
+	CHECK(target.BuildRetargetMap(source, map));
+	CHECK(map.MatchedBoneCount == RigBoneCount);
+	CHECK_NEAR(map.TranslationScale, 2.0f, 1e-4f);
+
+	const CompiledAnimationClip* sourceClip = source.FindClip("Wave");
+	const CompiledAnimationClip* targetClip = target.FindClip("Wave");
+	CHECK(sourceClip != nullptr && targetClip != nullptr);
+	if( sourceClip == nullptr || targetClip == nullptr )
+		return;
+
+	// The target's own "Wave" is the same motion on top of its bind pose,
+	// which is what the retargeted source clip must come out as.
+	AnimationWorkspace retargetWorkspace;
+	AnimationWorkspace targetWorkspace;
+	std::vector<XMFLOAT4X4> retargeted(RigBoneCount);
+	std::vector<XMFLOAT4X4> expected(RigBoneCount);
+
+	for(UINT frame = 0; frame <= 60; ++frame)
+	{
+		float t = frame / 60.0f;
+
+		target.GetFinalTransforms(sourceClip, t, map, retargeted, retargetWorkspace);
+		target.GetFinalTransforms(targetClip, t, expected, targetWorkspace);
+
+		CHECK(MaxDifference(retargeted, expected) <= 2e-3f);
+	}
+}
+
+namespace
+{
+	// 16 bit rotation components and translations over a bone's own range
+	// stay well inside this on the test skeleton's local matrices.
+	const float MaxCompiledError = 2e-4f;
+
+	XMFLOAT4X4 PoseMatrix(const BonePose& pose)
+	{
+		XMFLOAT4X4 M;
+		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(XMLoadFloat3(&pose.Scale), XMVectorZero(),
+			XMLoadFloat4(&pose.RotationQuat), XMLoadFloat3(&pose.Translation)));
+		return M;
+	}
+
+	// Samples every clip of skinned at boundary times (before the start, on
+	// and between keys, past the end) in order, then at random times in
+	// random order so the cursors have to search backwards, and compares
+	// the compiled clip's three sampling paths with the source curves.
+	void CheckCompiledMatchesSource(const SkinnedData& skinned, UINT keyCount)
+	{
+		const UINT numBones = skinned.BoneCount();
+		std::mt19937 random(keyCount);
+
+		// Every other bone, for the bone-list path.
+		std::vector<UINT> someBones;
+		for(UINT i = 0; i < numBones; i += 2)
+			someBones.push_back(i);
+
+		for(const std::string& name : skinned.GetClipNames())
+		{
+			const AnimationClip& source = skinned.GetClipSet()->Animations.at(name);
+			const CompiledAnimationClip* compiled = skinned.FindClip(name);
+
+			float start = compiled->GetClipStartTime();
+			float end = compiled->GetClipEndTime();
+			CHECK(start == source.GetClipStartTime());
+			CHECK(end == source.GetClipEndTime());
+
+			std::vector<float> times = { start - 0.1f };
+			for(UINT k = 0; k < keyCount; ++k)
+			{
+				float key = start + (end - start) * k / (keyCount - 1);
+				times.push_back(key);
+				times.push_back(key + 0.5f * (end - start) / (keyCount - 1));
+			}
+			times.push_back(end);
+			times.push_back(end + 0.1f);
+
+			std::uniform_real_distribution<float> anyTime(start - 0.1f, end + 0.1f);
+			for(UINT i = 0; i < 200; ++i)
+				times.push_back(anyTime(random));
+
+			std::vector<XMFLOAT4X4> expected(numBones);
+			std::vector<XMFLOAT4X4> sampled(numBones);
+			std::vector<XMFLOAT4X4> someSampled(numBones);
+			std::vector<BonePose> pose(numBones);
+			std::vector<UINT> cursors;
+			std::vector<UINT> someCursors(numBones, 0);
+			std::vector<UINT> poseCursors;
+
+			for(float t : times)
+			{
+				source.Interpolate(t, expected);
+				compiled->Interpolate(t, sampled, cursors);
+				compiled->Interpolate(t, someBones, someSampled, someCursors);
+				compiled->SamplePose(t, pose, poseCursors);
+
+				CHECK(MaxDifference(sampled, expected) <= MaxCompiledError);
+
+				for(UINT bone : someBones)
+				{
+					CHECK(MaxDifference(someSampled[bone], expected[bone]) <= MaxCompiledError);
+				}
+
+				for(UINT bone = 0; bone < numBones; ++bone)
+				{
+					CHECK(MaxDifference(PoseMatrix(pose[bone]), expected[bone]) <= MaxCompiledError);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(CompiledClipsMatchSourceCurves)
+{
+	// An odd bone count leaves a partial group of four at the end.
+	SkinnedData dense;
+	CHECK(TestSkeleton::Build(dense, 23));
+	CheckCompiledMatchesSource(dense, 31);
+
+	// Few keys put long slerps between them.
+	SkinnedData sparse;
+	CHECK(TestSkeleton::Build(sparse, 23, 5));
+	CheckCompiledMatchesSource(sparse, 5);
+}
+
+TEST_CASE(PoseCacheSkipsLeavesOnlyOnMisses)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 15));
+	const CompiledAnimationClip* clip = skinned.FindClip("Walk");
+
+	// Times on the cache's steps, so snapping changes nothing.
+	PoseCache cache(skinned, 0.25f, 1 << 20);
+	AnimationWorkspace workspace;
+	AnimationWorkspace referenceWorkspace;
+	AnimationWorkspace fullWorkspace;
+	std::vector<XMFLOAT4X4> cached(skinned.BoneCount());
+	std::vector<XMFLOAT4X4> reference(skinned.BoneCount());
+	std::vector<XMFLOAT4X4> full(skinned.BoneCount());
+
+	// Misses skip the leaves the way SkinnedData does: they keep the
+	// transform from the previous pose.
+	for(float t : { 0.5f, 0.75f })
+	{
+		cache.GetFinalTransforms(clip, t, cached, workspace, true);
+		skinned.GetFinalTransforms(clip, t, reference, referenceWorkspace, true);
+		CHECK(MaxDifference(cached, reference) <= 1e-6f);
+	}
+
+	skinned.GetFinalTransforms(clip, 0.75f, full, fullWorkspace);
+	CHECK(MaxDifference(cached, full) > 1e-4f);
+	CHECK(cache.GetMissCount() == 2);
+
+	// Those poses were not stored, so a full request misses too.
+	cache.GetFinalTransforms(clip, 0.75f, cached, workspace);
+	CHECK(MaxDifference(cached, full) <= 1e-6f);
+	CHECK(cache.GetMissCount() == 3);
+
+	// A hit hands out the full pose, even when leaves could be skipped.
+	cache.GetFinalTransforms(clip, 0.75f, cached, workspace, true);
+	CHECK(MaxDifference(cached, full) <= 1e-6f);
+	CHECK(cache.GetHitCount() == 1);
+}
+
+namespace
+{
+	// Keys an uneven distance apart, so a step in time crosses a varying
+	// number of them.
+	BoneAnimation MakeUnevenTrack(UINT keyCount)
+	{
+		BoneAnimation track = TestSkeleton::MakeTrack(1, keyCount, 1.0f, 0.0f);
+
+		float t = 0.0f;
+		for(UINT k = 0; k < keyCount; ++k)
+		{
+			track.Keyframes[k].TimePos = t;
+			t += 0.1f + 0.09f * sinf((float)k);
+		}
+		return track;
+	}
+
+	bool Bounds(const BoneAnimation& track, UINT pair, float t)
+	{
+		return pair + 1 < track.Keyframes.size() &&
+			track.Keyframes[pair].TimePos <= t && t <= track.Keyframes[pair+1].TimePos;
+	}
+}
+
+TEST_CASE(KeyframeCursorFindsBoundingPair)
+{
+	const UINT keyCount = 50;
+	const UINT lastPair = keyCount - 2;
+	BoneAnimation track = MakeUnevenTrack(keyCount);
+	float start = track.GetStartTime();
+	float end = track.GetEndTime();
+
+	// Forward in frame-sized steps, forward in steps longer than the
+	// cursor walks, backward, on every key, then random seeks.
+	std::vector<float> times;
+	for(float t = start; t <= end; t += 0.02f)
+		times.push_back(t);
+	for(float t = start; t <= end; t += 0.73f)
+		times.push_back(t);
+	for(float t = end; t >= start; t -= 0.3f)
+		times.push_back(t);
+	for(const Keyframe& key : track.Keyframes)
+		times.push_back(key.TimePos);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> anyTime(start, end);
+	for(UINT i = 0; i < 500; ++i)
+		times.push_back(anyTime(random));
+
+	UINT cursor = 0;
+	UINT interpolateCursor = 0;
+	for(float t : times)
+	{
+		UINT fresh = (UINT)-1;
+		UINT pair = track.FindKeyframe(t, cursor);
+		CHECK(pair == cursor);
+		CHECK(Bounds(track, pair, t));
+		CHECK(Bounds(track, track.FindKeyframe(t, fresh), t));
+
+		XMFLOAT4X4 withCursor;
+		XMFLOAT4X4 withSearch;
+		track.Interpolate(t, withCursor, interpolateCursor);
+		track.Interpolate(t, withSearch);
+		CHECK(MaxDifference(withCursor, withSearch) <= 1e-6f);
+	}
+
+	// Cursors left over from a longer track, or from the end of this one.
+	UINT stale = keyCount + 10;
+	CHECK(Bounds(track, track.FindKeyframe(start + 0.05f, stale), start + 0.05f));
+	stale = lastPair;
+	CHECK(Bounds(track, track.FindKeyframe(start + 0.05f, stale), start + 0.05f));
+
+	// Times off the track clamp to the first and last pair.
+	CHECK(track.FindKeyframe(start - 1.0f, cursor) == 0);
+	CHECK(track.FindKeyframe(end + 1.0f, cursor) == lastPair);
+}
+
+BENCHMARK(KeyframeCursorLookup)
+{
+	const float frameTime = 1.0f / 60.0f;
+	XMFLOAT4X4 M;
+
+	// One long track, keys at 30 Hz, played forward at 60 Hz.
+	const UINT keyCount = 10000;
+	BoneAnimation track = TestSkeleton::MakeTrack(0, keyCount, (keyCount - 1) / 30.0f, 0.0f);
+	float end = track.GetEndTime();
+	UINT samples = (UINT)(end / frameTime);
+
+	double withCursor = MeasureMilliseconds([&]() {
+		UINT cursor = 0;
+		for(UINT i = 0; i < samples; ++i)
+			track.Interpolate(i * frameTime, M, cursor);
+	});
+	double withSearch = MeasureMilliseconds([&]() {
+		for(UINT i = 0; i < samples; ++i)
+			track.Interpolate(i * frameTime, M);
+	});
+
+	TestRegistry::Report("10k-key track, cursor", withCursor * 1e6 / samples, "ns/sample");
+	TestRegistry::Report("10k-key track, binary search", withSearch * 1e6 / samples, "ns/sample");
+
+	// Every clip of the soldier, whole poses at 60 Hz.
+	SkinnedData soldier;
+	if( !TestSoldier::Load(soldier) )
+		return;
+
+	std::vector<XMFLOAT4X4> transforms(soldier.BoneCount());
+	UINT poses = 0;
+	for(const auto& clip : soldier.GetClipSet()->Animations)
+		poses += (UINT)((clip.second.GetClipEndTime() - clip.second.GetClipStartTime()) / frameTime) + 1;
+
+	withCursor = MeasureMilliseconds([&]() {
+		for(const auto& clip : soldier.GetClipSet()->Animations)
+		{
+			std::vector<UINT> cursors;
+			for(float t = clip.second.GetClipStartTime(); t <= clip.second.GetClipEndTime(); t += frameTime)
+				clip.second.Interpolate(t, transforms, cursors);
+		}
+	});
+	withSearch = MeasureMilliseconds([&]() {
+		for(const auto& clip : soldier.GetClipSet()->Animations)
+		{
+			for(float t = clip.second.GetClipStartTime(); t <= clip.second.GetClipEndTime(); t += frameTime)
+				clip.second.Interpolate(t, transforms);
+		}
+	});
+
+	TestRegistry::Report("soldier.m3d, cursor", withCursor * 1e3 / poses, "us/pose");
+	TestRegistry::Report("soldier.m3d, binary search", withSearch * 1e3 / poses, "us/pose");
+}
+
+BENCHMARK(LayerBlendCost)
+{
+	SkinnedData soldier;
+	if( !TestSoldier::Load(soldier) )
+		return;
+
+	const CompiledAnimationClip* clip = soldier.FindClip(soldier.GetClipNames().front());
+	const float start = clip->GetClipStartTime();
+	const float length = clip->GetClipEndTime() - start;
+	const UINT poses = 600;
+	const UINT numBones = soldier.BoneCount();
+
+	AnimationWorkspace workspace;
+	std::vector<XMFLOAT4X4> finalTransforms(numBones);
+
+	double single = MeasureMilliseconds([&]() {
+		for(UINT i = 0; i < poses; ++i)
+			soldier.GetFinalTransforms(clip, start + fmodf(i / 60.0f, length), finalTransforms, workspace);
+	});
+	TestRegistry::Report("soldier.m3d, one clip", single * 1e6 / (poses * numBones), "ns/bone");
+
+	// The same clip at staggered times stands in for different clips.
+	for(UINT layerCount : { 1u, 2u, 4u })
+	{
+		std::vector<AnimationLayer> layers(layerCount);
+		for(UINT j = 0; j < layerCount; ++j)
+		{
+			layers[j].Clip = clip;
+			layers[j].Weight = 1.0f / layerCount;
+		}
+
+		double blended = MeasureMilliseconds([&]() {
+			for(UINT i = 0; i < poses; ++i)
+			{
+				for(UINT j = 0; j < layerCount; ++j)
+					layers[j].TimePos = start + fmodf(i / 60.0f + 0.3f * j, length);
+				soldier.GetFinalTransforms(layers, finalTransforms, workspace);
+			}
+		});
+
+		std::string what = "soldier.m3d, " + std::to_string(layerCount) + " layer(s)";
+		TestRegistry::Report(what.c_str(), blended * 1e6 / (poses * numBones), "ns/bone");
+	}
+}
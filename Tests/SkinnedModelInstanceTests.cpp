@@ -0,0 +1,199 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "../Init_Direct3D/D3dHeader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const float ClipStart = 0.5f;
+	const float ClipEnd = 1.5f;
+
+	// Two bones, keyed from ClipStart to ClipEnd.  The root walks one unit
+	// along x per second, so after root motion extraction every second of
+	// playback moves the instance one unit, wrap or no wrap.
+	bool BuildLateClip(SkinnedData& skinned)
+	{
+		std::vector<int> hierarchy = { -1, 0 };
+		std::vector<XMFLOAT4X4> offsets(2, MathHelper::Identity4x4());
+		std::unordered_map<std::string, AnimationClip> clips;
+
+		AnimationClip& clip = clips["Late"];
+		clip.BoneAnimations.resize(2);
+		for(UINT bone = 0; bone < 2; ++bone)
+		{
+			for(UINT k = 0; k < 11; ++k)
+			{
+				Keyframe key;
+				key.TimePos = ClipStart + (ClipEnd - ClipStart) * k / 10;
+				key.Translation = XMFLOAT3(bone == 0 ? key.TimePos - ClipStart : 0.0f, 1.0f, 0.0f);
+				key.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+				key.RotationQuat = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+				clip.BoneAnimations[bone].Keyframes.push_back(key);
+			}
+		}
+
+		if( !skinned.Set(hierarchy, offsets, clips) )
+			return false;
+
+		skinned.ExtractRootMotion();
+		return skinned.AddEvent("Late", 0.75f, "Left") && skinned.AddEvent("Late", 1.25f, "Right");
+	}
+
+	using TestSkeleton::MaxDifference;
+
+	void StartClip(SkinnedModelInstance& inst, SkinnedData& skinned, const std::string& clipName)
+	{
+		inst.SkinnedInfo = &skinned;
+		inst.FinalTransforms.resize(skinned.BoneCount());
+		inst.SetClip(clipName);
+	}
+}
+
+TEST_CASE(LateClipWrapsToItsStart)
+{
+	SkinnedData skinned;
+	CHECK(BuildLateClip(skinned));
+
+	SkinnedModelInstance inst;
+	inst.SkinnedInfo = &skinned;
+	inst.FinalTransforms.resize(skinned.BoneCount());
+	inst.SetClip("Late");
+	CHECK(inst.TimePos == ClipStart);
+
+	// Three loops of the clip, in steps that do not divide it evenly.
+	const float dt = 0.07f;
+	const UINT steps = 43;
+	UINT left = 0;
+	UINT right = 0;
+
+	for(UINT i = 0; i < steps; ++i)
+	{
+		inst.UpdateSkinnedAnimation(dt);
+		inst.ApplyRootMotion();
+
+		CHECK(inst.TimePos >= ClipStart && inst.TimePos <= ClipEnd);
+
+		for(const AnimationEvent* e : inst.FiredEvents)
+		{
+			if( e->Name == "Left" )
+				++left;
+			else if( e->Name == "Right" )
+				++right;
+		}
+	}
+
+	// Pose time, root motion and events all went round the same loops.
+	const float elapsed = dt * steps;
+	CHECK_NEAR(inst.TimePos, ClipStart + fmodf(elapsed, ClipEnd - ClipStart), 1e-4f);
+	CHECK_NEAR(inst.Position.x, elapsed, 1e-3f);
+	CHECK(left == 3);
+	CHECK(right == 3);
+}
+
+TEST_CASE(CrossFadeHandsOverToTheNewClip)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 12));
+
+	SkinnedModelInstance inst;
+	StartClip(inst, skinned, "Walk");
+	inst.UpdateSkinnedAnimation(0.1f);
+
+	inst.CrossFade("Run", 0.5f);
+	CHECK(inst.ClipName == "Run");
+	CHECK(inst.Layers.size() == 2);
+	if( inst.Layers.size() != 2 )
+		return;
+
+	// The weights move linearly and always sum to one.
+	const float dt = 0.1f;
+	for(UINT step = 1; step < 5; ++step)
+	{
+		inst.UpdateSkinnedAnimation(dt);
+		CHECK(inst.Layers.size() == 2);
+		CHECK_NEAR(inst.Layers[0].Weight, 1.0f - 0.2f * step, 1e-5f);
+		CHECK_NEAR(inst.Layers[1].Weight, 0.2f * step, 1e-5f);
+		CHECK_NEAR(inst.Layers[0].Weight + inst.Layers[1].Weight, 1.0f, 1e-5f);
+	}
+
+	// Past the fade the old clip is gone and the instance plays one clip.
+	inst.UpdateSkinnedAnimation(dt);
+	inst.UpdateSkinnedAnimation(dt);
+	CHECK(inst.Layers.empty());
+	CHECK(inst.Clip == skinned.FindClip("Run"));
+
+	AnimationWorkspace workspace;
+	std::vector<XMFLOAT4X4> expected(skinned.BoneCount());
+	skinned.GetFinalTransforms(inst.Clip, inst.TimePos, expected, workspace);
+	CHECK(MaxDifference(inst.FinalTransforms, expected) <= 1e-5f);
+}
+
+TEST_CASE(LayerWeightsAreNormalized)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 12));
+
+	// Weights 1 and 0.5 blend the same as 2 and 1.
+	SkinnedModelInstance a;
+	StartClip(a, skinned, "Walk");
+	CHECK(a.AddLayer("Run", 0.5f) != nullptr);
+
+	SkinnedModelInstance b;
+	StartClip(b, skinned, "Walk");
+	CHECK(b.AddLayer("Run", 1.0f) != nullptr);
+	b.Layers[0].Weight = 2.0f;
+
+	// One clip at any weight is that clip.
+	SkinnedModelInstance c;
+	StartClip(c, skinned, "Walk");
+	CHECK(c.AddLayer("Run", 0.0f) != nullptr);
+	c.Layers[0].Weight = 0.3f;
+
+	SkinnedModelInstance plain;
+	StartClip(plain, skinned, "Walk");
+
+	for(UINT step = 0; step < 10; ++step)
+	{
+		a.UpdateSkinnedAnimation(0.05f);
+		b.UpdateSkinnedAnimation(0.05f);
+		c.UpdateSkinnedAnimation(0.05f);
+		plain.UpdateSkinnedAnimation(0.05f);
+
+		CHECK(MaxDifference(a.FinalTransforms, b.FinalTransforms) <= 1e-5f);
+		CHECK(MaxDifference(c.FinalTransforms, plain.FinalTransforms) <= 1e-5f);
+		CHECK(MaxDifference(a.FinalTransforms, plain.FinalTransforms) > 1e-3f);
+	}
+}
+
+TEST_CASE(ZeroWeightLayerIsKept)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, 12));
+
+	// A layer added at weight zero, to be raised later, is not a layer that
+	// has faded out.
+	SkinnedModelInstance inst;
+	StartClip(inst, skinned, "Walk");
+	CHECK(inst.AddLayer("Run", 0.0f) != nullptr);
+
+	SkinnedModelInstance plain;
+	StartClip(plain, skinned, "Walk");
+
+	for(UINT step = 0; step < 5; ++step)
+	{
+		inst.UpdateSkinnedAnimation(0.05f);
+		plain.UpdateSkinnedAnimation(0.05f);
+	}
+
+	CHECK(inst.Layers.size() == 2);
+	CHECK(MaxDifference(inst.FinalTransforms, plain.FinalTransforms) <= 1e-5f);
+	if( inst.Layers.size() != 2 )
+		return;
+
+	inst.Layers[1].Weight = 1.0f;
+	inst.UpdateSkinnedAnimation(0.05f);
+	plain.UpdateSkinnedAnimation(0.05f);
+	CHECK(inst.Layers.size() == 2);
+	CHECK(MaxDifference(inst.FinalTransforms, plain.FinalTransforms) > 1e-3f);
+}
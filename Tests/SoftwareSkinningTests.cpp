@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+#include "TestSkeleton.h"
+#include "TestSoldier.h"
+#include "../Init_Direct3D/SoftwareSkinning.h"
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BoneCount = 12;
+
+	// Blending the matrices first rounds differently from blending the
+	// four transformed points; the test skeleton stays within a few units.
+	const float MaxSkinError = 1e-5f;
+
+	// Random positions and normals on random bones.  The first vertices
+	// put all their weight on one slot, the implied fourth one included.
+	std::vector<M3DLoader::SkinnedVertex> MakeVertices(UINT count, UINT boneCount)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_int_distribution<int> bone(0, boneCount - 1);
+
+		const XMFLOAT3 oneSlot[4] = { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
+
+		std::vector<M3DLoader::SkinnedVertex> vertices(count);
+		for(UINT i = 0; i < count; ++i)
+		{
+			M3DLoader::SkinnedVertex& v = vertices[i];
+			v.Pos = XMFLOAT3(coord(rng), coord(rng), coord(rng));
+			XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(coord(rng), coord(rng), coord(rng), 0.0f)));
+
+			for(int j = 0; j < 4; ++j)
+				v.BoneIndices[j] = (USHORT)bone(rng);
+
+			if( i < 4 )
+			{
+				v.BoneWeights = oneSlot[i];
+				continue;
+			}
+
+			float w[4] = { unit(rng), unit(rng), unit(rng), unit(rng) };
+			float sum = w[0] + w[1] + w[2] + w[3];
+			v.BoneWeights = XMFLOAT3(w[0] / sum, w[1] / sum, w[2] / sum);
+		}
+
+		return vertices;
+	}
+
+	// Every bone transforms the vertex on its own, then the results are
+	// weighted, as the linear blend is written on paper.
+	void SkinPerBone(const M3DLoader::SkinnedVertex& v, const std::vector<XMFLOAT4X4>& finalTransforms,
+		XMFLOAT3& position, XMFLOAT3& normal)
+	{
+		const float weights[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z,
+			1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z };
+
+		XMVECTOR p = XMVectorZero();
+		XMVECTOR n = XMVectorZero();
+		for(int j = 0; j < 4; ++j)
+		{
+			// The palette is transposed for the shader.
+			XMMATRIX bone = XMMatrixTranspose(XMLoadFloat4x4(&finalTransforms[v.BoneIndices[j]]));
+			p = XMVectorAdd(p, XMVectorScale(XMVector3Transform(XMLoadFloat3(&v.Pos), bone), weights[j]));
+			n = XMVectorAdd(n, XMVectorScale(XMVector3TransformNormal(XMLoadFloat3(&v.Normal), bone), weights[j]));
+		}
+
+		XMStoreFloat3(&position, p);
+		XMStoreFloat3(&normal, n);
+	}
+
+	float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+	}
+}
+
+TEST_CASE(SkinnedVerticesMatchPerBoneBlend)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	std::vector<XMFLOAT4X4> finalTransforms(BoneCount);
+	AnimationWorkspace workspace;
+	skinned.GetFinalTransforms(skinned.FindClip("Walk"), 0.37f, finalTransforms, workspace);
+
+	SoftwareSkinner skinner;
+	skinner.SetPalette(finalTransforms.data(), BoneCount);
+	CHECK(skinner.BoneCount() == BoneCount);
+
+	std::vector<M3DLoader::SkinnedVertex> vertices = MakeVertices(500, BoneCount);
+	std::vector<XMFLOAT3> positions(vertices.size());
+	std::vector<XMFLOAT3> normals(vertices.size());
+	skinner.Skin(vertices.data(), 0, (UINT)vertices.size(), positions.data(), normals.data());
+
+	float maxPosition = 0.0f;
+	float maxNormal = 0.0f;
+	for(size_t i = 0; i < vertices.size(); ++i)
+	{
+		XMFLOAT3 position, normal;
+		SkinPerBone(vertices[i], finalTransforms, position, normal);
+		maxPosition = MathHelper::Max(maxPosition, Distance(positions[i], position));
+		maxNormal = MathHelper::Max(maxNormal, Distance(normals[i], normal));
+	}
+
+	CHECK(maxPosition <= MaxSkinError);
+	CHECK(maxNormal <= MaxSkinError);
+
+	// A vertex weighted only by the implied fourth weight follows that bone
+	// alone.
+	const M3DLoader::SkinnedVertex& fourth = vertices[3];
+	XMFLOAT3 expected;
+	XMStoreFloat3(&expected, XMVector3Transform(XMLoadFloat3(&fourth.Pos),
+		XMMatrixTranspose(XMLoadFloat4x4(&finalTransforms[fourth.BoneIndices[3]]))));
+	CHECK(Distance(positions[3], expected) <= MaxSkinError);
+}
+
+TEST_CASE(ParallelSkinningMatchesSerial)
+{
+	SkinnedData skinned;
+	CHECK(TestSkeleton::Build(skinned, BoneCount));
+
+	std::vector<XMFLOAT4X4> finalTransforms(BoneCount);
+	AnimationWorkspace workspace;
+	skinned.GetFinalTransforms(skinned.FindClip("Run"), 0.2f, finalTransforms, workspace);
+
+	SoftwareSkinner skinner;
+	skinner.SetPalette(finalTransforms.data(), BoneCount);
+
+	// Three chunks, the last one short.
+	std::vector<M3DLoader::SkinnedVertex> vertices = MakeVertices(SoftwareSkinner::GrainSize * 2 + 100, BoneCount);
+	std::vector<XMFLOAT3> serialPositions(vertices.size());
+	std::vector<XMFLOAT3> serialNormals(vertices.size());
+	skinner.Skin(vertices.data(), 0, (UINT)vertices.size(), serialPositions.data(), serialNormals.data());
+
+	JobSystem jobs(3);
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	skinner.Skin(jobs, vertices, positions, normals);
+
+	CHECK(positions.size() == vertices.size() && normals.size() == vertices.size());
+	CHECK(std::memcmp(positions.data(), serialPositions.data(), vertices.size() * sizeof(XMFLOAT3)) == 0);
+	CHECK(std::memcmp(normals.data(), serialNormals.data(), vertices.size() * sizeof(XMFLOAT3)) == 0);
+
+	skinner.Skin(jobs, vertices, positions);
+	CHECK(std::memcmp(positions.data(), serialPositions.data(), vertices.size() * sizeof(XMFLOAT3)) == 0);
+}
+
+BENCHMARK(SoftwareSkinning)
+{
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	SkinnedData soldier;
+	if( !TestSoldier::Load(vertices, indices, soldier) )
+		return;
+
+	std::vector<XMFLOAT4X4> finalTransforms(soldier.BoneCount());
+	AnimationWorkspace workspace;
+	const CompiledAnimationClip* clip = soldier.FindClip(soldier.GetClipNames().front());
+	soldier.GetFinalTransforms(clip, clip->GetClipStartTime(), finalTransforms, workspace);
+
+	SoftwareSkinner skinner;
+	skinner.SetPalette(finalTransforms.data(), soldier.BoneCount());
+
+	// Many passes per run, so one run is well above the timer resolution.
+	const UINT passes = 100;
+	const double vertexCount = (double)vertices.size() * passes;
+	std::vector<XMFLOAT3> positions(vertices.size());
+	std::vector<XMFLOAT3> normals(vertices.size());
+
+	double positionsOnly = MeasureMilliseconds([&]() {
+		for(UINT i = 0; i < passes; ++i)
+			skinner.Skin(vertices.data(), 0, (UINT)vertices.size(), positions.data());
+	});
+	double withNormals = MeasureMilliseconds([&]() {
+		for(UINT i = 0; i < passes; ++i)
+			skinner.Skin(vertices.data(), 0, (UINT)vertices.size(), positions.data(), normals.data());
+	});
+
+	JobSystem jobs;
+	double parallel = MeasureMilliseconds([&]() {
+		for(UINT i = 0; i < passes; ++i)
+			skinner.Skin(jobs, vertices, positions, normals);
+	});
+
+	std::string soldierName = "soldier, " + std::to_string(vertices.size()) + " vertices";
+	TestRegistry::Report((soldierName + ", positions").c_str(), vertexCount / positionsOnly / 1e3, "M vertices/s");
+	TestRegistry::Report((soldierName + ", with normals").c_str(), vertexCount / withNormals / 1e3, "M vertices/s");
+	TestRegistry::Report((soldierName + ", job system, " + std::to_string(jobs.ThreadCount()) + " thread(s)").c_str(),
+		vertexCount / parallel / 1e3, "M vertices/s");
+	TestRegistry::Report("per soldier, with normals", withNormals / passes, "ms");
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "TestSoldier.h"
+#include "../Init_Direct3D/D3dHeader.h"
+#include "../Init_Direct3D/SkinnedInstanceUpdater.h"
+
+///<summary>
+/// InitDirect3DApp's crowd of soldiers without the device, for the
+/// benchmarks.  The skeleton is prepared the way the app's load step does
+/// it, the instances stand in rows of ten with staggered start times, the
+/// camera starts where the app's does, and Buffer stands in for the
+/// skinned constant buffer (two regions, one slot per instance).
+///</summary>
+struct TestCrowd
+{
+	SkinnedData SkinnedInfo;
+	std::unique_ptr<PoseCache> Cache;
+	SkinnedInstanceUpdater::InstanceList Instances;
+	AnimationLodPolicy AnimationLod;
+	Camera SceneCamera;
+
+	std::vector<BYTE> Buffer;
+	UINT SlotByteSize = 0;
+
+	bool Load()
+	{
+		if( !TestSoldier::Load(SkinnedInfo) )
+			return false;
+
+		SkinnedInfo.ExtractRootMotion();
+		SkinnedInfo.ReduceAnimations(KeyframeTolerance());
+
+		SceneCamera.SetPosition(0.0f, 2.0f, -15.0f);
+		return true;
+	}
+
+	// Replaces the instances with count new ones, sharing a new pose cache
+	// if usePoseCache is set.
+	void Populate(UINT count, bool usePoseCache)
+	{
+		Instances.clear();
+		Cache.reset();
+		if( usePoseCache )
+			Cache = std::make_unique<PoseCache>(SkinnedInfo, 1.0f / 60.0f, 1 << 20);
+
+		for(UINT i = 0; i < count; ++i)
+		{
+			auto inst = std::make_unique<SkinnedModelInstance>();
+			inst->SkinnedInfo = &SkinnedInfo;
+			inst->Cache = Cache.get();
+			inst->FinalTransforms.resize(SkinnedInfo.BoneCount());
+			inst->SetClip("Take1");
+
+			float clipLength = inst->Clip->GetClipEndTime() - inst->Clip->GetClipStartTime();
+			if( clipLength > 0.0f )
+				inst->TimePos += fmodf(0.37f * i, clipLength);
+			inst->LodFrame = i;
+
+			float x = 2.0f * (i % 10);
+			float z = -5.0f - 2.0f * (i / 10);
+			DirectX::XMMATRIX scale = DirectX::XMMatrixScaling(0.05f, 0.05f, -0.05f);
+			DirectX::XMMATRIX rotate = DirectX::XMMatrixRotationY(MathHelper::Pi);
+			DirectX::XMStoreFloat4x4(&inst->World, scale * rotate * DirectX::XMMatrixTranslation(x, 0.0f, z));
+			inst->Position = DirectX::XMFLOAT3(x, 0.0f, z);
+
+			Instances.push_back(std::move(inst));
+		}
+
+		UINT paletteByteSize = SkinnedInfo.BoneCount() *
+			BonePalette::Stride(BonePalette::Format::Affine3x4) * sizeof(DirectX::XMFLOAT4);
+		SlotByteSize = d3dUtil::CalcConstantBufferByteSize(paletteByteSize);
+		Buffer.assign((size_t)SlotByteSize * count * 2, 0);
+	}
+
+	// Points updater at Buffer, the way InitDirect3DApp does.  lod is
+	// usually &AnimationLod, the app's levels, or nullptr for none.
+	void Connect(SkinnedInstanceUpdater& updater, const AnimationLodPolicy* lod)
+	{
+		updater.SetTarget(Buffer.data(), SlotByteSize, SlotByteSize * (UINT)Instances.size());
+		updater.SetPaletteFormat(BonePalette::Format::Affine3x4);
+		updater.SetLodPolicy(lod);
+	}
+};
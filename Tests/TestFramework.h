@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+///<summary>
+/// Minimal runner for the console test project.  TEST_CASE registers a
+/// function before main() runs; CHECK records a failure and carries on, so
+/// one run reports every broken expectation.  Unlike assert, the checks
+/// stay on in Release builds.
+///
+/// The runner prints one line per test and main() returns nonzero if any
+/// check failed, so the project can gate a build step.
+///
+/// BENCHMARK registers a timing run the same way.  Benchmarks only run
+/// with "Tests.exe --bench [filter]", and only mean something in Release;
+/// each one prints its numbers through Report.
+///</summary>
+class TestRegistry
+{
+public:
+	typedef void (*TestFunction)();
+
+	static void Add(const char* name, TestFunction test);
+	static void AddBenchmark(const char* name, TestFunction benchmark);
+	static void Fail(const char* file, int line, const char* expression);
+
+	// Runs every registered test and returns the number that failed.
+	static int RunAll();
+
+	// Runs the benchmarks whose name contains filter, or all of them.
+	static void RunBenchmarks(const char* filter);
+
+	// Prints one result line of the running benchmark.
+	static void Report(const char* what, double value, const char* unit);
+};
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, TestRegistry::TestFunction test)
+	{
+		TestRegistry::Add(name, test);
+	}
+};
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar(const char* name, TestRegistry::TestFunction benchmark)
+	{
+		TestRegistry::AddBenchmark(name, benchmark);
+	}
+};
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static BenchmarkRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if( !(expression) ) TestRegistry::Fail(__FILE__, __LINE__, #expression); } while( 0 )
+
+#define CHECK_NEAR(a, b, tolerance) \
+	CHECK(std::fabs((a) - (b)) <= (tolerance))
+
+// Calls to the global operator new so far.  TestMain.cpp replaces operator
+// new to count them; tests compare the count before and after a loop.
+extern std::atomic<size_t> gAllocationCount;
+
+// Milliseconds taken by the fastest of repeats calls to work.  The fastest
+// run is the one least disturbed by the rest of the machine.
+template<typename Work>
+double MeasureMilliseconds(Work&& work, int repeats = 5)
+{
+	double best = 1e30;
+	for(int i = 0; i < repeats; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		work();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
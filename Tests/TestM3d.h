@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../Common/MathHelper.h"
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+///<summary>
+/// Writes made-up .m3d text files for the loader tests, laid out the way
+/// the exporter writes soldier.m3d.  The model is a strip of triangles
+/// over Vertices vertices, each skinned to two bones, on a binary-tree
+/// skeleton with one clip ("Take1") of Keyframes keys per bone.
+///
+/// The options break a file on purpose: BadBoneIndex points one vertex
+/// past the skeleton, Truncate cuts the file in the middle of the
+/// keyframes, and MovedLineBreaks keeps every token but moves the line
+/// breaks, which the one-record-per-line parallel parse cannot follow.
+///</summary>
+namespace TestM3d
+{
+	struct Options
+	{
+		UINT Vertices = 64;
+		UINT Bones = 6;
+		UINT Keyframes = 9;
+
+		bool Skinned = true;
+		bool BadBoneIndex = false;
+		bool Truncate = false;
+		bool MovedLineBreaks = false;
+	};
+
+	inline void Append(std::string& text, const char* format, ...)
+	{
+		char line[256];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(line, sizeof(line), format, args);
+		va_end(args);
+		text += line;
+	}
+
+	inline void AppendSkeleton(std::string& text, const Options& o)
+	{
+		text += "***************BoneOffsets*******************\n";
+		for(UINT b = 0; b < o.Bones; ++b)
+			Append(text, "BoneOffset%u 1 0 0 0 0 1 0 0 0 0 1 0 0 %.9g 0 1\n", b, -1.0f * b);
+
+		text += "***************BoneHierarchy*****************\n";
+		for(UINT b = 0; b < o.Bones; ++b)
+			Append(text, "ParentIndexOfBone%u: %d\n", b, b == 0 ? -1 : (int)(b - 1) / 2);
+
+		text += "***************AnimationClips****************\n";
+		text += "AnimationClip Take1\n{\n";
+		for(UINT b = 0; b < o.Bones; ++b)
+		{
+			Append(text, "\tBone%u #Keyframes: %u\n\t{\n", b, o.Keyframes);
+			for(UINT k = 0; k < o.Keyframes; ++k)
+			{
+				float t = (float)k / (o.Keyframes - 1);
+				float half = 0.3f * sinf(MathHelper::Pi * 2.0f * t + b);
+
+				Append(text, "\t\tTime: %.9g Pos: 0 %.9g %.9g", t, b == 0 ? 0.0f : 1.0f, 0.1f * t);
+				text += o.MovedLineBreaks ? "\n\t\t" : " ";
+				Append(text, "Scale: 1 1 1 Quat: 0 %.9g 0 %.9g\n", sinf(half), cosf(half));
+			}
+			text += "\t}\n";
+		}
+		text += "}\n";
+	}
+
+	inline std::string Make(const Options& o)
+	{
+		const UINT bones = o.Skinned ? o.Bones : 0;
+		const UINT clips = o.Skinned ? 1 : 0;
+		const UINT triangles = o.Vertices - 2;
+		const char* breakOrSpace = o.MovedLineBreaks ? " " : "\n";
+
+		std::string text;
+		text += "***************m3d-File-Header***************\n";
+		Append(text, "#Materials 1\n#Vertices %u\n#Triangles %u\n#Bones %u\n#AnimationClips %u\n\n",
+			o.Vertices, triangles, bones, clips);
+
+		text += "***************Materials*********************\n";
+		text += "Name: test\nDiffuse: 1 0.5 0.25\nFresnel0: 0.05 0.05 0.05\nRoughness: 0.5\nAlphaClip: 0\n"
+			"MaterialTypeName: Skinned\nDiffuseMap: test_diff.dds\nNormalMap: test_norm.dds\n\n";
+
+		text += "***************SubsetTable*******************\n";
+		Append(text, "SubsetID: 0 VertexStart: 0 VertexCount: %u FaceStart: 0 FaceCount: %u\n\n", o.Vertices, triangles);
+
+		text += "***************Vertices**********************\n";
+		for(UINT i = 0; i < o.Vertices; ++i)
+		{
+			float x = 0.5f * (i / 2);
+			float y = (float)(i % 2);
+			float u = (float)i / o.Vertices;
+
+			Append(text, "Position: %.9g %.9g %.9g\n", x, y, 0.01f * i);
+			Append(text, "Tangent: 1 0 0 1\n");
+			Append(text, "Normal: 0 0 -1%sTex-Coords: %.9g %.9g\n", breakOrSpace, u, y);
+
+			if( o.Skinned )
+			{
+				float w = 0.25f + 0.5f * u;
+				UINT bone = i % bones;
+				UINT next = (bone + 1) % bones;
+				if( o.BadBoneIndex && i == o.Vertices / 2 )
+					next = bones;
+
+				Append(text, "BlendWeights: %.9g %.9g 0 0\n", w, 1.0f - w);
+				Append(text, "BlendIndices: %u %u 0 0\n", bone, next);
+			}
+			text += "\n";
+		}
+
+		text += "***************Triangles*********************\n";
+		for(UINT t = 0; t < triangles; ++t)
+		{
+			// Alternate the winding so the strip faces one way.
+			if( t % 2 == 0 )
+				Append(text, "%u %u %u", t, t + 1, t + 2);
+			else
+				Append(text, "%u %u %u", t + 1, t, t + 2);
+			text += o.MovedLineBreaks && t % 2 == 0 ? " " : "\n";
+		}
+		if( o.MovedLineBreaks && triangles % 2 == 1 )
+			text += "\n";
+
+		if( o.Skinned )
+			AppendSkeleton(text, o);
+
+		if( o.Truncate )
+			text.resize(text.size() - text.size() / 8);
+
+		return text;
+	}
+
+	inline bool Write(const std::string& filename, const Options& o)
+	{
+		FILE* file = std::fopen(filename.c_str(), "wb");
+		if( file == nullptr )
+			return false;
+
+		std::string text = Make(o);
+		bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+		return std::fclose(file) == 0 && ok;
+	}
+}
@@ -0,0 +1,129 @@
+#include "TestFramework.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+std::atomic<size_t> gAllocationCount{ 0 };
+
+void* operator new(std::size_t size)
+{
+	++gAllocationCount;
+
+	void* p = std::malloc(size > 0 ? size : 1);
+	if( p == nullptr )
+		throw std::bad_alloc();
+
+	return p;
+}
+
+// The standard library takes temporary buffers, as for stable_sort, with
+// the nothrow form; they count too and are freed by the delete below.
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	++gAllocationCount;
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+	struct RegisteredTest
+	{
+		const char* Name;
+		TestRegistry::TestFunction Run;
+	};
+
+	// Function-local so registration works whatever order the test files
+	// are initialized in.
+	std::vector<RegisteredTest>& GetTests()
+	{
+		static std::vector<RegisteredTest> tests;
+		return tests;
+	}
+
+	std::vector<RegisteredTest>& GetBenchmarks()
+	{
+		static std::vector<RegisteredTest> benchmarks;
+		return benchmarks;
+	}
+
+	int gFailedChecks = 0;
+}
+
+void TestRegistry::Add(const char* name, TestFunction test)
+{
+	GetTests().push_back({ name, test });
+}
+
+void TestRegistry::AddBenchmark(const char* name, TestFunction benchmark)
+{
+	GetBenchmarks().push_back({ name, benchmark });
+}
+
+void TestRegistry::Fail(const char* file, int line, const char* expression)
+{
+	std::printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	++gFailedChecks;
+}
+
+int TestRegistry::RunAll()
+{
+	int failedTests = 0;
+
+	for(const RegisteredTest& test : GetTests())
+	{
+		std::printf("[ RUN  ] %s\n", test.Name);
+
+		int failedBefore = gFailedChecks;
+		test.Run();
+
+		bool passed = gFailedChecks == failedBefore;
+		if( !passed )
+			++failedTests;
+
+		std::printf("[ %s ] %s\n", passed ? " OK " : "FAIL", test.Name);
+	}
+
+	std::printf("%d of %d tests failed\n", failedTests, (int)GetTests().size());
+
+	return failedTests;
+}
+
+void TestRegistry::RunBenchmarks(const char* filter)
+{
+	for(const RegisteredTest& benchmark : GetBenchmarks())
+	{
+		if( std::strstr(benchmark.Name, filter) == nullptr )
+			continue;
+
+		std::printf("[ BENCH ] %s\n", benchmark.Name);
+		benchmark.Run();
+	}
+}
+
+void TestRegistry::Report(const char* what, double value, const char* unit)
+{
+	std::printf("  %-48s %12.3f %s\n", what, value, unit);
+}
+
+int main(int argc, char** argv)
+{
+	if( argc > 1 && std::strcmp(argv[1], "--bench") == 0 )
+	{
+		TestRegistry::RunBenchmarks(argc > 2 ? argv[2] : "");
+		return EXIT_SUCCESS;
+	}
+
+	return TestRegistry::RunAll() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
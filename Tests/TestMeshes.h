@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../Init_Direct3D/D3dHeader.h"
+#include "../Common/GeometryGenerator.h"
+
+///<summary>
+/// Turns GeometryGenerator output into the app's vertex format, so the mesh
+/// tests can run on generated shapes instead of model files.  Every field is
+/// copied; offset moves the positions, for tests that want the mesh away
+/// from the origin.
+///</summary>
+namespace TestMeshes
+{
+	inline std::vector<Vertex> ToVertices(const GeometryGenerator::MeshData& mesh,
+		const DirectX::XMFLOAT3& offset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f))
+	{
+		std::vector<Vertex> vertices(mesh.Vertices.size());
+		for(size_t i = 0; i < vertices.size(); ++i)
+		{
+			const GeometryGenerator::Vertex& src = mesh.Vertices[i];
+			vertices[i].Pos = DirectX::XMFLOAT3(src.Position.x + offset.x, src.Position.y + offset.y, src.Position.z + offset.z);
+			vertices[i].Normal = src.Normal;
+			vertices[i].Tangent = src.TangentU;
+			vertices[i].Uv = src.TexC;
+		}
+		return vertices;
+	}
+}
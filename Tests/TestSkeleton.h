@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../Init_Direct3D/SkinnedData.h"
+
+///<summary>
+/// A made-up skeleton for the animation tests, so they need no model file.
+/// The bones form a binary tree (bone i hangs off bone (i-1)/2), giving a
+/// mix of inner and leaf bones.  Every bone bends about its own axis and
+/// bobs along z, with keys spaced evenly over the clip.
+///
+/// "Walk" and "Run" differ in length and phase, so blending them does not
+/// reduce to one clip.
+///</summary>
+namespace TestSkeleton
+{
+	inline BoneAnimation MakeTrack(UINT bone, UINT keyCount, float endTime, float phase)
+	{
+		BoneAnimation track;
+		track.Keyframes.resize(keyCount);
+
+		DirectX::XMVECTOR axis = DirectX::XMVector3Normalize(
+			DirectX::XMVectorSet(1.0f, (float)(bone % 3), (float)(bone % 5) - 2.0f, 0.0f));
+
+		for(UINT k = 0; k < keyCount; ++k)
+		{
+			float t = endTime * k / (keyCount - 1);
+			float angle = 0.6f * sinf(DirectX::XM_2PI * t / endTime + phase + bone);
+
+			Keyframe& key = track.Keyframes[k];
+			key.TimePos = t;
+			key.Translation = DirectX::XMFLOAT3(0.0f, bone == 0 ? 0.0f : 1.0f, 0.1f * cosf(angle));
+			key.Scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+			DirectX::XMStoreFloat4(&key.RotationQuat, DirectX::XMQuaternionRotationAxis(axis, angle));
+		}
+
+		return track;
+	}
+
+	inline bool Build(SkinnedData& skinned, UINT boneCount, UINT keyCount = 31)
+	{
+		std::vector<int> hierarchy(boneCount);
+		std::vector<DirectX::XMFLOAT4X4> offsets(boneCount, MathHelper::Identity4x4());
+		std::unordered_map<std::string, AnimationClip> clips;
+
+		for(UINT i = 0; i < boneCount; ++i)
+			hierarchy[i] = i == 0 ? -1 : (int)(i - 1) / 2;
+
+		for(UINT i = 0; i < boneCount; ++i)
+		{
+			clips["Walk"].BoneAnimations.push_back(MakeTrack(i, keyCount, 1.0f, 0.0f));
+			clips["Run"].BoneAnimations.push_back(MakeTrack(i, keyCount, 0.7f, 1.3f));
+		}
+
+		return skinned.Set(hierarchy, offsets, clips);
+	}
+
+	// Largest difference between matching elements.
+	inline float MaxDifference(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		float maxDiff = 0.0f;
+		for(int r = 0; r < 4; ++r)
+			for(int c = 0; c < 4; ++c)
+				maxDiff = MathHelper::Max(maxDiff, fabsf(a.m[r][c] - b.m[r][c]));
+		return maxDiff;
+	}
+
+	inline float MaxDifference(const std::vector<DirectX::XMFLOAT4X4>& a, const std::vector<DirectX::XMFLOAT4X4>& b)
+	{
+		float maxDiff = 0.0f;
+		for(size_t i = 0; i < a.size(); ++i)
+			maxDiff = MathHelper::Max(maxDiff, MaxDifference(a[i], b[i]));
+		return maxDiff;
+	}
+}
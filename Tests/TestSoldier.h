@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../Init_Direct3D/LoadM3d.h"
+#include <cstdio>
+
+///<summary>
+/// Loads the demo's soldier.m3d for the benchmarks.  The path is relative
+/// to the project directory, where Visual Studio starts the test binary.
+/// A missing file prints a note and returns false, so a benchmark can skip
+/// rather than fail.
+///</summary>
+namespace TestSoldier
+{
+	const char* const Filename = "../Models/soldier.m3d";
+
+	inline bool Load(std::vector<M3DLoader::SkinnedVertex>& vertices, std::vector<USHORT>& indices,
+		SkinnedData& skinInfo)
+	{
+		std::vector<M3DLoader::Subset> subsets;
+		std::vector<M3DLoader::M3dMaterial> mats;
+
+		M3DLoader loader;
+		if( !loader.LoadM3d(Filename, vertices, indices, subsets, mats, skinInfo) )
+		{
+			std::printf("  %s did not load, skipped\n", Filename);
+			return false;
+		}
+		return true;
+	}
+
+	inline bool Load(SkinnedData& skinInfo)
+	{
+		std::vector<M3DLoader::SkinnedVertex> vertices;
+		std::vector<USHORT> indices;
+		return Load(vertices, indices, skinInfo);
+	}
+}
@@ -0,0 +1,211 @@
+#include "TestFramework.h"
+#include "../Init_Direct3D/VertexCompression.h"
+#include "TestMeshes.h"
+#include <random>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+using TestMeshes::ToVertices;
+
+namespace
+{
+	// 16 bit SNORM octahedral directions are good to a few thousandths of
+	// a degree.  MeasureError takes the angle with acosf, which cannot tell
+	// apart angles below a few hundredths of a degree, so its stats get
+	// the looser bound.
+	const float MaxDirectionDegrees = 0.006f;
+	const float MaxMeasuredDirectionDegrees = 0.06f;
+
+	// Halves hold [0,1] UVs to half of 2^-11.
+	const float MaxUvError = 0.5f / 2048.0f;
+
+	// Three weights rounded to 1/255, at most one of them pulled down a
+	// step; the implied fourth takes the sum of their errors.
+	const float MaxWeightError = 1.5f / 255.0f + 1e-6f;
+
+	// Half a quantization step on every axis of the mesh bounds.
+	float MaxPositionError(const VertexCompression::PositionDequant& dequant)
+	{
+		XMVECTOR halfStep = XMVectorScale(XMLoadFloat3(&dequant.Scale), 0.5f / 65535.0f);
+		return XMVectorGetX(XMVector3Length(halfStep)) * 1.01f + 1e-6f;
+	}
+
+	void CheckStaticMesh(const GeometryGenerator::MeshData& mesh, const XMFLOAT3& offset)
+	{
+		std::vector<Vertex> vertices = ToVertices(mesh, offset);
+		std::vector<VertexCompression::PackedVertex> packed;
+		VertexCompression::PositionDequant dequant;
+
+		VertexCompression::Compress(vertices, packed, dequant);
+		CHECK(packed.size() == vertices.size());
+
+		VertexCompression::ErrorStats stats = VertexCompression::MeasureError(vertices, packed, dequant);
+
+		CHECK(stats.MaxPosition <= MaxPositionError(dequant));
+		CHECK(stats.MaxNormalDegrees <= MaxMeasuredDirectionDegrees);
+		CHECK(stats.MaxTangentDegrees <= MaxMeasuredDirectionDegrees);
+		CHECK(stats.MaxUv <= MaxUvError);
+	}
+}
+
+TEST_CASE(PackedVertexSizes)
+{
+	CHECK(sizeof(VertexCompression::PackedVertex) == 20);
+	CHECK(sizeof(VertexCompression::PackedSkinnedVertex) == 32);
+}
+
+TEST_CASE(StaticMeshesReconstructWithinBounds)
+{
+	GeometryGenerator geoGen;
+
+	CheckStaticMesh(geoGen.CreateSphere(0.5f, 40, 40), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	CheckStaticMesh(geoGen.CreateGeosphere(3.0f, 4), XMFLOAT3(10.0f, -4.0f, 2.5f));
+	CheckStaticMesh(geoGen.CreateBox(2.0f, 3.0f, 4.0f, 2), XMFLOAT3(-100.0f, 0.0f, 50.0f));
+	CheckStaticMesh(geoGen.CreateCylinder(1.0f, 0.5f, 6.0f, 32, 8), XMFLOAT3(0.0f, 3.0f, 0.0f));
+}
+
+TEST_CASE(FlatMeshKeepsItsPlane)
+{
+	// The grid has no extent in y, so that axis has no range to quantize.
+	GeometryGenerator geoGen;
+	std::vector<Vertex> vertices = ToVertices(geoGen.CreateGrid(20.0f, 30.0f, 16, 16), XMFLOAT3(0.0f, 1.5f, 0.0f));
+
+	std::vector<VertexCompression::PackedVertex> packed;
+	VertexCompression::PositionDequant dequant;
+	VertexCompression::Compress(vertices, packed, dequant);
+
+	CHECK(dequant.Scale.y == 0.0f);
+
+	bool onPlane = true;
+	for(const auto& p : packed)
+		onPlane = onPlane && VertexCompression::DecodePosition(p.Pos, dequant).y == 1.5f;
+	CHECK(onPlane);
+
+	VertexCompression::ErrorStats stats = VertexCompression::MeasureError(vertices, packed, dequant);
+	CHECK(stats.MaxPosition <= MaxPositionError(dequant));
+}
+
+TEST_CASE(OctahedralDirectionsWithinBound)
+{
+	std::vector<XMFLOAT3> directions;
+
+	// Axes and diagonals sit on the folds and corners of the octahedron.
+	for(int x = -1; x <= 1; ++x)
+		for(int y = -1; y <= 1; ++y)
+			for(int z = -1; z <= 1; ++z)
+				if( x != 0 || y != 0 || z != 0 )
+					directions.push_back(XMFLOAT3((float)x, (float)y, (float)z));
+
+	std::mt19937 rng(21);
+	std::normal_distribution<float> gauss;
+	for(int i = 0; i < 20000; ++i)
+		directions.push_back(XMFLOAT3(gauss(rng), gauss(rng), gauss(rng)));
+
+	float maxDegrees = 0.0f;
+	for(const XMFLOAT3& d : directions)
+	{
+		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&d));
+		XMFLOAT3 decoded = VertexCompression::DecodeOctahedral(VertexCompression::EncodeOctahedral(d));
+		XMVECTOR m = XMLoadFloat3(&decoded);
+
+		// atan2 of sine and cosine stays accurate for tiny angles.
+		float sinAngle = XMVectorGetX(XMVector3Length(XMVector3Cross(n, m)));
+		float cosAngle = XMVectorGetX(XMVector3Dot(n, m));
+		maxDegrees = MathHelper::Max(maxDegrees, XMConvertToDegrees(atan2f(sinAngle, cosAngle)));
+
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(m)), 1.0f, 1e-5f);
+	}
+
+	CHECK(maxDegrees <= MaxDirectionDegrees);
+}
+
+TEST_CASE(BoneWeightsStayNormalized)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	float maxError = 0.0f;
+	bool fitsInOne = true;
+	bool neverNegative = true;
+
+	for(int i = 0; i < 20000; ++i)
+	{
+		// Up to four influences, some of them zero, summing to one.
+		float w[4];
+		float sum = 0.0f;
+		for(int j = 0; j < 4; ++j)
+		{
+			w[j] = (i + j) % 3 == 0 ? 0.0f : unit(rng);
+			sum += w[j];
+		}
+		if( sum == 0.0f )
+		{
+			w[0] = 1.0f;
+			sum = 1.0f;
+		}
+		for(int j = 0; j < 4; ++j)
+			w[j] /= sum;
+
+		XMUBYTEN4 encoded = VertexCompression::EncodeWeights(XMFLOAT3(w[0], w[1], w[2]));
+		XMFLOAT4 decoded = VertexCompression::DecodeWeights(encoded);
+		const float d[4] = { decoded.x, decoded.y, decoded.z, decoded.w };
+
+		// The stored three never add up past one, so the fourth is only
+		// ever negative by the float rounding of 1 - x - y - z.
+		fitsInOne = fitsInOne && encoded.x + encoded.y + encoded.z <= 255;
+
+		for(int j = 0; j < 4; ++j)
+		{
+			maxError = MathHelper::Max(maxError, fabsf(d[j] - w[j]));
+			neverNegative = neverNegative && d[j] >= -1e-6f;
+		}
+	}
+
+	CHECK(fitsInOne);
+	CHECK(neverNegative);
+	CHECK(maxError <= MaxWeightError);
+}
+
+TEST_CASE(SkinnedVerticesReconstructWithinBounds)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 24, 12);
+
+	std::mt19937 rng(8);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<M3DLoader::SkinnedVertex> vertices(mesh.Vertices.size());
+	for(size_t i = 0; i < vertices.size(); ++i)
+	{
+		M3DLoader::SkinnedVertex& v = vertices[i];
+		v.Pos = mesh.Vertices[i].Position;
+		v.Normal = mesh.Vertices[i].Normal;
+		v.TangentU = mesh.Vertices[i].TangentU;
+		v.TexC = mesh.Vertices[i].TexC;
+
+		float a = unit(rng);
+		float b = unit(rng) * (1.0f - a);
+		v.BoneWeights = XMFLOAT3(a, b, (1.0f - a - b) * unit(rng));
+		for(int j = 0; j < 4; ++j)
+			v.BoneIndices[j] = (USHORT)((i + j * 7) % 60);
+	}
+
+	std::vector<VertexCompression::PackedSkinnedVertex> packed;
+	VertexCompression::PositionDequant dequant;
+	VertexCompression::Compress(vertices, packed, dequant);
+	CHECK(packed.size() == vertices.size());
+
+	VertexCompression::ErrorStats stats = VertexCompression::MeasureError(vertices, packed, dequant);
+
+	CHECK(stats.MaxPosition <= MaxPositionError(dequant));
+	CHECK(stats.MaxNormalDegrees <= MaxMeasuredDirectionDegrees);
+	CHECK(stats.MaxTangentDegrees <= MaxMeasuredDirectionDegrees);
+	CHECK(stats.MaxUv <= MaxUvError);
+	CHECK(stats.MaxWeight <= MaxWeightError);
+
+	bool sameIndices = true;
+	for(size_t i = 0; i < vertices.size(); ++i)
+		for(int j = 0; j < 4; ++j)
+			sameIndices = sameIndices && packed[i].BoneIndices[j] == vertices[i].BoneIndices[j];
+	CHECK(sameIndices);
+}